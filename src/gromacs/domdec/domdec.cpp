@@ -89,6 +89,7 @@
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pulling/pull.h"
+#include "gromacs/timing/timelinetracer.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/topology/block.h"
 #include "gromacs/topology/idef.h"
@@ -259,66 +260,113 @@ void dd_get_constraint_range(const gmx_domdec_t& dd, int* at_start, int* at_end)
     *at_end   = dd.comm->atomRanges.end(DDAtomRanges::Type::Constraints);
 }
 
-void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
+/*! \brief Copies the coordinates to send in pulse \p ind along dimension index \p d to a buffer
+ *
+ * Applies the periodic shift, and rotation with screw PBC, when needed.
+ */
+static void packCoordinateHalo(const gmx_domdec_t&            dd,
+                               const matrix                   box,
+                               int                            d,
+                               const gmx_domdec_ind_t&        ind,
+                               gmx::ArrayRef<const gmx::RVec> x,
+                               gmx::ArrayRef<gmx::RVec>       sendBuffer)
 {
-    wallcycle_start(wcycle, WallCycleCounter::MoveX);
+    const bool bPBC   = (dd.ci[dd.dim[d]] == 0);
+    const bool bScrew = (bPBC && dd.unitCellInfo.haveScrewPBC && dd.dim[d] == XX);
 
     rvec shift = { 0, 0, 0 };
+    if (bPBC)
+    {
+        copy_rvec(box[dd.dim[d]], shift);
+    }
+
+    int n = 0;
+    if (!bPBC)
+    {
+        for (int j : ind.index)
+        {
+            sendBuffer[n] = x[j];
+            n++;
+        }
+    }
+    else if (!bScrew)
+    {
+        for (int j : ind.index)
+        {
+            /* We need to shift the coordinates */
+            for (int d = 0; d < DIM; d++)
+            {
+                sendBuffer[n][d] = x[j][d] + shift[d];
+            }
+            n++;
+        }
+    }
+    else
+    {
+        for (int j : ind.index)
+        {
+            /* Shift x */
+            sendBuffer[n][XX] = x[j][XX] + shift[XX];
+            /* Rotate y and z.
+             * This operation requires a special shift force
+             * treatment, which is performed in calc_vir.
+             */
+            sendBuffer[n][YY] = box[YY][YY] - x[j][YY];
+            sendBuffer[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
+            n++;
+        }
+    }
+}
+
+/*! \brief Copies the coordinates received in pulse \p ind from \p receiveBuffer to \p x
+ *
+ * Only needed when we do not receive in place.
+ */
+static void unpackCoordinateHalo(const gmx_domdec_ind_t&        ind,
+                                 int                            nzone,
+                                 gmx::ArrayRef<const gmx::RVec> receiveBuffer,
+                                 gmx::ArrayRef<gmx::RVec>       x)
+{
+    int j = 0;
+    for (int zone = 0; zone < nzone; zone++)
+    {
+        for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
+        {
+            x[i] = receiveBuffer[j++];
+        }
+    }
+}
 
+/*! \brief Communicates the coordinates to the neighboring cells
+ *
+ * When \p skipFirstPulse is true, the first pulse should have been
+ * communicated already by dd_move_x_start() and dd_move_x_finish().
+ */
+static void communicateCoordinateHalo(gmx_domdec_t*            dd,
+                                      const matrix             box,
+                                      gmx::ArrayRef<gmx::RVec> x,
+                                      bool                     skipFirstPulse)
+{
     gmx_domdec_comm_t* comm = dd->comm;
 
     int nzone   = 1;
     int nat_tot = comm->atomRanges.numHomeAtoms();
     for (int d = 0; d < dd->ndim; d++)
     {
-        const bool bPBC   = (dd->ci[dd->dim[d]] == 0);
-        const bool bScrew = (bPBC && dd->unitCellInfo.haveScrewPBC && dd->dim[d] == XX);
-        if (bPBC)
-        {
-            copy_rvec(box[dd->dim[d]], shift);
-        }
         gmx_domdec_comm_dim_t* cd = &comm->cd[d];
-        for (const gmx_domdec_ind_t& ind : cd->ind)
+        for (int p = 0; p < cd->numPulses(); p++)
         {
-            DDBufferAccess<gmx::RVec> sendBufferAccess(comm->rvecBuffer, ind.nsend[nzone + 1]);
-            gmx::ArrayRef<gmx::RVec>& sendBuffer = sendBufferAccess.buffer;
-            int                       n          = 0;
-            if (!bPBC)
-            {
-                for (int j : ind.index)
-                {
-                    sendBuffer[n] = x[j];
-                    n++;
-                }
-            }
-            else if (!bScrew)
-            {
-                for (int j : ind.index)
-                {
-                    /* We need to shift the coordinates */
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        sendBuffer[n][d] = x[j][d] + shift[d];
-                    }
-                    n++;
-                }
-            }
-            else
+            const gmx_domdec_ind_t& ind = cd->ind[p];
+            if (skipFirstPulse && d == 0 && p == 0)
             {
-                for (int j : ind.index)
-                {
-                    /* Shift x */
-                    sendBuffer[n][XX] = x[j][XX] + shift[XX];
-                    /* Rotate y and z.
-                     * This operation requires a special shift force
-                     * treatment, which is performed in calc_vir.
-                     */
-                    sendBuffer[n][YY] = box[YY][YY] - x[j][YY];
-                    sendBuffer[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
-                    n++;
-                }
+                nat_tot += ind.nrecv[nzone + 1];
+                continue;
             }
 
+            DDBufferAccess<gmx::RVec> sendBufferAccess(comm->rvecBuffer, ind.nsend[nzone + 1]);
+            gmx::ArrayRef<gmx::RVec>& sendBuffer = sendBufferAccess.buffer;
+            packCoordinateHalo(*dd, box, d, ind, x, sendBuffer);
+
             DDBufferAccess<gmx::RVec> receiveBufferAccess(
                     comm->rvecBuffer2, cd->receiveInPlace ? 0 : ind.nrecv[nzone + 1]);
 
@@ -332,60 +380,217 @@ void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, g
                 receiveBuffer = receiveBufferAccess.buffer;
             }
             /* Send and receive the coordinates */
-            ddSendrecv(dd, d, dddirBackward, sendBuffer, receiveBuffer);
+            {
+                gmx::TimelineEventScope timelineEvent(dd->timelineTracer.get(),
+                                                      gmx::TimelineEventType::HaloCoordinatesComm,
+                                                      d,
+                                                      p);
+                ddSendrecv(dd, d, dddirBackward, sendBuffer, receiveBuffer);
+            }
 
             if (!cd->receiveInPlace)
             {
-                int j = 0;
-                for (int zone = 0; zone < nzone; zone++)
-                {
-                    for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
-                    {
-                        x[i] = receiveBuffer[j++];
-                    }
-                }
+                unpackCoordinateHalo(ind, nzone, receiveBuffer, x);
             }
             nat_tot += ind.nrecv[nzone + 1];
         }
         nzone += nzone;
     }
+}
+
+void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
+{
+    wallcycle_start(wcycle, WallCycleCounter::MoveX);
+
+    communicateCoordinateHalo(dd, box, x, false);
 
     wallcycle_stop(wcycle, WallCycleCounter::MoveX);
 }
 
-void dd_move_f(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces, gmx_wallcycle* wcycle)
+void dd_move_x_start(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
 {
-    wallcycle_start(wcycle, WallCycleCounter::MoveF);
+    wallcycle_start(wcycle, WallCycleCounter::MoveX);
+
+    gmx_domdec_comm_t&      comm  = *dd->comm;
+    DDNonblockingHaloPulse& pulse = comm.nonblockingCoordinateHalo;
+    GMX_ASSERT(!pulse.isInFlight, "Only one coordinate halo communication can be in flight");
+
+    /* The first pulse only sends home atoms, so it does not depend on other pulses */
+    const gmx_domdec_comm_dim_t& cd           = comm.cd[0];
+    const gmx_domdec_ind_t&      ind          = cd.ind[0];
+    const int                    nzone        = 1;
+    const int                    numToReceive = ind.nrecv[nzone + 1];
+    const int                    numHomeAtoms = comm.atomRanges.numHomeAtoms();
+
+    pulse.sendBuffer.resize(ind.nsend[nzone + 1]);
+    packCoordinateHalo(*dd, box, 0, ind, x, pulse.sendBuffer);
+
+    if (cd.receiveInPlace)
+    {
+        pulse.receiveView = gmx::arrayRefFromArray(x.data() + numHomeAtoms, numToReceive);
+    }
+    else
+    {
+        pulse.receiveBuffer.resize(numToReceive);
+        pulse.receiveView = pulse.receiveBuffer;
+    }
+
+    pulse.numRequests = ddIsendrecv(
+            dd, 0, dddirBackward, pulse.sendBuffer, pulse.receiveView, pulse.requests.data());
+    pulse.isInFlight = true;
+
+    wallcycle_stop(wcycle, WallCycleCounter::MoveX);
+}
+
+void dd_move_x_finish(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
+{
+    wallcycle_start_nocount(wcycle, WallCycleCounter::MoveX);
+
+    gmx_domdec_comm_t&      comm  = *dd->comm;
+    DDNonblockingHaloPulse& pulse = comm.nonblockingCoordinateHalo;
+    GMX_ASSERT(pulse.isInFlight, "dd_move_x_start() should be called before dd_move_x_finish()");
+
+    {
+        gmx::TimelineEventScope timelineEvent(
+                dd->timelineTracer.get(), gmx::TimelineEventType::HaloCoordinatesComm, 0, 0);
+        ddWaitSendrecv(pulse.numRequests, pulse.requests.data());
+    }
+    pulse.isInFlight = false;
+
+    if (!comm.cd[0].receiveInPlace)
+    {
+        unpackCoordinateHalo(comm.cd[0].ind[0], 1, pulse.receiveView, x);
+    }
+
+    communicateCoordinateHalo(dd, box, x, true);
 
+    wallcycle_stop(wcycle, WallCycleCounter::MoveX);
+}
+
+/*! \brief Copies the forces on the atoms received in pulse \p ind from \p f to \p sendBuffer
+ *
+ * Only needed when we do not communicate in place.
+ */
+static void packForceHalo(const gmx_domdec_ind_t&        ind,
+                          int                            nzone,
+                          gmx::ArrayRef<const gmx::RVec> f,
+                          gmx::ArrayRef<gmx::RVec>       sendBuffer)
+{
+    int j = 0;
+    for (int zone = 0; zone < nzone; zone++)
+    {
+        for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
+        {
+            sendBuffer[j++] = f[i];
+        }
+    }
+}
+
+/*! \brief Adds the forces received in pulse \p ind along dimension index \p d to the local forces
+ *
+ * Also adds the received forces to the shift forces, when these are required.
+ */
+static void reduceForceHalo(const gmx_domdec_t&            dd,
+                            int                            d,
+                            const gmx_domdec_ind_t&        ind,
+                            gmx::ArrayRef<const gmx::RVec> receiveBuffer,
+                            gmx::ForceWithShiftForces*     forceWithShiftForces)
+{
     gmx::ArrayRef<gmx::RVec> f      = forceWithShiftForces->force();
     gmx::ArrayRef<gmx::RVec> fshift = forceWithShiftForces->shiftForces();
 
+    /* Only forces in domains near the PBC boundaries need to
+       consider PBC in the treatment of fshift */
+    const bool shiftForcesNeedPbc =
+            (forceWithShiftForces->computeVirial() && dd.ci[dd.dim[d]] == 0);
+    const bool applyScrewPbc =
+            (shiftForcesNeedPbc && dd.unitCellInfo.haveScrewPBC && dd.dim[d] == XX);
+    /* Determine which shift vector we need */
+    ivec vis       = { 0, 0, 0 };
+    vis[dd.dim[d]] = 1;
+    const int is   = gmx::ivecToShiftIndex(vis);
+
+    int n = 0;
+    if (!shiftForcesNeedPbc)
+    {
+        for (int j : ind.index)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                f[j][d] += receiveBuffer[n][d];
+            }
+            n++;
+        }
+    }
+    else if (!applyScrewPbc)
+    {
+        for (int j : ind.index)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                f[j][d] += receiveBuffer[n][d];
+            }
+            /* Add this force to the shift force */
+            for (int d = 0; d < DIM; d++)
+            {
+                fshift[is][d] += receiveBuffer[n][d];
+            }
+            n++;
+        }
+    }
+    else
+    {
+        for (int j : ind.index)
+        {
+            /* Rotate the force */
+            f[j][XX] += receiveBuffer[n][XX];
+            f[j][YY] -= receiveBuffer[n][YY];
+            f[j][ZZ] -= receiveBuffer[n][ZZ];
+            if (shiftForcesNeedPbc)
+            {
+                /* Add this force to the shift force */
+                for (int d = 0; d < DIM; d++)
+                {
+                    fshift[is][d] += receiveBuffer[n][d];
+                }
+            }
+            n++;
+        }
+    }
+}
+
+/*! \brief Sums the forces over the neighboring cells
+ *
+ * When \p skipFirstPulse is true, the first pulse should have been
+ * communicated already by dd_move_f_start() and dd_move_f_finish().
+ */
+static void communicateForceHalo(gmx_domdec_t*              dd,
+                                 gmx::ForceWithShiftForces* forceWithShiftForces,
+                                 bool                       skipFirstPulse)
+{
+    gmx::ArrayRef<gmx::RVec> f = forceWithShiftForces->force();
+
     gmx_domdec_comm_t& comm    = *dd->comm;
     int                nzone   = comm.zones.n / 2;
     int                nat_tot = comm.atomRanges.end(DDAtomRanges::Type::Zones);
     for (int d = dd->ndim - 1; d >= 0; d--)
     {
-        /* Only forces in domains near the PBC boundaries need to
-           consider PBC in the treatment of fshift */
-        const bool shiftForcesNeedPbc =
-                (forceWithShiftForces->computeVirial() && dd->ci[dd->dim[d]] == 0);
-        const bool applyScrewPbc =
-                (shiftForcesNeedPbc && dd->unitCellInfo.haveScrewPBC && dd->dim[d] == XX);
-        /* Determine which shift vector we need */
-        ivec vis        = { 0, 0, 0 };
-        vis[dd->dim[d]] = 1;
-        const int is    = gmx::ivecToShiftIndex(vis);
-
         /* Loop over the pulses */
         const gmx_domdec_comm_dim_t& cd = comm.cd[d];
         for (int p = cd.numPulses() - 1; p >= 0; p--)
         {
-            const gmx_domdec_ind_t&   ind = cd.ind[p];
-            DDBufferAccess<gmx::RVec> receiveBufferAccess(comm.rvecBuffer, ind.nsend[nzone + 1]);
-            gmx::ArrayRef<gmx::RVec>& receiveBuffer = receiveBufferAccess.buffer;
+            const gmx_domdec_ind_t& ind = cd.ind[p];
 
             nat_tot -= ind.nrecv[nzone + 1];
 
+            if (skipFirstPulse && d == dd->ndim - 1 && p == cd.numPulses() - 1)
+            {
+                continue;
+            }
+
+            DDBufferAccess<gmx::RVec> receiveBufferAccess(comm.rvecBuffer, ind.nsend[nzone + 1]);
+            gmx::ArrayRef<gmx::RVec>& receiveBuffer = receiveBufferAccess.buffer;
+
             DDBufferAccess<gmx::RVec> sendBufferAccess(
                     comm.rvecBuffer2, cd.receiveInPlace ? 0 : ind.nrecv[nzone + 1]);
 
@@ -397,68 +602,99 @@ void dd_move_f(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces
             else
             {
                 sendBuffer = sendBufferAccess.buffer;
-                int j      = 0;
-                for (int zone = 0; zone < nzone; zone++)
-                {
-                    for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
-                    {
-                        sendBuffer[j++] = f[i];
-                    }
-                }
+                packForceHalo(ind, nzone, f, sendBuffer);
             }
             /* Communicate the forces */
-            ddSendrecv(dd, d, dddirForward, sendBuffer, receiveBuffer);
-            /* Add the received forces */
-            int n = 0;
-            if (!shiftForcesNeedPbc)
             {
-                for (int j : ind.index)
-                {
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        f[j][d] += receiveBuffer[n][d];
-                    }
-                    n++;
-                }
-            }
-            else if (!applyScrewPbc)
-            {
-                for (int j : ind.index)
-                {
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        f[j][d] += receiveBuffer[n][d];
-                    }
-                    /* Add this force to the shift force */
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        fshift[is][d] += receiveBuffer[n][d];
-                    }
-                    n++;
-                }
-            }
-            else
-            {
-                for (int j : ind.index)
-                {
-                    /* Rotate the force */
-                    f[j][XX] += receiveBuffer[n][XX];
-                    f[j][YY] -= receiveBuffer[n][YY];
-                    f[j][ZZ] -= receiveBuffer[n][ZZ];
-                    if (shiftForcesNeedPbc)
-                    {
-                        /* Add this force to the shift force */
-                        for (int d = 0; d < DIM; d++)
-                        {
-                            fshift[is][d] += receiveBuffer[n][d];
-                        }
-                    }
-                    n++;
-                }
+                gmx::TimelineEventScope timelineEvent(
+                        dd->timelineTracer.get(), gmx::TimelineEventType::HaloForcesComm, d, p);
+                ddSendrecv(dd, d, dddirForward, sendBuffer, receiveBuffer);
             }
+            /* Add the received forces */
+            gmx::TimelineEventScope timelineEvent(
+                    dd->timelineTracer.get(), gmx::TimelineEventType::HaloForcesReduction, d, p);
+            reduceForceHalo(*dd, d, ind, receiveBuffer, forceWithShiftForces);
         }
         nzone /= 2;
     }
+}
+
+void dd_move_f(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces, gmx_wallcycle* wcycle)
+{
+    wallcycle_start(wcycle, WallCycleCounter::MoveF);
+
+    communicateForceHalo(dd, forceWithShiftForces, false);
+
+    wallcycle_stop(wcycle, WallCycleCounter::MoveF);
+}
+
+void dd_move_f_start(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces, gmx_wallcycle* wcycle)
+{
+    wallcycle_start(wcycle, WallCycleCounter::MoveF);
+
+    gmx_domdec_comm_t&      comm  = *dd->comm;
+    DDNonblockingHaloPulse& pulse = comm.nonblockingForceHalo;
+    GMX_ASSERT(!pulse.isInFlight, "Only one force halo communication can be in flight");
+
+    /* The force pulses run in reverse order. The first force pulse sends
+     * the forces on the atoms received in the last coordinate pulse,
+     * which do not receive contributions from other pulses.
+     */
+    gmx::ArrayRef<gmx::RVec>     f         = forceWithShiftForces->force();
+    const int                    d         = dd->ndim - 1;
+    const gmx_domdec_comm_dim_t& cd        = comm.cd[d];
+    const gmx_domdec_ind_t&      ind       = cd.ind[cd.numPulses() - 1];
+    const int                    nzone     = comm.zones.n / 2;
+    const int                    numToSend = ind.nrecv[nzone + 1];
+
+    gmx::ArrayRef<gmx::RVec> sendBuffer;
+    if (cd.receiveInPlace)
+    {
+        const int nat_tot = comm.atomRanges.end(DDAtomRanges::Type::Zones) - numToSend;
+        sendBuffer        = gmx::arrayRefFromArray(f.data() + nat_tot, numToSend);
+    }
+    else
+    {
+        pulse.sendBuffer.resize(numToSend);
+        sendBuffer = pulse.sendBuffer;
+        packForceHalo(ind, nzone, f, sendBuffer);
+    }
+    pulse.receiveBuffer.resize(ind.nsend[nzone + 1]);
+    pulse.receiveView = pulse.receiveBuffer;
+
+    pulse.numRequests = ddIsendrecv(
+            dd, d, dddirForward, sendBuffer, pulse.receiveView, pulse.requests.data());
+    pulse.isInFlight = true;
+
+    wallcycle_stop(wcycle, WallCycleCounter::MoveF);
+}
+
+void dd_move_f_finish(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces, gmx_wallcycle* wcycle)
+{
+    wallcycle_start_nocount(wcycle, WallCycleCounter::MoveF);
+
+    gmx_domdec_comm_t&      comm  = *dd->comm;
+    DDNonblockingHaloPulse& pulse = comm.nonblockingForceHalo;
+    GMX_ASSERT(pulse.isInFlight, "dd_move_f_start() should be called before dd_move_f_finish()");
+
+    const int                    d  = dd->ndim - 1;
+    const gmx_domdec_comm_dim_t& cd = comm.cd[d];
+    const int                    p  = cd.numPulses() - 1;
+    {
+        gmx::TimelineEventScope timelineEvent(
+                dd->timelineTracer.get(), gmx::TimelineEventType::HaloForcesComm, d, p);
+        ddWaitSendrecv(pulse.numRequests, pulse.requests.data());
+    }
+    pulse.isInFlight = false;
+
+    {
+        gmx::TimelineEventScope timelineEvent(
+                dd->timelineTracer.get(), gmx::TimelineEventType::HaloForcesReduction, d, p);
+        reduceForceHalo(*dd, d, cd.ind[p], pulse.receiveView, forceWithShiftForces);
+    }
+
+    communicateForceHalo(dd, forceWithShiftForces, true);
+
     wallcycle_stop(wcycle, WallCycleCounter::MoveF);
 }
 
@@ -983,6 +1219,11 @@ bool ddUsesUpdateGroups(const gmx_domdec_t& dd)
     return dd.comm->systemInfo.useUpdateGroups;
 }
 
+bool ddOverlapsCpuHaloCommunication(const gmx_domdec_t& dd)
+{
+    return dd.comm->ddSettings.overlapCpuHaloCommunication;
+}
+
 void dd_cycles_add(const gmx_domdec_t* dd, float cycles, int ddCycl)
 {
     /* Note that the cycles value can be incorrect, either 0 or some
@@ -2785,6 +3026,12 @@ static DDSettings getDDSettings(const gmx::MDLogger&     mdlog,
     ddSettings.nstDDDumpGrid       = dd_getenv(mdlog, "GMX_DD_NST_DUMP_GRID", 0);
     ddSettings.DD_debug            = dd_getenv(mdlog, "GMX_DD_DEBUG", 0);
 
+    ddSettings.useIncrementalLocalTopology =
+            (dd_getenv(mdlog, "GMX_DD_NO_INCREMENTAL_TOP", 0) == 0);
+    ddSettings.timelineTraceMaxNumEvents = dd_getenv(mdlog, "GMX_DD_TIMELINE_TRACE", 0);
+    ddSettings.overlapCpuHaloCommunication =
+            (dd_getenv(mdlog, "GMX_DD_NO_CPU_HALO_OVERLAP", 0) == 0);
+
     if (ddSettings.useSendRecv2)
     {
         GMX_LOG(mdlog.info)
@@ -3017,6 +3264,23 @@ gmx_domdec_t* DomainDecompositionBuilder::Impl::build(LocalAtomSetManager* atomS
     dd->localTopologyChecker = std::make_unique<LocalTopologyChecker>(
             mdlog_, cr_, mtop_, dd->comm->systemInfo.useUpdateGroups);
 
+    if (thisRankHasDuty(cr_, DUTY_PP) && ddSettings_.timelineTraceMaxNumEvents > 0)
+    {
+        dd->timelineTracer =
+                std::make_unique<TimelineTracer>(ddSettings_.timelineTraceMaxNumEvents);
+#if GMX_MPI
+        /* Synchronize the PP ranks so the time origins of the timelines match */
+        MPI_Barrier(dd->mpi_comm_all);
+#endif
+        dd->timelineTracer->setOrigin();
+        GMX_LOG(mdlog_.info)
+                .appendTextFormatted(
+                        "Will record a timeline of up to %d communication events per PP rank "
+                        "and write it to %s",
+                        ddSettings_.timelineTraceMaxNumEvents,
+                        c_ddTimelineTraceFileName);
+    }
+
     return dd;
 }
 
@@ -200,6 +200,34 @@ void dd_move_x(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVe
  */
 void dd_move_f(struct gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces, gmx_wallcycle* wcycle);
 
+/*! \brief Returns whether to overlap halo communication with local work in CPU-only runs */
+bool ddOverlapsCpuHaloCommunication(const gmx_domdec_t& dd);
+
+/*! \brief Posts the first pulse of the coordinate communication with non-blocking calls
+ *
+ * Work that does not use non-local coordinates can be done before
+ * calling dd_move_x_finish(), which completes the communication.
+ */
+void dd_move_x_start(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle);
+
+/*! \brief Completes the coordinate communication started by dd_move_x_start() */
+void dd_move_x_finish(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle);
+
+/*! \brief Posts the first pulse of the force communication with non-blocking calls
+ *
+ * Work that only adds forces on home atoms can be done before
+ * calling dd_move_f_finish(), which completes the communication.
+ * Forces on non-local atoms should not be modified in between.
+ */
+void dd_move_f_start(struct gmx_domdec_t*       dd,
+                     gmx::ForceWithShiftForces* forceWithShiftForces,
+                     gmx_wallcycle*             wcycle);
+
+/*! \brief Completes the force communication started by dd_move_f_start() */
+void dd_move_f_finish(struct gmx_domdec_t*       dd,
+                      gmx::ForceWithShiftForces* forceWithShiftForces,
+                      gmx_wallcycle*             wcycle);
+
 /*! \brief Communicate a real for each atom to the neighboring cells. */
 void dd_atom_spread_real(struct gmx_domdec_t* dd, real v[]);
 
@@ -178,6 +178,17 @@ typedef struct gmx_cgsort
     int ind = 0;
 } gmx_cgsort_t;
 
+/*! \brief A contiguous range of home atoms that is moved as a whole when sorting */
+struct DDHomeAtomBlock
+{
+    /**< The local index of the first atom before sorting */
+    int source = 0;
+    /**< The local index of the first atom after sorting */
+    int destination = 0;
+    /**< The number of atoms */
+    int size = 0;
+};
+
 /*! \brief Temporary buffers for sorting atoms */
 typedef struct gmx_domdec_sort
 {
@@ -187,6 +198,12 @@ typedef struct gmx_domdec_sort
     std::vector<gmx_cgsort_t> stationary;
     /**< Array of moved atom/charge group indices */
     std::vector<gmx_cgsort_t> moved;
+    /**< Start of each grid column in the nbnxm atom order, including fillers */
+    std::vector<int> columnStarts;
+    /**< Blocks of atoms of unchanged grid columns that shift position */
+    std::vector<DDHomeAtomBlock> blocks;
+    /**< Indices of the sorted entries of changed grid columns that are moved one by one */
+    std::vector<int> movedIndices;
     /**< Integer buffer for sorting */
     std::vector<int> intBuffer;
     /**< Int64 buffer for sorting */
@@ -404,6 +421,28 @@ public:
     gmx::ArrayRef<T> buffer; /**< The access to the memory buffer */
 };
 
+/*! \brief Storage for a halo communication pulse that is posted with non-blocking MPI calls
+ *
+ * This is used to overlap the first pulse of the coordinate and force
+ * halo exchange with local computation. The buffers can not be DDBuffer
+ * objects, as those only provide scoped access.
+ */
+struct DDNonblockingHaloPulse
+{
+    //! Whether communication has been posted, but has not been completed yet
+    bool isInFlight = false;
+    //! Buffer for the data to send, not used for forces with in-place communication
+    std::vector<gmx::RVec> sendBuffer;
+    //! Buffer for the data to receive, not used for coordinates with in-place communication
+    std::vector<gmx::RVec> receiveBuffer;
+    //! View of the data to receive, either \p receiveBuffer or part of the local state
+    gmx::ArrayRef<gmx::RVec> receiveView;
+    //! The MPI requests for the receive and the send
+    std::array<MPI_Request, 2> requests;
+    //! The number of requests posted
+    int numRequests = 0;
+};
+
 /*! \brief Temporary buffer for setting up communiation over one pulse and all zones in the halo */
 struct dd_comm_setup_work_t
 {
@@ -484,6 +523,15 @@ struct DDSettings
     //! Whether we should record the load
     bool recordLoad = false;
 
+    //! Whether to reuse home-zone interaction assignments when making the local topology
+    bool useIncrementalLocalTopology = true;
+
+    //! The maximum number of communication timeline events to record per rank, 0: no tracing
+    int timelineTraceMaxNumEvents = 0;
+
+    //! Whether to overlap the first halo communication pulse with local work in CPU-only runs
+    bool overlapCpuHaloCommunication = true;
+
     /* Debugging */
     //! Step interval for dumping the local+non-local atoms to pdb
     int nstDDDump = 0;
@@ -663,6 +711,11 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
     /**< Another rvec comm. buffer */
     DDBuffer<gmx::RVec> rvecBuffer2;
 
+    /**< Communication state for the first coordinate halo pulse overlapping with local work */
+    DDNonblockingHaloPulse nonblockingCoordinateHalo;
+    /**< Communication state for the first force halo pulse overlapping with local work */
+    DDNonblockingHaloPulse nonblockingForceHalo;
+
     /* Communication buffers for local redistribution */
     /**< Charge group flag comm. buffers */
     std::array<std::vector<int>, DIM * 2> cggl_flag;
@@ -799,6 +852,9 @@ static constexpr double DD_CELL_MARGIN2 = 1.00005;
 /*! \brief With pressure scaling, keep cell sizes 2% above the limit to allow for some scaling */
 static constexpr double DD_PRES_SCALE_MARGIN = 1.02;
 
+/*! \brief The name of the file the communication timeline trace is written to */
+static constexpr char c_ddTimelineTraceFileName[] = "ddtimeline.json";
+
 /*! \endcond */
 
 #endif
@@ -145,6 +145,53 @@ template void ddSendrecv(const gmx_domdec_t*, int, int, gmx::ArrayRef<real>, gmx
 //! Specialization of extern template for gmx::RVec
 template void ddSendrecv(const gmx_domdec_t*, int, int, gmx::ArrayRef<gmx::RVec>, gmx::ArrayRef<gmx::RVec>);
 
+int ddIsendrecv(const gmx_domdec_t gmx_unused* dd,
+                int gmx_unused                      ddDimensionIndex,
+                int gmx_unused                      direction,
+                gmx::ArrayRef<gmx::RVec> gmx_unused sendBuffer,
+                gmx::ArrayRef<gmx::RVec> gmx_unused receiveBuffer,
+                MPI_Request gmx_unused* requests)
+{
+    int numRequests = 0;
+#if GMX_MPI
+    int sendRank    = dd->neighbor[ddDimensionIndex][direction == dddirForward ? 0 : 1];
+    int receiveRank = dd->neighbor[ddDimensionIndex][direction == dddirForward ? 1 : 0];
+
+    constexpr int mpiTag = 0;
+    if (!receiveBuffer.empty())
+    {
+        MPI_Irecv(receiveBuffer.data(),
+                  receiveBuffer.size() * sizeof(gmx::RVec),
+                  MPI_BYTE,
+                  receiveRank,
+                  mpiTag,
+                  dd->mpi_comm_all,
+                  &requests[numRequests++]);
+    }
+    if (!sendBuffer.empty())
+    {
+        MPI_Isend(sendBuffer.data(),
+                  sendBuffer.size() * sizeof(gmx::RVec),
+                  MPI_BYTE,
+                  sendRank,
+                  mpiTag,
+                  dd->mpi_comm_all,
+                  &requests[numRequests++]);
+    }
+#endif
+    return numRequests;
+}
+
+void ddWaitSendrecv(int gmx_unused numRequests, MPI_Request gmx_unused* requests)
+{
+#if GMX_MPI
+    if (numRequests > 0)
+    {
+        MPI_Waitall(numRequests, requests, MPI_STATUSES_IGNORE);
+    }
+#endif
+}
+
 void dd_sendrecv2_rvec(const struct gmx_domdec_t gmx_unused* dd,
                        int gmx_unused                        ddimind,
                        rvec gmx_unused* buf_s_fw,
@@ -80,6 +80,7 @@ class HashedMap;
 class LocalAtomSetManager;
 class LocalTopologyChecker;
 class GpuHaloExchange;
+class TimelineTracer;
 } // namespace gmx
 
 /*! \internal
@@ -242,6 +243,9 @@ struct gmx_domdec_t
 
     /* GPU halo exchange objects: this structure supports a vector of pulses for each dimension */
     std::vector<std::unique_ptr<gmx::GpuHaloExchange>> gpuHaloExchange[DIM];
+
+    /* Timeline tracer for communication events, only set when requested */
+    std::unique_ptr<gmx::TimelineTracer> timelineTracer;
 };
 
 //! Are we the master node for domain decomposition
@@ -593,10 +593,202 @@ static inline int assignPositionRestraintsForAtom(const int                atomI
     return numBondedInteractions;
 }
 
+/*! \brief Record the home-zone interactions of home atom \p atomIndex for reuse
+ *
+ * Interactions linked to this atom can be reused at the next partitioning
+ * when they have all been assigned to this domain and they only involve
+ * home atoms. Then, as long as all atoms involved remain home atoms,
+ * the assignment is independent of the zone setup.
+ *
+ * \returns whether the interactions of this atom can be reused
+ */
+static bool recordHomeInteractionsForAtom(const int                globalAtomIndex,
+                                          const int                atomIndexInMolecule,
+                                          gmx::ArrayRef<const int> rtil,
+                                          const int                ind_start,
+                                          const int                ind_end,
+                                          const gmx_ga2la_t&       ga2la,
+                                          const bool               checkDistanceTwoBody,
+                                          const real               cutoffSquared,
+                                          const t_pbc*             pbc_null,
+                                          ArrayRef<const RVec>     coordinates,
+                                          const DDBondedChecking   ddBondedChecking,
+                                          std::vector<int>*        homeInteractions,
+                                          int*                     numBondedInteractions)
+{
+    *numBondedInteractions = 0;
+
+    int j = ind_start;
+    while (j < ind_end)
+    {
+        const int      ftype  = rtil[j++];
+        const t_iatom* iatoms = rtil.data() + j;
+        const int      nral   = NRAL(ftype);
+        j += 1 + nral_rt(ftype);
+
+        /* Position restraints are assigned separately */
+        if (ftype == F_POSRES || ftype == F_FBPOSRES)
+        {
+            continue;
+        }
+
+        homeInteractions->push_back(ftype);
+        homeInteractions->push_back(iatoms[0]);
+        for (int k = 1; k <= nral; k++)
+        {
+            const int  k_gl      = globalAtomIndex + iatoms[k] - atomIndexInMolecule;
+            const int* homeIndex = ga2la.findHome(k_gl);
+            if (homeIndex == nullptr)
+            {
+                return false;
+            }
+            homeInteractions->push_back(*homeIndex);
+        }
+
+        const bool isVsite = ((interaction_function[ftype].flags & IF_VSITE) != 0U);
+        if (!isVsite)
+        {
+            if (nral == 2 && checkDistanceTwoBody)
+            {
+                const int* atoms = homeInteractions->data() + homeInteractions->size() - 2;
+                if (dd_dist2(pbc_null, coordinates, atoms[0], atoms[1]) >= cutoffSquared)
+                {
+                    /* This interaction was not assigned here */
+                    return false;
+                }
+            }
+            if (ddBondedChecking == DDBondedChecking::All
+                || !(interaction_function[ftype].flags & IF_LIMZERO))
+            {
+                (*numBondedInteractions)++;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*! \brief Try to assign the interactions stored at the previous partitioning for a home atom
+ *
+ * The interactions in \p cachedInteractions use the home atom indices of
+ * the previous partitioning, \p previousToCurrent maps these to the current ones.
+ * Nothing is assigned when any atom involved is no longer a home atom or
+ * when a two-body interaction no longer passes the distance check.
+ *
+ * \returns whether the cached interactions have been assigned
+ */
+static bool reuseHomeInteractionsForAtom(ArrayRef<const int>     cachedInteractions,
+                                         ArrayRef<const int>     previousToCurrent,
+                                         const bool              checkDistanceTwoBody,
+                                         const real              cutoffSquared,
+                                         const t_pbc*            pbc_null,
+                                         ArrayRef<const RVec>    coordinates,
+                                         InteractionDefinitions* idef,
+                                         std::vector<int>*       homeInteractions)
+{
+    /* First check that all interactions can be reused, so we never assign partially */
+    for (gmx::index j = 0; j < cachedInteractions.ssize();)
+    {
+        const int ftype = cachedInteractions[j];
+        const int nral  = NRAL(ftype);
+        for (int k = 1; k <= nral; k++)
+        {
+            if (previousToCurrent[cachedInteractions[j + 1 + k]] < 0)
+            {
+                return false;
+            }
+        }
+        if (nral == 2 && checkDistanceTwoBody && !(interaction_function[ftype].flags & IF_VSITE)
+            && dd_dist2(pbc_null,
+                        coordinates,
+                        previousToCurrent[cachedInteractions[j + 2]],
+                        previousToCurrent[cachedInteractions[j + 3]])
+                       >= cutoffSquared)
+        {
+            return false;
+        }
+        j += 2 + nral;
+    }
+
+    for (gmx::index j = 0; j < cachedInteractions.ssize();)
+    {
+        t_iatom tiatoms[1 + MAXATOMLIST];
+
+        const int ftype = cachedInteractions[j];
+        const int nral  = NRAL(ftype);
+        tiatoms[0]      = cachedInteractions[j + 1];
+        for (int k = 1; k <= nral; k++)
+        {
+            tiatoms[k] = previousToCurrent[cachedInteractions[j + 1 + k]];
+        }
+        idef->il[ftype].push_back(tiatoms[0], nral, tiatoms + 1);
+
+        homeInteractions->push_back(ftype);
+        homeInteractions->insert(homeInteractions->end(), tiatoms, tiatoms + 1 + nral);
+
+        j += 2 + nral;
+    }
+
+    return true;
+}
+
+/*! \brief Prepare \p cache for assigning the home-zone interactions at a new partitioning
+ *
+ * Determines the mapping between the home atoms of the previous and the current
+ * partitioning and moves the interactions recorded by each thread to the previous buffers.
+ */
+static void prepareHomeInteractionCache(HomeInteractionCache*   cache,
+                                        const gmx_ga2la_t&      ga2la,
+                                        const int               numHomeAtoms,
+                                        ArrayRef<thread_work_t> threadWorkObjects)
+{
+    for (thread_work_t& threadWork : threadWorkObjects)
+    {
+        std::swap(threadWork.homeInteractions, threadWork.previousHomeInteractions);
+        threadWork.homeInteractions.clear();
+    }
+
+    cache->currentToPrevious.assign(numHomeAtoms, -1);
+    if (cache->isValid)
+    {
+        const int numPreviousHomeAtoms = cache->globalAtomIndices.size();
+        cache->previousToCurrent.resize(numPreviousHomeAtoms);
+        const int numThreads = threadWorkObjects.size();
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+        for (int a = 0; a < numPreviousHomeAtoms; a++)
+        {
+            const int* homeIndex = ga2la.findHome(cache->globalAtomIndices[a]);
+            if (homeIndex)
+            {
+                cache->previousToCurrent[a]          = *homeIndex;
+                cache->currentToPrevious[*homeIndex] = a;
+            }
+            else
+            {
+                cache->previousToCurrent[a] = -1;
+            }
+        }
+    }
+    cache->newAtoms.assign(numHomeAtoms, CachedHomeAtomInteractions());
+}
+
+/*! \brief Store the home atom cache entries generated for the current partitioning */
+static void finishHomeInteractionCache(HomeInteractionCache* cache,
+                                       ArrayRef<const int>   homeAtomGlobalIndices)
+{
+    std::swap(cache->atoms, cache->newAtoms);
+    cache->globalAtomIndices.assign(homeAtomGlobalIndices.begin(), homeAtomGlobalIndices.end());
+    cache->isValid = true;
+}
+
 /*! \brief This function looks up and assigns bonded interactions for zone iz.
  *
  * With thread parallelizing each thread acts on a different atom range:
  * at_start to at_end.
+ *
+ * When \p homeInteractionCache is not nullptr, which is only allowed for
+ * the home zone, interactions of home atoms are reused from the previous
+ * partitioning when possible and the assignments are recorded for reuse.
  */
 static int make_bondeds_zone(gmx_reverse_top_t*                 rt,
                              ArrayRef<const int>                globalAtomIndices,
@@ -612,7 +804,9 @@ static int make_bondeds_zone(gmx_reverse_top_t*                 rt,
                              const t_iparams*                   ip_in,
                              InteractionDefinitions*            idef,
                              int                                izone,
-                             const gmx::Range<int>&             atomRange)
+                             const gmx::Range<int>&             atomRange,
+                             HomeInteractionCache*              homeInteractionCache,
+                             int                                thread)
 {
     int mb                  = 0;
     int mt                  = 0;
@@ -623,6 +817,10 @@ static int make_bondeds_zone(gmx_reverse_top_t*                 rt,
 
     int numBondedInteractions = 0;
 
+    ArrayRef<thread_work_t> threadWorkObjects = rt->threadWorkObjects();
+    std::vector<int>*       homeInteractions =
+            (homeInteractionCache ? &threadWorkObjects[thread].homeInteractions : nullptr);
+
     for (int i : atomRange)
     {
         /* Get the global atom number */
@@ -633,25 +831,87 @@ static int make_bondeds_zone(gmx_reverse_top_t*                 rt,
         gmx::ArrayRef<const int>     index = rt->interactionListForMoleculeType(mt).index;
         gmx::ArrayRef<const t_iatom> rtil  = rt->interactionListForMoleculeType(mt).il;
 
-        numBondedInteractions += assignInteractionsForAtom<InteractionConnectivity::Intramolecular>(
-                i,
-                globalAtomIndex,
-                atomIndexInMolecule,
-                index,
-                rtil,
-                index[atomIndexInMolecule],
-                index[atomIndexInMolecule + 1],
-                ga2la,
-                zones,
-                checkDistanceMultiBody,
-                rcheck,
-                checkDistanceTwoBody,
-                cutoffSquared,
-                pbc_null,
-                coordinates,
-                idef,
-                izone,
-                ddBondedChecking);
+        /* Try to reuse the assignments of the previous partitioning */
+        const int previousIndex =
+                (homeInteractionCache ? homeInteractionCache->currentToPrevious[i] : -1);
+        bool haveReusedInteractions = false;
+        if (previousIndex >= 0 && homeInteractionCache->atoms[previousIndex].thread >= 0)
+        {
+            const CachedHomeAtomInteractions& cached = homeInteractionCache->atoms[previousIndex];
+            const std::vector<int>& previousHomeInteractions =
+                    threadWorkObjects[cached.thread].previousHomeInteractions;
+
+            const int start        = homeInteractions->size();
+            haveReusedInteractions = reuseHomeInteractionsForAtom(
+                    gmx::constArrayRefFromArray(previousHomeInteractions.data() + cached.start,
+                                                cached.end - cached.start),
+                    homeInteractionCache->previousToCurrent,
+                    checkDistanceTwoBody,
+                    cutoffSquared,
+                    pbc_null,
+                    coordinates,
+                    idef,
+                    homeInteractions);
+            if (haveReusedInteractions)
+            {
+                homeInteractionCache->newAtoms[i] = {
+                    thread, start, int(homeInteractions->size()), cached.numBondedInteractions
+                };
+                numBondedInteractions += cached.numBondedInteractions;
+            }
+        }
+
+        if (!haveReusedInteractions)
+        {
+            numBondedInteractions +=
+                    assignInteractionsForAtom<InteractionConnectivity::Intramolecular>(
+                            i,
+                            globalAtomIndex,
+                            atomIndexInMolecule,
+                            index,
+                            rtil,
+                            index[atomIndexInMolecule],
+                            index[atomIndexInMolecule + 1],
+                            ga2la,
+                            zones,
+                            checkDistanceMultiBody,
+                            rcheck,
+                            checkDistanceTwoBody,
+                            cutoffSquared,
+                            pbc_null,
+                            coordinates,
+                            idef,
+                            izone,
+                            ddBondedChecking);
+        }
+
+        if (homeInteractionCache && !haveReusedInteractions)
+        {
+            const int start                        = homeInteractions->size();
+            int       numBondedInteractionsForAtom = 0;
+            if (recordHomeInteractionsForAtom(globalAtomIndex,
+                                              atomIndexInMolecule,
+                                              rtil,
+                                              index[atomIndexInMolecule],
+                                              index[atomIndexInMolecule + 1],
+                                              ga2la,
+                                              checkDistanceTwoBody,
+                                              cutoffSquared,
+                                              pbc_null,
+                                              coordinates,
+                                              ddBondedChecking,
+                                              homeInteractions,
+                                              &numBondedInteractionsForAtom))
+            {
+                homeInteractionCache->newAtoms[i] = {
+                    thread, start, int(homeInteractions->size()), numBondedInteractionsForAtom
+                };
+            }
+            else
+            {
+                homeInteractions->resize(start);
+            }
+        }
 
         // Assign position restraints, when present, for the home zone
         if (izone == 0 && rt->hasPositionRestraints())
@@ -812,6 +1072,19 @@ static int make_local_bondeds_excls(gmx_domdec_t*           dd,
 
     const real cutoffSquared = gmx::square(cutoff);
 
+    /* Home-zone interactions can be reused between partitionings, except for
+     * intermolecular interactions which are not linked to molecule types.
+     */
+    const bool useHomeInteractionCache = (dd->comm->ddSettings.useIncrementalLocalTopology
+                                          && !rt->hasIntermolecularInteractions());
+    HomeInteractionCache* homeInteractionCache =
+            (useHomeInteractionCache ? rt->homeInteractionCache() : nullptr);
+    if (homeInteractionCache)
+    {
+        prepareHomeInteractionCache(
+                homeInteractionCache, *dd->ga2la, zones->cg_range[1], rt->threadWorkObjects());
+    }
+
     /* Clear the counts */
     idef->clear();
     int numBondedInteractions = 0;
@@ -860,7 +1133,9 @@ static int make_local_bondeds_excls(gmx_domdec_t*           dd,
                                           idef->iparams.data(),
                                           idef_t,
                                           izone,
-                                          gmx::Range<int>(cg0t, cg1t));
+                                          gmx::Range<int>(cg0t, cg1t),
+                                          izone == 0 ? homeInteractionCache : nullptr,
+                                          thread);
 
                 if (izone < numIZonesForExclusions)
                 {
@@ -894,6 +1169,13 @@ static int make_local_bondeds_excls(gmx_domdec_t*           dd,
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
 
+        if (izone == 0 && homeInteractionCache)
+        {
+            ArrayRef<const int> homeAtomGlobalIndices =
+                    gmx::constArrayRefFromArray(dd->globalAtomIndices.data(), cg1);
+            finishHomeInteractionCache(homeInteractionCache, homeAtomGlobalIndices);
+        }
+
         if (threadWorkObjects.size() > 1)
         {
             combine_idef(idef, threadWorkObjects);
@@ -53,6 +53,7 @@
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/topology/topsort.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/smalloc.h"
@@ -132,6 +133,14 @@ void mdAlgorithmsSetupAtomData(const t_commrec*     cr,
         make_local_shells(cr, *mdatoms, shellfc);
     }
 
+    if (fr->sortBondedInteractionsByLocality)
+    {
+        /* Sort the bondeds so each thread gets interactions within a compact
+         * atom range, which reduces the number of force blocks to reduce.
+         */
+        gmx_sort_ilist_locality(&top->idef);
+    }
+
     for (auto& listedForces : fr->listedForces)
     {
         listedForces.setup(top->idef, fr->natoms_force, fr->listedForcesGpu != nullptr);
@@ -82,11 +82,13 @@
 #include "gromacs/mdtypes/state.h"
 #include "gromacs/nbnxm/nbnxm.h"
 #include "gromacs/pulling/pull.h"
+#include "gromacs/timing/timelinetracer.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/futil.h"
 #include "gromacs/utility/logger.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
@@ -103,6 +105,7 @@
 #include "domdec_vsite.h"
 #include "dump.h"
 #include "redistribute.h"
+#include "sortstate.h"
 #include "utility.h"
 
 /*! \brief Turn on DLB when the load imbalance causes this amount of total loss.
@@ -2500,62 +2503,33 @@ static void set_zones_size(gmx_domdec_t*      dd,
     }
 }
 
-/*! \brief Order data in \p dataToSort according to \p sort
+/*! \brief Returns the sorting order for atoms based on the nbnxn grid order in sort
  *
- * Note: both buffers should have at least \p sort.size() elements.
+ * Stores the grid column index of each atom in \c nsc.
  */
-template<typename T>
-static void orderVector(gmx::ArrayRef<const gmx_cgsort_t> sort,
-                        gmx::ArrayRef<T>                  dataToSort,
-                        gmx::ArrayRef<T>                  sortBuffer)
-{
-    GMX_ASSERT(dataToSort.size() >= sort.size(), "The vector needs to be sufficiently large");
-    GMX_ASSERT(sortBuffer.size() >= sort.size(),
-               "The sorting buffer needs to be sufficiently large");
-
-    /* Order the data into the temporary buffer */
-    size_t i = 0;
-    for (const gmx_cgsort_t& entry : sort)
-    {
-        sortBuffer[i++] = dataToSort[entry.ind];
-    }
-
-    /* Copy back to the original array */
-    std::copy(sortBuffer.begin(), sortBuffer.begin() + sort.size(), dataToSort.begin());
-}
-
-/*! \brief Order data in \p dataToSort according to \p sort
- *
- * Note: \p vectorToSort should have at least \p sort.size() elements,
- *       \p workVector is resized when it is too small.
- */
-template<typename T>
-static void orderVector(gmx::ArrayRef<const gmx_cgsort_t> sort,
-                        gmx::ArrayRef<T>                  vectorToSort,
-                        std::vector<T>*                   workVector)
-{
-    if (gmx::index(workVector->size()) < sort.ssize())
-    {
-        workVector->resize(sort.size());
-    }
-    orderVector<T>(sort, vectorToSort, *workVector);
-}
-
-//! Returns the sorting order for atoms based on the nbnxn grid order in sort
-static void dd_sort_order_nbnxn(const t_forcerec* fr, std::vector<gmx_cgsort_t>* sort)
+static void dd_sort_order_nbnxn(const t_forcerec*          fr,
+                                std::vector<int>*          columnStarts,
+                                std::vector<gmx_cgsort_t>* sort)
 {
     gmx::ArrayRef<const int> atomOrder = fr->nbv->getLocalAtomOrder();
+    fr->nbv->getLocalAtomOrderColumnStarts(columnStarts);
 
     /* Using push_back() instead of this resize results in much slower code */
     sort->resize(atomOrder.size());
-    gmx::ArrayRef<gmx_cgsort_t> buffer    = *sort;
-    size_t                      numSorted = 0;
-    for (int i : atomOrder)
+    gmx::ArrayRef<gmx_cgsort_t> buffer     = *sort;
+    size_t                      numSorted  = 0;
+    const int                   numColumns = columnStarts->size() - 1;
+    for (int column = 0; column < numColumns; column++)
     {
-        if (i >= 0)
+        for (int j = (*columnStarts)[column]; j < (*columnStarts)[column + 1]; j++)
         {
-            /* The values of nsc and ind_gl are not used in this case */
-            buffer[numSorted++].ind = i;
+            const int i = atomOrder[j];
+            if (i >= 0)
+            {
+                /* The value of ind_gl is not used in this case */
+                buffer[numSorted].nsc   = column;
+                buffer[numSorted++].ind = i;
+            }
         }
     }
     sort->resize(numSorted);
@@ -2566,10 +2540,7 @@ static void dd_sort_state(gmx_domdec_t* dd, t_forcerec* fr, t_state* state)
 {
     gmx_domdec_sort_t* sort = dd->comm->sort.get();
 
-    dd_sort_order_nbnxn(fr, &sort->sorted);
-
-    /* We alloc with the old size, since cgindex is still old */
-    DDBufferAccess<gmx::RVec> rvecBuffer(dd->comm->rvecBuffer, dd->numHomeAtoms);
+    dd_sort_order_nbnxn(fr, &sort->columnStarts, &sort->sorted);
 
     /* Set the new home atom/charge group count */
     dd->numHomeAtoms = sort->sorted.size();
@@ -2583,23 +2554,42 @@ static void dd_sort_state(gmx_domdec_t* dd, t_forcerec* fr, t_state* state)
     GMX_RELEASE_ASSERT(cgsort.ssize() == dd->numHomeAtoms,
                        "We should sort all the home atom groups");
 
-    if (state->flags & enumValueToBitMask(StateEntry::X))
-    {
-        orderVector(cgsort, makeArrayRef(state->x), rvecBuffer.buffer);
-    }
-    if (state->flags & enumValueToBitMask(StateEntry::V))
+    /* Grid columns that did not change since the previous sort are moved
+     * as blocks, or not at all, only the atoms of changed columns are moved
+     * one by one. Determine the moves once and use them for all vectors.
+     */
+    gmx::setHomeAtomMoves(cgsort, sort);
+    if (debug)
     {
-        orderVector(cgsort, makeArrayRef(state->v), rvecBuffer.buffer);
+        fprintf(debug,
+                "Moving %zu out of %d home atoms one by one and %zu blocks\n",
+                sort->movedIndices.size(),
+                dd->numHomeAtoms,
+                sort->blocks.size());
     }
-    if (state->flags & enumValueToBitMask(StateEntry::Cgp))
+
+    if (!sort->movedIndices.empty() || !sort->blocks.empty())
     {
-        orderVector(cgsort, makeArrayRef(state->cg_p), rvecBuffer.buffer);
-    }
+        DDBufferAccess<gmx::RVec> rvecBuffer(dd->comm->rvecBuffer, sort->movedIndices.size());
+
+        if (state->flags & enumValueToBitMask(StateEntry::X))
+        {
+            gmx::orderVector(cgsort, *sort, makeArrayRef(state->x), rvecBuffer.buffer);
+        }
+        if (state->flags & enumValueToBitMask(StateEntry::V))
+        {
+            gmx::orderVector(cgsort, *sort, makeArrayRef(state->v), rvecBuffer.buffer);
+        }
+        if (state->flags & enumValueToBitMask(StateEntry::Cgp))
+        {
+            gmx::orderVector(cgsort, *sort, makeArrayRef(state->cg_p), rvecBuffer.buffer);
+        }
 
-    /* Reorder the global cg index */
-    orderVector<int>(cgsort, dd->globalAtomGroupIndices, &sort->intBuffer);
-    /* Reorder the atom info */
-    orderVector<int64_t>(cgsort, fr->atomInfo, &sort->int64Buffer);
+        /* Reorder the global cg index */
+        gmx::orderVector<int>(cgsort, *sort, dd->globalAtomGroupIndices, &sort->intBuffer);
+        /* Reorder the atom info */
+        gmx::orderVector<int64_t>(cgsort, *sort, fr->atomInfo, &sort->int64Buffer);
+    }
     /* Set the home atom number */
     dd->comm->atomRanges.setEnd(DDAtomRanges::Type::Home, dd->numHomeAtoms);
 
@@ -2685,6 +2675,83 @@ bool check_grid_jump(int64_t step, const gmx_domdec_t* dd, real cutoff, const gm
     return invalid;
 }
 
+/*! \brief Collects the timeline traces of all PP ranks on the master and writes them to file
+ *
+ * The events of each rank use the DD rank as process id, so the viewer
+ * shows one timeline per rank.
+ */
+static void writeTimelineTrace(const gmx_domdec_t& dd, FILE* fplog)
+{
+    const std::string events = dd.timelineTracer->chromeTraceEvents(dd.rank);
+
+    /* Collect the size of the trace and the number of dropped events of each rank */
+    const int64_t localInfo[2] = { static_cast<int64_t>(events.size()),
+                                   dd.timelineTracer->numDroppedEvents() };
+    std::vector<int64_t> info(DDMASTER(dd) ? 2 * dd.nnodes : 0);
+    dd_gather(&dd, sizeof(localInfo), localInfo, info.data());
+
+    std::vector<int>  counts;
+    std::vector<int>  displacements;
+    std::vector<char> allEvents;
+    if (DDMASTER(dd))
+    {
+        int totalSize = 0;
+        for (int rank = 0; rank < dd.nnodes; rank++)
+        {
+            counts.push_back(info[2 * rank]);
+            displacements.push_back(totalSize);
+            totalSize += counts.back();
+        }
+        allEvents.resize(totalSize);
+    }
+    dd_gatherv(&dd,
+               events.size(),
+               events.data(),
+               counts.data(),
+               displacements.data(),
+               allEvents.data());
+
+    if (!DDMASTER(dd))
+    {
+        return;
+    }
+
+    FILE* fp = gmx_ffopen(c_ddTimelineTraceFileName, "w");
+    fprintf(fp, "[\n");
+    bool    haveWrittenEvents = false;
+    int64_t numDroppedEvents  = 0;
+    for (int rank = 0; rank < dd.nnodes; rank++)
+    {
+        if (counts[rank] > 0)
+        {
+            fprintf(fp,
+                    "%s%.*s",
+                    haveWrittenEvents ? ",\n" : "",
+                    counts[rank],
+                    allEvents.data() + displacements[rank]);
+            haveWrittenEvents = true;
+        }
+        numDroppedEvents += info[2 * rank + 1];
+    }
+    fprintf(fp, "\n]\n");
+    gmx_ffclose(fp);
+
+    if (fplog)
+    {
+        fprintf(fplog,
+                "\nWrote the communication timeline of all PP ranks to %s\n",
+                c_ddTimelineTraceFileName);
+        if (numDroppedEvents > 0)
+        {
+            fprintf(fplog,
+                    "NOTE: %" PRId64
+                    " events did not fit in the timeline buffers and were not recorded,\n"
+                    "      increase GMX_DD_TIMELINE_TRACE to record more events.\n",
+                    numDroppedEvents);
+        }
+    }
+}
+
 void print_dd_statistics(const t_commrec* cr, const t_inputrec& inputrec, FILE* fplog)
 {
     gmx_domdec_comm_t* comm = cr->dd->comm;
@@ -2692,6 +2759,11 @@ void print_dd_statistics(const t_commrec* cr, const t_inputrec& inputrec, FILE*
     const int numRanges = static_cast<int>(DDAtomRanges::Type::Number);
     gmx_sumd(numRanges, comm->sum_nat, cr);
 
+    if (cr->dd->timelineTracer)
+    {
+        writeTimelineTrace(*cr->dd, fplog);
+    }
+
     if (fplog == nullptr)
     {
         return;
@@ -2772,6 +2844,9 @@ void dd_partition_system(FILE*                     fplog,
     gmx_domdec_t*      dd   = cr->dd;
     gmx_domdec_comm_t* comm = dd->comm;
 
+    gmx::TimelineEventScope timelineEvent(dd->timelineTracer.get(),
+                                          gmx::TimelineEventType::Partition);
+
     // TODO if the update code becomes accessible here, use
     // upd->deform for this logic.
     bool bBoxChanged = (bMasterState || inputrecDeform(&inputrec));
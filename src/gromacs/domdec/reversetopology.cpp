@@ -100,6 +100,8 @@ struct gmx_reverse_top_t::Impl
     /* Work data structures for multi-threading */
     //! \brief Thread work array for local topology generation
     std::vector<thread_work_t> th_work;
+    //! \brief Home-zone interactions kept between partitionings
+    HomeInteractionCache homeInteractionCache;
     //! @endcond
 };
 
@@ -326,6 +328,11 @@ ArrayRef<thread_work_t> gmx_reverse_top_t::threadWorkObjects() const
     return impl_->th_work;
 }
 
+HomeInteractionCache* gmx_reverse_top_t::homeInteractionCache() const
+{
+    return &impl_->homeInteractionCache;
+}
+
 bool gmx_reverse_top_t::doListedForcesSorting() const
 {
     return impl_->doListedForcesSorting;
@@ -102,6 +102,50 @@ struct thread_work_t
     int numBondedInteractions               = 0; /**< The number of bonded interactions observed */
     gmx::ListOfLists<int> excl;                  /**< List of exclusions */
     int                   excl_count = 0;        /**< The total exclusion count for \p excl */
+    /*! \brief Home-zone interactions recorded by this thread at the current partitioning,
+     * stored as ftype|type|a0|...|an with home atom local indices */
+    std::vector<int> homeInteractions;
+    //! \brief The contents of \p homeInteractions at the previous partitioning
+    std::vector<int> previousHomeInteractions;
+};
+
+/*! \internal \brief Location of the cached home-zone interactions of a home atom */
+struct CachedHomeAtomInteractions
+{
+    //! The thread work object storing the interactions, -1 when nothing can be reused
+    int thread = -1;
+    //! Start index in the interaction buffer of the thread work object
+    int start = 0;
+    //! End index in the interaction buffer of the thread work object
+    int end = 0;
+    //! The number of bonded interactions to count for the assignment check
+    int numBondedInteractions = 0;
+};
+
+/*! \internal \brief Cache for incremental local topology updates
+ *
+ * Home atoms whose interactions only involve home atoms get all these
+ * interactions assigned to the home zone. When, after repartitioning,
+ * all atoms of such interactions are still home atoms, the assignment
+ * does not change and the interactions can be copied from the previous
+ * local topology with only a renumbering of the local atom indices.
+ * This avoids the reverse-topology traversal and global to local
+ * lookups for most home atoms.
+ */
+struct HomeInteractionCache
+{
+    //! Whether the cache contains data from a previous partitioning
+    bool isValid = false;
+    //! The global atom indices of the home atoms at the previous partitioning
+    std::vector<int> globalAtomIndices;
+    //! Cache entries for the home atoms of the previous partitioning
+    std::vector<CachedHomeAtomInteractions> atoms;
+    //! Cache entries being generated for the current home atoms
+    std::vector<CachedHomeAtomInteractions> newAtoms;
+    //! Current home atom index for each previous home atom, -1 when it is no longer home
+    std::vector<int> previousToCurrent;
+    //! Previous home atom index for each current home atom, -1 when it was not home
+    std::vector<int> currentToPrevious;
 };
 
 /*! \internal \brief Options for setting up gmx_reverse_top_t */
@@ -152,6 +196,8 @@ public:
     bool hasPositionRestraints() const;
     //! Returns the per-thread working structures for making the local topology
     gmx::ArrayRef<thread_work_t> threadWorkObjects() const;
+    //! Returns the cache of home-zone interactions for incremental local topology updates
+    HomeInteractionCache* homeInteractionCache() const;
     //! Returns whether the local topology listed-forces interactions should be sorted
     bool doListedForcesSorting() const;
 
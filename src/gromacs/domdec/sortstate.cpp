@@ -0,0 +1,175 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Defines functions for sorting the home atoms of the local
+ * state into the order of the nbnxm search grid.
+ *
+ * \ingroup module_domdec
+ */
+
+#include "gmxpre.h"
+
+#include "sortstate.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace gmx
+{
+
+/*! \brief Returns the indices of the longest sequence of \p blocks with increasing source
+ *
+ * Uses the O(N log N) patience sorting algorithm.
+ */
+static std::vector<int> longestIncreasingSourceSequence(ArrayRef<const DDHomeAtomBlock> blocks)
+{
+    /* The last block of the best sequence found of each length */
+    std::vector<int> tails;
+    /* The previous block in the sequence ending at each block */
+    std::vector<int> previous(blocks.size(), -1);
+    for (index b = 0; b < blocks.ssize(); b++)
+    {
+        const auto position = std::lower_bound(
+                tails.begin(), tails.end(), blocks[b].source, [blocks](int tail, int source) {
+                    return blocks[tail].source < source;
+                });
+        if (position != tails.begin())
+        {
+            previous[b] = *(position - 1);
+        }
+        if (position == tails.end())
+        {
+            tails.push_back(b);
+        }
+        else
+        {
+            *position = b;
+        }
+    }
+
+    std::vector<int> sequence(tails.size());
+    int              b = tails.empty() ? -1 : tails.back();
+    for (auto it = sequence.rbegin(); it != sequence.rend(); ++it)
+    {
+        *it = b;
+        b   = previous[b];
+    }
+
+    return sequence;
+}
+
+void setHomeAtomMoves(ArrayRef<const gmx_cgsort_t> sorted, gmx_domdec_sort_t* sort)
+{
+    std::vector<DDHomeAtomBlock>& blocks       = sort->blocks;
+    std::vector<int>&             movedIndices = sort->movedIndices;
+
+    blocks.clear();
+    movedIndices.clear();
+
+    /* Collect the columns with contiguous atom ranges that shift as block candidates */
+    const int numAtoms = sorted.ssize();
+    int       start    = 0;
+    while (start < numAtoms)
+    {
+        const int column       = sorted[start].nsc;
+        bool      isContiguous = true;
+        int       end          = start + 1;
+        while (end < numAtoms && sorted[end].nsc == column)
+        {
+            isContiguous = isContiguous && (sorted[end].ind == sorted[start].ind + end - start);
+            end++;
+        }
+
+        if (isContiguous)
+        {
+            /* Unchanged columns that do not shift stay in place */
+            if (sorted[start].ind != start)
+            {
+                blocks.push_back({ sorted[start].ind, start, end - start });
+            }
+        }
+        else
+        {
+            for (int i = start; i < end; i++)
+            {
+                if (sorted[i].ind != i)
+                {
+                    movedIndices.push_back(i);
+                }
+            }
+        }
+
+        start = end;
+    }
+
+    /* Blocks can only be moved in place when their order is the same in
+     * the source and the destination. This is normally the case, but the
+     * grid can change, or a column of only received atoms can have a source
+     * beyond the next columns. Keep the longest sequence of blocks with
+     * increasing source and move the atoms of the other blocks one by one.
+     */
+    const std::vector<int> keep = longestIncreasingSourceSequence(blocks);
+    size_t                 k    = 0;
+    int                    numKept = 0;
+    for (int b = 0; b < gmx::ssize(blocks); b++)
+    {
+        const DDHomeAtomBlock block = blocks[b];
+        if (k < keep.size() && keep[k] == b)
+        {
+            k++;
+            if (numKept > 0 && blocks[numKept - 1].source + blocks[numKept - 1].size == block.source
+                && blocks[numKept - 1].destination + blocks[numKept - 1].size == block.destination)
+            {
+                /* Merge with the previous block, since they shift by the same amount */
+                blocks[numKept - 1].size += block.size;
+            }
+            else
+            {
+                blocks[numKept++] = block;
+            }
+        }
+        else
+        {
+            for (int i = block.destination; i < block.destination + block.size; i++)
+            {
+                movedIndices.push_back(i);
+            }
+        }
+    }
+    blocks.resize(numKept);
+}
+
+} // namespace gmx
@@ -0,0 +1,147 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Declares functions for sorting the home atoms of the local
+ * state into the order of the nbnxm search grid.
+ *
+ * \ingroup module_domdec
+ */
+
+#ifndef GMX_DOMDEC_SORTSTATE_H
+#define GMX_DOMDEC_SORTSTATE_H
+
+#include <algorithm>
+#include <vector>
+
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/gmxassert.h"
+
+#include "domdec_internal.h"
+
+namespace gmx
+{
+
+/*! \brief Determines how to move the home atoms to the order given by \p sorted
+ *
+ * The entries of \p sorted should contain the grid column index in \c nsc
+ * and the current local atom index in \c ind. After the previous sort the
+ * home atoms were in grid order. Atoms that moved to another domain are
+ * not in \p sorted and received atoms have local indices beyond the old
+ * home atoms. So a grid column whose atoms have not changed since the
+ * previous sort has consecutive local indices. Such columns are moved as
+ * contiguous blocks and are not touched at all when they do not shift.
+ * Consecutive blocks with the same shift are merged. The atoms of the other
+ * columns, i.e. the columns with atoms that moved in, out or within the
+ * column, are moved one by one. So are the atoms of blocks that are out
+ * of order with respect to the other blocks, which can occur after the grid
+ * changed or for columns with only received atoms.
+ *
+ * Sets \p sort->blocks and \p sort->movedIndices.
+ */
+void setHomeAtomMoves(ArrayRef<const gmx_cgsort_t> sorted, gmx_domdec_sort_t* sort);
+
+/*! \brief Orders \p dataToSort according to \p sorted with the moves set by setHomeAtomMoves()
+ *
+ * Note: \p sortBuffer should have at least \p sort.movedIndices.size() elements.
+ */
+template<typename T>
+void orderVector(ArrayRef<const gmx_cgsort_t> sorted,
+                 const gmx_domdec_sort_t&     sort,
+                 ArrayRef<T>                  dataToSort,
+                 ArrayRef<T>                  sortBuffer)
+{
+    GMX_ASSERT(dataToSort.size() >= sorted.size(), "The vector needs to be sufficiently large");
+    GMX_ASSERT(sortBuffer.size() >= sort.movedIndices.size(),
+               "The sorting buffer needs to be sufficiently large");
+
+    /* Gather the atoms that are moved one by one before the blocks overwrite them */
+    size_t i = 0;
+    for (int index : sort.movedIndices)
+    {
+        sortBuffer[i++] = dataToSort[sorted[index].ind];
+    }
+
+    /* The blocks are ordered on both source and destination. So blocks
+     * shifting down can be moved in increasing order and blocks shifting
+     * up in decreasing order without overwriting data that is still needed.
+     */
+    for (const DDHomeAtomBlock& block : sort.blocks)
+    {
+        if (block.destination < block.source)
+        {
+            std::copy(dataToSort.begin() + block.source,
+                      dataToSort.begin() + block.source + block.size,
+                      dataToSort.begin() + block.destination);
+        }
+    }
+    for (auto block = sort.blocks.rbegin(); block != sort.blocks.rend(); ++block)
+    {
+        if (block->destination > block->source)
+        {
+            std::copy_backward(dataToSort.begin() + block->source,
+                               dataToSort.begin() + block->source + block->size,
+                               dataToSort.begin() + block->destination + block->size);
+        }
+    }
+
+    /* Scatter the atoms that are moved one by one to their sorted location */
+    i = 0;
+    for (int index : sort.movedIndices)
+    {
+        dataToSort[index] = sortBuffer[i++];
+    }
+}
+
+/*! \brief Orders \p vectorToSort according to \p sorted with the moves set by setHomeAtomMoves()
+ *
+ * Uses \p workVector as buffer and increases its size when needed.
+ */
+template<typename T>
+void orderVector(ArrayRef<const gmx_cgsort_t> sorted,
+                 const gmx_domdec_sort_t&     sort,
+                 ArrayRef<T>                  vectorToSort,
+                 std::vector<T>*              workVector)
+{
+    if (workVector->size() < sort.movedIndices.size())
+    {
+        workVector->resize(sort.movedIndices.size());
+    }
+    orderVector<T>(sorted, sort, vectorToSort, *workVector);
+}
+
+} // namespace gmx
+
+#endif
@@ -544,6 +544,12 @@ TEST(HaloExchangeTest, Coordinates1dHaloWith1Pulse)
     // Check results
     checkResults1dHaloWith1Pulse(h_x.data(), &dd, numHomeAtoms);
 
+    // Repeat with the first pulse communicated with non-blocking calls
+    initHaloData(h_x.data(), numHomeAtoms, numAtomsTotal);
+    dd_move_x_start(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    dd_move_x_finish(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    checkResults1dHaloWith1Pulse(h_x.data(), &dd, numHomeAtoms);
+
     if (GMX_GPU_CUDA && GMX_THREAD_MPI) // repeat with GPU halo codepath
     {
         // early return if no devices are available.
@@ -600,6 +606,12 @@ TEST(HaloExchangeTest, Coordinates1dHaloWith2Pulses)
     // Check results
     checkResults1dHaloWith2Pulses(h_x.data(), &dd, numHomeAtoms);
 
+    // Repeat with the first pulse communicated with non-blocking calls
+    initHaloData(h_x.data(), numHomeAtoms, numAtomsTotal);
+    dd_move_x_start(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    dd_move_x_finish(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    checkResults1dHaloWith2Pulses(h_x.data(), &dd, numHomeAtoms);
+
     if (GMX_GPU_CUDA && GMX_THREAD_MPI) // repeat with GPU halo codepath
     {
         // early return if no devices are available.
@@ -657,6 +669,12 @@ TEST(HaloExchangeTest, Coordinates2dHaloWith1PulseInEachDim)
     // Check results
     checkResults2dHaloWith1PulseInEachDim(h_x.data(), &dd, numHomeAtoms);
 
+    // Repeat with the first pulse communicated with non-blocking calls
+    initHaloData(h_x.data(), numHomeAtoms, numAtomsTotal);
+    dd_move_x_start(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    dd_move_x_finish(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    checkResults2dHaloWith1PulseInEachDim(h_x.data(), &dd, numHomeAtoms);
+
     if (GMX_GPU_CUDA && GMX_THREAD_MPI) // repeat with GPU halo codepath
     {
         // early return if no devices are available.
@@ -713,6 +731,12 @@ TEST(HaloExchangeTest, Coordinates2dHaloWith2PulsesInDim1)
     // Check results
     checkResults2dHaloWith2PulsesInDim1(h_x.data(), &dd, numHomeAtoms);
 
+    // Repeat with the first pulse communicated with non-blocking calls
+    initHaloData(h_x.data(), numHomeAtoms, numAtomsTotal);
+    dd_move_x_start(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    dd_move_x_finish(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    checkResults2dHaloWith2PulsesInDim1(h_x.data(), &dd, numHomeAtoms);
+
     if (GMX_GPU_CUDA && GMX_THREAD_MPI) // repeat with GPU halo codepath
     {
         // early return if no devices are available.
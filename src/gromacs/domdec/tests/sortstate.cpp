@@ -0,0 +1,260 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for sorting the home atoms of the local state into grid order.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include "gromacs/domdec/sortstate.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformintdistribution.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Returns the sort order for grid columns given as lists of current local atom indices
+std::vector<gmx_cgsort_t> makeSorted(const std::vector<std::vector<int>>& columns)
+{
+    std::vector<gmx_cgsort_t> sorted;
+    for (size_t c = 0; c < columns.size(); c++)
+    {
+        for (int index : columns[c])
+        {
+            gmx_cgsort_t entry;
+            entry.nsc = c;
+            entry.ind = index;
+            sorted.push_back(entry);
+        }
+    }
+
+    return sorted;
+}
+
+/*! \brief Sorts integer and RVec data with \p sorted and checks the result
+ *
+ * \p numLocalAtoms is the number of atoms before sorting, including
+ * atoms that moved out and atoms that moved in.
+ */
+void sortAndCheck(ArrayRef<const gmx_cgsort_t> sorted, int numLocalAtoms, gmx_domdec_sort_t* sort)
+{
+    setHomeAtomMoves(sorted, sort);
+
+    std::vector<int>  indices(numLocalAtoms);
+    std::vector<RVec> x(numLocalAtoms);
+    for (int i = 0; i < numLocalAtoms; i++)
+    {
+        indices[i] = i;
+        x[i]       = { 1.0_real * i, 2.0_real * i, -1.0_real * i };
+    }
+
+    std::vector<int> intBuffer;
+    orderVector<int>(sorted, *sort, indices, &intBuffer);
+    std::vector<RVec> rvecBuffer(sort->movedIndices.size());
+    orderVector<RVec>(sorted, *sort, x, rvecBuffer);
+
+    for (index i = 0; i < sorted.ssize(); i++)
+    {
+        EXPECT_EQ(indices[i], sorted[i].ind) << "for sorted entry " << i;
+        EXPECT_EQ(x[i][XX], 1.0_real * sorted[i].ind) << "for sorted entry " << i;
+        EXPECT_EQ(x[i][YY], 2.0_real * sorted[i].ind) << "for sorted entry " << i;
+        EXPECT_EQ(x[i][ZZ], -1.0_real * sorted[i].ind) << "for sorted entry " << i;
+    }
+}
+
+//! Returns the number of atoms that are moved as part of a block
+int numAtomsInBlocks(const gmx_domdec_sort_t& sort)
+{
+    int numAtoms = 0;
+    for (const DDHomeAtomBlock& block : sort.blocks)
+    {
+        numAtoms += block.size;
+    }
+
+    return numAtoms;
+}
+
+TEST(SortStateTest, UnchangedColumnsAreNotTouched)
+{
+    const auto sorted = makeSorted({ { 0, 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9, 10 } });
+
+    gmx_domdec_sort_t sort;
+    sortAndCheck(sorted, 11, &sort);
+
+    EXPECT_TRUE(sort.blocks.empty());
+    EXPECT_TRUE(sort.movedIndices.empty());
+}
+
+TEST(SortStateTest, PartialMovesOnlyTouchChangedColumns)
+{
+    /* Atom 5 moved out of column 1, atom 20 moved into column 3 */
+    const auto sorted = makeSorted({ { 0, 1, 2, 3 },
+                                     { 4, 6, 7 },
+                                     { 8, 9, 10, 11 },
+                                     { 12, 13, 20, 14, 15 },
+                                     { 16, 17, 18, 19 } });
+
+    gmx_domdec_sort_t sort;
+    sortAndCheck(sorted, 21, &sort);
+
+    /* Column 2 shifts down as a block, columns 0 and 4 are not touched */
+    ASSERT_EQ(sort.blocks.size(), 1);
+    EXPECT_EQ(sort.blocks[0].source, 8);
+    EXPECT_EQ(sort.blocks[0].destination, 7);
+    EXPECT_EQ(sort.blocks[0].size, 4);
+    /* Only the atoms of columns 1 and 3 that change position are moved one by one */
+    EXPECT_EQ(sort.movedIndices, std::vector<int>({ 5, 6, 11, 12, 13 }));
+}
+
+TEST(SortStateTest, ShiftedColumnsAreMergedIntoOneBlock)
+{
+    /* Atom 20 moved into column 0, shifting all later columns up */
+    const auto sorted = makeSorted({ { 0, 1, 20, 2, 3 }, { 4, 5, 6, 7 }, { 8, 9, 10, 11 } });
+
+    gmx_domdec_sort_t sort;
+    sortAndCheck(sorted, 21, &sort);
+
+    ASSERT_EQ(sort.blocks.size(), 1);
+    EXPECT_EQ(sort.blocks[0].source, 4);
+    EXPECT_EQ(sort.blocks[0].destination, 5);
+    EXPECT_EQ(sort.blocks[0].size, 8);
+    EXPECT_EQ(sort.movedIndices, std::vector<int>({ 2, 3, 4 }));
+}
+
+TEST(SortStateTest, ColumnsOutOfOrderAreMovedOneByOne)
+{
+    /* The grid changed such that the order of the columns swapped */
+    const auto sorted = makeSorted({ { 4, 5, 6, 7 }, { 0, 1, 2, 3 } });
+
+    gmx_domdec_sort_t sort;
+    sortAndCheck(sorted, 8, &sort);
+
+    /* Only one of the columns can be moved in place as a block */
+    ASSERT_EQ(sort.blocks.size(), 1);
+    EXPECT_EQ(sort.blocks[0].source, 0);
+    EXPECT_EQ(sort.blocks[0].destination, 4);
+    EXPECT_EQ(sort.movedIndices, std::vector<int>({ 0, 1, 2, 3 }));
+}
+
+TEST(SortStateTest, ColumnOfReceivedAtomsDoesNotBlockLaterColumns)
+{
+    /* Column 0 only has received atoms, the other columns shift up */
+    const auto sorted =
+            makeSorted({ { 12, 13 }, { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 8, 9, 10, 11 } });
+
+    gmx_domdec_sort_t sort;
+    sortAndCheck(sorted, 14, &sort);
+
+    ASSERT_EQ(sort.blocks.size(), 1);
+    EXPECT_EQ(sort.blocks[0].source, 0);
+    EXPECT_EQ(sort.blocks[0].destination, 2);
+    EXPECT_EQ(sort.blocks[0].size, 12);
+    EXPECT_EQ(sort.movedIndices, std::vector<int>({ 0, 1 }));
+}
+
+TEST(SortStateTest, RandomPartialMovesGiveSortedState)
+{
+    const int c_numColumns       = 100;
+    const int c_maxAtomsInColumn = 10;
+
+    DefaultRandomEngine           rng(1234);
+    UniformIntDistribution<int>   sizeDist(0, c_maxAtomsInColumn);
+    std::vector<std::vector<int>> columns(c_numColumns);
+    int                           numLocalAtoms = 0;
+    for (auto& column : columns)
+    {
+        const int size = sizeDist(rng);
+        for (int i = 0; i < size; i++)
+        {
+            column.push_back(numLocalAtoms++);
+        }
+    }
+
+    /* Move 1% of the atoms out and the same number of new atoms into random columns */
+    UniformIntDistribution<int> percentDist(0, 99);
+    UniformIntDistribution<int> columnDist(0, c_numColumns - 1);
+    std::vector<bool>           columnChanged(c_numColumns, false);
+    const int                   numOldAtoms = numLocalAtoms;
+    for (int c = 0; c < c_numColumns; c++)
+    {
+        for (size_t i = 0; i < columns[c].size(); i++)
+        {
+            if (columns[c][i] < numOldAtoms && percentDist(rng) == 0)
+            {
+                columns[c].erase(columns[c].begin() + i);
+                columnChanged[c] = true;
+
+                const int                   newColumn = columnDist(rng);
+                UniformIntDistribution<int> positionDist(0, columns[newColumn].size());
+                columns[newColumn].insert(columns[newColumn].begin() + positionDist(rng),
+                                          numLocalAtoms++);
+                columnChanged[newColumn] = true;
+            }
+        }
+    }
+    ASSERT_GT(numLocalAtoms, numOldAtoms) << "The test should move atoms";
+
+    const auto sorted = makeSorted(columns);
+
+    gmx_domdec_sort_t sort;
+    sortAndCheck(sorted, numLocalAtoms, &sort);
+
+    size_t numAtomsInChangedColumns = 0;
+    for (int c = 0; c < c_numColumns; c++)
+    {
+        numAtomsInChangedColumns += columnChanged[c] ? columns[c].size() : 0;
+    }
+    EXPECT_LE(sort.movedIndices.size(), numAtomsInChangedColumns)
+            << "Only atoms in changed columns should be moved one by one";
+    EXPECT_LE(sort.movedIndices.size() + numAtomsInBlocks(sort), sorted.size());
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -68,6 +68,7 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/mdtypes/state_propagator_data_gpu.h"
 #include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/timing/timelinetracer.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxmpi.h"
@@ -376,6 +377,9 @@ void gmx_pme_send_coordinates(t_forcerec*                    fr,
 {
     wallcycle_start(wcycle, WallCycleCounter::PpPmeSendX);
 
+    gmx::TimelineEventScope timelineEvent(cr->dd ? cr->dd->timelineTracer.get() : nullptr,
+                                          gmx::TimelineEventType::PmeSendCoordinates);
+
     unsigned int flags = PP_PME_COORD;
     if (computeEnergyAndVirial)
     {
@@ -539,6 +543,9 @@ void gmx_pme_receive_f(gmx::PmePpCommGpu*    pmePpCommGpu,
                        bool                  receivePmeForceToGpu,
                        float*                pme_cycles)
 {
+    gmx::TimelineEventScope timelineEvent(cr->dd ? cr->dd->timelineTracer.get() : nullptr,
+                                          gmx::TimelineEventType::PmeReceiveForces);
+
     if (c_useDelayedWait)
     {
         /* Wait for the x request to finish */
@@ -137,6 +137,7 @@ enum tpxv
     tpxv_VSite1,                                  /**< Added 1 type virtual site */
     tpxv_MTS,                                     /**< Added multiple time stepping */
     tpxv_RemovedConstantAcceleration, /**< Removed support for constant acceleration NEMD. */
+    tpxv_ShellPropagation,            /**< Added extended-Lagrangian shell propagation */
     tpxv_Count                        /**< the total number of tpxv versions */
 };
 
@@ -1382,6 +1383,18 @@ static void do_inputrec(gmx::ISerializer* serializer, t_inputrec* ir, int file_v
     serializer->doBool(&ir->bShakeSOR);
     serializer->doInt(&ir->niter);
     serializer->doReal(&ir->fc_stepsize);
+    if (file_version >= tpxv_ShellPropagation)
+    {
+        serializer->doEnumAsInt(&ir->shellPropagation);
+        serializer->doReal(&ir->shellRefT);
+        serializer->doReal(&ir->shellTauT);
+    }
+    else
+    {
+        ir->shellPropagation = ShellPropagation::Scf;
+        ir->shellRefT        = 1;
+        ir->shellTauT        = 0.1;
+    }
     serializer->doEnumAsInt(&ir->eConstrAlg);
     serializer->doInt(&ir->nProjOrder);
     serializer->doReal(&ir->LincsWarnAngle);
@@ -224,7 +224,7 @@ static void check_viol(FILE*                          log,
         } while (((i + n) < disres.size())
                  && (forceparams[forceatoms[i + n]].disres.label == label + label_old));
 
-        calc_disres_R_6(nullptr, nullptr, n, &forceatoms[i], x, pbc, disresdata, nullptr);
+        calc_disres_R_6(nullptr, nullptr, 0, n, &forceatoms[i], x, pbc, disresdata, nullptr);
 
         if (disresdata->Rt_6[label] <= 0)
         {
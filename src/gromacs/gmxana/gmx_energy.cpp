@@ -1499,7 +1499,7 @@ static void do_dhdl(t_enxframe*             fr,
                work if the order of data is always the same and if we're
                only using the g_energy compiled with the mdrun that produced
                the ener.edr. */
-            *fp_dhdl = open_dhdl(filename, ir, oenv);
+            *fp_dhdl = open_dhdl(filename, ir, false, oenv);
         }
         else
         {
@@ -266,6 +266,65 @@ void gmx_sumd(int gmx_unused nr, double gmx_unused r[], const t_commrec gmx_unus
 #endif
 }
 
+/* Non-blocking collectives are only available with MPI 3 or later,
+ * thread-MPI does not support them.
+ */
+#if GMX_LIB_MPI && MPI_VERSION >= 3
+#    define GMX_HAVE_NONBLOCKING_COLLECTIVES 1
+#else
+#    define GMX_HAVE_NONBLOCKING_COLLECTIVES 0
+#endif
+
+bool gmx_have_nonblocking_sumd()
+{
+    return GMX_HAVE_NONBLOCKING_COLLECTIVES;
+}
+
+void gmx_sumd_start(int gmx_unused nr,
+                    double gmx_unused r[],
+                    const t_commrec gmx_unused* cr,
+                    MPI_Request gmx_unused* request)
+{
+#if GMX_HAVE_NONBLOCKING_COLLECTIVES
+    if (cr->nc.bUse)
+    {
+        /* The sum within the node is cheap, so we only overlap the sum
+         * over the nodes and broadcast the result in gmx_sumd_finish().
+         */
+        if (cr->nc.rank_intra == 0)
+        {
+            MPI_Reduce(MPI_IN_PLACE, r, nr, MPI_DOUBLE, MPI_SUM, 0, cr->nc.comm_intra);
+            MPI_Iallreduce(MPI_IN_PLACE, r, nr, MPI_DOUBLE, MPI_SUM, cr->nc.comm_inter, request);
+        }
+        else
+        {
+            MPI_Reduce(r, nullptr, nr, MPI_DOUBLE, MPI_SUM, 0, cr->nc.comm_intra);
+            *request = MPI_REQUEST_NULL;
+        }
+    }
+    else
+    {
+        MPI_Iallreduce(MPI_IN_PLACE, r, nr, MPI_DOUBLE, MPI_SUM, cr->mpi_comm_mygroup, request);
+    }
+#else
+    gmx_sumd(nr, r, cr);
+#endif
+}
+
+void gmx_sumd_finish(int gmx_unused nr,
+                     double gmx_unused r[],
+                     const t_commrec gmx_unused* cr,
+                     MPI_Request gmx_unused* request)
+{
+#if GMX_HAVE_NONBLOCKING_COLLECTIVES
+    MPI_Wait(request, MPI_STATUS_IGNORE);
+    if (cr->nc.bUse)
+    {
+        MPI_Bcast(r, nr, MPI_DOUBLE, 0, cr->nc.comm_intra);
+    }
+#endif
+}
+
 void gmx_sumf(int gmx_unused nr, float gmx_unused r[], const t_commrec gmx_unused* cr)
 {
 #if !GMX_MPI
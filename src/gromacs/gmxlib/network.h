@@ -93,6 +93,22 @@ void gmx_sumf(int nr, float r[], const struct t_commrec* cr);
 void gmx_sumd(int nr, double r[], const struct t_commrec* cr);
 /* Calculate the global sum of an array of doubles */
 
+//! Returns whether gmx_sumd_start() sums without blocking
+bool gmx_have_nonblocking_sumd();
+
+/*! \brief Start the global sum of an array of doubles
+ *
+ * The sum is completed by gmx_sumd_finish(), which should be called
+ * with the same arguments. \p r should not be accessed in between.
+ * With two step summing, the sum within physical nodes is done here
+ * and only the sum over the nodes is non-blocking.
+ * When non-blocking collectives are not supported, the sum is done here.
+ */
+void gmx_sumd_start(int nr, double r[], const struct t_commrec* cr, MPI_Request* request);
+
+//! Complete the global sum started by gmx_sumd_start()
+void gmx_sumd_finish(int nr, double r[], const struct t_commrec* cr, MPI_Request* request);
+
 #if GMX_DOUBLE
 #    define gmx_sum gmx_sumd
 #else
@@ -44,6 +44,7 @@
 #include <cmath>
 
 #include <algorithm>
+#include <array>
 
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/gmxlib/nonbonded/nonbonded.h"
@@ -197,7 +198,32 @@ static inline RealType potSwitchPotentialMod(const RealType potentialInp,
 }
 
 
-//! Templated free-energy non-bonded kernel
+/*! \brief The maximum number of lambda points computed in one pass over the pair list
+ *
+ * This allows the kernel to store the lambda dependent data on the stack.
+ * More lambda points are computed in multiple passes.
+ */
+static constexpr int c_maxNumLambdaPointsPerPass = 64;
+
+//! Lambda dependent factors for the A and B states at one lambda point
+struct LambdaFactors
+{
+    real LFC[2];       //!< Coulomb lambda factor for state A and B
+    real LFV[2];       //!< Van der Waals lambda factor for state A and B
+    real lFacCoul[2];  //!< Coulomb soft-core lambda factor for state A and B
+    real dlFacCoul[2]; //!< Derivative of \p lFacCoul with respect to lambda
+    real lFacVdw[2];   //!< Van der Waals soft-core lambda factor for state A and B
+    real dlFacVdw[2];  //!< Derivative of \p lFacVdw with respect to lambda
+};
+
+/*! \brief Templated free-energy non-bonded kernel
+ *
+ * Computes the interactions at all lambda points in \p lambdas in a single
+ * pass over the pair list. The distances, exclusions, parameters and table
+ * lookups, which do not depend on lambda, are only computed once per pair.
+ * Forces can only be computed when a single lambda point is passed.
+ * At most \p c_maxNumLambdaPointsPerPass lambda points can be passed.
+ */
 template<typename DataTypes, bool useSoftCore, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald, bool elecInteractionTypeIsEwald, bool vdwModifierIsPotSwitch>
 static void nb_free_energy_kernel(const t_nblist&                nlist,
                                   gmx::ArrayRef<const gmx::RVec> coords,
@@ -213,11 +239,11 @@ static void nb_free_energy_kernel(const t_nblist&                nlist,
                                   gmx::ArrayRef<const int>       typeA,
                                   gmx::ArrayRef<const int>       typeB,
                                   int                            flags,
-                                  gmx::ArrayRef<const real>      lambda,
-                                  gmx::ArrayRef<real>            dvdl,
-                                  gmx::ArrayRef<real>            energygrp_elec,
-                                  gmx::ArrayRef<real>            energygrp_vdw,
-                                  t_nrnb* gmx_restrict           nrnb)
+                                  gmx::ArrayRef<const gmx::ArrayRef<const real>> lambdas,
+                                  gmx::ArrayRef<const gmx::ArrayRef<real>>       dvdl,
+                                  gmx::ArrayRef<const gmx::ArrayRef<real>>       energygrp_elec,
+                                  gmx::ArrayRef<const gmx::ArrayRef<real>>       energygrp_vdw,
+                                  t_nrnb* gmx_restrict                           nrnb)
 {
 #define STATE_A 0
 #define STATE_B 1
@@ -243,8 +269,6 @@ static void nb_free_energy_kernel(const t_nblist&                nlist,
     gmx::ArrayRef<const int> shift  = nlist.shift;
     gmx::ArrayRef<const int> gid    = nlist.gid;
 
-    const real  lambda_coul   = lambda[static_cast<int>(FreeEnergyPerturbationCouplingType::Coul)];
-    const real  lambda_vdw    = lambda[static_cast<int>(FreeEnergyPerturbationCouplingType::Vdw)];
     const auto& scParams      = *ic.softCoreParameters;
     const real  alpha_coul    = scParams.alphaCoulomb;
     const real  alpha_vdw     = scParams.alphaVdw;
@@ -342,37 +366,60 @@ static void nb_free_energy_kernel(const t_nblist&                nlist,
     GMX_RELEASE_ASSERT(!(vdwInteractionTypeIsEwald && vdwModifierIsPotSwitch),
                        "Can not apply soft-core to switched Ewald potentials");
 
-    real dvdlCoul = 0;
-    real dvdlVdw  = 0;
+    const int numLambdaPoints = lambdas.ssize();
+    GMX_ASSERT(!doForces || numLambdaPoints == 1,
+               "Forces can only be computed for a single lambda point");
+    GMX_ASSERT(numLambdaPoints <= c_maxNumLambdaPointsPerPass,
+               "The number of lambda points should fit in the stack buffers");
 
-    /* Lambda factor for state A, 1-lambda*/
-    real LFC[NSTATES], LFV[NSTATES];
-    LFC[STATE_A] = one - lambda_coul;
-    LFV[STATE_A] = one - lambda_vdw;
-
-    /* Lambda factor for state B, lambda*/
-    LFC[STATE_B] = lambda_coul;
-    LFV[STATE_B] = lambda_vdw;
+    std::array<real, c_maxNumLambdaPointsPerPass> dvdlCoul = { 0 };
+    std::array<real, c_maxNumLambdaPointsPerPass> dvdlVdw  = { 0 };
+    std::array<real, c_maxNumLambdaPointsPerPass> vCTot;
+    std::array<real, c_maxNumLambdaPointsPerPass> vVTot;
 
     /*derivative of the lambda factor for state A and B */
     real DLF[NSTATES];
     DLF[STATE_A] = -1;
     DLF[STATE_B] = 1;
 
-    real           lFacCoul[NSTATES], dlFacCoul[NSTATES], lFacVdw[NSTATES], dlFacVdw[NSTATES];
-    constexpr real sc_r_power = 6.0_real;
-    for (int i = 0; i < NSTATES; i++)
+    constexpr real             sc_r_power = 6.0_real;
+    std::array<LambdaFactors, c_maxNumLambdaPointsPerPass> lambdaFactors;
+    for (int l = 0; l < numLambdaPoints; l++)
     {
-        lFacCoul[i]  = (lam_power == 2 ? (1 - LFC[i]) * (1 - LFC[i]) : (1 - LFC[i]));
-        dlFacCoul[i] = DLF[i] * lam_power / sc_r_power * (lam_power == 2 ? (1 - LFC[i]) : 1);
-        lFacVdw[i]   = (lam_power == 2 ? (1 - LFV[i]) * (1 - LFV[i]) : (1 - LFV[i]));
-        dlFacVdw[i]  = DLF[i] * lam_power / sc_r_power * (lam_power == 2 ? (1 - LFV[i]) : 1);
+        const real lambda_coul =
+                lambdas[l][static_cast<int>(FreeEnergyPerturbationCouplingType::Coul)];
+        const real lambda_vdw =
+                lambdas[l][static_cast<int>(FreeEnergyPerturbationCouplingType::Vdw)];
+
+        real* LFC = lambdaFactors[l].LFC;
+        real* LFV = lambdaFactors[l].LFV;
+
+        /* Lambda factor for state A, 1-lambda*/
+        LFC[STATE_A] = one - lambda_coul;
+        LFV[STATE_A] = one - lambda_vdw;
+
+        /* Lambda factor for state B, lambda*/
+        LFC[STATE_B] = lambda_coul;
+        LFV[STATE_B] = lambda_vdw;
+
+        for (int i = 0; i < NSTATES; i++)
+        {
+            lambdaFactors[l].lFacCoul[i] =
+                    (lam_power == 2 ? (1 - LFC[i]) * (1 - LFC[i]) : (1 - LFC[i]));
+            lambdaFactors[l].dlFacCoul[i] =
+                    DLF[i] * lam_power / sc_r_power * (lam_power == 2 ? (1 - LFC[i]) : 1);
+            lambdaFactors[l].lFacVdw[i] =
+                    (lam_power == 2 ? (1 - LFV[i]) * (1 - LFV[i]) : (1 - LFV[i]));
+            lambdaFactors[l].dlFacVdw[i] =
+                    DLF[i] * lam_power / sc_r_power * (lam_power == 2 ? (1 - LFV[i]) : 1);
+        }
     }
 
     // TODO: We should get rid of using pointers to real
-    const real*        x      = coords[0];
-    real* gmx_restrict f      = &(forceWithShiftForces->force()[0][0]);
-    real* gmx_restrict fshift = &(forceWithShiftForces->shiftForces()[0][0]);
+    const real*        x = coords[0];
+    real* gmx_restrict f = doForces ? &(forceWithShiftForces->force()[0][0]) : nullptr;
+    real* gmx_restrict fshift =
+            doShiftForces ? &(forceWithShiftForces->shiftForces()[0][0]) : nullptr;
 
     const real rlistSquared = gmx::square(rlist);
 
@@ -398,11 +445,11 @@ static void nb_free_energy_kernel(const t_nblist&                nlist,
         const real iqB   = facel * chargeB[ii];
         const int  ntiA  = 2 * ntype * typeA[ii];
         const int  ntiB  = 2 * ntype * typeB[ii];
-        real       vCTot = 0;
-        real       vVTot = 0;
         real       fIX   = 0;
         real       fIY   = 0;
         real       fIZ   = 0;
+        std::fill_n(vCTot.begin(), numLambdaPoints, 0);
+        std::fill_n(vVTot.begin(), numLambdaPoints, 0);
 
         for (int k = nj0; k < nj1; k++)
         {
@@ -525,147 +572,172 @@ static void nb_free_energy_kernel(const t_nblist&                nlist,
                     }
                 }
 
-                for (int i = 0; i < NSTATES; i++)
+                for (int l = 0; l < numLambdaPoints; l++)
                 {
-                    fScalC[i] = 0;
-                    fScalV[i] = 0;
-                    vCoul[i]  = 0;
-                    vVdw[i]   = 0;
-
-                    RealType rInvC, rInvV, rC, rV, rPInvC, rPInvV;
-
-                    /* Only spend time on A or B state if it is non-zero */
-                    if ((qq[i] != 0) || (c6[i] != 0) || (c12[i] != 0))
+                    const real* LFC       = lambdaFactors[l].LFC;
+                    const real* LFV       = lambdaFactors[l].LFV;
+                    const real* lFacCoul  = lambdaFactors[l].lFacCoul;
+                    const real* dlFacCoul = lambdaFactors[l].dlFacCoul;
+                    const real* lFacVdw   = lambdaFactors[l].lFacVdw;
+                    const real* dlFacVdw  = lambdaFactors[l].dlFacVdw;
+
+                    for (int i = 0; i < NSTATES; i++)
                     {
-                        /* this section has to be inside the loop because of the dependence on sigma6 */
-                        if (useSoftCore)
-                        {
-                            rPInvC = one / (alphaCoulEff * lFacCoul[i] * sigma6[i] + rp);
-                            pthRoot(rPInvC, &rInvC, &rC);
-                            if (scLambdasOrAlphasDiffer)
-                            {
-                                rPInvV = one / (alphaVdwEff * lFacVdw[i] * sigma6[i] + rp);
-                                pthRoot(rPInvV, &rInvV, &rV);
-                            }
-                            else
-                            {
-                                /* We can avoid one expensive pow and one / operation */
-                                rPInvV = rPInvC;
-                                rInvV  = rInvC;
-                                rV     = rC;
-                            }
-                        }
-                        else
-                        {
-                            rPInvC = 1;
-                            rInvC  = rInv;
-                            rC     = r;
-
-                            rPInvV = 1;
-                            rInvV  = rInv;
-                            rV     = r;
-                        }
+                        fScalC[i] = 0;
+                        fScalV[i] = 0;
+                        vCoul[i]  = 0;
+                        vVdw[i]   = 0;
 
-                        /* Only process the coulomb interactions if we have charges,
-                         * and if we either include all entries in the list (no cutoff
-                         * used in the kernel), or if we are within the cutoff.
-                         */
-                        bool computeElecInteraction = (elecInteractionTypeIsEwald && r < rCoulomb)
-                                                      || (!elecInteractionTypeIsEwald && rC < rCoulomb);
+                        RealType rInvC, rInvV, rC, rV, rPInvC, rPInvV;
 
-                        if ((qq[i] != 0) && computeElecInteraction)
+                        /* Only spend time on A or B state if it is non-zero */
+                        if ((qq[i] != 0) || (c6[i] != 0) || (c12[i] != 0))
                         {
-                            if (elecInteractionTypeIsEwald)
-                            {
-                                vCoul[i]  = ewaldPotential(qq[i], rInvC, sh_ewald);
-                                fScalC[i] = ewaldScalarForce(qq[i], rInvC);
-                            }
-                            else
-                            {
-                                vCoul[i]  = reactionFieldPotential(qq[i], rInvC, rC, krf, crf);
-                                fScalC[i] = reactionFieldScalarForce(qq[i], rInvC, rC, krf, two);
-                            }
-                        }
-
-                        /* Only process the VDW interactions if we have
-                         * some non-zero parameters, and if we either
-                         * include all entries in the list (no cutoff used
-                         * in the kernel), or if we are within the cutoff.
-                         */
-                        bool computeVdwInteraction = (vdwInteractionTypeIsEwald && r < rVdw)
-                                                     || (!vdwInteractionTypeIsEwald && rV < rVdw);
-                        if ((c6[i] != 0 || c12[i] != 0) && computeVdwInteraction)
-                        {
-                            RealType rInv6;
+                            /* this section has to be inside the loop because of the
+                             * dependence on sigma6
+                             */
                             if (useSoftCore)
                             {
-                                rInv6 = rPInvV;
+                                rPInvC = one / (alphaCoulEff * lFacCoul[i] * sigma6[i] + rp);
+                                pthRoot(rPInvC, &rInvC, &rC);
+                                if (scLambdasOrAlphasDiffer)
+                                {
+                                    rPInvV = one / (alphaVdwEff * lFacVdw[i] * sigma6[i] + rp);
+                                    pthRoot(rPInvV, &rInvV, &rV);
+                                }
+                                else
+                                {
+                                    /* We can avoid one expensive pow and one / operation */
+                                    rPInvV = rPInvC;
+                                    rInvV  = rInvC;
+                                    rV     = rC;
+                                }
                             }
                             else
                             {
-                                rInv6 = calculateRinv6(rInvV);
+                                rPInvC = 1;
+                                rInvC  = rInv;
+                                rC     = r;
+
+                                rPInvV = 1;
+                                rInvV  = rInv;
+                                rV     = r;
                             }
-                            RealType vVdw6  = calculateVdw6(c6[i], rInv6);
-                            RealType vVdw12 = calculateVdw12(c12[i], rInv6);
 
-                            vVdw[i] = lennardJonesPotential(
-                                    vVdw6, vVdw12, c6[i], c12[i], repulsionShift, dispersionShift, oneSixth, oneTwelfth);
-                            fScalV[i] = lennardJonesScalarForce(vVdw6, vVdw12);
+                            /* Only process the coulomb interactions if we have charges,
+                             * and if we either include all entries in the list (no cutoff
+                             * used in the kernel), or if we are within the cutoff.
+                             */
+                            bool computeElecInteraction =
+                                    (elecInteractionTypeIsEwald && r < rCoulomb)
+                                    || (!elecInteractionTypeIsEwald && rC < rCoulomb);
 
-                            if (vdwInteractionTypeIsEwald)
+                            if ((qq[i] != 0) && computeElecInteraction)
                             {
-                                /* Subtract the grid potential at the cut-off */
-                                vVdw[i] += ewaldLennardJonesGridSubtract(
-                                        nbfp_grid[tj[i]], shLjEwald, oneSixth);
+                                if (elecInteractionTypeIsEwald)
+                                {
+                                    vCoul[i]  = ewaldPotential(qq[i], rInvC, sh_ewald);
+                                    fScalC[i] = ewaldScalarForce(qq[i], rInvC);
+                                }
+                                else
+                                {
+                                    vCoul[i]  = reactionFieldPotential(qq[i], rInvC, rC, krf, crf);
+                                    fScalC[i] =
+                                            reactionFieldScalarForce(qq[i], rInvC, rC, krf, two);
+                                }
                             }
 
-                            if (vdwModifierIsPotSwitch)
+                            /* Only process the VDW interactions if we have
+                             * some non-zero parameters, and if we either
+                             * include all entries in the list (no cutoff used
+                             * in the kernel), or if we are within the cutoff.
+                             */
+                            bool computeVdwInteraction =
+                                    (vdwInteractionTypeIsEwald && r < rVdw)
+                                    || (!vdwInteractionTypeIsEwald && rV < rVdw);
+                            if ((c6[i] != 0 || c12[i] != 0) && computeVdwInteraction)
                             {
-                                RealType d        = rV - ic.rvdw_switch;
-                                d                 = (d > zero) ? d : zero;
-                                const RealType d2 = d * d;
-                                const RealType sw =
-                                        one + d2 * d * (vdw_swV3 + d * (vdw_swV4 + d * vdw_swV5));
-                                const RealType dsw = d2 * (vdw_swF2 + d * (vdw_swF3 + d * vdw_swF4));
-
-                                fScalV[i] = potSwitchScalarForceMod(
-                                        fScalV[i], vVdw[i], sw, rV, rVdw, dsw, zero);
-                                vVdw[i] = potSwitchPotentialMod(vVdw[i], sw, rV, rVdw, zero);
+                                RealType rInv6;
+                                if (useSoftCore)
+                                {
+                                    rInv6 = rPInvV;
+                                }
+                                else
+                                {
+                                    rInv6 = calculateRinv6(rInvV);
+                                }
+                                RealType vVdw6  = calculateVdw6(c6[i], rInv6);
+                                RealType vVdw12 = calculateVdw12(c12[i], rInv6);
+
+                                vVdw[i] = lennardJonesPotential(vVdw6,
+                                                                vVdw12,
+                                                                c6[i],
+                                                                c12[i],
+                                                                repulsionShift,
+                                                                dispersionShift,
+                                                                oneSixth,
+                                                                oneTwelfth);
+                                fScalV[i] = lennardJonesScalarForce(vVdw6, vVdw12);
+
+                                if (vdwInteractionTypeIsEwald)
+                                {
+                                    /* Subtract the grid potential at the cut-off */
+                                    vVdw[i] += ewaldLennardJonesGridSubtract(
+                                            nbfp_grid[tj[i]], shLjEwald, oneSixth);
+                                }
+
+                                if (vdwModifierIsPotSwitch)
+                                {
+                                    RealType d        = rV - ic.rvdw_switch;
+                                    d                 = (d > zero) ? d : zero;
+                                    const RealType d2 = d * d;
+                                    const RealType sw =
+                                            one
+                                            + d2 * d * (vdw_swV3 + d * (vdw_swV4 + d * vdw_swV5));
+                                    const RealType dsw =
+                                            d2 * (vdw_swF2 + d * (vdw_swF3 + d * vdw_swF4));
+
+                                    fScalV[i] = potSwitchScalarForceMod(
+                                            fScalV[i], vVdw[i], sw, rV, rVdw, dsw, zero);
+                                    vVdw[i] = potSwitchPotentialMod(vVdw[i], sw, rV, rVdw, zero);
+                                }
                             }
-                        }
 
-                        /* fScalC (and fScalV) now contain: dV/drC * rC
-                         * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
-                         * Further down we first multiply by r^p-2 and then by
-                         * the vector r, which in total gives: dV/drC * (r/rC)^1-p
-                         */
-                        fScalC[i] *= rPInvC;
-                        fScalV[i] *= rPInvV;
-                    }
-                } // end for (int i = 0; i < NSTATES; i++)
+                            /* fScalC (and fScalV) now contain: dV/drC * rC
+                             * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
+                             * Further down we first multiply by r^p-2 and then by
+                             * the vector r, which in total gives: dV/drC * (r/rC)^1-p
+                             */
+                            fScalC[i] *= rPInvC;
+                            fScalV[i] *= rPInvV;
+                        }
+                    } // end for (int i = 0; i < NSTATES; i++)
 
-                /* Assemble A and B states */
-                for (int i = 0; i < NSTATES; i++)
-                {
-                    vCTot += LFC[i] * vCoul[i];
-                    vVTot += LFV[i] * vVdw[i];
+                    /* Assemble A and B states */
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        vCTot[l] += LFC[i] * vCoul[i];
+                        vVTot[l] += LFV[i] * vVdw[i];
 
-                    fScal += LFC[i] * fScalC[i] * rpm2;
-                    fScal += LFV[i] * fScalV[i] * rpm2;
+                        fScal += LFC[i] * fScalC[i] * rpm2;
+                        fScal += LFV[i] * fScalV[i] * rpm2;
 
-                    if (useSoftCore)
-                    {
-                        dvdlCoul += vCoul[i] * DLF[i]
+                        if (useSoftCore)
+                        {
+                            dvdlCoul[l] +=
+                                    vCoul[i] * DLF[i]
                                     + LFC[i] * alphaCoulEff * dlFacCoul[i] * fScalC[i] * sigma6[i];
-                        dvdlVdw += vVdw[i] * DLF[i]
-                                   + LFV[i] * alphaVdwEff * dlFacVdw[i] * fScalV[i] * sigma6[i];
-                    }
-                    else
-                    {
-                        dvdlCoul += vCoul[i] * DLF[i];
-                        dvdlVdw += vVdw[i] * DLF[i];
+                            dvdlVdw[l] +=
+                                    vVdw[i] * DLF[i]
+                                    + LFV[i] * alphaVdwEff * dlFacVdw[i] * fScalV[i] * sigma6[i];
+                        }
+                        else
+                        {
+                            dvdlCoul[l] += vCoul[i] * DLF[i];
+                            dvdlVdw[l] += vVdw[i] * DLF[i];
+                        }
                     }
-                }
+                } // end for (int l = 0; l < numLambdaPoints; l++)
             } // end if (bPairIncluded)
             else if (icoul == NbkernelElecType::ReactionField)
             {
@@ -681,11 +753,15 @@ static void nb_free_energy_kernel(const t_nblist&                nlist,
                     VV *= half;
                 }
 
-                for (int i = 0; i < NSTATES; i++)
+                for (int l = 0; l < numLambdaPoints; l++)
                 {
-                    vCTot += LFC[i] * qq[i] * VV;
-                    fScal += LFC[i] * qq[i] * FF;
-                    dvdlCoul += DLF[i] * qq[i] * VV;
+                    const real* LFC = lambdaFactors[l].LFC;
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        vCTot[l] += LFC[i] * qq[i] * VV;
+                        fScal += LFC[i] * qq[i] * FF;
+                        dvdlCoul[l] += DLF[i] * qq[i] * VV;
+                    }
                 }
             }
 
@@ -723,11 +799,15 @@ static void nb_free_energy_kernel(const t_nblist&                nlist,
                     v_lr *= half;
                 }
 
-                for (int i = 0; i < NSTATES; i++)
+                for (int l = 0; l < numLambdaPoints; l++)
                 {
-                    vCTot -= LFC[i] * qq[i] * v_lr;
-                    fScal -= LFC[i] * qq[i] * f_lr;
-                    dvdlCoul -= (DLF[i] * qq[i]) * v_lr;
+                    const real* LFC = lambdaFactors[l].LFC;
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        vCTot[l] -= LFC[i] * qq[i] * v_lr;
+                        fScal -= LFC[i] * qq[i] * f_lr;
+                        dvdlCoul[l] -= (DLF[i] * qq[i]) * v_lr;
+                    }
                 }
             }
 
@@ -768,12 +848,16 @@ static void nb_free_energy_kernel(const t_nblist&                nlist,
                     VV *= half;
                 }
 
-                for (int i = 0; i < NSTATES; i++)
+                for (int l = 0; l < numLambdaPoints; l++)
                 {
-                    const real c6grid = nbfp_grid[tj[i]];
-                    vVTot += LFV[i] * c6grid * VV;
-                    fScal += LFV[i] * c6grid * FF;
-                    dvdlVdw += (DLF[i] * c6grid) * VV;
+                    const real* LFV = lambdaFactors[l].LFV;
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        const real c6grid = nbfp_grid[tj[i]];
+                        vVTot[l] += LFV[i] * c6grid * VV;
+                        fScal += LFV[i] * c6grid * FF;
+                        dvdlVdw[l] += (DLF[i] * c6grid) * VV;
+                    }
                 }
             }
 
@@ -829,24 +913,33 @@ static void nb_free_energy_kernel(const t_nblist&                nlist,
             if (doPotential)
             {
                 int ggid = gid[n];
+                for (int l = 0; l < numLambdaPoints; l++)
+                {
 #pragma omp atomic
-                energygrp_elec[ggid] += vCTot;
+                    energygrp_elec[l][ggid] += vCTot[l];
 #pragma omp atomic
-                energygrp_vdw[ggid] += vVTot;
+                    energygrp_vdw[l][ggid] += vVTot[l];
+                }
             }
         }
     } // end for (int n = 0; n < nri; n++)
 
+    for (int l = 0; l < numLambdaPoints; l++)
+    {
 #pragma omp atomic
-    dvdl[static_cast<int>(FreeEnergyPerturbationCouplingType::Coul)] += dvdlCoul;
+        dvdl[l][static_cast<int>(FreeEnergyPerturbationCouplingType::Coul)] += dvdlCoul[l];
 #pragma omp atomic
-    dvdl[static_cast<int>(FreeEnergyPerturbationCouplingType::Vdw)] += dvdlVdw;
+        dvdl[l][static_cast<int>(FreeEnergyPerturbationCouplingType::Vdw)] += dvdlVdw[l];
+    }
 
     /* Estimate flops, average for free energy stuff:
      * 12  flops per outer iteration
      * 150 flops per inner iteration
+     * We count the flops for each lambda point as with separate evaluations.
      */
-    atomicNrnbIncrement(nrnb, eNR_NBKERNEL_FREE_ENERGY, nlist.nri * 12 + nlist.jindex[nri] * 150);
+    atomicNrnbIncrement(nrnb,
+                        eNR_NBKERNEL_FREE_ENERGY,
+                        numLambdaPoints * (nlist.nri * 12 + nlist.jindex[nri] * 150));
 
     if (numExcludedPairsBeyondRlist > 0)
     {
@@ -877,11 +970,11 @@ typedef void (*KernelFunction)(const t_nblist&                nlist,
                                gmx::ArrayRef<const int>       typeA,
                                gmx::ArrayRef<const int>       typeB,
                                int                            flags,
-                               gmx::ArrayRef<const real>      lambda,
-                               gmx::ArrayRef<real>            dvdl,
-                               gmx::ArrayRef<real>            energygrp_elec,
-                               gmx::ArrayRef<real>            energygrp_vdw,
-                               t_nrnb* gmx_restrict           nrnb);
+                               gmx::ArrayRef<const gmx::ArrayRef<const real>> lambdas,
+                               gmx::ArrayRef<const gmx::ArrayRef<real>>       dvdl,
+                               gmx::ArrayRef<const gmx::ArrayRef<real>>       energygrp_elec,
+                               gmx::ArrayRef<const gmx::ArrayRef<real>>       energygrp_vdw,
+                               t_nrnb* gmx_restrict                           nrnb);
 
 template<bool useSoftCore, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald, bool elecInteractionTypeIsEwald, bool vdwModifierIsPotSwitch>
 static KernelFunction dispatchKernelOnUseSimd(const bool useSimd)
@@ -996,6 +1089,95 @@ static KernelFunction dispatchKernel(const bool                 scLambdasOrAlpha
 }
 
 
+/*! \brief Selects the kernel instantiation and computes the interactions
+ * at all lambda points in \p lambdas
+ *
+ * The lambda points are computed in passes over the pair list of at most
+ * \p c_maxNumLambdaPointsPerPass points.
+ */
+static void computeFreeEnergyInteractions(const t_nblist&                nlist,
+                                          gmx::ArrayRef<const gmx::RVec> coords,
+                                          gmx::ForceWithShiftForces*     ff,
+                                          const bool                     useSimd,
+                                          const int                      ntype,
+                                          const real                     rlist,
+                                          const interaction_const_t&     ic,
+                                          gmx::ArrayRef<const gmx::RVec> shiftvec,
+                                          gmx::ArrayRef<const real>      nbfp,
+                                          gmx::ArrayRef<const real>      nbfp_grid,
+                                          gmx::ArrayRef<const real>      chargeA,
+                                          gmx::ArrayRef<const real>      chargeB,
+                                          gmx::ArrayRef<const int>       typeA,
+                                          gmx::ArrayRef<const int>       typeB,
+                                          int                            flags,
+                                          gmx::ArrayRef<const gmx::ArrayRef<const real>> lambdas,
+                                          gmx::ArrayRef<const gmx::ArrayRef<real>>       dvdl,
+                                          gmx::ArrayRef<const gmx::ArrayRef<real>> energygrp_elec,
+                                          gmx::ArrayRef<const gmx::ArrayRef<real>> energygrp_vdw,
+                                          t_nrnb*                                  nrnb)
+{
+    GMX_ASSERT(EEL_PME_EWALD(ic.eeltype) || ic.eeltype == CoulombInteractionType::Cut || EEL_RF(ic.eeltype),
+               "Unsupported eeltype with free energy");
+    GMX_ASSERT(ic.softCoreParameters, "We need soft-core parameters");
+
+    const auto& scParams                   = *ic.softCoreParameters;
+    const bool  vdwInteractionTypeIsEwald  = (EVDW_PME(ic.vdwtype));
+    const bool  elecInteractionTypeIsEwald = (EEL_PME_EWALD(ic.eeltype));
+    const bool  vdwModifierIsPotSwitch     = (ic.vdw_modifier == InteractionModifiers::PotSwitch);
+
+    for (size_t lambdaStart = 0; lambdaStart < lambdas.size();
+         lambdaStart += c_maxNumLambdaPointsPerPass)
+    {
+        const size_t numLambdaPoints =
+                std::min<size_t>(c_maxNumLambdaPointsPerPass, lambdas.size() - lambdaStart);
+        const auto passLambdas = lambdas.subArray(lambdaStart, numLambdaPoints);
+
+        bool scLambdasOrAlphasDiffer = true;
+        if (scParams.alphaCoulomb == 0 && scParams.alphaVdw == 0)
+        {
+            scLambdasOrAlphasDiffer = false;
+        }
+        else if (scParams.alphaCoulomb == scParams.alphaVdw)
+        {
+            /* The soft-core radii for Coulomb and VdW can only be shared
+             * when they are equal at all lambda points.
+             */
+            scLambdasOrAlphasDiffer = std::any_of(
+                    passLambdas.begin(), passLambdas.end(), [](gmx::ArrayRef<const real> lambda) {
+                        return lambda[static_cast<int>(FreeEnergyPerturbationCouplingType::Coul)]
+                               != lambda[static_cast<int>(FreeEnergyPerturbationCouplingType::Vdw)];
+                    });
+        }
+
+        KernelFunction kernelFunc;
+        kernelFunc = dispatchKernel(scLambdasOrAlphasDiffer,
+                                    vdwInteractionTypeIsEwald,
+                                    elecInteractionTypeIsEwald,
+                                    vdwModifierIsPotSwitch,
+                                    useSimd,
+                                    ic);
+        kernelFunc(nlist,
+                   coords,
+                   ff,
+                   ntype,
+                   rlist,
+                   ic,
+                   shiftvec,
+                   nbfp,
+                   nbfp_grid,
+                   chargeA,
+                   chargeB,
+                   typeA,
+                   typeB,
+                   flags,
+                   passLambdas,
+                   dvdl.subArray(lambdaStart, numLambdaPoints),
+                   energygrp_elec.subArray(lambdaStart, numLambdaPoints),
+                   energygrp_vdw.subArray(lambdaStart, numLambdaPoints),
+                   nrnb);
+    }
+}
+
 void gmx_nb_free_energy_kernel(const t_nblist&                nlist,
                                gmx::ArrayRef<const gmx::RVec> coords,
                                gmx::ForceWithShiftForces*     ff,
@@ -1017,54 +1199,74 @@ void gmx_nb_free_energy_kernel(const t_nblist&                nlist,
                                gmx::ArrayRef<real>            energygrp_vdw,
                                t_nrnb*                        nrnb)
 {
-    GMX_ASSERT(EEL_PME_EWALD(ic.eeltype) || ic.eeltype == CoulombInteractionType::Cut || EEL_RF(ic.eeltype),
-               "Unsupported eeltype with free energy");
-    GMX_ASSERT(ic.softCoreParameters, "We need soft-core parameters");
-
-    const auto& scParams                   = *ic.softCoreParameters;
-    const bool  vdwInteractionTypeIsEwald  = (EVDW_PME(ic.vdwtype));
-    const bool  elecInteractionTypeIsEwald = (EEL_PME_EWALD(ic.eeltype));
-    const bool  vdwModifierIsPotSwitch     = (ic.vdw_modifier == InteractionModifiers::PotSwitch);
-    bool        scLambdasOrAlphasDiffer    = true;
-
-    if (scParams.alphaCoulomb == 0 && scParams.alphaVdw == 0)
-    {
-        scLambdasOrAlphasDiffer = false;
-    }
-    else
-    {
-        if (lambda[static_cast<int>(FreeEnergyPerturbationCouplingType::Coul)]
-                    == lambda[static_cast<int>(FreeEnergyPerturbationCouplingType::Vdw)]
-            && scParams.alphaCoulomb == scParams.alphaVdw)
-        {
-            scLambdasOrAlphasDiffer = false;
-        }
-    }
+    const std::array<gmx::ArrayRef<const real>, 1> lambdas       = { lambda };
+    const std::array<gmx::ArrayRef<real>, 1>       dvdls         = { dvdl };
+    const std::array<gmx::ArrayRef<real>, 1>       energygrpElec = { energygrp_elec };
+    const std::array<gmx::ArrayRef<real>, 1>       energygrpVdw  = { energygrp_vdw };
+
+    computeFreeEnergyInteractions(nlist,
+                                  coords,
+                                  ff,
+                                  useSimd,
+                                  ntype,
+                                  rlist,
+                                  ic,
+                                  shiftvec,
+                                  nbfp,
+                                  nbfp_grid,
+                                  chargeA,
+                                  chargeB,
+                                  typeA,
+                                  typeB,
+                                  flags,
+                                  lambdas,
+                                  dvdls,
+                                  energygrpElec,
+                                  energygrpVdw,
+                                  nrnb);
+}
 
-    KernelFunction kernelFunc;
-    kernelFunc = dispatchKernel(scLambdasOrAlphasDiffer,
-                                vdwInteractionTypeIsEwald,
-                                elecInteractionTypeIsEwald,
-                                vdwModifierIsPotSwitch,
-                                useSimd,
-                                ic);
-    kernelFunc(nlist,
-               coords,
-               ff,
-               ntype,
-               rlist,
-               ic,
-               shiftvec,
-               nbfp,
-               nbfp_grid,
-               chargeA,
-               chargeB,
-               typeA,
-               typeB,
-               flags,
-               lambda,
-               dvdl,
-               energygrp_elec,
-               energygrp_vdw,
-               nrnb);
+void gmx_nb_free_energy_kernel_foreign_lambdas(const t_nblist&                nlist,
+                                               gmx::ArrayRef<const gmx::RVec> coords,
+                                               const bool                     useSimd,
+                                               const int                      ntype,
+                                               const real                     rlist,
+                                               const interaction_const_t&     ic,
+                                               gmx::ArrayRef<const gmx::RVec> shiftvec,
+                                               gmx::ArrayRef<const real>      nbfp,
+                                               gmx::ArrayRef<const real>      nbfp_grid,
+                                               gmx::ArrayRef<const real>      chargeA,
+                                               gmx::ArrayRef<const real>      chargeB,
+                                               gmx::ArrayRef<const int>       typeA,
+                                               gmx::ArrayRef<const int>       typeB,
+                                               gmx::ArrayRef<const gmx::ArrayRef<const real>> lambdas,
+                                               gmx::ArrayRef<const gmx::ArrayRef<real>> dvdl,
+                                               gmx::ArrayRef<const gmx::ArrayRef<real>> energygrp_elec,
+                                               gmx::ArrayRef<const gmx::ArrayRef<real>> energygrp_vdw,
+                                               t_nrnb*                                  nrnb)
+{
+    GMX_ASSERT(dvdl.size() == lambdas.size() && energygrp_elec.size() == lambdas.size()
+                       && energygrp_vdw.size() == lambdas.size(),
+               "We need output buffers for all lambda points");
+
+    computeFreeEnergyInteractions(nlist,
+                                  coords,
+                                  nullptr,
+                                  useSimd,
+                                  ntype,
+                                  rlist,
+                                  ic,
+                                  shiftvec,
+                                  nbfp,
+                                  nbfp_grid,
+                                  chargeA,
+                                  chargeB,
+                                  typeA,
+                                  typeB,
+                                  GMX_NONBONDED_DO_POTENTIAL | GMX_NONBONDED_DO_FOREIGNLAMBDA,
+                                  lambdas,
+                                  dvdl,
+                                  energygrp_elec,
+                                  energygrp_vdw,
+                                  nrnb);
 }
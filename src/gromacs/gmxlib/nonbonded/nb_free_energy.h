@@ -73,4 +73,31 @@ void gmx_nb_free_energy_kernel(const t_nblist&                nlist,
                                gmx::ArrayRef<real>            energygrp_vdw,
                                t_nrnb* gmx_restrict           nrnb);
 
+/*! \brief Computes the perturbed non-bonded energies and dV/dlambda at multiple lambda points
+ *
+ * All lambda points are evaluated in a single pass over the pair list, so
+ * the lambda independent part of each pair interaction, such as the distance,
+ * exclusion check, parameter and table lookups, is only computed once.
+ * No forces are computed. The output for lambda point \p lambdas[l] is added
+ * to \p dvdl[l], \p energygrp_elec[l] and \p energygrp_vdw[l].
+ */
+void gmx_nb_free_energy_kernel_foreign_lambdas(const t_nblist&                nlist,
+                                               gmx::ArrayRef<const gmx::RVec> coords,
+                                               bool                           useSimd,
+                                               int                            ntype,
+                                               real                           rlist,
+                                               const interaction_const_t&     ic,
+                                               gmx::ArrayRef<const gmx::RVec> shiftvec,
+                                               gmx::ArrayRef<const real>      nbfp,
+                                               gmx::ArrayRef<const real>      nbfp_grid,
+                                               gmx::ArrayRef<const real>      chargeA,
+                                               gmx::ArrayRef<const real>      chargeB,
+                                               gmx::ArrayRef<const int>       typeA,
+                                               gmx::ArrayRef<const int>       typeB,
+                                               gmx::ArrayRef<const gmx::ArrayRef<const real>> lambdas,
+                                               gmx::ArrayRef<const gmx::ArrayRef<real>> dvdl,
+                                               gmx::ArrayRef<const gmx::ArrayRef<real>> energygrp_elec,
+                                               gmx::ArrayRef<const gmx::ArrayRef<real>> energygrp_vdw,
+                                               t_nrnb* gmx_restrict                     nrnb);
+
 #endif
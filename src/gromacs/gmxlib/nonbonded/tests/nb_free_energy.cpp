@@ -53,6 +53,7 @@
 #include "gromacs/gmxlib/nonbonded/nonbonded.h"
 
 #include <cmath>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -466,11 +467,123 @@ protected:
 
         checkOutput(&checker_, output);
     }
+
+    //! Checks that evaluating several lambda points in one pass matches separate evaluations
+    void checkForeignLambdas()
+    {
+        input_.frHelper.setSoftcoreAlpha(softcoreAlpha_);
+        input_.frHelper.setSoftcoreCoulomb(softcoreCoulomb_);
+
+        t_forcerec fr;
+        input_.frHelper.getForcerec(&fr);
+
+        t_nblist nbl = input_.atoms.getNbList();
+
+        // Lambda points with equal and with different Coulomb and VdW lambda values,
+        // more than the kernel computes in one pass over the pair list
+        const int numFepCouplingTerms = static_cast<int>(FreeEnergyPerturbationCouplingType::Count);
+        const int numLambdaPoints     = 70;
+        std::vector<std::vector<real>> lambdaPoints(numLambdaPoints);
+        lambdaPoints[0].assign(numFepCouplingTerms, lambda_);
+        lambdaPoints[1].assign(numFepCouplingTerms, 0.2_real);
+        lambdaPoints[2].assign(numFepCouplingTerms, 1.0_real);
+        lambdaPoints[1][static_cast<int>(FreeEnergyPerturbationCouplingType::Vdw)] = 0.7_real;
+        for (int l = 3; l < numLambdaPoints; l++)
+        {
+            lambdaPoints[l].assign(numFepCouplingTerms, real(l) / numLambdaPoints);
+        }
+        // Let the Coulomb and VdW lambda values differ only in the second pass
+        const int vdwIndex = static_cast<int>(FreeEnergyPerturbationCouplingType::Vdw);
+        lambdaPoints[numLambdaPoints - 1][vdwIndex] = 0.1_real;
+
+        std::vector<OutputQuantities>     multiOutput(lambdaPoints.size());
+        std::vector<ArrayRef<const real>> lambdas;
+        std::vector<ArrayRef<real>>       dvdl;
+        std::vector<ArrayRef<real>>       energygrpElec;
+        std::vector<ArrayRef<real>>       energygrpVdw;
+        for (size_t l = 0; l < lambdaPoints.size(); l++)
+        {
+            lambdas.emplace_back(lambdaPoints[l]);
+            dvdl.emplace_back(multiOutput[l].dvdLambda);
+            energygrpElec.emplace_back(
+                    multiOutput[l].energy.energyGroupPairTerms[NonBondedEnergyTerms::CoulombSR]);
+            energygrpVdw.emplace_back(
+                    multiOutput[l].energy.energyGroupPairTerms[NonBondedEnergyTerms::LJSR]);
+        }
+
+        t_nrnb nrnb;
+
+        gmx_nb_free_energy_kernel_foreign_lambdas(nbl,
+                                                  x_.arrayRefWithPadding().unpaddedArrayRef(),
+                                                  fr.use_simd_kernels,
+                                                  fr.ntype,
+                                                  fr.rlist,
+                                                  *fr.ic,
+                                                  fr.shift_vec,
+                                                  fr.nbfp,
+                                                  fr.ljpme_c6grid,
+                                                  input_.atoms.chargeA,
+                                                  input_.atoms.chargeB,
+                                                  input_.atoms.typeA,
+                                                  input_.atoms.typeB,
+                                                  lambdas,
+                                                  dvdl,
+                                                  energygrpElec,
+                                                  energygrpVdw,
+                                                  &nrnb);
+
+        for (size_t l = 0; l < lambdaPoints.size(); l++)
+        {
+            SCOPED_TRACE("Lambda point " + std::to_string(l));
+
+            OutputQuantities          output;
+            bool                      unusedBool = true;
+            gmx::ForceWithShiftForces forces(
+                    output.f.arrayRefWithPadding(), unusedBool, output.fShift);
+            gmx_nb_free_energy_kernel(nbl,
+                                      x_.arrayRefWithPadding().unpaddedArrayRef(),
+                                      &forces,
+                                      fr.use_simd_kernels,
+                                      fr.ntype,
+                                      fr.rlist,
+                                      *fr.ic,
+                                      fr.shift_vec,
+                                      fr.nbfp,
+                                      fr.ljpme_c6grid,
+                                      input_.atoms.chargeA,
+                                      input_.atoms.chargeB,
+                                      input_.atoms.typeA,
+                                      input_.atoms.typeB,
+                                      GMX_NONBONDED_DO_POTENTIAL | GMX_NONBONDED_DO_FOREIGNLAMBDA,
+                                      lambdaPoints[l],
+                                      output.dvdLambda,
+                                      output.energy.energyGroupPairTerms[NonBondedEnergyTerms::CoulombSR],
+                                      output.energy.energyGroupPairTerms[NonBondedEnergyTerms::LJSR],
+                                      &nrnb);
+
+            for (auto term : { NonBondedEnergyTerms::CoulombSR, NonBondedEnergyTerms::LJSR })
+            {
+                const real reference = output.energy.energyGroupPairTerms[term][0];
+                EXPECT_REAL_EQ_TOL(reference,
+                                   multiOutput[l].energy.energyGroupPairTerms[term][0],
+                                   relativeToleranceAsFloatingPoint(reference, 1e-5));
+            }
+            for (auto term :
+                 { FreeEnergyPerturbationCouplingType::Coul, FreeEnergyPerturbationCouplingType::Vdw })
+            {
+                const real reference = output.dvdLambda[static_cast<int>(term)];
+                EXPECT_REAL_EQ_TOL(reference,
+                                   multiOutput[l].dvdLambda[static_cast<int>(term)],
+                                   relativeToleranceAsFloatingPoint(reference, 1e-5));
+            }
+        }
+    }
 };
 
 TEST_P(NonbondedFepTest, testKernel)
 {
     testKernel();
+    checkForeignLambdas();
 }
 
 //! configurations to test
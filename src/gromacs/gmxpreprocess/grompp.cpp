@@ -478,7 +478,8 @@ static void check_vel(gmx_mtop_t* mtop, rvec v[])
 
 static void check_shells_inputrec(gmx_mtop_t* mtop, t_inputrec* ir, warninp* wi)
 {
-    int nshells = 0;
+    int nshells                  = 0;
+    int numShellsWithInvalidMass = 0;
 
     for (const AtomProxy atomP : AtomRange(*mtop))
     {
@@ -486,6 +487,29 @@ static void check_shells_inputrec(gmx_mtop_t* mtop, t_inputrec* ir, warninp* wi)
         if (local.ptype == ParticleType::Shell || local.ptype == ParticleType::Bond)
         {
             nshells++;
+            if (local.m <= 0 || local.mB != local.m)
+            {
+                numShellsWithInvalidMass++;
+            }
+        }
+    }
+    if (ir->shellPropagation == ShellPropagation::ExtendedLagrangian)
+    {
+        if (nshells == 0)
+        {
+            std::string warningMessage = gmx::formatString(
+                    "shell-propagation = %s has no effect without shells",
+                    enumValueToString(ShellPropagation::ExtendedLagrangian));
+            warning_note(wi, warningMessage.c_str());
+        }
+        else if (numShellsWithInvalidMass > 0)
+        {
+            std::string warningMessage = gmx::formatString(
+                    "With shell-propagation = %s all shells should have a mass that is not "
+                    "perturbed, but %d shells have no mass or a perturbed mass",
+                    enumValueToString(ShellPropagation::ExtendedLagrangian),
+                    numShellsWithInvalidMass);
+            warning_error(wi, warningMessage.c_str());
         }
     }
     if ((nshells > 0) && (ir->nstcalcenergy != 1))
@@ -624,6 +624,20 @@ void check_ir(const char*                    mdparin,
         CHECK(EEL_FULL(ir->coulombtype) && !EEL_PME(ir->coulombtype));
     }
 
+    /* SHELL STUFF */
+    if (ir->shellPropagation == ShellPropagation::ExtendedLagrangian)
+    {
+        sprintf(err_buf,
+                "shell-propagation = %s is only supported with integrator = %s",
+                enumValueToString(ShellPropagation::ExtendedLagrangian),
+                enumValueToString(IntegrationAlgorithm::MD));
+        CHECK(ir->eI != IntegrationAlgorithm::MD);
+        sprintf(err_buf, "shell-ref-t should be positive");
+        CHECK(ir->shellRefT <= 0);
+        sprintf(err_buf, "shell-tau-t should be positive");
+        CHECK(ir->shellTauT <= 0);
+    }
+
     /* SHAKE / LINCS */
     if ((opts->nshake > 0) && (opts->bMorse))
     {
@@ -2018,6 +2032,12 @@ void get_ir(const char*     mdparin,
     ir->niter = get_eint(&inp, "niter", 20, wi);
     printStringNoNewline(&inp, "Step size (ps^2) for minimization of flexible constraints");
     ir->fc_stepsize = get_ereal(&inp, "fcstep", 0, wi);
+    printStringNoNewline(
+            &inp, "Shell propagation: scf or extended-lagrangian with a thermostat for the shells");
+    ir->shellPropagation = getEnum<ShellPropagation>(&inp, "shell-propagation", wi);
+    printStringNoNewline(&inp, "Temperature (K) and time constant (ps) of the shell thermostat");
+    ir->shellRefT = get_ereal(&inp, "shell-ref-t", 1, wi);
+    ir->shellTauT = get_ereal(&inp, "shell-tau-t", 0.1, wi);
     printStringNoNewline(&inp, "Frequency of steepest descents steps when doing CG");
     ir->nstcgsteep = get_eint(&inp, "nstcgsteep", 1000, wi);
     ir->nbfgscorr  = get_eint(&inp, "nbfgscorr", 10, wi);
@@ -2968,6 +2988,7 @@ static void calc_nrdf(const gmx_mtop_t* mtop, t_inputrec* ir, char** gnames)
      * then subtract half a degree of freedom for each constraint
      *
      * Only atoms and nuclei contribute to the degrees of freedom...
+     * ...and shells, when they are propagated with an extended Lagrangian.
      */
 
     opts = &ir->opts;
@@ -2998,13 +3019,15 @@ static void calc_nrdf(const gmx_mtop_t* mtop, t_inputrec* ir, char** gnames)
         na_vcm[i]       = 0;
         nrdf_vcm_sub[i] = 0;
     }
+    const bool shellsHaveDof = (ir->shellPropagation == ShellPropagation::ExtendedLagrangian);
     snew(nrdf2, natoms);
     for (const AtomProxy atomP : AtomRange(*mtop))
     {
         const t_atom& local = atomP.atom();
         int           i     = atomP.globalAtomNumber();
         nrdf2[i]            = 0;
-        if (local.ptype == ParticleType::Atom || local.ptype == ParticleType::Nucleus)
+        if (local.ptype == ParticleType::Atom || local.ptype == ParticleType::Nucleus
+            || (local.ptype == ParticleType::Shell && shellsHaveDof))
         {
             int g = getGroupType(groups, SimulationAtomGroupType::Freeze, i);
             for (int d = 0; d < DIM; d++)
@@ -2587,20 +2587,21 @@ real unimplemented(int gmx_unused             nbonds,
 }
 
 template<BondedKernelFlavor flavor>
-real restrangles(int             nbonds,
-                 const t_iatom   forceatoms[],
-                 const t_iparams forceparams[],
-                 const rvec      x[],
-                 rvec4           f[],
-                 rvec            fshift[],
-                 const t_pbc*    pbc,
-                 real gmx_unused lambda,
-                 real gmx_unused* dvdlambda,
-                 gmx::ArrayRef<const real> /*charge*/,
-                 t_fcdata gmx_unused* fcd,
-                 t_disresdata gmx_unused* disresdata,
-                 t_oriresdata gmx_unused* oriresdata,
-                 int gmx_unused* global_atom_index)
+std::enable_if_t<flavor != BondedKernelFlavor::ForcesSimdWhenAvailable || !GMX_SIMD_HAVE_REAL, real>
+restrangles(int             nbonds,
+            const t_iatom   forceatoms[],
+            const t_iparams forceparams[],
+            const rvec      x[],
+            rvec4           f[],
+            rvec            fshift[],
+            const t_pbc*    pbc,
+            real gmx_unused lambda,
+            real gmx_unused* dvdlambda,
+            gmx::ArrayRef<const real> /*charge*/,
+            t_fcdata gmx_unused* fcd,
+            t_disresdata gmx_unused* disresdata,
+            t_oriresdata gmx_unused* oriresdata,
+            int gmx_unused* global_atom_index)
 {
     int    i, d, ai, aj, ak, type, m;
     int    t1, t2;
@@ -2690,21 +2691,288 @@ real restrangles(int             nbonds,
 }
 
 
+#if GMX_SIMD_HAVE_REAL
+
+/* As restrangles above, but using SIMD to calculate many restricted angles at once.
+ * This routines does not calculate energies and shift forces.
+ */
 template<BondedKernelFlavor flavor>
-real restrdihs(int             nbonds,
-               const t_iatom   forceatoms[],
-               const t_iparams forceparams[],
-               const rvec      x[],
-               rvec4           f[],
-               rvec            fshift[],
-               const t_pbc*    pbc,
-               real gmx_unused lambda,
-               real gmx_unused* dvlambda,
-               gmx::ArrayRef<const real> /*charge*/,
-               t_fcdata gmx_unused* fcd,
-               t_disresdata gmx_unused* disresdata,
-               t_oriresdata gmx_unused* oriresdata,
-               int gmx_unused* global_atom_index)
+std::enable_if_t<flavor == BondedKernelFlavor::ForcesSimdWhenAvailable, real>
+restrangles(int             nbonds,
+            const t_iatom   forceatoms[],
+            const t_iparams forceparams[],
+            const rvec      x[],
+            rvec4           f[],
+            rvec gmx_unused fshift[],
+            const t_pbc*    pbc,
+            real gmx_unused lambda,
+            real gmx_unused* dvdlambda,
+            gmx::ArrayRef<const real> /*charge*/,
+            t_fcdata gmx_unused* fcd,
+            t_disresdata gmx_unused* disresdata,
+            t_oriresdata gmx_unused* oriresdata,
+            int gmx_unused* global_atom_index)
+{
+    const int                                nfa1 = 4;
+    int                                      i, iu, s;
+    int                                      type;
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ai[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t aj[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ak[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         coeff[2 * GMX_SIMD_REAL_WIDTH];
+    SimdReal                                 deg2rad_S(gmx::c_deg2Rad);
+    SimdReal                                 xi_S, yi_S, zi_S;
+    SimdReal                                 xj_S, yj_S, zj_S;
+    SimdReal                                 xk_S, yk_S, zk_S;
+    SimdReal                                 k_S, cos_equil_S;
+    SimdReal                                 dax_S, day_S, daz_S;
+    SimdReal                                 dpx_S, dpy_S, dpz_S;
+    SimdReal                                 one_S(1.0);
+    SimdReal                                 c_ante_S, c_cros_S, c_post_S;
+    SimdReal                                 norm_S, cos_S, sin2_S;
+    SimdReal                                 ratio_ante_S, ratio_post_S;
+    SimdReal                                 delta_cos_S, prefactor_S;
+    SimdReal                                 f_ix_S, f_iy_S, f_iz_S;
+    SimdReal                                 f_kx_S, f_ky_S, f_kz_S;
+    alignas(GMX_SIMD_ALIGNMENT) real         pbc_simd[9 * GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of angles times nfa1, here we step GMX_SIMD_REAL_WIDTH angles */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH * nfa1)
+    {
+        /* Collect atoms for GMX_SIMD_REAL_WIDTH angles.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu + 1];
+            aj[s] = forceatoms[iu + 2];
+            ak[s] = forceatoms[iu + 3];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s * nfa1 < nbonds)
+            {
+                coeff[s]                       = forceparams[type].harmonic.krA;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = forceparams[type].harmonic.rA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[s]                       = 0;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = 0;
+            }
+        }
+
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), ai, &xi_S, &yi_S, &zi_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), aj, &xj_S, &yj_S, &zj_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), ak, &xk_S, &yk_S, &zk_S);
+        dax_S = xj_S - xi_S;
+        day_S = yj_S - yi_S;
+        daz_S = zj_S - zi_S;
+        dpx_S = xk_S - xj_S;
+        dpy_S = yk_S - yj_S;
+        dpz_S = zk_S - zj_S;
+
+        pbc_correct_dx_simd(&dax_S, &day_S, &daz_S, pbc_simd);
+        pbc_correct_dx_simd(&dpx_S, &dpy_S, &dpz_S, pbc_simd);
+
+        k_S = load<SimdReal>(coeff);
+        /* The equilibrium angle is defined for the supplementary angle */
+        cos_equil_S = -cos(load<SimdReal>(coeff + GMX_SIMD_REAL_WIDTH) * deg2rad_S);
+
+        /* See compute_factors_restangles() for the expressions below */
+        c_ante_S = norm2(dax_S, day_S, daz_S);
+        c_cros_S = iprod(dax_S, day_S, daz_S, dpx_S, dpy_S, dpz_S);
+        c_post_S = norm2(dpx_S, dpy_S, dpz_S);
+
+        norm_S = invsqrt(c_ante_S * c_post_S);
+        cos_S  = c_cros_S * norm_S;
+        /* As in the SIMD flavor of angles, we compute cos^2 using a division
+         * to avoid amplifying the invsqrt errors for cos values close to 1.
+         * The scalar code avoids this by using double precision.
+         */
+        sin2_S = one_S - c_cros_S * c_cros_S / (c_ante_S * c_post_S);
+
+        ratio_ante_S = c_cros_S * inv(c_ante_S);
+        ratio_post_S = c_cros_S * inv(c_post_S);
+
+        delta_cos_S = cos_S - cos_equil_S;
+        prefactor_S = -k_S * delta_cos_S * norm_S * fnma(cos_S, cos_equil_S, one_S)
+                      * inv(sin2_S * sin2_S);
+
+        f_ix_S = prefactor_S * fms(ratio_ante_S, dax_S, dpx_S);
+        f_iy_S = prefactor_S * fms(ratio_ante_S, day_S, dpy_S);
+        f_iz_S = prefactor_S * fms(ratio_ante_S, daz_S, dpz_S);
+        f_kx_S = prefactor_S * fnma(ratio_post_S, dpx_S, dax_S);
+        f_ky_S = prefactor_S * fnma(ratio_post_S, dpy_S, day_S);
+        f_kz_S = prefactor_S * fnma(ratio_post_S, dpz_S, daz_S);
+
+        /* The force on aj is minus the sum of the forces on ai and ak */
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ai, f_ix_S, f_iy_S, f_iz_S);
+        transposeScatterDecrU<4>(
+                reinterpret_cast<real*>(f), aj, f_ix_S + f_kx_S, f_iy_S + f_ky_S, f_iz_S + f_kz_S);
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ak, f_kx_S, f_ky_S, f_kz_S);
+    }
+
+    return 0;
+}
+
+/*! \brief Distance vectors and their scalar products for GMX_SIMD_REAL_WIDTH
+ * restricted or CBT dihedrals, see compute_factors_restrdihs() */
+struct RestcbtDihedralSimd
+{
+    //! The distance vector x[aj] - x[ai]
+    SimdReal delta_ante[DIM];
+    //! The distance vector x[ak] - x[aj]
+    SimdReal delta_crnt[DIM];
+    //! The distance vector x[al] - x[ak]
+    SimdReal delta_post[DIM];
+    //! Scalar products of the distance vectors
+    SimdReal c_self_ante, c_self_crnt, c_self_post;
+    //! Scalar products of the distance vectors
+    SimdReal c_cros_ante, c_cros_acrs, c_cros_post;
+    //! Differences of products of scalar products
+    SimdReal c_prod, d_ante, d_post;
+};
+
+/*! \brief Loads the PBC corrected distance vectors for GMX_SIMD_REAL_WIDTH
+ * dihedrals and computes the scalar products shared by the restricted
+ * and CBT dihedral potentials */
+inline void gmx_simdcall restcbt_dih_deltas_simd(const rvec           x[],
+                                                 const int*           ai,
+                                                 const int*           aj,
+                                                 const int*           ak,
+                                                 const int*           al,
+                                                 const real*          pbc_simd,
+                                                 RestcbtDihedralSimd* dih)
+{
+    SimdReal xi_S[DIM], xj_S[DIM], xk_S[DIM], xl_S[DIM];
+    SimdReal eps_S(GMX_REAL_EPS);
+
+    gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), ai, &xi_S[XX], &xi_S[YY], &xi_S[ZZ]);
+    gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), aj, &xj_S[XX], &xj_S[YY], &xj_S[ZZ]);
+    gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), ak, &xk_S[XX], &xk_S[YY], &xk_S[ZZ]);
+    gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), al, &xl_S[XX], &xl_S[YY], &xl_S[ZZ]);
+
+    for (int d = 0; d < DIM; d++)
+    {
+        dih->delta_ante[d] = xj_S[d] - xi_S[d];
+        dih->delta_crnt[d] = xk_S[d] - xj_S[d];
+        dih->delta_post[d] = xl_S[d] - xk_S[d];
+    }
+    pbc_correct_dx_simd(&dih->delta_ante[XX], &dih->delta_ante[YY], &dih->delta_ante[ZZ], pbc_simd);
+    pbc_correct_dx_simd(&dih->delta_crnt[XX], &dih->delta_crnt[YY], &dih->delta_crnt[ZZ], pbc_simd);
+    pbc_correct_dx_simd(&dih->delta_post[XX], &dih->delta_post[YY], &dih->delta_post[ZZ], pbc_simd);
+
+    const SimdReal* da = dih->delta_ante;
+    const SimdReal* dc = dih->delta_crnt;
+    const SimdReal* dp = dih->delta_post;
+
+    dih->c_self_ante = norm2(da[XX], da[YY], da[ZZ]);
+    dih->c_self_crnt = norm2(dc[XX], dc[YY], dc[ZZ]);
+    dih->c_self_post = norm2(dp[XX], dp[YY], dp[ZZ]);
+    dih->c_cros_ante = iprod(da[XX], da[YY], da[ZZ], dc[XX], dc[YY], dc[ZZ]);
+    dih->c_cros_acrs = iprod(da[XX], da[YY], da[ZZ], dp[XX], dp[YY], dp[ZZ]);
+    dih->c_cros_post = iprod(dc[XX], dc[YY], dc[ZZ], dp[XX], dp[YY], dp[ZZ]);
+    dih->c_prod = fms(dih->c_cros_ante, dih->c_cros_post, dih->c_self_crnt * dih->c_cros_acrs);
+    dih->d_ante = fms(dih->c_self_ante, dih->c_self_crnt, dih->c_cros_ante * dih->c_cros_ante);
+    dih->d_post = fms(dih->c_self_post, dih->c_self_crnt, dih->c_cros_post * dih->c_cros_post);
+
+    /* Avoid small values when three consecutive beads align */
+    dih->d_ante = max(dih->d_ante, eps_S);
+    dih->d_post = max(dih->d_post, eps_S);
+}
+
+/*! \brief Computes a force as a linear combination of the three distance vectors */
+inline void gmx_simdcall restcbt_dih_force_simd(const RestcbtDihedralSimd& dih,
+                                                SimdReal                   factor_ante,
+                                                SimdReal                   factor_crnt,
+                                                SimdReal                   factor_post,
+                                                SimdReal                   force[DIM])
+{
+    for (int d = 0; d < DIM; d++)
+    {
+        force[d] = fma(factor_ante,
+                       dih.delta_ante[d],
+                       fma(factor_crnt, dih.delta_crnt[d], factor_post * dih.delta_post[d]));
+    }
+}
+
+/*! \brief Computes the forces due to the derivatives of the dihedral angle
+ *
+ * The factors are those of compute_factors_restrdihs(), here pre-multiplied
+ * by \p prefactor_phi.
+ */
+inline void gmx_simdcall restcbt_dih_phi_forces_simd(const RestcbtDihedralSimd& dih,
+                                                     SimdReal                   prefactor_phi,
+                                                     SimdReal                   ratio_phi_ante,
+                                                     SimdReal                   ratio_phi_post,
+                                                     SimdReal                   f_i[DIM],
+                                                     SimdReal                   f_j[DIM],
+                                                     SimdReal                   f_k[DIM],
+                                                     SimdReal                   f_l[DIM])
+{
+    const SimdReal two_S(2.0);
+    const SimdReal pr_ante = prefactor_phi * ratio_phi_ante;
+    const SimdReal pr_post = prefactor_phi * ratio_phi_post;
+    const SimdReal p_self_crnt = prefactor_phi * dih.c_self_crnt;
+    const SimdReal p_cros_ante = prefactor_phi * dih.c_cros_ante;
+    const SimdReal p_cros_post = prefactor_phi * dih.c_cros_post;
+    const SimdReal p_cros_acrs2 = prefactor_phi * two_S * dih.c_cros_acrs;
+
+    restcbt_dih_force_simd(dih,
+                           pr_ante * dih.c_self_crnt,
+                           fnma(pr_ante, dih.c_cros_ante, -p_cros_post),
+                           p_self_crnt,
+                           f_i);
+    restcbt_dih_force_simd(dih,
+                           fnma(pr_ante, dih.c_self_crnt + dih.c_cros_ante, -p_cros_post),
+                           p_cros_post + p_cros_acrs2
+                                   + fma(pr_ante,
+                                         dih.c_self_ante + dih.c_cros_ante,
+                                         pr_post * dih.c_self_post),
+                           fnma(pr_post, dih.c_cros_post, -(p_cros_ante + p_self_crnt)),
+                           f_j);
+    restcbt_dih_force_simd(dih,
+                           fma(pr_ante, dih.c_cros_ante, p_cros_post + p_self_crnt),
+                           -(p_cros_ante + p_cros_acrs2)
+                                   - fma(pr_ante,
+                                         dih.c_self_ante,
+                                         pr_post * (dih.c_self_post + dih.c_cros_post)),
+                           fma(pr_post, dih.c_self_crnt + dih.c_cros_post, p_cros_ante),
+                           f_k);
+    restcbt_dih_force_simd(dih,
+                           -p_self_crnt,
+                           fma(pr_post, dih.c_cros_post, p_cros_ante),
+                           -pr_post * dih.c_self_crnt,
+                           f_l);
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
+template<BondedKernelFlavor flavor>
+std::enable_if_t<flavor != BondedKernelFlavor::ForcesSimdWhenAvailable || !GMX_SIMD_HAVE_REAL, real>
+restrdihs(int             nbonds,
+          const t_iatom   forceatoms[],
+          const t_iparams forceparams[],
+          const rvec      x[],
+          rvec4           f[],
+          rvec            fshift[],
+          const t_pbc*    pbc,
+          real gmx_unused lambda,
+          real gmx_unused* dvlambda,
+          gmx::ArrayRef<const real> /*charge*/,
+          t_fcdata gmx_unused* fcd,
+          t_disresdata gmx_unused* disresdata,
+          t_oriresdata gmx_unused* oriresdata,
+          int gmx_unused* global_atom_index)
 {
     int  i, d, type, ai, aj, ak, al;
     rvec f_i, f_j, f_k, f_l;
@@ -2814,21 +3082,133 @@ real restrdihs(int             nbonds,
 }
 
 
+#if GMX_SIMD_HAVE_REAL
+
+/* As restrdihs above, but using SIMD to calculate many dihedrals at once.
+ * This routines does not calculate energies and shift forces.
+ */
+template<BondedKernelFlavor flavor>
+std::enable_if_t<flavor == BondedKernelFlavor::ForcesSimdWhenAvailable, real>
+restrdihs(int             nbonds,
+          const t_iatom   forceatoms[],
+          const t_iparams forceparams[],
+          const rvec      x[],
+          rvec4           f[],
+          rvec gmx_unused fshift[],
+          const t_pbc*    pbc,
+          real gmx_unused lambda,
+          real gmx_unused* dvlambda,
+          gmx::ArrayRef<const real> /*charge*/,
+          t_fcdata gmx_unused* fcd,
+          t_disresdata gmx_unused* disresdata,
+          t_oriresdata gmx_unused* oriresdata,
+          int gmx_unused* global_atom_index)
+{
+    const int                                nfa1 = 5;
+    int                                      i, iu, s;
+    int                                      type;
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ai[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t aj[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ak[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t al[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         coeff[2 * GMX_SIMD_REAL_WIDTH];
+    SimdReal                                 deg2rad_S(gmx::c_deg2Rad);
+    SimdReal                                 one_S(1.0);
+    SimdReal                                 zero_S(0.0);
+    RestcbtDihedralSimd                      dih;
+    SimdReal                                 k_S, cos_phi0_S;
+    SimdReal                                 norm_phi_S, cos_phi_S, sin2_phi_S;
+    SimdReal                                 delta_cos_S, prefactor_phi_S;
+    SimdReal                                 f_i_S[DIM], f_j_S[DIM], f_k_S[DIM], f_l_S[DIM];
+    alignas(GMX_SIMD_ALIGNMENT) real         pbc_simd[9 * GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH * nfa1)
+    {
+        /* Collect atoms quadruplets for GMX_SIMD_REAL_WIDTH dihedrals.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu + 1];
+            aj[s] = forceatoms[iu + 2];
+            ak[s] = forceatoms[iu + 3];
+            al[s] = forceatoms[iu + 4];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s * nfa1 < nbonds)
+            {
+                coeff[s]                       = forceparams[type].pdihs.cpA;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = forceparams[type].pdihs.phiA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[s]                       = 0;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = 0;
+            }
+        }
+
+        restcbt_dih_deltas_simd(x, ai, aj, ak, al, pbc_simd, &dih);
+
+        k_S        = load<SimdReal>(coeff);
+        cos_phi0_S = cos(load<SimdReal>(coeff + GMX_SIMD_REAL_WIDTH) * deg2rad_S);
+
+        /* See compute_factors_restrdihs() for the expressions below */
+        norm_phi_S = invsqrt(dih.d_ante * dih.d_post);
+        cos_phi_S  = dih.c_prod * norm_phi_S;
+        /* cos(phi) can be slightly larger than 1 due to round-off errors */
+        sin2_phi_S = max(fnma(cos_phi_S, cos_phi_S, one_S), zero_S);
+
+        delta_cos_S     = cos_phi_S - cos_phi0_S;
+        prefactor_phi_S = -k_S * delta_cos_S * norm_phi_S * fnma(cos_phi_S, cos_phi0_S, one_S)
+                          * inv(sin2_phi_S * sin2_phi_S);
+
+        restcbt_dih_phi_forces_simd(dih,
+                                    prefactor_phi_S,
+                                    dih.c_prod * inv(dih.d_ante),
+                                    dih.c_prod * inv(dih.d_post),
+                                    f_i_S,
+                                    f_j_S,
+                                    f_k_S,
+                                    f_l_S);
+
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ai, f_i_S[XX], f_i_S[YY], f_i_S[ZZ]);
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), aj, f_j_S[XX], f_j_S[YY], f_j_S[ZZ]);
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ak, f_k_S[XX], f_k_S[YY], f_k_S[ZZ]);
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), al, f_l_S[XX], f_l_S[YY], f_l_S[ZZ]);
+    }
+
+    return 0;
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
+
 template<BondedKernelFlavor flavor>
-real cbtdihs(int             nbonds,
-             const t_iatom   forceatoms[],
-             const t_iparams forceparams[],
-             const rvec      x[],
-             rvec4           f[],
-             rvec            fshift[],
-             const t_pbc*    pbc,
-             real gmx_unused lambda,
-             real gmx_unused* dvdlambda,
-             gmx::ArrayRef<const real> /*charge*/,
-             t_fcdata gmx_unused* fcd,
-             t_disresdata gmx_unused* disresdata,
-             t_oriresdata gmx_unused* oriresdata,
-             int gmx_unused* global_atom_index)
+std::enable_if_t<flavor != BondedKernelFlavor::ForcesSimdWhenAvailable || !GMX_SIMD_HAVE_REAL, real>
+cbtdihs(int             nbonds,
+        const t_iatom   forceatoms[],
+        const t_iparams forceparams[],
+        const rvec      x[],
+        rvec4           f[],
+        rvec            fshift[],
+        const t_pbc*    pbc,
+        real gmx_unused lambda,
+        real gmx_unused* dvdlambda,
+        gmx::ArrayRef<const real> /*charge*/,
+        t_fcdata gmx_unused* fcd,
+        t_disresdata gmx_unused* disresdata,
+        t_oriresdata gmx_unused* oriresdata,
+        int gmx_unused* global_atom_index)
 {
     int  type, ai, aj, ak, al, i, d;
     int  t1, t2, t3;
@@ -2930,6 +3310,187 @@ real cbtdihs(int             nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/* As cbtdihs above, but using SIMD to calculate many dihedrals at once.
+ * This routines does not calculate energies and shift forces.
+ */
+template<BondedKernelFlavor flavor>
+std::enable_if_t<flavor == BondedKernelFlavor::ForcesSimdWhenAvailable, real>
+cbtdihs(int             nbonds,
+        const t_iatom   forceatoms[],
+        const t_iparams forceparams[],
+        const rvec      x[],
+        rvec4           f[],
+        rvec gmx_unused fshift[],
+        const t_pbc*    pbc,
+        real gmx_unused lambda,
+        real gmx_unused* dvdlambda,
+        gmx::ArrayRef<const real> /*charge*/,
+        t_fcdata gmx_unused* fcd,
+        t_disresdata gmx_unused* disresdata,
+        t_oriresdata gmx_unused* oriresdata,
+        int gmx_unused* global_atom_index)
+{
+    const int                                nfa1 = 5;
+    int                                      i, iu, s, j, d;
+    int                                      type;
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ai[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t aj[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ak[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t al[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         coeff[NR_CBTDIHS * GMX_SIMD_REAL_WIDTH];
+    SimdReal                                 one_S(1.0);
+    SimdReal                                 zero_S(0.0);
+    SimdReal                                 two_S(2.0);
+    SimdReal                                 three_S(3.0);
+    SimdReal                                 four_S(4.0);
+    RestcbtDihedralSimd                      dih;
+    SimdReal                                 c_S[NR_CBTDIHS];
+    SimdReal                                 norm_phi_S, norm_theta_ante_S, norm_theta_post_S;
+    SimdReal                                 cos_phi_S, cos_theta_ante_S, cos_theta_post_S;
+    SimdReal                                 sin2_theta_ante_S, sin2_theta_post_S;
+    SimdReal                                 sin_theta_ante_S, sin_theta_post_S;
+    SimdReal                                 sin3_theta_ante_S, sin3_theta_post_S;
+    SimdReal                                 poly_S, dpoly_S;
+    SimdReal                                 prefactor_phi_S;
+    SimdReal                                 prefactor_theta_ante_S, prefactor_theta_post_S;
+    SimdReal                                 ratio_ante_ante_S, ratio_ante_crnt_S;
+    SimdReal                                 ratio_post_crnt_S, ratio_post_post_S;
+    SimdReal                                 f_theta_S[DIM], f_theta2_S[DIM];
+    SimdReal                                 f_i_S[DIM], f_j_S[DIM], f_k_S[DIM], f_l_S[DIM];
+    alignas(GMX_SIMD_ALIGNMENT) real         pbc_simd[9 * GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH * nfa1)
+    {
+        /* Collect atoms quadruplets for GMX_SIMD_REAL_WIDTH dihedrals.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu + 1];
+            aj[s] = forceatoms[iu + 2];
+            ak[s] = forceatoms[iu + 3];
+            al[s] = forceatoms[iu + 4];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s * nfa1 < nbonds)
+            {
+                for (j = 0; j < NR_CBTDIHS; j++)
+                {
+                    coeff[j * GMX_SIMD_REAL_WIDTH + s] = forceparams[type].cbtdihs.cbtcA[j];
+                }
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                for (j = 0; j < NR_CBTDIHS; j++)
+                {
+                    coeff[j * GMX_SIMD_REAL_WIDTH + s] = 0;
+                }
+            }
+        }
+
+        restcbt_dih_deltas_simd(x, ai, aj, ak, al, pbc_simd, &dih);
+
+        for (j = 0; j < NR_CBTDIHS; j++)
+        {
+            c_S[j] = load<SimdReal>(coeff + j * GMX_SIMD_REAL_WIDTH);
+        }
+
+        /* See compute_factors_cbtdihs() for the expressions below */
+        norm_phi_S        = invsqrt(dih.d_ante * dih.d_post);
+        norm_theta_ante_S = invsqrt(dih.c_self_ante * dih.c_self_crnt);
+        norm_theta_post_S = invsqrt(dih.c_self_crnt * dih.c_self_post);
+        cos_phi_S         = dih.c_prod * norm_phi_S;
+        cos_theta_ante_S  = dih.c_cros_ante * norm_theta_ante_S;
+        cos_theta_post_S  = dih.c_cros_post * norm_theta_post_S;
+        /* cos(theta) can be slightly larger than 1 due to round-off errors */
+        sin2_theta_ante_S = max(fnma(cos_theta_ante_S, cos_theta_ante_S, one_S), zero_S);
+        sin2_theta_post_S = max(fnma(cos_theta_post_S, cos_theta_post_S, one_S), zero_S);
+        sin_theta_ante_S  = sqrt(sin2_theta_ante_S);
+        sin_theta_post_S  = sqrt(sin2_theta_post_S);
+        sin3_theta_ante_S = sin2_theta_ante_S * sin_theta_ante_S;
+        sin3_theta_post_S = sin2_theta_post_S * sin_theta_post_S;
+
+        /* The torsion polynomial in cos(phi) and its derivative */
+        poly_S = fma(cos_phi_S, c_S[5], c_S[4]);
+        poly_S = fma(cos_phi_S, poly_S, c_S[3]);
+        poly_S = fma(cos_phi_S, poly_S, c_S[2]);
+        poly_S = fma(cos_phi_S, poly_S, c_S[1]);
+
+        dpoly_S = fma(cos_phi_S, four_S * c_S[5], three_S * c_S[4]);
+        dpoly_S = fma(cos_phi_S, dpoly_S, two_S * c_S[3]);
+        dpoly_S = fma(cos_phi_S, dpoly_S, c_S[2]);
+
+        /* Forces due to the derivatives of the dihedral angle phi */
+        prefactor_phi_S = -c_S[0] * norm_phi_S * dpoly_S * sin3_theta_ante_S * sin3_theta_post_S;
+
+        restcbt_dih_phi_forces_simd(dih,
+                                    prefactor_phi_S,
+                                    dih.c_prod * inv(dih.d_ante),
+                                    dih.c_prod * inv(dih.d_post),
+                                    f_i_S,
+                                    f_j_S,
+                                    f_k_S,
+                                    f_l_S);
+
+        /* Forces due to the derivatives of the bending angle theta_ante,
+         * the force on aj is minus the sum of the forces on ai and ak.
+         */
+        prefactor_theta_ante_S = three_S * c_S[0] * norm_theta_ante_S * poly_S * cos_theta_ante_S
+                                 * sin_theta_ante_S * sin3_theta_post_S;
+        ratio_ante_ante_S = dih.c_cros_ante * inv(dih.c_self_ante);
+        ratio_ante_crnt_S = dih.c_cros_ante * inv(dih.c_self_crnt);
+        for (d = 0; d < DIM; d++)
+        {
+            f_theta_S[d] = prefactor_theta_ante_S
+                           * fms(ratio_ante_ante_S, dih.delta_ante[d], dih.delta_crnt[d]);
+            f_theta2_S[d] = prefactor_theta_ante_S
+                            * fnma(ratio_ante_crnt_S, dih.delta_crnt[d], dih.delta_ante[d]);
+            f_i_S[d] = f_i_S[d] + f_theta_S[d];
+            f_j_S[d] = f_j_S[d] - f_theta_S[d] - f_theta2_S[d];
+            f_k_S[d] = f_k_S[d] + f_theta2_S[d];
+        }
+
+        /* Forces due to the derivatives of the bending angle theta_post,
+         * the force on ak is minus the sum of the forces on aj and al.
+         */
+        prefactor_theta_post_S = three_S * c_S[0] * norm_theta_post_S * poly_S * cos_theta_post_S
+                                 * sin_theta_post_S * sin3_theta_ante_S;
+        ratio_post_crnt_S = dih.c_cros_post * inv(dih.c_self_crnt);
+        ratio_post_post_S = dih.c_cros_post * inv(dih.c_self_post);
+        for (d = 0; d < DIM; d++)
+        {
+            f_theta_S[d] = prefactor_theta_post_S
+                           * fms(ratio_post_crnt_S, dih.delta_crnt[d], dih.delta_post[d]);
+            f_theta2_S[d] = prefactor_theta_post_S
+                            * fnma(ratio_post_post_S, dih.delta_post[d], dih.delta_crnt[d]);
+            f_j_S[d] = f_j_S[d] + f_theta_S[d];
+            f_k_S[d] = f_k_S[d] - f_theta_S[d] - f_theta2_S[d];
+            f_l_S[d] = f_l_S[d] + f_theta2_S[d];
+        }
+
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ai, f_i_S[XX], f_i_S[YY], f_i_S[ZZ]);
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), aj, f_j_S[XX], f_j_S[YY], f_j_S[ZZ]);
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ak, f_k_S[XX], f_k_S[YY], f_k_S[ZZ]);
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), al, f_l_S[XX], f_l_S[YY], f_l_S[ZZ]);
+    }
+
+    return 0;
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 template<BondedKernelFlavor flavor>
 std::enable_if_t<flavor != BondedKernelFlavor::ForcesSimdWhenAvailable || !GMX_SIMD_HAVE_REAL, real>
 rbdihs(int             nbonds,
@@ -47,6 +47,7 @@
 #include <cstring>
 
 #include <algorithm>
+#include <memory>
 
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/math/functions.h"
@@ -69,6 +70,8 @@
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/smalloc.h"
 
+#include "ensemble_sum.h"
+
 void init_disres(FILE*                 fplog,
                  const gmx_mtop_t&     mtop,
                  t_inputrec*           ir,
@@ -270,6 +273,13 @@ void init_disres(FILE*                 fplog,
     else
     {
         snew(dd->Rtl_6, dd->nres);
+
+        const int nstSum = gmx::nmrEnsembleSumIntervalFromEnvironment(fplog);
+        if (ddRole == DDRole::Master)
+        {
+            check_multi_int(fplog, ms, nstSum, "GMX_NMR_ENSEMBLE_NSTSUM", FALSE);
+        }
+        dd->ensembleSum = std::make_unique<gmx::EnsembleSum>(2 * dd->nres, nstSum);
     }
 
     if (dd->npair > 0)
@@ -295,6 +305,7 @@ void init_disres(FILE*                 fplog,
 
 void calc_disres_R_6(const t_commrec*      cr,
                      const gmx_multisim_t* ms,
+                     const int64_t         step,
                      int                   nfa,
                      const t_iatom         forceatoms[],
                      const rvec            x[],
@@ -395,7 +406,7 @@ void calc_disres_R_6(const t_commrec*      cr,
         }
 
         GMX_ASSERT(cr != nullptr && ms != nullptr, "We need multisim with nsystems>1");
-        gmx_sum_sim(2 * dd->nres, dd->Rt_6, ms);
+        dd->ensembleSum->sum(gmx::arrayRefFromArray(dd->Rt_6, 2 * dd->nres), ms, step);
 
         if (DOMAINDECOMP(cr))
         {
@@ -636,6 +647,10 @@ real ta_disres(int              nfa,
     return vtot;
 }
 
+t_disresdata::t_disresdata() = default;
+
+t_disresdata::~t_disresdata() = default;
+
 void update_disres_history(const t_disresdata& dd, history_t* hist)
 {
     if (dd.dr_tau != 0)
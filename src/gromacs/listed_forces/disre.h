@@ -45,6 +45,7 @@
 #ifndef GMX_LISTED_FORCES_DISRE_H
 #define GMX_LISTED_FORCES_DISRE_H
 
+#include <cstdint>
 #include <cstdio>
 
 #include "gromacs/topology/ifunc.h"
@@ -102,9 +103,13 @@ void init_disres(FILE*                 fplog,
 /*! \brief
  * Calculates r and r^-3 (inst. and time averaged) for all pairs
  * and the ensemble averaged r^-6 (inst. and time averaged) for all restraints
+ *
+ * The MD \p step sets when the ensemble sums are done with
+ * GMX_NMR_ENSEMBLE_NSTSUM, see gmx::EnsembleSum.
  */
 void calc_disres_R_6(const t_commrec*      cr,
                      const gmx_multisim_t* ms,
+                     int64_t               step,
                      int                   nfa,
                      const t_iatom*        fa,
                      const rvec*           x,
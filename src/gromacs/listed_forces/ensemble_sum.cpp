@@ -0,0 +1,152 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Defines a class for summing restraint data over an ensemble
+ * of simulations with optionally lagged, non-blocking collectives.
+ *
+ * \ingroup module_listed_forces
+ */
+#include "gmxpre.h"
+
+#include "ensemble_sum.h"
+
+#include <cstdlib>
+
+#include <algorithm>
+
+#include "gromacs/mdrunutility/multisim.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+int nmrEnsembleSumIntervalFromEnvironment(FILE* fplog)
+{
+    const char* env = std::getenv("GMX_NMR_ENSEMBLE_NSTSUM");
+    if (env == nullptr)
+    {
+        return 0;
+    }
+
+    int nstSum = 0;
+    if (sscanf(env, "%d", &nstSum) != 1 || nstSum < 0)
+    {
+        gmx_fatal(FARGS, "GMX_NMR_ENSEMBLE_NSTSUM should be a non-negative integer, not '%s'", env);
+    }
+    if (fplog && nstSum > 0)
+    {
+        fprintf(fplog,
+                "Found GMX_NMR_ENSEMBLE_NSTSUM set to %d, NMR restraint data of the other "
+                "systems in the ensemble lags by at most %d steps\n",
+                nstSum,
+                nstSum);
+    }
+
+    return nstSum;
+}
+
+EnsembleSum::EnsembleSum(const int numValues, const int nstSum) :
+    nstSum_(nstSum),
+    sumBuffer_(nstSum > 0 ? numValues : 0),
+    localContributions_(nstSum > 0 ? numValues : 0),
+    otherContributions_(nstSum > 0 ? numValues : 0)
+{
+    GMX_RELEASE_ASSERT(nstSum >= 0, "The ensemble sum interval should not be negative");
+}
+
+EnsembleSum::~EnsembleSum()
+{
+    if (sumIsInProgress_)
+    {
+        gmx_sumd_sim_finish(&sumRequest_);
+    }
+}
+
+void EnsembleSum::sum(ArrayRef<real> values, const gmx_multisim_t* ms, const int64_t step)
+{
+    if (nstSum_ == 0)
+    {
+        gmx_sum_sim(values.ssize(), values.data(), ms);
+
+        return;
+    }
+
+    GMX_ASSERT(values.size() == sumBuffer_.size(), "The number of values should not change");
+
+    const int numValues = values.ssize();
+
+    if (sumIsInProgress_)
+    {
+        gmx_sumd_sim_finish(&sumRequest_);
+        sumIsInProgress_ = false;
+
+        for (int i = 0; i < numValues; i++)
+        {
+            otherContributions_[i] = sumBuffer_[i] - localContributions_[i];
+        }
+    }
+
+    if (!haveStartedSum_)
+    {
+        /* There is no previous sum yet, so we need a blocking sum */
+        std::copy(values.begin(), values.end(), sumBuffer_.begin());
+        gmx_sumd_sim(numValues, sumBuffer_.data(), ms);
+        for (int i = 0; i < numValues; i++)
+        {
+            otherContributions_[i] = sumBuffer_[i] - values[i];
+        }
+        haveStartedSum_ = true;
+        lastSumStep_    = step;
+    }
+    else if (step - lastSumStep_ >= nstSum_)
+    {
+        /* Start a sum that we complete at the next call */
+        std::copy(values.begin(), values.end(), localContributions_.begin());
+        std::copy(values.begin(), values.end(), sumBuffer_.begin());
+        gmx_sumd_sim_start(numValues, sumBuffer_.data(), ms, &sumRequest_);
+        sumIsInProgress_ = true;
+        lastSumStep_     = step;
+    }
+
+    for (int i = 0; i < numValues; i++)
+    {
+        values[i] += otherContributions_[i];
+    }
+}
+
+} // namespace gmx
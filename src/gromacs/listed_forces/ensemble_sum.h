@@ -0,0 +1,128 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Declares a class for summing restraint data over an ensemble
+ * of simulations with optionally lagged, non-blocking collectives.
+ *
+ * \ingroup module_listed_forces
+ */
+
+#ifndef GMX_LISTED_FORCES_ENSEMBLE_SUM_H
+#define GMX_LISTED_FORCES_ENSEMBLE_SUM_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include <vector>
+
+#include "gromacs/utility/classhelpers.h"
+#include "gromacs/utility/gmxmpi.h"
+#include "gromacs/utility/real.h"
+
+struct gmx_multisim_t;
+
+namespace gmx
+{
+template<typename>
+class ArrayRef;
+
+/*! \brief Returns the interval in steps for lagged ensemble sums of NMR restraint data
+ *
+ * Reads the environment variable GMX_NMR_ENSEMBLE_NSTSUM. Returns 0,
+ * which means a blocking sum every step, when it is not set.
+ */
+int nmrEnsembleSumIntervalFromEnvironment(FILE* fplog);
+
+/*! \internal \brief Sums the contributions of the simulations of an ensemble
+ *
+ * With a sum interval of 0, every call to sum() does a blocking sum over
+ * the simulations. With an interval of N > 0 steps, a non-blocking sum
+ * over the simulations is started when at least N MD steps have passed
+ * since the start of the previous sum. It is completed at the next call,
+ * so it overlaps with the rest of the MD step. In between, the sum is
+ * the contribution of this simulation at the current step plus the
+ * contributions of the other simulations of the last completed sum.
+ * Thus only the contributions of the other simulations lag. When sum()
+ * is called every step, they lag by at most N steps. The first call
+ * always does a blocking sum.
+ *
+ * All simulations should call sum() at the same steps.
+ */
+class EnsembleSum
+{
+public:
+    /*! \brief Constructor
+     *
+     * \param[in] numValues  The number of values to sum
+     * \param[in] nstSum     The interval in MD steps for the sums over the simulations
+     */
+    EnsembleSum(int numValues, int nstSum);
+
+    //! Destructor, completes a sum that is still in progress
+    ~EnsembleSum();
+
+    /*! \brief Replaces the contributions of this simulation by the (lagged) ensemble sums
+     *
+     * \param[in,out] values  The contributions of this simulation, returns the sums
+     * \param[in]     ms      The multi-simulation setup
+     * \param[in]     step    The MD step, determines when to sum over the simulations
+     */
+    void sum(ArrayRef<real> values, const gmx_multisim_t* ms, int64_t step);
+
+private:
+    //! The interval in MD steps for the sums over the simulations, 0 means blocking sums every call
+    int nstSum_;
+    //! Whether a sum over the simulations has been started
+    bool haveStartedSum_ = false;
+    //! The step at which the last sum over the simulations was started
+    int64_t lastSumStep_ = 0;
+    //! Buffer for the sum over the simulations
+    std::vector<double> sumBuffer_;
+    //! The contributions of this simulation to the sum that is in progress
+    std::vector<real> localContributions_;
+    //! The contributions of the other simulations of the last completed sum
+    std::vector<double> otherContributions_;
+    //! Whether a sum over the simulations is in progress
+    bool sumIsInProgress_ = false;
+    //! The request for the sum that is in progress
+    MPI_Request sumRequest_;
+
+    GMX_DISALLOW_COPY_AND_ASSIGN(EnsembleSum);
+};
+
+} // namespace gmx
+
+#endif
@@ -53,6 +53,7 @@
 #include <algorithm>
 #include <array>
 #include <numeric>
+#include <utility>
 
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/gmxlib/nrnb.h"
@@ -92,7 +93,7 @@ ListedForces::ListedForces(const gmx_ffparams_t&      ffparams,
     idefSelection_(ffparams),
     threading_(std::make_unique<bonded_threading_t>(numThreads, numEnergyGroups, fplog)),
     interactionSelection_(interactionSelection),
-    foreignEnergyGroups_(std::make_unique<gmx_grppairener_t>(numEnergyGroups))
+    numEnergyGroups_(numEnergyGroups)
 {
 }
 
@@ -430,8 +431,6 @@ real calc_one_bond(int                           thread,
 
     const bool havePerturbedInteractions =
             (idef.ilsort == ilsortFE_SORTED && numNonperturbedInteractions < iatoms.ssize());
-    BondedKernelFlavor flavor =
-            selectBondedKernelFlavor(stepWork, fr->use_simd_kernels, havePerturbedInteractions);
     FreeEnergyPerturbationCouplingType efptFTYPE;
     if (IS_RESTRAINT_TYPE(ftype))
     {
@@ -449,81 +448,111 @@ real calc_one_bond(int                           thread,
                "The thread division should match the topology");
 
     const int nb0 = workDivision.bound(ftype, thread);
-    const int nbn = workDivision.bound(ftype, thread + 1) - nb0;
+    const int nb1 = workDivision.bound(ftype, thread + 1);
+
+    /* The perturbed interactions are stored at the end of the list.
+     * We split the range of this thread into a non-perturbed part,
+     * which can use the SIMD kernel flavors, and a perturbed part,
+     * which requires the general kernels.
+     */
+    const int nbSplit =
+            (havePerturbedInteractions ? std::clamp(numNonperturbedInteractions, nb0, nb1) : nb1);
+    const std::array<std::pair<int, int>, 2> ranges = { { { nb0, nbSplit }, { nbSplit, nb1 } } };
 
     ArrayRef<const t_iparams> iparams = idef.iparams;
 
+    const ArrayRef<real> chargeA =
+            md->chargeA ? gmx::arrayRefFromArray(md->chargeA, md->nr) : gmx::ArrayRef<real>{};
+    const ArrayRef<real> chargeB =
+            md->chargeB ? gmx::arrayRefFromArray(md->chargeB, md->nr) : gmx::ArrayRef<real>{};
+    const ArrayRef<bool> atomIsPerturbed =
+            md->bPerturbed ? gmx::arrayRefFromArray(md->bPerturbed, md->nr) : gmx::ArrayRef<bool>();
+
     real v = 0;
-    if (!isPairInteraction(ftype))
+    for (size_t r = 0; r < ranges.size(); r++)
     {
-        if (ftype == F_CMAP)
+        const int  nbStart          = ranges[r].first;
+        const int  nbn              = ranges[r].second - ranges[r].first;
+        const bool rangeIsPerturbed = (r == 1);
+        if (nbn == 0)
         {
-            /* TODO The execution time for CMAP dihedrals might be
-               nice to account to its own subtimer, but first
-               wallcycle needs to be extended to support calling from
-               multiple threads. */
-            v = cmap_dihs(nbn,
-                          iatoms.data() + nb0,
-                          iparams.data(),
-                          &idef.cmap_grid,
-                          x,
-                          f,
-                          fshift,
-                          pbc,
-                          lambda[static_cast<int>(efptFTYPE)],
-                          &(dvdl[static_cast<int>(efptFTYPE)]),
-                          gmx::arrayRefFromArray(md->chargeA, md->nr),
-                          fcd,
-                          nullptr,
-                          nullptr,
-                          global_atom_index);
+            continue;
+        }
+
+        const BondedKernelFlavor flavor =
+                selectBondedKernelFlavor(stepWork, fr->use_simd_kernels, rangeIsPerturbed);
+
+        if (!isPairInteraction(ftype))
+        {
+            if (ftype == F_CMAP)
+            {
+                /* TODO The execution time for CMAP dihedrals might be
+                   nice to account to its own subtimer, but first
+                   wallcycle needs to be extended to support calling from
+                   multiple threads. */
+                v += cmap_dihs(nbn,
+                               iatoms.data() + nbStart,
+                               iparams.data(),
+                               &idef.cmap_grid,
+                               x,
+                               f,
+                               fshift,
+                               pbc,
+                               lambda[static_cast<int>(efptFTYPE)],
+                               &(dvdl[static_cast<int>(efptFTYPE)]),
+                               gmx::arrayRefFromArray(md->chargeA, md->nr),
+                               fcd,
+                               nullptr,
+                               nullptr,
+                               global_atom_index);
+            }
+            else
+            {
+                v += calculateSimpleBond(ftype,
+                                         nbn,
+                                         iatoms.data() + nbStart,
+                                         iparams.data(),
+                                         x,
+                                         f,
+                                         fshift,
+                                         pbc,
+                                         lambda[static_cast<int>(efptFTYPE)],
+                                         &(dvdl[static_cast<int>(efptFTYPE)]),
+                                         gmx::arrayRefFromArray(md->chargeA, md->nr),
+                                         fcd,
+                                         fcd->disres,
+                                         fcd->orires.get(),
+                                         global_atom_index,
+                                         flavor);
+            }
         }
         else
         {
-            v = calculateSimpleBond(ftype,
-                                    nbn,
-                                    iatoms.data() + nb0,
-                                    iparams.data(),
-                                    x,
-                                    f,
-                                    fshift,
-                                    pbc,
-                                    lambda[static_cast<int>(efptFTYPE)],
-                                    &(dvdl[static_cast<int>(efptFTYPE)]),
-                                    gmx::arrayRefFromArray(md->chargeA, md->nr),
-                                    fcd,
-                                    fcd->disres,
-                                    fcd->orires.get(),
-                                    global_atom_index,
-                                    flavor);
+            /* TODO The execution time for pairs might be nice to account
+               to its own subtimer, but first wallcycle needs to be
+               extended to support calling from multiple threads. */
+            do_pairs(ftype,
+                     nbn,
+                     iatoms.data() + nbStart,
+                     iparams.data(),
+                     x,
+                     f,
+                     fshift,
+                     pbc,
+                     lambda.data(),
+                     dvdl.data(),
+                     chargeA,
+                     chargeB,
+                     atomIsPerturbed,
+                     gmx::arrayRefFromArray(md->cENER, md->nr),
+                     md->nPerturbed,
+                     fr,
+                     rangeIsPerturbed,
+                     stepWork,
+                     grpp,
+                     global_atom_index);
         }
     }
-    else
-    {
-        /* TODO The execution time for pairs might be nice to account
-           to its own subtimer, but first wallcycle needs to be
-           extended to support calling from multiple threads. */
-        do_pairs(ftype,
-                 nbn,
-                 iatoms.data() + nb0,
-                 iparams.data(),
-                 x,
-                 f,
-                 fshift,
-                 pbc,
-                 lambda.data(),
-                 dvdl.data(),
-                 md->chargeA ? gmx::arrayRefFromArray(md->chargeA, md->nr) : gmx::ArrayRef<real>{},
-                 md->chargeB ? gmx::arrayRefFromArray(md->chargeB, md->nr) : gmx::ArrayRef<real>{},
-                 md->bPerturbed ? gmx::arrayRefFromArray(md->bPerturbed, md->nr) : gmx::ArrayRef<bool>(),
-                 gmx::arrayRefFromArray(md->cENER, md->nr),
-                 md->nPerturbed,
-                 fr,
-                 havePerturbedInteractions,
-                 stepWork,
-                 grpp,
-                 global_atom_index);
-    }
 
     if (thread == 0)
     {
@@ -702,26 +731,32 @@ void calc_listed(struct gmx_wallcycle*         wcycle,
     }
 }
 
+//! Values of all lambda components, or of dV/dlambda for all components
+using LambdaComponentArray = gmx::EnumerationArray<FreeEnergyPerturbationCouplingType, real>;
+
 /*! \brief As calc_listed(), but only determines the potential energy
- * for the perturbed interactions.
+ * for the perturbed interactions at all lambda points in \p lambdas.
  *
+ * All lambda points are evaluated for one interaction type before
+ * moving on to the next type, so the perturbed interactions and their
+ * coordinates only need to be brought into cache once.
  * The shift forces in fr are not affected.
  */
-void calc_listed_lambda(const InteractionDefinitions& idef,
-                        bonded_threading_t*           bt,
-                        const rvec                    x[],
-                        const t_forcerec*             fr,
-                        const struct t_pbc*           pbc,
-                        gmx::ArrayRef<real>           forceBufferLambda,
-                        gmx::ArrayRef<gmx::RVec>      shiftForceBufferLambda,
-                        gmx_grppairener_t*            grpp,
-                        gmx::ArrayRef<real>           epot,
-                        gmx::ArrayRef<real>           dvdl,
-                        t_nrnb*                       nrnb,
-                        gmx::ArrayRef<const real>     lambda,
-                        const t_mdatoms*              md,
-                        t_fcdata*                     fcd,
-                        int*                          global_atom_index)
+void calc_listed_lambda(const InteractionDefinitions&             idef,
+                        bonded_threading_t*                       bt,
+                        const rvec                                x[],
+                        const t_forcerec*                         fr,
+                        const struct t_pbc*                       pbc,
+                        gmx::ArrayRef<real>                       forceBufferLambda,
+                        gmx::ArrayRef<gmx::RVec>                  shiftForceBufferLambda,
+                        gmx::ArrayRef<gmx_grppairener_t>          grpp,
+                        gmx::ArrayRef<std::array<real, F_NRE>>    epot,
+                        gmx::ArrayRef<LambdaComponentArray>       dvdl,
+                        t_nrnb*                                   nrnb,
+                        gmx::ArrayRef<const LambdaComponentArray> lambdas,
+                        const t_mdatoms*                          md,
+                        t_fcdata*                                 fcd,
+                        int*                                      global_atom_index)
 {
     WorkDivision& workDivision = bt->foreignLambdaWorkDivision;
 
@@ -735,7 +770,9 @@ void calc_listed_lambda(const InteractionDefinitions& idef,
         pbc_null = nullptr;
     }
 
-    /* We already have the forces, so we use temp buffers here */
+    /* We already have the forces, so we use temp buffers here.
+     * The forces are discarded, so we only clear them once for all lambda points.
+     */
     std::fill(forceBufferLambda.begin(), forceBufferLambda.end(), 0.0_real);
     std::fill(shiftForceBufferLambda.begin(),
               shiftForceBufferLambda.end(),
@@ -743,6 +780,9 @@ void calc_listed_lambda(const InteractionDefinitions& idef,
     rvec4* f      = reinterpret_cast<rvec4*>(forceBufferLambda.data());
     rvec*  fshift = as_rvec_array(shiftForceBufferLambda.data());
 
+    gmx::StepWorkload tempFlags;
+    tempFlags.computeEnergy = true;
+
     /* Loop over all bonded force types to calculate the bonded energies */
     for (int ftype = 0; (ftype < F_NRE); ftype++)
     {
@@ -759,28 +799,30 @@ void calc_listed_lambda(const InteractionDefinitions& idef,
                 workDivision.setBound(ftype, 0, 0);
                 workDivision.setBound(ftype, 1, iatomsPerturbed.ssize());
 
-                gmx::StepWorkload tempFlags;
-                tempFlags.computeEnergy = true;
-                real v                  = calc_one_bond(0,
-                                       ftype,
-                                       idef,
-                                       iatomsPerturbed,
-                                       iatomsPerturbed.ssize(),
-                                       workDivision,
-                                       x,
-                                       f,
-                                       fshift,
-                                       fr,
-                                       pbc_null,
-                                       grpp,
-                                       nrnb,
-                                       lambda,
-                                       dvdl,
-                                       md,
-                                       fcd,
-                                       tempFlags,
-                                       global_atom_index);
-                epot[ftype] += v;
+                for (gmx::index i = 0; i < lambdas.ssize(); i++)
+                {
+                    /* All interactions in the temporary list are perturbed */
+                    real v = calc_one_bond(0,
+                                           ftype,
+                                           idef,
+                                           iatomsPerturbed,
+                                           0,
+                                           workDivision,
+                                           x,
+                                           f,
+                                           fshift,
+                                           fr,
+                                           pbc_null,
+                                           &grpp[i],
+                                           nrnb,
+                                           lambdas[i],
+                                           dvdl[i],
+                                           md,
+                                           fcd,
+                                           tempFlags,
+                                           global_atom_index);
+                    epot[i][ftype] += v;
+                }
             }
         }
     }
@@ -793,6 +835,7 @@ void ListedForces::calculate(struct gmx_wallcycle*                     wcycle,
                              const t_lambda*                           fepvals,
                              const t_commrec*                          cr,
                              const gmx_multisim_t*                     ms,
+                             const int64_t                             step,
                              gmx::ArrayRefWithPadding<const gmx::RVec> coordinates,
                              gmx::ArrayRef<const gmx::RVec>            xWholeMolecules,
                              t_fcdata*                                 fcdata,
@@ -851,6 +894,7 @@ void ListedForces::calculate(struct gmx_wallcycle*                     wcycle,
         {
             GMX_ASSERT(!xWholeMolecules.empty(), "Need whole molecules for orienation restraints");
             enerd->term[F_ORIRESDEV] = calc_orires_dev(ms,
+                                                       step,
                                                        idef.il[F_ORIRES].size(),
                                                        idef.il[F_ORIRES].iatoms.data(),
                                                        idef.iparams.data(),
@@ -865,6 +909,7 @@ void ListedForces::calculate(struct gmx_wallcycle*                     wcycle,
         {
             calc_disres_R_6(cr,
                             ms,
+                            step,
                             idef.il[F_DISRES].size(),
                             idef.il[F_DISRES].iatoms.data(),
                             x,
@@ -883,7 +928,6 @@ void ListedForces::calculate(struct gmx_wallcycle*                     wcycle,
      */
     if (fepvals->n_lambda > 0 && stepWork.computeDhdl)
     {
-        gmx::EnumerationArray<FreeEnergyPerturbationCouplingType, real> dvdl = { 0 };
         if (!idef.il[F_POSRES].empty())
         {
             posres_wrapper_lambda(wcycle, fepvals, idef, &pbc_full, x, enerd, lambda, fr);
@@ -895,34 +939,43 @@ void ListedForces::calculate(struct gmx_wallcycle*                     wcycle,
             {
                 gmx_incons("The bonded interactions are not sorted for free energy");
             }
-            for (int i = 0; i < 1 + enerd->foreignLambdaTerms.numLambdas(); i++)
+            const int numLambdaPoints = 1 + enerd->foreignLambdaTerms.numLambdas();
+            if (gmx::ssize(foreignEnergyGroups_) < numLambdaPoints)
+            {
+                foreignEnergyGroups_.resize(numLambdaPoints, gmx_grppairener_t(numEnergyGroups_));
+            }
+            std::vector<LambdaComponentArray>    lambdaPoints(numLambdaPoints);
+            std::vector<LambdaComponentArray>    dvdl(numLambdaPoints, LambdaComponentArray{ 0 });
+            std::vector<std::array<real, F_NRE>> foreignTerms(numLambdaPoints, { 0 });
+            for (int i = 0; i < numLambdaPoints; i++)
             {
-                gmx::EnumerationArray<FreeEnergyPerturbationCouplingType, real> lam_i;
-                foreignEnergyGroups_->clear();
-                std::array<real, F_NRE> foreign_term = { 0 };
-                for (auto j : keysOf(lam_i))
+                for (auto j : keysOf(lambdaPoints[i]))
                 {
-                    lam_i[j] = (i == 0 ? lambda[static_cast<int>(j)] : fepvals->all_lambda[j][i - 1]);
+                    lambdaPoints[i][j] =
+                            (i == 0 ? lambda[static_cast<int>(j)] : fepvals->all_lambda[j][i - 1]);
                 }
-                calc_listed_lambda(idef,
-                                   threading_.get(),
-                                   x,
-                                   fr,
-                                   pbc,
-                                   forceBufferLambda_,
-                                   shiftForceBufferLambda_,
-                                   foreignEnergyGroups_.get(),
-                                   foreign_term,
-                                   dvdl,
-                                   nrnb,
-                                   lam_i,
-                                   md,
-                                   fcdata,
-                                   global_atom_index);
-                sum_epot(*foreignEnergyGroups_, foreign_term.data());
-                const double dvdlSum = std::accumulate(std::begin(dvdl), std::end(dvdl), 0.);
-                std::fill(std::begin(dvdl), std::end(dvdl), 0.0);
-                enerd->foreignLambdaTerms.accumulate(i, foreign_term[F_EPOT], dvdlSum);
+                foreignEnergyGroups_[i].clear();
+            }
+            calc_listed_lambda(idef,
+                               threading_.get(),
+                               x,
+                               fr,
+                               pbc,
+                               forceBufferLambda_,
+                               shiftForceBufferLambda_,
+                               gmx::makeArrayRef(foreignEnergyGroups_).subArray(0, numLambdaPoints),
+                               foreignTerms,
+                               dvdl,
+                               nrnb,
+                               lambdaPoints,
+                               md,
+                               fcdata,
+                               global_atom_index);
+            for (int i = 0; i < numLambdaPoints; i++)
+            {
+                sum_epot(foreignEnergyGroups_[i], foreignTerms[i].data());
+                const double dvdlSum = std::accumulate(std::begin(dvdl[i]), std::end(dvdl[i]), 0.);
+                enerd->foreignLambdaTerms.accumulate(i, foreignTerms[i][F_EPOT], dvdlSum);
             }
             wallcycle_sub_stop(wcycle, WallCycleSubCounter::ListedFep);
         }
@@ -69,6 +69,8 @@
 #ifndef GMX_LISTED_FORCES_LISTED_FORCES_H
 #define GMX_LISTED_FORCES_LISTED_FORCES_H
 
+#include <cstdint>
+
 #include <memory>
 #include <vector>
 
@@ -187,12 +189,15 @@ public:
      *
      * xWholeMolecules only needs to contain whole molecules when orientation
      * restraints need to be computed and can be empty otherwise.
+     * The MD \p step is only used for the ensemble sums of distance and
+     * orientation restraints.
      */
     void calculate(struct gmx_wallcycle*                     wcycle,
                    const matrix                              box,
                    const t_lambda*                           fepvals,
                    const t_commrec*                          cr,
                    const gmx_multisim_t*                     ms,
+                   int64_t                                   step,
                    gmx::ArrayRefWithPadding<const gmx::RVec> coordinates,
                    gmx::ArrayRef<const gmx::RVec>            xWholeMolecules,
                    t_fcdata*                                 fcdata,
@@ -233,8 +238,10 @@ private:
     std::vector<real> forceBufferLambda_;
     //! Shift force buffer for free-energy forces
     std::vector<gmx::RVec> shiftForceBufferLambda_;
-    //! Temporary array for storing foreign lambda group pair energies
-    std::unique_ptr<gmx_grppairener_t> foreignEnergyGroups_;
+    //! The number of energy groups
+    int numEnergyGroups_;
+    //! Temporary arrays for storing group pair energies, one for each foreign lambda point
+    std::vector<gmx_grppairener_t> foreignEnergyGroups_;
 
     GMX_DISALLOW_COPY_AND_ASSIGN(ListedForces);
 };
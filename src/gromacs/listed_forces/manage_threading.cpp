@@ -139,7 +139,8 @@ static void divide_bondeds_by_locality(bonded_threading_t* bt, int numType, cons
              * in bonded interactions are usually in increasing order.
              * If they are not assigned in increasing order, the balancing
              * is still good, but the memory access and reduction cost will
-             * be higher.
+             * be higher. Setting GMX_BONDED_SORT_LOCALITY sorts the lists
+             * on the first atom, so each thread gets a compact atom range.
              */
             int f_min;
 
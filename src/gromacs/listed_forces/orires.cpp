@@ -42,6 +42,8 @@
 #include <climits>
 #include <cmath>
 
+#include <memory>
+
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/linearalgebra/nrjac.h"
 #include "gromacs/math/do_fit.h"
@@ -63,6 +65,8 @@
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/smalloc.h"
 
+#include "ensemble_sum.h"
+
 using gmx::ArrayRef;
 using gmx::RVec;
 
@@ -282,6 +286,9 @@ t_oriresdata::t_oriresdata(FILE*                 fplog,
         check_multi_int(
                 fplog, ms, numReferenceAtoms, "the number of fit atoms for orientation restraining", FALSE);
         check_multi_int(fplog, ms, ir.nsteps, "nsteps", FALSE);
+        const int nstSum = gmx::nmrEnsembleSumIntervalFromEnvironment(fplog);
+        check_multi_int(fplog, ms, nstSum, "GMX_NMR_ENSEMBLE_NSTSUM", FALSE);
+        ensembleSum = std::make_unique<gmx::EnsembleSum>(5 * numRestraints, nstSum);
         /* Copy the reference coordinates from the master to the other nodes */
         gmx_sum_sim(DIM * numReferenceAtoms, xref[0], ms);
     }
@@ -377,6 +384,7 @@ void print_orires_log(FILE* log, t_oriresdata* od)
 }
 
 real calc_orires_dev(const gmx_multisim_t* ms,
+                     const int64_t         step,
                      int                   nfa,
                      const t_iatom         forceatoms[],
                      const t_iparams       ip[],
@@ -490,7 +498,8 @@ real calc_orires_dev(const gmx_multisim_t* ms,
 
     if (ms)
     {
-        gmx_sum_sim(5 * od->numRestraints, od->DTensorsEnsembleAv[0], ms);
+        od->ensembleSum->sum(
+                gmx::arrayRefFromArray(od->DTensorsEnsembleAv[0], 5 * od->numRestraints), ms, step);
     }
 
     /* Calculate the order tensor S for each experiment via optimization */
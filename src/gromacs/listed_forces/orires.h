@@ -45,6 +45,7 @@
 #ifndef GMX_LISTED_FORCES_ORIRES_H
 #define GMX_LISTED_FORCES_ORIRES_H
 
+#include <cstdint>
 #include <cstdio>
 
 #include "gromacs/topology/ifunc.h"
@@ -71,8 +72,11 @@ class ArrayRef;
  * Calculates the time averaged D matrices, the S matrix for each experiment.
  *
  * Returns the weighted RMS deviation of the orientation restraints.
+ * The MD \p step sets when the ensemble sums are done with
+ * GMX_NMR_ENSEMBLE_NSTSUM, see gmx::EnsembleSum.
  */
 real calc_orires_dev(const gmx_multisim_t*          ms,
+                     int64_t                        step,
                      int                            nfa,
                      const t_iatom                  fa[],
                      const t_iparams                ip[],
@@ -72,6 +72,13 @@
 
 using namespace gmx; // TODO: Remove when this file is moved into gmx namespace
 
+/*! \brief Whether a listed interaction beyond the table limit has been reported
+ *
+ * This flag isn't race free. But it doesn't matter because if a race occurs the only
+ * disadvantage is that the warning is printed twice.
+ */
+static gmx_bool warned_rlimit = FALSE; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
 /*! \brief Issue a warning if a listed interaction is beyond a table limit */
 static void warning_rlimit(const rvec* x, int ai, int aj, int* global_atom_index, real r, real rlimit)
 {
@@ -339,6 +346,32 @@ static real free_energy_evaluate_single(real
     return fscal;
 }
 
+/*! \brief Sets pointers to the energy group pair terms that interactions of type \p ftype add to */
+static void getPairEnergyTerms(int                ftype,
+                               gmx_grppairener_t* grppener,
+                               real**             energygrp_elec,
+                               real**             energygrp_vdw)
+{
+    switch (ftype)
+    {
+        case F_LJ14:
+        case F_LJC14_Q:
+            *energygrp_elec =
+                    grppener->energyGroupPairTerms[NonBondedEnergyTerms::Coulomb14].data();
+            *energygrp_vdw  = grppener->energyGroupPairTerms[NonBondedEnergyTerms::LJ14].data();
+            break;
+        case F_LJC_PAIRS_NB:
+            *energygrp_elec =
+                    grppener->energyGroupPairTerms[NonBondedEnergyTerms::CoulombSR].data();
+            *energygrp_vdw  = grppener->energyGroupPairTerms[NonBondedEnergyTerms::LJSR].data();
+            break;
+        default:
+            *energygrp_elec = nullptr; /* Keep compiler happy */
+            *energygrp_vdw  = nullptr; /* Keep compiler happy */
+            gmx_fatal(FARGS, "Unknown function type %d in do_nonbonded14", ftype);
+    }
+}
+
 /*! \brief Calculate pair interactions, supports all types and conditions. */
 template<BondedKernelFlavor flavor>
 static real do_pairs_general(int                           ftype,
@@ -368,29 +401,13 @@ static real do_pairs_general(int                           ftype,
     real            fscal, velec, vvdw;
     real*           energygrp_elec;
     real*           energygrp_vdw;
-    static gmx_bool warned_rlimit = FALSE;
     /* Free energy stuff */
     gmx_bool   bFreeEnergy;
     real       LFC[2], LFV[2], DLF[2], lfac_coul[2], lfac_vdw[2], dlfac_coul[2], dlfac_vdw[2];
     real       qqB, c6B, c12B;
     const real oneSixth = 1.0_real / 6.0_real;
 
-    switch (ftype)
-    {
-        case F_LJ14:
-        case F_LJC14_Q:
-            energygrp_elec = grppener->energyGroupPairTerms[NonBondedEnergyTerms::Coulomb14].data();
-            energygrp_vdw  = grppener->energyGroupPairTerms[NonBondedEnergyTerms::LJ14].data();
-            break;
-        case F_LJC_PAIRS_NB:
-            energygrp_elec = grppener->energyGroupPairTerms[NonBondedEnergyTerms::CoulombSR].data();
-            energygrp_vdw  = grppener->energyGroupPairTerms[NonBondedEnergyTerms::LJSR].data();
-            break;
-        default:
-            energygrp_elec = nullptr; /* Keep compiler happy */
-            energygrp_vdw  = nullptr; /* Keep compiler happy */
-            gmx_fatal(FARGS, "Unknown function type %d in do_nonbonded14", ftype);
-    }
+    getPairEnergyTerms(ftype, grppener, &energygrp_elec, &energygrp_vdw);
 
     if (fr->efep != FreeEnergyPerturbationType::No)
     {
@@ -490,8 +507,6 @@ static real do_pairs_general(int                           ftype,
 
         if (r2 >= fr->pairsTable->interactionRange * fr->pairsTable->interactionRange)
         {
-            /* This check isn't race free. But it doesn't matter because if a race occurs the only
-             * disadvantage is that the warning is printed twice */
             if (!warned_rlimit)
             {
                 warning_rlimit(x, ai, aj, global_atom_index, sqrt(r2), fr->pairsTable->interactionRange);
@@ -563,34 +578,57 @@ static real do_pairs_general(int                           ftype,
     return 0.0;
 }
 
-/*! \brief Calculate pairs, only for plain-LJ + plain Coulomb normal type.
+/*! \brief Calculate pairs, only for plain-LJ + plain Coulomb without perturbation.
  *
  * This function is templated for real/SimdReal and for optimization.
+ * Supports F_LJ14, F_LJC14_Q and F_LJC_PAIRS_NB. For F_LJ14 the charge
+ * product is scaled by \p scale_factor, which should include fudgeQQ.
+ *
+ * When \p flavor requests the virial, shift forces are computed for pairs
+ * that were shifted by PBC when \p pbcForShifts is not nullptr. As the SIMD
+ * PBC code does not return shift indices, these are determined with scalar
+ * code, but only for the pairs with a displacement that was changed by PBC.
+ *
+ * As in do_pairs_general(), pairs at distances beyond \p tableRange are
+ * skipped and reported once.
  */
-template<typename T, int pack_size, typename pbc_type>
-static void do_pairs_simple(int                 nbonds,
-                            const t_iatom       iatoms[],
-                            const t_iparams     iparams[],
-                            const rvec          x[],
-                            rvec4               f[],
-                            const pbc_type      pbc,
-                            gmx::ArrayRef<real> charge,
-                            const real          scale_factor)
+template<BondedKernelFlavor flavor, typename T, int pack_size, typename pbc_type>
+static void do_pairs_simple(int                           ftype,
+                            int                           nbonds,
+                            const t_iatom                 iatoms[],
+                            const t_iparams               iparams[],
+                            const rvec                    x[],
+                            rvec4                         f[],
+                            rvec                          fshift[],
+                            const pbc_type                pbc,
+                            const t_pbc*                  pbcForShifts,
+                            gmx::ArrayRef<real>           charge,
+                            const real                    epsfac,
+                            const real                    scale_factor,
+                            gmx::ArrayRef<unsigned short> cENER,
+                            int                           numEnergyGroups,
+                            real*                         energygrp_elec,
+                            real*                         energygrp_vdw,
+                            const real                    tableRange,
+                            int*                          global_atom_index)
 {
     const int nfa1 = 1 + 2;
 
     T six(6);
     T twelve(12);
-    T ef(scale_factor);
+    T ef(epsfac);
+    T tableRangeSquared(tableRange * tableRange);
 
 #if GMX_SIMD_HAVE_REAL
     alignas(GMX_SIMD_ALIGNMENT) std::int32_t ai[pack_size];
     alignas(GMX_SIMD_ALIGNMENT) std::int32_t aj[pack_size];
     alignas(GMX_SIMD_ALIGNMENT) real         coeff[3 * pack_size];
+    alignas(GMX_SIMD_ALIGNMENT) real         buffer[DIM * pack_size];
 #else
     std::int32_t ai[pack_size];
     std::int32_t aj[pack_size];
     real         coeff[3 * pack_size];
+    real         buffer[DIM * pack_size];
 #endif
 
     /* nbonds is #pairs*nfa1, here we step pack_size pairs */
@@ -608,9 +646,32 @@ static void do_pairs_simple(int                 nbonds,
 
             if (i + s * nfa1 < nbonds)
             {
-                coeff[0 * pack_size + s] = iparams[itype].lj14.c6A;
-                coeff[1 * pack_size + s] = iparams[itype].lj14.c12A;
-                coeff[2 * pack_size + s] = charge[ai[s]] * charge[aj[s]];
+                /* The charge products here do not include epsfac */
+                switch (ftype)
+                {
+                    case F_LJ14:
+                        coeff[0 * pack_size + s] = iparams[itype].lj14.c6A;
+                        coeff[1 * pack_size + s] = iparams[itype].lj14.c12A;
+                        coeff[2 * pack_size + s] = charge[ai[s]] * charge[aj[s]] * scale_factor;
+                        break;
+                    case F_LJC14_Q:
+                        coeff[0 * pack_size + s] = iparams[itype].ljc14.c6;
+                        coeff[1 * pack_size + s] = iparams[itype].ljc14.c12;
+                        coeff[2 * pack_size + s] = iparams[itype].ljc14.qi * iparams[itype].ljc14.qj
+                                                   * iparams[itype].ljc14.fqq;
+                        break;
+                    case F_LJC_PAIRS_NB:
+                        coeff[0 * pack_size + s] = iparams[itype].ljcnb.c6;
+                        coeff[1 * pack_size + s] = iparams[itype].ljcnb.c12;
+                        coeff[2 * pack_size + s] =
+                                iparams[itype].ljcnb.qi * iparams[itype].ljcnb.qj;
+                        break;
+                    default:
+                        GMX_ASSERT(false, "Unsupported pair interaction type");
+                        coeff[0 * pack_size + s] = 0;
+                        coeff[1 * pack_size + s] = 0;
+                        coeff[2 * pack_size + s] = 0;
+                }
 
                 /* Avoid indexing the iatoms array out of bounds.
                  * We pad the coordinate indices with the last atom pair.
@@ -638,35 +699,180 @@ static void do_pairs_simple(int                 nbonds,
         T c12 = load<T>(coeff + 1 * pack_size);
         T qq  = load<T>(coeff + 2 * pack_size);
 
-        /* We could save these operations by storing 6*C6,12*C12 */
-        c6  = six * c6;
-        c12 = twelve * c12;
-
         T dr[DIM];
         pbc_dx_aiuc(pbc, xi, xj, dr);
 
-        T rsq   = dr[XX] * dr[XX] + dr[YY] * dr[YY] + dr[ZZ] * dr[ZZ];
+        T rsq = dr[XX] * dr[XX] + dr[YY] * dr[YY] + dr[ZZ] * dr[ZZ];
+
+        /* Interactions beyond the table limit are skipped, as with tables */
+        const auto beyondTable = (tableRangeSquared <= rsq);
+        if (anyTrue(beyondTable))
+        {
+            store(buffer, rsq);
+            for (int s = 0; s < pack_size && i + s * nfa1 < nbonds && !warned_rlimit; s++)
+            {
+                if (buffer[s] >= tableRange * tableRange)
+                {
+                    warning_rlimit(
+                            x, ai[s], aj[s], global_atom_index, std::sqrt(buffer[s]), tableRange);
+                    warned_rlimit = TRUE;
+                }
+            }
+            c6  = selectByNotMask(c6, beyondTable);
+            c12 = selectByNotMask(c12, beyondTable);
+            qq  = selectByNotMask(qq, beyondTable);
+        }
+
         T rinv  = gmx::invsqrt(rsq);
         T rinv2 = rinv * rinv;
         T rinv6 = rinv2 * rinv2 * rinv2;
 
-        /* Calculate the Coulomb force * r */
+        /* Calculate the Coulomb force * r, which is equal to the Coulomb energy */
         T cfr = ef * qq * rinv;
 
         /* Calculate the LJ force * r and add it to the Coulomb part */
-        T fr = gmx::fma(fms(c12, rinv6, c6), rinv6, cfr);
+        T fr = gmx::fma(fms(twelve * c12, rinv6, six * c6), rinv6, cfr);
 
         T finvr = fr * rinv2;
         T fx    = finvr * dr[XX];
         T fy    = finvr * dr[YY];
         T fz    = finvr * dr[ZZ];
 
+        if (computeEnergy(flavor))
+        {
+            /* The padded pairs have zero coefficients and do not contribute */
+            store(buffer, cfr);
+            store(buffer + pack_size, fms(c12, rinv6, c6) * rinv6);
+            for (int s = 0; s < pack_size; s++)
+            {
+                const int gid = GID(cENER[ai[s]], cENER[aj[s]], numEnergyGroups);
+                energygrp_elec[gid] += buffer[s];
+                energygrp_vdw[gid] += buffer[pack_size + s];
+            }
+        }
+
         /* Add the pair forces to the force array.
          * Note that here we might add multiple force components for some atoms
          * due to the SIMD padding. But the extra force components are zero.
          */
         transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ai, fx, fy, fz);
         transposeScatterDecrU<4>(reinterpret_cast<real*>(f), aj, fx, fy, fz);
+
+        if (computeVirial(flavor) && pbcForShifts != nullptr
+            && anyTrue(dr[XX] != xi[XX] - xj[XX] || dr[YY] != xi[YY] - xj[YY]
+                       || dr[ZZ] != xi[ZZ] - xj[ZZ]))
+        {
+            store(buffer + XX * pack_size, fx);
+            store(buffer + YY * pack_size, fy);
+            store(buffer + ZZ * pack_size, fz);
+            for (int s = 0; s < pack_size && i + s * nfa1 < nbonds; s++)
+            {
+                rvec      dx;
+                const int fshift_index = pbc_dx_aiuc(pbcForShifts, x[ai[s]], x[aj[s]], dx);
+                if (fshift_index != c_centralShiftIndex)
+                {
+                    const rvec fpair = { buffer[XX * pack_size + s],
+                                         buffer[YY * pack_size + s],
+                                         buffer[ZZ * pack_size + s] };
+                    rvec_inc(fshift[fshift_index], fpair);
+                    rvec_dec(fshift[c_centralShiftIndex], fpair);
+                }
+            }
+        }
+    }
+}
+
+/*! \brief Calculate pairs with do_pairs_simple(), with SIMD when enabled */
+template<BondedKernelFlavor flavor>
+static void do_pairs_simple_dispatch(int                           ftype,
+                                     int                           nbonds,
+                                     const t_iatom                 iatoms[],
+                                     const t_iparams               iparams[],
+                                     const rvec                    x[],
+                                     rvec4                         f[],
+                                     rvec                          fshift[],
+                                     const struct t_pbc*           pbc,
+                                     gmx::ArrayRef<real>           chargeA,
+                                     gmx::ArrayRef<unsigned short> cENER,
+                                     int                           numEnergyGroups,
+                                     const t_forcerec*             fr,
+                                     gmx_grppairener_t*            grppener,
+                                     int*                          global_atom_index)
+{
+    real* energygrp_elec = nullptr;
+    real* energygrp_vdw  = nullptr;
+    if (computeEnergy(flavor))
+    {
+        getPairEnergyTerms(ftype, grppener, &energygrp_elec, &energygrp_vdw);
+    }
+
+    /* As in do_pairs_general(), shift forces only occur with molecular PBC */
+    const t_pbc* pbcForShifts = (fr->bMolPBC ? pbc : nullptr);
+
+    const real epsfac       = fr->ic->epsfac;
+    const real scale_factor = (ftype == F_LJ14 ? fr->fudgeQQ : 1.0_real);
+    const real tableRange   = fr->pairsTable->interactionRange;
+
+#if GMX_SIMD_HAVE_REAL
+    if (fr->use_simd_kernels)
+    {
+        alignas(GMX_SIMD_ALIGNMENT) real pbc_simd[9 * GMX_SIMD_REAL_WIDTH];
+        set_pbc_simd(pbc, pbc_simd);
+
+        do_pairs_simple<flavor, SimdReal, GMX_SIMD_REAL_WIDTH, const real*>(ftype,
+                                                                           nbonds,
+                                                                           iatoms,
+                                                                           iparams,
+                                                                           x,
+                                                                           f,
+                                                                           fshift,
+                                                                           pbc_simd,
+                                                                           pbcForShifts,
+                                                                           chargeA,
+                                                                           epsfac,
+                                                                           scale_factor,
+                                                                           cENER,
+                                                                           numEnergyGroups,
+                                                                           energygrp_elec,
+                                                                           energygrp_vdw,
+                                                                           tableRange,
+                                                                           global_atom_index);
+    }
+    else
+#endif
+    {
+        /* This construct is needed because pbc_dx_aiuc doesn't accept pbc=NULL */
+        t_pbc        pbc_no;
+        const t_pbc* pbc_nonnull;
+
+        if (pbc != nullptr)
+        {
+            pbc_nonnull = pbc;
+        }
+        else
+        {
+            set_pbc(&pbc_no, PbcType::No, nullptr);
+            pbc_nonnull = &pbc_no;
+        }
+
+        do_pairs_simple<flavor, real, 1, const t_pbc*>(ftype,
+                                                       nbonds,
+                                                       iatoms,
+                                                       iparams,
+                                                       x,
+                                                       f,
+                                                       fshift,
+                                                       pbc_nonnull,
+                                                       pbcForShifts,
+                                                       chargeA,
+                                                       epsfac,
+                                                       scale_factor,
+                                                       cENER,
+                                                       numEnergyGroups,
+                                                       energygrp_elec,
+                                                       energygrp_vdw,
+                                                       tableRange,
+                                                       global_atom_index);
     }
 }
 
@@ -692,45 +898,70 @@ void do_pairs(int                           ftype,
               gmx_grppairener_t*            grppener,
               int*                          global_atom_index)
 {
-    if (ftype == F_LJ14 && fr->ic->vdwtype != VanDerWaalsType::User && !EEL_USER(fr->ic->eeltype)
-        && !havePerturbedInteractions && (!stepWork.computeVirial && !stepWork.computeEnergy))
+    /* We use a fast code-path for plain LJ + Coulomb pairs without FEP.
+     * Only F_LJ14 pairs can be perturbed, the general kernel never applies
+     * FEP to F_LJC14_Q and F_LJC_PAIRS_NB. Note that the fast path uses
+     * analytical instead of tabulated interactions, but it skips pairs
+     * beyond the table range in the same way.
+     */
+    const bool useSimplePairs =
+            (fr->ic->vdwtype != VanDerWaalsType::User && !EEL_USER(fr->ic->eeltype)
+             && (ftype != F_LJ14 || !havePerturbedInteractions));
+
+    if (useSimplePairs)
     {
-        /* We use a fast code-path for plain LJ 1-4 without FEP.
-         *
-         * TODO: Add support for energies (straightforward) and virial
-         * in the SIMD template. For the virial it's inconvenient to store
-         * the force sums for the shifts and we should directly calculate
-         * and sum the virial for the shifts. But we should do this
-         * at once for the angles and dihedrals as well.
-         */
-#if GMX_SIMD_HAVE_REAL
-        if (fr->use_simd_kernels)
+        if (stepWork.computeVirial)
         {
-            alignas(GMX_SIMD_ALIGNMENT) real pbc_simd[9 * GMX_SIMD_REAL_WIDTH];
-            set_pbc_simd(pbc, pbc_simd);
-
-            do_pairs_simple<SimdReal, GMX_SIMD_REAL_WIDTH, const real*>(
-                    nbonds, iatoms, iparams, x, f, pbc_simd, chargeA, fr->ic->epsfac * fr->fudgeQQ);
+            do_pairs_simple_dispatch<BondedKernelFlavor::ForcesAndVirialAndEnergy>(
+                    ftype,
+                    nbonds,
+                    iatoms,
+                    iparams,
+                    x,
+                    f,
+                    fshift,
+                    pbc,
+                    chargeA,
+                    cENER,
+                    numEnergyGroups,
+                    fr,
+                    grppener,
+                    global_atom_index);
+        }
+        else if (stepWork.computeEnergy)
+        {
+            do_pairs_simple_dispatch<BondedKernelFlavor::ForcesAndEnergy>(ftype,
+                                                                          nbonds,
+                                                                          iatoms,
+                                                                          iparams,
+                                                                          x,
+                                                                          f,
+                                                                          fshift,
+                                                                          pbc,
+                                                                          chargeA,
+                                                                          cENER,
+                                                                          numEnergyGroups,
+                                                                          fr,
+                                                                          grppener,
+                                                                          global_atom_index);
         }
         else
-#endif
         {
-            /* This construct is needed because pbc_dx_aiuc doesn't accept pbc=NULL */
-            t_pbc        pbc_no;
-            const t_pbc* pbc_nonnull;
-
-            if (pbc != nullptr)
-            {
-                pbc_nonnull = pbc;
-            }
-            else
-            {
-                set_pbc(&pbc_no, PbcType::No, nullptr);
-                pbc_nonnull = &pbc_no;
-            }
-
-            do_pairs_simple<real, 1, const t_pbc*>(
-                    nbonds, iatoms, iparams, x, f, pbc_nonnull, chargeA, fr->ic->epsfac * fr->fudgeQQ);
+            do_pairs_simple_dispatch<BondedKernelFlavor::ForcesSimdWhenAvailable>(
+                    ftype,
+                    nbonds,
+                    iatoms,
+                    iparams,
+                    x,
+                    f,
+                    fshift,
+                    pbc,
+                    chargeA,
+                    cENER,
+                    numEnergyGroups,
+                    fr,
+                    grppener,
+                    global_atom_index);
         }
     }
     else if (stepWork.computeVirial)
@@ -50,19 +50,26 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
 
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdtypes/enerdata.h"
 #include "gromacs/mdtypes/forceoutput.h"
 #include "gromacs/mdtypes/forcerec.h"
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/topology/idef.h"
 #include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 
 struct gmx_wallcycle;
@@ -185,47 +192,86 @@ real do_fbposres_cylinder(int fbdim, rvec fm, rvec dx, real rfb, real kk, gmx_bo
     return v;
 }
 
-/*! \brief Compute energies and forces for flat-bottomed position restraints
+//! The minimum number of (flat-bottomed) position restraints per thread
+constexpr int c_minNumRestraintsPerThread = 256;
+
+//! Energy, dV/dlambda and virial contributions from a range of position restraints
+struct PositionRestraintOutput
+{
+    //! The potential energy
+    real v = 0;
+    //! dV/dlambda
+    real dvdl = 0;
+    //! The diagonal virial contribution
+    rvec virial = { 0 };
+};
+
+/*! \brief Returns the number of threads to use for computing \p nbonds entries of restraints
  *
- * Returns the flat-bottomed potential. Same PBC treatment as in
- * normal position restraints */
-real fbposres(int                   nbonds,
-              const t_iatom         forceatoms[],
-              const t_iparams       forceparams[],
-              const rvec            x[],
-              gmx::ForceWithVirial* forceWithVirial,
-              const t_pbc*          pbc,
-              RefCoordScaling       refcoord_scaling,
-              PbcType               pbcType,
-              const rvec            com)
-/* compute flat-bottomed positions restraints */
+ * Position restraints are computed outside the bonded thread division, but use
+ * the same number of threads, as long as each thread gets a reasonable amount of work.
+ */
+int numPositionRestraintThreads(int nbonds)
 {
-    int              i, ai, m, d, type, npbcdim = 0, fbdim;
-    const t_iparams* pr;
-    real             kk, v;
-    real             dr, dr2, rfb, rfb2, fact;
-    rvec             com_sc, rdist, dx, dpdl, fm;
-    gmx_bool         bInvert;
+    const int maxNumThreads = std::max(gmx_omp_nthreads_get(ModuleMultiThread::Bonded), 1);
 
-    npbcdim = numPbcDimensions(pbcType);
-    GMX_ASSERT((pbcType == PbcType::No) == (npbcdim == 0), "");
-    if (refcoord_scaling == RefCoordScaling::Com)
+    return std::clamp(nbonds / (2 * c_minNumRestraintsPerThread), 1, maxNumThreads);
+}
+
+//! Returns the start of the range in the restraint atom list for \p thread out of \p numThreads
+int restraintRangeStart(int nbonds, int thread, int numThreads)
+{
+    /* Each restraint occupies two entries: the type and the atom index */
+    return 2 * static_cast<int>((static_cast<int64_t>(nbonds / 2) * thread) / numThreads);
+}
+
+/*! \brief Adds the restraint force \p fm to atom \p ai
+ *
+ * With multiple threads, an atom might be restrained by more than one restraint
+ * in the ranges of different threads, so we need atomic updates. These are
+ * practically never contended, as each atom usually has only one restraint.
+ */
+inline void addRestraintForce(rvec f[], int ai, const rvec fm, bool useAtomics)
+{
+    if (useAtomics)
     {
-        clear_rvec(com_sc);
-        for (m = 0; m < npbcdim; m++)
+        for (int m = 0; m < DIM; m++)
         {
-            assert(npbcdim <= DIM);
-            for (d = m; d < npbcdim; d++)
-            {
-                com_sc[m] += com[d] * pbc->box[d][m];
-            }
+#pragma omp atomic
+            f[ai][m] += fm[m];
         }
     }
+    else
+    {
+        rvec_inc(f[ai], fm);
+    }
+}
+
+/*! \brief Compute energies and forces for flat-bottomed position restraints
+ * in the range \p start to \p end of \p forceatoms
+ *
+ * Same PBC treatment as in normal position restraints */
+void fbposresRange(int                      start,
+                   int                      end,
+                   const t_iatom            forceatoms[],
+                   const t_iparams          forceparams[],
+                   const rvec               x[],
+                   rvec                     f[],
+                   bool                     useAtomics,
+                   const t_pbc*             pbc,
+                   RefCoordScaling          refcoord_scaling,
+                   int                      npbcdim,
+                   const rvec               com_sc,
+                   PositionRestraintOutput* output)
+{
+    int              i, ai, m, type, fbdim;
+    const t_iparams* pr;
+    real             kk, v;
+    real             dr, dr2, rfb, rfb2, fact;
+    rvec             rdist, dx, dpdl, fm;
+    gmx_bool         bInvert;
 
-    rvec* f      = as_rvec_array(forceWithVirial->force_.data());
-    real  vtot   = 0.0;
-    rvec  virial = { 0 };
-    for (i = 0; (i < nbonds);)
+    for (i = start; (i < end);)
     {
         type = forceatoms[i++];
         ai   = forceatoms[i++];
@@ -309,14 +355,82 @@ real fbposres(int                   nbonds,
                 break;
         }
 
-        vtot += v;
+        output->v += v;
 
+        addRestraintForce(f, ai, fm, useAtomics);
         for (m = 0; (m < DIM); m++)
         {
-            f[ai][m] += fm[m];
             /* Here we correct for the pbc_dx which included rdist */
-            virial[m] -= 0.5 * (dx[m] + rdist[m]) * fm[m];
+            output->virial[m] -= 0.5 * (dx[m] + rdist[m]) * fm[m];
+        }
+    }
+}
+
+/*! \brief Compute energies and forces for flat-bottomed position restraints
+ *
+ * Returns the flat-bottomed potential. Same PBC treatment as in
+ * normal position restraints */
+real fbposres(int                   nbonds,
+              const t_iatom         forceatoms[],
+              const t_iparams       forceparams[],
+              const rvec            x[],
+              gmx::ForceWithVirial* forceWithVirial,
+              const t_pbc*          pbc,
+              RefCoordScaling       refcoord_scaling,
+              PbcType               pbcType,
+              const rvec            com)
+/* compute flat-bottomed positions restraints */
+{
+    int  m, d, npbcdim = 0;
+    rvec com_sc;
+
+    npbcdim = numPbcDimensions(pbcType);
+    GMX_ASSERT((pbcType == PbcType::No) == (npbcdim == 0), "");
+    if (refcoord_scaling == RefCoordScaling::Com)
+    {
+        clear_rvec(com_sc);
+        for (m = 0; m < npbcdim; m++)
+        {
+            assert(npbcdim <= DIM);
+            for (d = m; d < npbcdim; d++)
+            {
+                com_sc[m] += com[d] * pbc->box[d][m];
+            }
+        }
+    }
+
+    rvec* f = as_rvec_array(forceWithVirial->force_.data());
+
+    const int                            numThreads = numPositionRestraintThreads(nbonds);
+    std::vector<PositionRestraintOutput> threadOutput(numThreads);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        try
+        {
+            fbposresRange(restraintRangeStart(nbonds, thread, numThreads),
+                          restraintRangeStart(nbonds, thread + 1, numThreads),
+                          forceatoms,
+                          forceparams,
+                          x,
+                          f,
+                          numThreads > 1,
+                          pbc,
+                          refcoord_scaling,
+                          npbcdim,
+                          com_sc,
+                          &threadOutput[thread]);
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    /* Reduce in thread order, so the result does not depend on the scheduling */
+    real vtot   = 0.0;
+    rvec virial = { 0 };
+    for (const auto& output : threadOutput)
+    {
+        vtot += output.v;
+        rvec_inc(virial, output.virial);
     }
 
     forceWithVirial->addVirialContribution(virial);
@@ -324,6 +438,205 @@ real fbposres(int                   nbonds,
     return vtot;
 }
 
+/*! \brief Compute energies and forces, when requested, for position restraints
+ * in the range \p start to \p end of \p forceatoms
+ */
+template<bool computeForce>
+void posresRange(int                      start,
+                 int                      end,
+                 const t_iatom            forceatoms[],
+                 const t_iparams          forceparams[],
+                 const rvec               x[],
+                 rvec                     f[],
+                 bool                     useAtomics,
+                 const struct t_pbc*      pbc,
+                 real                     lambda,
+                 RefCoordScaling          refcoord_scaling,
+                 int                      npbcdim,
+                 const rvec               comA_sc,
+                 const rvec               comB_sc,
+                 PositionRestraintOutput* output)
+{
+    int              i, ai, m, type;
+    const t_iparams* pr;
+    real             kk;
+    rvec             rdist, dpdl, dx, fm;
+
+    const real L1 = 1.0 - lambda;
+
+    for (i = start; (i < end);)
+    {
+        type = forceatoms[i++];
+        ai   = forceatoms[i++];
+        pr   = &forceparams[type];
+
+        /* return dx, rdist, and dpdl */
+        posres_dx(x[ai],
+                  forceparams[type].posres.pos0A,
+                  forceparams[type].posres.pos0B,
+                  comA_sc,
+                  comB_sc,
+                  lambda,
+                  pbc,
+                  refcoord_scaling,
+                  npbcdim,
+                  dx,
+                  rdist,
+                  dpdl);
+
+        for (m = 0; (m < DIM); m++)
+        {
+            kk    = L1 * pr->posres.fcA[m] + lambda * pr->posres.fcB[m];
+            fm[m] = -kk * dx[m];
+            output->v += 0.5 * kk * dx[m] * dx[m];
+            output->dvdl += 0.5 * (pr->posres.fcB[m] - pr->posres.fcA[m]) * dx[m] * dx[m]
+                            + fm[m] * dpdl[m];
+
+            /* Here we correct for the pbc_dx which included rdist */
+            if (computeForce)
+            {
+                output->virial[m] -= 0.5 * (dx[m] + rdist[m]) * fm[m];
+            }
+        }
+        if (computeForce)
+        {
+            addRestraintForce(f, ai, fm, useAtomics);
+        }
+    }
+}
+
+#if GMX_SIMD_HAVE_REAL
+/*! \brief SIMD version of posresRange()
+ *
+ * Only supports reference coordinates without scaling, i.e. either no PBC
+ * or full PBC with a rectangular box, which is the common case.
+ */
+template<bool computeForce>
+void posresRangeSimd(int                      start,
+                     int                      end,
+                     const t_iatom            forceatoms[],
+                     const t_iparams          forceparams[],
+                     const rvec               x[],
+                     rvec                     f[],
+                     bool                     useAtomics,
+                     const struct t_pbc*      pbc,
+                     real                     lambda,
+                     PositionRestraintOutput* output)
+{
+    using gmx::SimdReal;
+
+    constexpr int c_width = GMX_SIMD_REAL_WIDTH;
+
+    int                              ai[c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real xBuf[DIM][c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real pos0ABuf[DIM][c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real pos0BBuf[DIM][c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real fcABuf[DIM][c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real fcBBuf[DIM][c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real fBuf[DIM][c_width];
+
+    const SimdReal lambda_S(lambda);
+    const SimdReal L1_S(1.0_real - lambda);
+    const SimdReal half_S(0.5_real);
+
+    /* Without PBC the reference position is not included in the virial correction */
+    const SimdReal rdistFactor_S(pbc != nullptr ? 1.0_real : 0.0_real);
+    SimdReal       box_S[DIM];
+    SimdReal       invBox_S[DIM];
+    for (int m = 0; m < DIM; m++)
+    {
+        box_S[m]    = SimdReal(pbc != nullptr ? pbc->box[m][m] : 0.0_real);
+        invBox_S[m] = SimdReal(pbc != nullptr ? 1.0_real / pbc->box[m][m] : 0.0_real);
+    }
+
+    SimdReal v_S(0.0_real);
+    SimdReal dvdl_S(0.0_real);
+    SimdReal virial_S[DIM] = { SimdReal(0.0_real), SimdReal(0.0_real), SimdReal(0.0_real) };
+
+    for (int i = start; i < end; i += 2 * c_width)
+    {
+        /* Collect c_width restraints, padding lanes get zero force constants */
+        for (int s = 0; s < c_width; s++)
+        {
+            const int iu = i + 2 * s;
+            if (iu < end)
+            {
+                const t_iparams& pr = forceparams[forceatoms[iu]];
+                ai[s]               = forceatoms[iu + 1];
+                for (int m = 0; m < DIM; m++)
+                {
+                    xBuf[m][s]     = x[ai[s]][m];
+                    pos0ABuf[m][s] = pr.posres.pos0A[m];
+                    pos0BBuf[m][s] = pr.posres.pos0B[m];
+                    fcABuf[m][s]   = pr.posres.fcA[m];
+                    fcBBuf[m][s]   = pr.posres.fcB[m];
+                }
+            }
+            else
+            {
+                for (int m = 0; m < DIM; m++)
+                {
+                    xBuf[m][s]     = 0;
+                    pos0ABuf[m][s] = 0;
+                    pos0BBuf[m][s] = 0;
+                    fcABuf[m][s]   = 0;
+                    fcBBuf[m][s]   = 0;
+                }
+            }
+        }
+
+        for (int m = 0; m < DIM; m++)
+        {
+            const SimdReal pos0A_S = gmx::load<SimdReal>(pos0ABuf[m]);
+            const SimdReal pos0B_S = gmx::load<SimdReal>(pos0BBuf[m]);
+            const SimdReal fcA_S   = gmx::load<SimdReal>(fcABuf[m]);
+            const SimdReal fcB_S   = gmx::load<SimdReal>(fcBBuf[m]);
+
+            const SimdReal pos_S  = gmx::fma(L1_S, pos0A_S, lambda_S * pos0B_S);
+            const SimdReal dpdl_S = pos0B_S - pos0A_S;
+            const SimdReal kk_S   = gmx::fma(L1_S, fcA_S, lambda_S * fcB_S);
+
+            SimdReal dx_S = gmx::load<SimdReal>(xBuf[m]) - pos_S;
+            if (pbc != nullptr)
+            {
+                dx_S = gmx::fnma(box_S[m], gmx::round(dx_S * invBox_S[m]), dx_S);
+            }
+
+            const SimdReal dx2_S = dx_S * dx_S;
+            const SimdReal fm_S  = -kk_S * dx_S;
+            v_S                  = gmx::fma(half_S * kk_S, dx2_S, v_S);
+            dvdl_S = gmx::fma(half_S * (fcB_S - fcA_S), dx2_S, gmx::fma(fm_S, dpdl_S, dvdl_S));
+
+            if (computeForce)
+            {
+                /* Here we correct for the pbc_dx which included rdist */
+                virial_S[m] = gmx::fnma(
+                        half_S * gmx::fma(rdistFactor_S, pos_S, dx_S), fm_S, virial_S[m]);
+                gmx::store(fBuf[m], fm_S);
+            }
+        }
+
+        if (computeForce)
+        {
+            for (int s = 0; s < c_width && i + 2 * s < end; s++)
+            {
+                const rvec fm = { fBuf[XX][s], fBuf[YY][s], fBuf[ZZ][s] };
+                addRestraintForce(f, ai[s], fm, useAtomics);
+            }
+        }
+    }
+
+    output->v += gmx::reduce(v_S);
+    output->dvdl += gmx::reduce(dvdl_S);
+    if (computeForce)
+    {
+        for (int m = 0; m < DIM; m++)
+        {
+            output->virial[m] += gmx::reduce(virial_S[m]);
+        }
+    }
+}
+#endif // GMX_SIMD_HAVE_REAL
 
 /*! \brief Compute energies and forces, when requested, for position restraints
  *
@@ -341,12 +654,11 @@ real posres(int                   nbonds,
             RefCoordScaling       refcoord_scaling,
             PbcType               pbcType,
             const rvec            comA,
-            const rvec            comB)
+            const rvec            comB,
+            bool                  useSimd)
 {
-    int              i, ai, m, d, type, npbcdim = 0;
-    const t_iparams* pr;
-    real             kk, fm;
-    rvec             comA_sc, comB_sc, rdist, dpdl, dx;
+    int  m, d, npbcdim = 0;
+    rvec comA_sc, comB_sc;
 
     npbcdim = numPbcDimensions(pbcType);
     GMX_ASSERT((pbcType == PbcType::No) == (npbcdim == 0), "");
@@ -365,51 +677,80 @@ real posres(int                   nbonds,
         }
     }
 
-    const real L1 = 1.0 - lambda;
-
-    rvec* f;
+    rvec* f = nullptr;
     if (computeForce)
     {
         GMX_ASSERT(forceWithVirial != nullptr, "When forces are requested we need a force object");
         f = as_rvec_array(forceWithVirial->force_.data());
     }
-    real vtot = 0.0;
-    /* Use intermediate virial buffer to reduce reduction rounding errors */
-    rvec virial = { 0 };
-    for (i = 0; (i < nbonds);)
-    {
-        type = forceatoms[i++];
-        ai   = forceatoms[i++];
-        pr   = &forceparams[type];
 
-        /* return dx, rdist, and dpdl */
-        posres_dx(x[ai],
-                  forceparams[type].posres.pos0A,
-                  forceparams[type].posres.pos0B,
-                  comA_sc,
-                  comB_sc,
-                  lambda,
-                  pbc,
-                  refcoord_scaling,
-                  npbcdim,
-                  dx,
-                  rdist,
-                  dpdl);
-
-        for (m = 0; (m < DIM); m++)
+    /* The SIMD kernel supports the common case of unscaled reference
+     * coordinates with either no PBC or full PBC in a rectangular box.
+     */
+    const bool useSimdKernel =
+            (GMX_SIMD_HAVE_REAL && useSimd
+             && ((pbc == nullptr && npbcdim == 0)
+                 || (pbc != nullptr && pbc->pbcType == PbcType::Xyz && !TRICLINIC(pbc->box)
+                     && refcoord_scaling == RefCoordScaling::No)));
+#if !GMX_SIMD_HAVE_REAL
+    GMX_UNUSED_VALUE(useSimdKernel);
+#endif
+
+    const int                            numThreads = numPositionRestraintThreads(nbonds);
+    std::vector<PositionRestraintOutput> threadOutput(numThreads);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        try
         {
-            kk = L1 * pr->posres.fcA[m] + lambda * pr->posres.fcB[m];
-            fm = -kk * dx[m];
-            vtot += 0.5 * kk * dx[m] * dx[m];
-            *dvdlambda += 0.5 * (pr->posres.fcB[m] - pr->posres.fcA[m]) * dx[m] * dx[m] + fm * dpdl[m];
-
-            /* Here we correct for the pbc_dx which included rdist */
-            if (computeForce)
+            const int start = restraintRangeStart(nbonds, thread, numThreads);
+            const int end   = restraintRangeStart(nbonds, thread + 1, numThreads);
+#if GMX_SIMD_HAVE_REAL
+            if (useSimdKernel)
             {
-                f[ai][m] += fm;
-                virial[m] -= 0.5 * (dx[m] + rdist[m]) * fm;
+                posresRangeSimd<computeForce>(start,
+                                              end,
+                                              forceatoms,
+                                              forceparams,
+                                              x,
+                                              f,
+                                              numThreads > 1,
+                                              pbc,
+                                              lambda,
+                                              &threadOutput[thread]);
+            }
+            else
+#endif
+            {
+                posresRange<computeForce>(start,
+                                          end,
+                                          forceatoms,
+                                          forceparams,
+                                          x,
+                                          f,
+                                          numThreads > 1,
+                                          pbc,
+                                          lambda,
+                                          refcoord_scaling,
+                                          npbcdim,
+                                          comA_sc,
+                                          comB_sc,
+                                          &threadOutput[thread]);
             }
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    /* Reduce in thread order, so the result does not depend on the scheduling.
+     * Use intermediate virial buffer to reduce reduction rounding errors.
+     */
+    real vtot   = 0.0;
+    rvec virial = { 0 };
+    for (const auto& output : threadOutput)
+    {
+        vtot += output.v;
+        *dvdlambda += output.dvdl;
+        rvec_inc(virial, output.virial);
     }
 
     if (computeForce)
@@ -445,7 +786,8 @@ void posres_wrapper(t_nrnb*                       nrnb,
                      fr->rc_scaling,
                      fr->pbcType,
                      fr->posres_com,
-                     fr->posres_comB);
+                     fr->posres_comB,
+                     fr->use_simd_kernels);
     enerd->term[F_POSRES] += v;
     /* If just the force constant changes, the FEP term is linear,
      * but if k changes, it is not.
@@ -484,7 +826,8 @@ void posres_wrapper_lambda(struct gmx_wallcycle*         wcycle,
                                      fr->rc_scaling,
                                      fr->pbcType,
                                      fr->posres_com,
-                                     fr->posres_comB);
+                                     fr->posres_comB,
+                                     fr->use_simd_kernels);
         foreignTerms.accumulate(i, v, dvdl);
     }
     wallcycle_sub_stop(wcycle, WallCycleSubCounter::Restraints);
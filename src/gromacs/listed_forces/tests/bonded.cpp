@@ -417,6 +417,21 @@ public:
      * \return The structure itself.
      */
     iListInput setRbDihedrals(const real rbc[NR_RBDIHS]) { return setRbDihedrals(rbc, rbc); }
+    /*! \brief Set parameters for combined bending-torsion dihedrals potential
+     *
+     * \param[in] cbtc Force constants
+     * \return The structure itself.
+     */
+    iListInput setCbtDihedrals(const real cbtc[NR_CBTDIHS])
+    {
+        ftype = F_CBTDIHS;
+        fep   = false;
+        for (int i = 0; i < NR_CBTDIHS; i++)
+        {
+            iparams.cbtdihs.cbtcA[i] = cbtc[i];
+        }
+        return *this;
+    }
     /*! \brief Set parameters for Polarization
      *
      * \param[in] alpha Polarizability
@@ -694,6 +709,9 @@ const real rbcB[NR_RBDIHS] = { -6.35, 12.6, 8.1, -10.7, 0.9, 15.4 };
 //! Constants for Ryckaert-Bellemans without FEP
 const real rbc[NR_RBDIHS] = { -7.35, 13.6, 8.4, -16.7, 1.3, 12.4 };
 
+//! Constants for combined bending-torsion dihedrals
+const real cbtc[NR_CBTDIHS] = { 4.5, 1.2, -0.8, 2.3, 0.4, -1.1 };
+
 //! Function types for testing dihedrals. Add new terms at the end.
 std::vector<iListInput> c_InputDihs = {
     { iListInput(5e-4, 1e-8).setPDihedrals(F_PDIHS, -100.0, 10.0, 2, -80.0, 20.0) },
@@ -701,7 +719,17 @@ std::vector<iListInput> c_InputDihs = {
     { iListInput(2e-4, 1e-8).setHarmonic(F_IDIHS, 100.0, 50.0) },
     { iListInput(2e-4, 1e-8).setHarmonic(F_IDIHS, 100.15, 50.0, 95.0, 30.0) },
     { iListInput(4e-4, 1e-8).setRbDihedrals(rbcA, rbcB) },
-    { iListInput(4e-4, 1e-8).setRbDihedrals(rbc) }
+    { iListInput(4e-4, 1e-8).setRbDihedrals(rbc) },
+    { iListInput(4e-4, 1e-8).setCbtDihedrals(cbtc) }
+};
+
+/*! \brief Function types for testing restricted dihedrals. Add new terms at the end.
+ *
+ * The restricted dihedral potential diverges for planar dihedrals, so these
+ * are tested with c_coordinatesForTestsGaucheDihedral.
+ */
+std::vector<iListInput> c_InputRestrictedDihs = {
+    { iListInput(1e-4, 1e-8).setPDihedrals(F_RESTRDIHS, -105.0, 15.0, 1) }
 };
 
 //! Function types for testing polarization. Add new terms at the end.
@@ -770,6 +798,16 @@ std::vector<PaddedVector<RVec>> c_coordinatesForTests = {
     { { 1.382, 1.573, 1.482 }, { 1.281, 1.559, 1.596 }, { 1.292, 1.422, 1.663 }, { 1.189, 1.407, 1.775 } }
 };
 
+/*! \brief Coordinates for testing restricted dihedrals
+ *
+ * The butane molecule above, with the last atom rotated to a gauche
+ * conformation, as the dihedral of the butane coordinates is close to
+ * 180 degrees, where the restricted dihedral potential diverges.
+ */
+std::vector<PaddedVector<RVec>> c_coordinatesForTestsGaucheDihedral = {
+    { { 1.382, 1.573, 1.482 }, { 1.281, 1.559, 1.596 }, { 1.292, 1.422, 1.663 }, { 1.254, 1.308, 1.568 } }
+};
+
 //! Coordinates for testing bonds with zero length
 std::vector<PaddedVector<RVec>> c_coordinatesForTestsZeroBondLength = {
     { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.005, 0.0, 0.1 }, { 0.005, 0.0, 0.1 } }
@@ -801,6 +839,12 @@ INSTANTIATE_TEST_CASE_P(Dihedral,
                                            ::testing::ValuesIn(c_coordinatesForTests),
                                            ::testing::ValuesIn(c_pbcForTests)));
 
+INSTANTIATE_TEST_CASE_P(RestrictedDihedral,
+                        ListedForcesTest,
+                        ::testing::Combine(::testing::ValuesIn(c_InputRestrictedDihs),
+                                           ::testing::ValuesIn(c_coordinatesForTestsGaucheDihedral),
+                                           ::testing::ValuesIn(c_pbcForTests)));
+
 INSTANTIATE_TEST_CASE_P(Polarize,
                         ListedForcesTest,
                         ::testing::Combine(::testing::ValuesIn(c_InputPols),
@@ -0,0 +1,153 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for the lagged ensemble sums of NMR restraint data
+ *
+ * Checks that the lagged sums match the blocking sums of the data of
+ * the other simulations at the step at which the lagged sum was started.
+ *
+ * \ingroup module_listed_forces
+ */
+
+#include "gmxpre.h"
+
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/listed_forces/ensemble_sum.h"
+#include "gromacs/mdrunutility/multisim.h"
+#include "gromacs/utility/arrayref.h"
+
+#include "testutils/mpitest.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of values to sum
+constexpr int c_numValues = 3;
+
+//! Returns the contributions of simulation \p simulationIndex at \p step
+std::vector<real> localValues(int simulationIndex, int64_t step)
+{
+    std::vector<real> values(c_numValues);
+    for (int i = 0; i < c_numValues; i++)
+    {
+        values[i] = (simulationIndex + 1) * (1 + 0.1_real * step) + 0.5_real * i;
+    }
+
+    return values;
+}
+
+/*! \brief Checks lagged sums against blocking sums
+ *
+ * Calls the lagged sum at the steps in \p steps. The second element of
+ * each entry is the step at which the data of the other simulations
+ * used at that step was summed.
+ */
+void checkLaggedSums(int nstSum, const std::vector<std::pair<int64_t, int64_t>>& steps)
+{
+    int rank;
+    int numRanks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &numRanks);
+
+    const gmx_multisim_t ms(numRanks, rank, MPI_COMM_WORLD, MPI_COMM_WORLD);
+
+    EnsembleSum laggedSum(c_numValues, nstSum);
+    EnsembleSum blockingSum(c_numValues, 0);
+
+    for (const auto& [step, sumStep] : steps)
+    {
+        std::vector<real> lagged = localValues(rank, step);
+        laggedSum.sum(lagged, &ms, step);
+
+        std::vector<real> blocking = localValues(rank, sumStep);
+        blockingSum.sum(blocking, &ms, sumStep);
+
+        const std::vector<real> current = localValues(rank, step);
+        const std::vector<real> old     = localValues(rank, sumStep);
+        for (int i = 0; i < c_numValues; i++)
+        {
+            EXPECT_REAL_EQ_TOL(blocking[i] - old[i] + current[i], lagged[i], defaultRealTolerance())
+                    << "at step " << step << " for value " << i;
+        }
+    }
+}
+
+TEST(EnsembleSumTest, LaggedSumsMatchBlockingSumsEveryStep)
+{
+    GMX_MPI_TEST(2);
+
+    checkLaggedSums(3,
+                    { { 0, 0 },
+                      { 1, 0 },
+                      { 2, 0 },
+                      { 3, 0 },
+                      { 4, 3 },
+                      { 5, 3 },
+                      { 6, 3 },
+                      { 7, 6 },
+                      { 8, 6 },
+                      { 9, 6 } });
+}
+
+TEST(EnsembleSumTest, LaggedSumsCountMdSteps)
+{
+    GMX_MPI_TEST(2);
+
+    // Restraints evaluated every second step, e.g. with multiple time stepping
+    checkLaggedSums(
+            3, { { 0, 0 }, { 2, 0 }, { 4, 0 }, { 6, 4 }, { 8, 4 }, { 10, 8 }, { 12, 8 } });
+}
+
+TEST(EnsembleSumTest, BlockingSumsSumEveryStep)
+{
+    GMX_MPI_TEST(2);
+
+    checkLaggedSums(0, { { 0, 0 }, { 1, 1 }, { 2, 2 } });
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
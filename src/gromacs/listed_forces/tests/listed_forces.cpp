@@ -0,0 +1,413 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests ListedForces with a mix of perturbed and non-perturbed interactions
+ *
+ * The interactions of each type are split over the threads and each
+ * thread splits its range into a non-perturbed part, which can use SIMD
+ * kernels, and a perturbed part. The energies at foreign lambda values
+ * are computed for all lambda values in one pass over the perturbed
+ * interactions. The results are compared with those of the plain
+ * kernels applied to all interactions at each lambda value separately.
+ *
+ * \ingroup module_listed_forces
+ */
+#include "gmxpre.h"
+
+#include "gromacs/listed_forces/listed_forces.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/listed_forces/bonded.h"
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdtypes/enerdata.h"
+#include "gromacs/mdtypes/fcdata.h"
+#include "gromacs/mdtypes/forceoutput.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/mdtypes/simulation_workload.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/topology/forcefieldparameters.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/topsort.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/enumerationhelpers.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of atoms in the chain the interactions act on
+constexpr int c_numAtoms = 60;
+
+//! The lambda value of the bonded interactions
+constexpr real c_lambda = 0.3;
+
+//! The foreign lambda values, these include the end states and the current value
+const std::vector<double> c_foreignLambdas = { 0.0, 0.25, 0.3, 0.6, 1.0 };
+
+//! The interaction types used in the test
+const std::array<int, 3> c_interactionTypes = { F_BONDS, F_ANGLES, F_PDIHS };
+
+//! Energy, dV/dlambda and forces for one lambda value
+struct ListedOutput
+{
+    //! The total energy
+    double energy = 0;
+    //! dV/dlambda
+    double dvdl = 0;
+    //! The forces
+    std::vector<RVec> f;
+};
+
+/*! \brief Test fixture for ListedForces with perturbed and non-perturbed interactions
+ *
+ * The parameter is the number of threads used by ListedForces.
+ */
+class PerturbedListedForcesTest : public ::testing::TestWithParam<int>
+{
+protected:
+    PerturbedListedForcesTest() : x_(c_numAtoms), idef_(ffparams_)
+    {
+        // A helix, so no angle is close to linear and no dihedral is undefined
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            x_[i] = { 1.5_real + 0.3_real * std::cos(1.7_real * i),
+                      1.5_real + 0.3_real * std::sin(1.7_real * i),
+                      0.2_real + 0.12_real * i };
+        }
+
+        // Each type has a non-perturbed parameter set and a perturbed one
+        t_iparams params = { { 0 } };
+        params.harmonic  = { 0.45, 2000, 0.45, 2000 };
+        addParameters(F_BONDS, params);
+        params.harmonic = { 0.45, 2000, 0.5, 3000 };
+        addParameters(F_BONDS, params);
+        params.harmonic = { 110, 400, 110, 400 };
+        addParameters(F_ANGLES, params);
+        params.harmonic = { 100, 300, 120, 500 };
+        addParameters(F_ANGLES, params);
+        params.pdihs = { 0, 5, 3, 0, 5 };
+        addParameters(F_PDIHS, params);
+        params.pdihs = { 0, 5, 3, 30, 8 };
+        addParameters(F_PDIHS, params);
+
+        // Interleave perturbed and non-perturbed interactions with different
+        // patterns per type, so the split points differ between types and threads
+        for (int i = 0; i + 1 < c_numAtoms; i++)
+        {
+            idef_.il[F_BONDS].push_back(parameterType(F_BONDS, i % 3 == 1),
+                                        std::array<int, 2>{ i, i + 1 });
+        }
+        for (int i = 0; i + 2 < c_numAtoms; i++)
+        {
+            idef_.il[F_ANGLES].push_back(parameterType(F_ANGLES, i % 4 != 0),
+                                         std::array<int, 3>{ i, i + 1, i + 2 });
+        }
+        for (int i = 0; i + 3 < c_numAtoms; i++)
+        {
+            idef_.il[F_PDIHS].push_back(parameterType(F_PDIHS, i % 5 == 2),
+                                        std::array<int, 4>{ i, i + 1, i + 2, i + 3 });
+        }
+        // Keep the interactions in the original order for the reference calculation
+        for (int ftype : c_interactionTypes)
+        {
+            unsortedIatoms_[ftype] = idef_.il[ftype].iatoms;
+        }
+
+        const std::vector<int64_t> atomInfo(c_numAtoms, 0);
+        gmx_sort_ilist_fe(&idef_, atomInfo);
+
+        fr_.bMolPBC          = false;
+        fr_.use_simd_kernels = true;
+
+        fepvals_.n_lambda = c_foreignLambdas.size();
+        for (auto& lambdas : fepvals_.all_lambda)
+        {
+            lambdas = c_foreignLambdas;
+        }
+
+        mdatoms_.nr = c_numAtoms;
+
+        fcdata_.disres = &disresdata_;
+    }
+
+    //! Adds parameters \p params for interaction type \p ftype
+    void addParameters(int ftype, const t_iparams& params)
+    {
+        ffparams_.functype.push_back(ftype);
+        ffparams_.iparams.push_back(params);
+    }
+
+    //! Returns the parameter type index for \p ftype, perturbed or not
+    static int parameterType(int ftype, bool perturbed)
+    {
+        const int perturbedOffset = perturbed ? 1 : 0;
+        switch (ftype)
+        {
+            case F_BONDS: return 0 + perturbedOffset;
+            case F_ANGLES: return 2 + perturbedOffset;
+            default: return 4 + perturbedOffset;
+        }
+    }
+
+    //! Returns the output of the plain kernels for all interactions at \p lambda
+    ListedOutput computeReference(real lambda)
+    {
+        std::vector<real> f4(4 * c_numAtoms, 0);
+        rvec              fshift[c_numShiftVectors] = { { 0 } };
+        ListedOutput      output;
+        for (int ftype : c_interactionTypes)
+        {
+            real dvdl = 0;
+            output.energy += calculateSimpleBond(ftype,
+                                                 unsortedIatoms_[ftype].size(),
+                                                 unsortedIatoms_[ftype].data(),
+                                                 ffparams_.iparams.data(),
+                                                 as_rvec_array(x_.data()),
+                                                 reinterpret_cast<rvec4*>(f4.data()),
+                                                 fshift,
+                                                 nullptr,
+                                                 lambda,
+                                                 &dvdl,
+                                                 {},
+                                                 nullptr,
+                                                 nullptr,
+                                                 nullptr,
+                                                 nullptr,
+                                                 BondedKernelFlavor::ForcesAndVirialAndEnergy);
+            output.dvdl += dvdl;
+        }
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            output.f.emplace_back(f4[4 * a + XX], f4[4 * a + YY], f4[4 * a + ZZ]);
+        }
+        return output;
+    }
+
+    /*! \brief Computes the listed forces with ListedForces
+     *
+     * \param[in]  stepWork  The work to do
+     * \param[out] enerd     The energy output, can be nullptr when not computing energies
+     * \returns the forces
+     */
+    std::vector<RVec> computeListedForces(const StepWorkload& stepWork, gmx_enerdata_t* enerd)
+    {
+        ListedForces listedForces(
+                ffparams_, 1, GetParam(), ListedForces::interactionSelectionAll(), nullptr);
+        listedForces.setup(idef_, c_numAtoms, false);
+
+        PaddedVector<RVec>   f(c_numAtoms, { 0, 0, 0 });
+        std::vector<RVec>    shiftForces(c_numShiftVectors, { 0, 0, 0 });
+        ForceWithShiftForces forceWithShiftForces(
+                f.arrayRefWithPadding(), stepWork.computeVirial, shiftForces);
+        ForceWithVirial forceWithVirial(f.arrayRefWithPadding().unpaddedArrayRef(),
+                                        stepWork.computeVirial);
+        ForceOutputs    forceOutputs(forceWithShiftForces, false, forceWithVirial);
+
+        gmx::EnumerationArray<FreeEnergyPerturbationCouplingType, real> lambdas;
+        std::fill(lambdas.begin(), lambdas.end(), c_lambda);
+        gmx_enerdata_t energyDummy(1, fepvals_.n_lambda);
+        t_nrnb         nrnb;
+        matrix         box = { { 0 } };
+
+        listedForces.calculate(nullptr,
+                               box,
+                               &fepvals_,
+                               nullptr,
+                               nullptr,
+                               0,
+                               x_.constArrayRefWithPadding(),
+                               {},
+                               &fcdata_,
+                               nullptr,
+                               &forceOutputs,
+                               &fr_,
+                               nullptr,
+                               enerd ? enerd : &energyDummy,
+                               &nrnb,
+                               lambdas,
+                               &mdatoms_,
+                               nullptr,
+                               stepWork);
+
+        if (enerd)
+        {
+            enerd->foreignLambdaTerms.finalizePotentialContributions(
+                    enerd->dvdl_lin, lambdas, fepvals_);
+        }
+
+        return { f.begin(), f.end() };
+    }
+
+    //! Returns the tolerance for the forces in \p reference
+    static FloatingPointTolerance forceTolerance(const ListedOutput& reference)
+    {
+        real maxForce = 0;
+        for (const RVec& force : reference.f)
+        {
+            maxForce = std::max(maxForce, norm(force));
+        }
+        // The forces are reduced in a different order over the threads
+        return relativeToleranceAsUlp(maxForce, 16);
+    }
+
+    //! Expects that \p f matches the forces in \p reference
+    static void compareForces(const ListedOutput& reference, ArrayRef<const RVec> f)
+    {
+        const FloatingPointTolerance tolerance = forceTolerance(reference);
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(reference.f[a][d], f[a][d], tolerance)
+                        << formatString("for atom %d dimension %d", a, d);
+            }
+        }
+    }
+
+    //! The coordinates
+    PaddedVector<RVec> x_;
+    //! The force field parameters
+    gmx_ffparams_t ffparams_;
+    //! The interactions, sorted on perturbation
+    InteractionDefinitions idef_;
+    //! The interactions in their original order
+    std::array<std::vector<int>, F_NRE> unsortedIatoms_;
+    //! The free-energy parameters
+    t_lambda fepvals_;
+    //! The force record
+    t_forcerec fr_;
+    //! The atom data, only the number of atoms is used
+    t_mdatoms mdatoms_ = { 0 };
+    //! Distance restraint data, needed by ListedForces
+    t_disresdata disresdata_;
+    //! Force calculation data
+    t_fcdata fcdata_;
+};
+
+TEST_P(PerturbedListedForcesTest, SortsPerturbedInteractionsToTheEnd)
+{
+    EXPECT_EQ(idef_.ilsort, ilsortFE_SORTED);
+    for (int ftype : c_interactionTypes)
+    {
+        const int numNonperturbed = idef_.numNonperturbedInteractions[ftype];
+        EXPECT_GT(numNonperturbed, 0);
+        EXPECT_LT(numNonperturbed, idef_.il[ftype].size());
+    }
+}
+
+TEST_P(PerturbedListedForcesTest, EnergiesDvdlAndForcesMatchReference)
+{
+    StepWorkload stepWork;
+    stepWork.computeForces       = true;
+    stepWork.computeEnergy       = true;
+    stepWork.computeVirial       = true;
+    stepWork.computeDhdl         = true;
+    stepWork.computeListedForces = true;
+
+    gmx_enerdata_t          enerd(1, fepvals_.n_lambda);
+    const std::vector<RVec> f = computeListedForces(stepWork, &enerd);
+
+    const ListedOutput reference = computeReference(c_lambda);
+
+    double energy = 0;
+    for (int ftype : c_interactionTypes)
+    {
+        energy += enerd.term[ftype];
+    }
+    const FloatingPointTolerance energyTolerance = relativeToleranceAsUlp(reference.energy, 64);
+    EXPECT_REAL_EQ_TOL(reference.energy, energy, energyTolerance);
+    EXPECT_REAL_EQ_TOL(reference.dvdl,
+                       enerd.dvdl_nonlin[FreeEnergyPerturbationCouplingType::Bonded],
+                       relativeToleranceAsUlp(reference.dvdl, 64));
+    compareForces(reference, f);
+
+    // The foreign lambda terms only contain the perturbed interactions,
+    // so we compare the energy differences with the current lambda
+    const auto [foreignDeltaH, foreignDvdl] = enerd.foreignLambdaTerms.getTerms(nullptr);
+    for (int i = 0; i < fepvals_.n_lambda; i++)
+    {
+        SCOPED_TRACE(formatString("At foreign lambda %g", c_foreignLambdas[i]));
+        const ListedOutput foreignReference = computeReference(c_foreignLambdas[i]);
+        const double       magnitude = std::max(reference.energy, foreignReference.energy);
+        EXPECT_REAL_EQ_TOL(foreignReference.energy - reference.energy,
+                           foreignDeltaH[i],
+                           relativeToleranceAsUlp(magnitude, 64));
+        EXPECT_REAL_EQ_TOL(foreignReference.dvdl,
+                           foreignDvdl[i],
+                           relativeToleranceAsUlp(foreignReference.dvdl, 64));
+    }
+}
+
+TEST_P(PerturbedListedForcesTest, ForcesMatchReference)
+{
+    // Without energies and virial the non-perturbed interactions use SIMD kernels
+    StepWorkload stepWork;
+    stepWork.computeForces       = true;
+    stepWork.computeListedForces = true;
+
+    for (bool useSimd : { false, true })
+    {
+        SCOPED_TRACE(formatString("With SIMD kernels %s", useSimd ? "enabled" : "disabled"));
+        fr_.use_simd_kernels = useSimd;
+
+        compareForces(computeReference(c_lambda), computeListedForces(stepWork, nullptr));
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(WithThreads, PerturbedListedForcesTest, ::testing::Values(1, 2, 3, 4));
+
+} // namespace
+} // namespace test
+} // namespace gmx
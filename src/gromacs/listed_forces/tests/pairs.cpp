@@ -78,6 +78,7 @@
 #include "gromacs/topology/idef.h"
 #include "gromacs/utility/enumerationhelpers.h"
 #include "gromacs/utility/strconvert.h"
+#include "gromacs/utility/stringutil.h"
 #include "gromacs/utility/stringstream.h"
 #include "gromacs/utility/textwriter.h"
 #include "gromacs/utility/fatalerror.h"
@@ -460,6 +461,99 @@ INSTANTIATE_TEST_CASE_P(14Interaction,
                                            ::testing::ValuesIn(c_coordinatesFor14Interaction),
                                            ::testing::ValuesIn(c_pbcForTests)));
 
+/*! \brief Computes unperturbed F_LJC14_Q interactions for \p iatoms without PBC
+ *
+ * These use the plain pair kernel, with SIMD when \p useSimd is true.
+ */
+OutputQuantities computeLjc14Pairs(const std::vector<t_iatom>& iatoms,
+                                   const PaddedVector<RVec>&   x,
+                                   const BondedKernelFlavor    flavor,
+                                   const bool                  useSimd)
+{
+    t_iparams iparams =
+            ListInput().setLjc14Interaction(1.0, -1.0, 0.001458, 1.0062882e-6, 0.5).iparams;
+
+    std::vector<int>            globalAtomIndex = { 0, 1, 2 };
+    std::vector<real>           charge(c_numAtoms, 0.0);
+    std::vector<unsigned short> energyGroup(c_numAtoms, 0);
+
+    matrix box = { { 0 } };
+    t_pbc  pbc;
+    set_pbc(&pbc, PbcType::No, box);
+
+    t_forcerec* fr       = frHelper.get();
+    fr->efep             = FreeEnergyPerturbationType::No;
+    fr->bMolPBC          = false;
+    fr->use_simd_kernels = useSimd;
+
+    StepWorkload stepWork;
+    stepWork.computeVirial = computeVirial(flavor);
+    stepWork.computeEnergy = computeEnergy(flavor);
+
+    OutputQuantities  output(static_cast<int>(NonBondedEnergyTerms::Count));
+    std::vector<real> lambdas(static_cast<int>(FreeEnergyPerturbationCouplingType::Count), 0.0);
+
+    do_pairs(F_LJC14_Q,
+             iatoms.size(),
+             iatoms.data(),
+             &iparams,
+             as_rvec_array(x.data()),
+             output.f,
+             output.fShift,
+             &pbc,
+             lambdas.data(),
+             output.dvdLambda.data(),
+             charge,
+             charge,
+             {},
+             energyGroup,
+             1,
+             fr,
+             false,
+             stepWork,
+             &output.energy,
+             globalAtomIndex.data());
+
+    return output;
+}
+
+TEST(ListedForcesPairsBeyondTableTest, PairsAreSkipped)
+{
+    // Atoms 0 and 2 are further apart than the table range of 2.9 nm
+    const PaddedVector<RVec> x = { { 0.0, 0.0, 0.0 }, { 0.1, 0.2, 0.3 }, { 3.0, 0.0, 0.0 } };
+    const std::vector<t_iatom> iatomsWithinTable = { 0, 0, 1 };
+    const std::vector<t_iatom> iatoms            = { 0, 0, 1, 0, 0, 2 };
+
+    for (const bool useSimd : { false, true })
+    {
+        for (const auto flavor : { BondedKernelFlavor::ForcesAndVirialAndEnergy,
+                                   BondedKernelFlavor::ForcesAndEnergy,
+                                   BondedKernelFlavor::ForcesSimdWhenAvailable })
+        {
+            SCOPED_TRACE(formatString("Testing bonded kernel flavor: %s, SIMD: %s",
+                                      c_bondedKernelFlavorStrings[flavor].c_str(),
+                                      useSimd ? "yes" : "no"));
+
+            const OutputQuantities reference =
+                    computeLjc14Pairs(iatomsWithinTable, x, flavor, useSimd);
+            const OutputQuantities output = computeLjc14Pairs(iatoms, x, flavor, useSimd);
+
+            for (int a = 0; a < c_numAtoms; a++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ(reference.f[a][d], output.f[a][d]);
+                }
+            }
+            for (const auto term : { NonBondedEnergyTerms::Coulomb14, NonBondedEnergyTerms::LJ14 })
+            {
+                EXPECT_REAL_EQ(reference.energy.energyGroupPairTerms[term][0],
+                               output.energy.energyGroupPairTerms[term][0]);
+            }
+        }
+    }
+}
+
 } // namespace
 
 } // namespace test
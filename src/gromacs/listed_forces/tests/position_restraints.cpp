@@ -44,7 +44,9 @@
 
 #include <cmath>
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -52,6 +54,7 @@
 #include "gromacs/listed_forces/listed_forces.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/math/vectypes.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdtypes/enerdata.h"
 #include "gromacs/mdtypes/forcerec.h"
 #include "gromacs/mdtypes/forceoutput.h"
@@ -80,6 +83,24 @@ namespace
 //! Tolerance for float evaluation
 constexpr float c_precisionTolerance = 1e-6;
 
+/*! \brief The minimum number of position restraints per thread
+ *
+ * This should match the value used in the position restraint code.
+ */
+constexpr int c_minNumRestraintsPerThread = 256;
+
+//! The forces, virial, energy and dV/dlambda of a set of position restraints
+struct PositionRestraintResult
+{
+    //! The forces
+    std::vector<RVec> forces;
+    //! The diagonal of the virial
+    RVec virial;
+    //! The potential energy
+    real energy;
+    //! dV/dlambda
+    real dvdl;
+};
 
 class PositionRestraintsTest : public ::testing::TestWithParam<std::tuple<RefCoordScaling, PbcType>>
 {
@@ -98,10 +119,9 @@ protected:
     std::unique_ptr<ForceWithVirial> forceWithVirial_;
     RefCoordScaling                  refCoordScaling_;
 
-    TestReferenceData    refData_;
-    TestReferenceChecker checker_;
+    TestReferenceData refData_;
 
-    PositionRestraintsTest() : idef_({}), enerd_(1, 0), checker_(refData_.rootChecker())
+    PositionRestraintsTest() : idef_({}), enerd_(1, 0)
     {
         refCoordScaling_ = std::get<0>(GetParam());
         pbcType_         = std::get<1>(GetParam());
@@ -112,9 +132,6 @@ protected:
         box_[2][2] = 1.1;
         set_pbc(&pbc_, pbcType_, box_);
 
-        FloatingPointTolerance tolerance = relativeToleranceAsFloatingPoint(1.0, c_precisionTolerance);
-        checker_.setDefaultTolerance(tolerance);
-
         fr_.rc_scaling    = refCoordScaling_;
         fr_.pbcType       = pbcType_;
         fr_.posres_com[1] = 0.5;
@@ -144,10 +161,123 @@ protected:
         f_.resize(x_.size(), { 0, 0, 0 });
         forceWithVirial_ = std::make_unique<ForceWithVirial>(f_, /*computeVirial=*/true);
     }
+
+    //! Evaluates the restraints at \p lambdas using \p useSimd and \p numThreads threads
+    PositionRestraintResult evaluate(ArrayRef<const real> lambdas, bool useSimd, int numThreads)
+    {
+        gmx_omp_nthreads_set(ModuleMultiThread::Bonded, numThreads);
+        fr_.use_simd_kernels = useSimd;
+
+        PositionRestraintResult result;
+        gmx_enerdata_t          enerd(1, 0);
+        result.forces.resize(x_.size(), { 0, 0, 0 });
+        ForceWithVirial forceWithVirial(result.forces, /*computeVirial=*/true);
+        posres_wrapper(&nrnb_,
+                       idef_,
+                       &pbc_,
+                       as_rvec_array(x_.data()),
+                       &enerd,
+                       lambdas,
+                       &fr_,
+                       &forceWithVirial);
+        for (int m = 0; m < DIM; m++)
+        {
+            result.virial[m] = forceWithVirial.getVirial()[m][m];
+        }
+        result.energy = enerd.term[F_POSRES];
+        result.dvdl   = enerd.dvdl_nonlin[FreeEnergyPerturbationCouplingType::Restraint];
+
+        return result;
+    }
+
+    /*! \brief Checks that the SIMD and the threaded kernels match the serial scalar kernel
+     *
+     * Uses \p numRestraints perturbed restraints with perturbed reference positions.
+     */
+    void checkSimdAndThreadsMatchSerialScalar(int numRestraints);
 };
 
 std::array<real, static_cast<size_t>(FreeEnergyPerturbationCouplingType::Count)> c_emptyLambdas = { { 0 } };
 
+void PositionRestraintsTest::checkSimdAndThreadsMatchSerialScalar(const int numRestraints)
+{
+    SCOPED_TRACE(formatString("Testing PBC type: %s, refcoord type: %s, %d restraints",
+                              c_pbcTypeNames[pbcType_].c_str(),
+                              enumValueToString(refCoordScaling_),
+                              numRestraints));
+    std::vector<RVec> positions;
+    std::vector<RVec> referencePositions;
+    std::vector<RVec> forceConstants;
+    for (int i = 0; i < numRestraints; i++)
+    {
+        positions.emplace_back(
+                0.05_real * (i % 17), 0.9_real - 0.02_real * (i % 41), 0.03_real * (i % 7));
+        referencePositions.emplace_back(0.8_real - 0.01_real * (i % 59),
+                                        0.1_real + 0.025_real * (i % 31),
+                                        1.0_real - 0.04_real * (i % 5));
+        forceConstants.emplace_back(100.0_real + 10 * (i % 23), 500.0_real, 50.0_real * (i % 3));
+    }
+    setValues(positions, referencePositions, forceConstants);
+    // The offset avoids distances of exactly half a box, where the choice
+    // of the periodic image depends on rounding
+    for (int i = 0; i < numRestraints; i++)
+    {
+        auto& entry = idef_.iparams_posres[i];
+        for (int m = 0; m < DIM; m++)
+        {
+            entry.posres.pos0B[m] = entry.posres.pos0A[m] + 0.1_real * (m + 1) + 0.003_real;
+            entry.posres.fcB[m]   = 0.5_real * entry.posres.fcA[m];
+        }
+    }
+    auto lambdas = c_emptyLambdas;
+    lambdas[static_cast<int>(FreeEnergyPerturbationCouplingType::Restraint)] = 0.3;
+
+    // Use up to four threads, as long as each thread gets enough restraints
+    const int maxNumThreads = std::clamp(numRestraints / (2 * c_minNumRestraintsPerThread), 1, 4);
+
+    const int numThreadsBackup = gmx_omp_nthreads_get(ModuleMultiThread::Bonded);
+
+    const PositionRestraintResult reference = evaluate(lambdas, false, 1);
+
+    // The forces are computed independently for each restraint, so they should agree
+    // to a few ULP. The sums are accumulated in a different order, which gives rounding
+    // differences that grow with the square root of the number of restraints.
+    const FloatingPointTolerance forceTolerance = ulpTolerance(4);
+    const uint64_t sumUlpTolerance = 4 * static_cast<uint64_t>(std::ceil(std::sqrt(numRestraints)));
+
+    for (bool useSimd : { false, true })
+    {
+        for (int numThreads : { 1, maxNumThreads })
+        {
+            SCOPED_TRACE(formatString("SIMD %s, %d threads", useSimd ? "on" : "off", numThreads));
+
+            const PositionRestraintResult result = evaluate(lambdas, useSimd, numThreads);
+
+            for (int i = 0; i < numRestraints; i++)
+            {
+                for (int m = 0; m < DIM; m++)
+                {
+                    EXPECT_REAL_EQ_TOL(reference.forces[i][m], result.forces[i][m], forceTolerance);
+                }
+            }
+            for (int m = 0; m < DIM; m++)
+            {
+                EXPECT_REAL_EQ_TOL(reference.virial[m],
+                                   result.virial[m],
+                                   relativeToleranceAsUlp(reference.virial[m], sumUlpTolerance));
+            }
+            EXPECT_REAL_EQ_TOL(reference.energy,
+                               result.energy,
+                               relativeToleranceAsUlp(reference.energy, sumUlpTolerance));
+            EXPECT_REAL_EQ_TOL(reference.dvdl,
+                               result.dvdl,
+                               relativeToleranceAsUlp(reference.dvdl, sumUlpTolerance));
+        }
+    }
+
+    gmx_omp_nthreads_set(ModuleMultiThread::Bonded, numThreadsBackup);
+}
+
 TEST_P(PositionRestraintsTest, BasicPosResNoFreeEnergy)
 {
     SCOPED_TRACE(formatString("Testing PBC type: %s, refcoord type: %s",
@@ -165,10 +295,24 @@ TEST_P(PositionRestraintsTest, BasicPosResNoFreeEnergy)
                    c_emptyLambdas,
                    &fr_,
                    forceWithVirial_.get());
-    checker_.checkSequence(
+    TestReferenceChecker checker(refData_.rootChecker());
+    checker.setDefaultTolerance(relativeToleranceAsFloatingPoint(1.0, c_precisionTolerance));
+    checker.checkSequence(
             std::begin(forceWithVirial_->force_), std::end(forceWithVirial_->force_), "Forces");
-    checker_.checkSequenceArray(3, forceWithVirial_->getVirial(), "Virial contribution");
-    checker_.checkReal(enerd_.term[F_POSRES], "Potential energy");
+    checker.checkSequenceArray(3, forceWithVirial_->getVirial(), "Virial contribution");
+    checker.checkReal(enerd_.term[F_POSRES], "Potential energy");
+}
+
+TEST_P(PositionRestraintsTest, SimdMatchesScalarWithFreeEnergy)
+{
+    // Use enough restraints to fill several SIMD registers and a remainder
+    checkSimdAndThreadsMatchSerialScalar(37);
+}
+
+TEST_P(PositionRestraintsTest, ThreadedSimdMatchesScalarWithFreeEnergy)
+{
+    // Use enough restraints to distribute them over four threads
+    checkSimdAndThreadsMatchSerialScalar(8 * c_minNumRestraintsPerThread + 37);
 }
 
 //! PBC values for testing
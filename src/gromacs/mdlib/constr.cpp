@@ -135,6 +135,10 @@ public:
                bool                      computeVirial,
                tensor                    constraintsVirial,
                ConstraintVariable        econq);
+    //! Returns whether SETTLE can be fused with the coordinate update
+    bool canFuseSettleWithUpdate() const;
+    //! Reports a SETTLE error at step \p step, exits when there are too many warnings
+    void reportSettleError(int64_t step);
     //! The total number of constraints.
     int ncon_tot = 0;
     //! The number of flexible constraints.
@@ -691,23 +695,7 @@ bool Constraints::Impl::apply(bool                      bLog,
 
             if (bSettleErrorHasOccurred0)
             {
-                char buf[STRLEN];
-                sprintf(buf,
-                        "\nstep "
-                        "%" PRId64
-                        ": One or more water molecules can not be settled.\n"
-                        "Check for bad contacts and/or reduce the timestep if appropriate.\n",
-                        step);
-                if (log)
-                {
-                    fprintf(log, "%s", buf);
-                }
-                fprintf(stderr, "%s", buf);
-                warncount_settle++;
-                if (warncount_settle > maxwarn)
-                {
-                    too_many_constraint_warnings(ConstraintAlgorithm::Count, warncount_settle);
-                }
+                reportSettleError(step);
                 bDump = TRUE;
 
                 bOK = FALSE;
@@ -847,6 +835,80 @@ int Constraints::numConstraintsTotal()
     return impl_->ncon_tot;
 }
 
+void Constraints::Impl::reportSettleError(int64_t step)
+{
+    char buf[STRLEN];
+    sprintf(buf,
+            "\nstep "
+            "%" PRId64
+            ": One or more water molecules can not be settled.\n"
+            "Check for bad contacts and/or reduce the timestep if appropriate.\n",
+            step);
+    if (log)
+    {
+        fprintf(log, "%s", buf);
+    }
+    fprintf(stderr, "%s", buf);
+    warncount_settle++;
+    if (warncount_settle > maxwarn)
+    {
+        too_many_constraint_warnings(ConstraintAlgorithm::Count, warncount_settle);
+    }
+}
+
+bool Constraints::Impl::canFuseSettleWithUpdate() const
+{
+    if (!settled || settled->numSettles() == 0 || lincsd != nullptr || shaked != nullptr)
+    {
+        return false;
+    }
+
+    /* The same conditions as in apply() for not needing PBC */
+    const bool needPbc = (ir.pbcType != PbcType::No
+                          && (cr->dd ? cr->dd->constraint_comm != nullptr : pbcHandlingRequired_));
+
+    return !needPbc && !(ir.bPull && pull_have_constraint(*pull_work)) && ed == nullptr
+           && cFREEZE_.empty() && settled->settlesAreConsecutiveAndOrdered();
+}
+
+const SettleData* Constraints::settleDataForFusedUpdate() const
+{
+    return impl_->canFuseSettleWithUpdate() ? impl_->settled.get() : nullptr;
+}
+
+bool Constraints::finishFusedSettle(const int64_t step,
+                                    const bool    haveVelocities,
+                                    const bool    computeVirial,
+                                    tensor        constraintsVirial,
+                                    const bool    errorHasOccurred)
+{
+    const int numSettles = impl_->settled->numSettles();
+
+    inc_nrnb(impl_->nrnb, eNR_SETTLE, numSettles);
+    if (haveVelocities)
+    {
+        inc_nrnb(impl_->nrnb, eNR_CONSTR_V, numSettles * 3);
+    }
+    if (computeVirial)
+    {
+        inc_nrnb(impl_->nrnb, eNR_CONSTR_VIR, numSettles * 3);
+
+        /* As in apply() for ConstraintVariable::Positions with leap-frog */
+        const real delta_t = impl_->ir.delta_t;
+        msmul(constraintsVirial, 0.5 / (delta_t * delta_t), constraintsVirial);
+    }
+
+    if (errorHasOccurred)
+    {
+        /* Note that the coordinates before constraining have already been
+         * overwritten, so we can not dump the configurations here.
+         */
+        impl_->reportSettleError(step);
+    }
+
+    return !errorHasOccurred;
+}
+
 FlexibleConstraintTreatment flexibleConstraintTreatment(bool haveDynamicsIntegrator)
 {
     if (haveDynamicsIntegrator)
@@ -1186,6 +1248,8 @@ Constraints::Impl::Impl(const gmx_mtop_t&     mtop_p,
             }
 
             shaked = std::make_unique<shakedata>();
+            // SHAKE and LINCS are exclusive, so SHAKE uses the constraint thread count of LINCS
+            shaked->numThreads = gmx_omp_nthreads_get(ModuleMultiThread::Lincs);
         }
     }
 
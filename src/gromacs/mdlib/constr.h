@@ -76,6 +76,7 @@ template<typename T>
 class ArrayRefWithPadding;
 template<typename>
 class ListOfLists;
+class SettleData;
 
 //! Describes supported flavours of constrained updates.
 enum class ConstraintVariable : int
@@ -210,6 +211,32 @@ public:
      */
     int numConstraintsTotal();
 
+    /*! \brief Returns the SETTLE data when constraining can be fused with the coordinate
+     * update, nullptr otherwise
+     *
+     * Fusing is possible when SETTLE is the only constraint algorithm in use, no PBC,
+     * pull or essential dynamics constraints are needed, there are no freeze groups
+     * and all settles act on consecutive atoms ordered by index.
+     */
+    const SettleData* settleDataForFusedUpdate() const;
+
+    /*! \brief Finishes SETTLE constraining that was applied within a fused update
+     *
+     * Counts the flops, scales the constraint virial and reports SETTLE errors.
+     *
+     * \param[in]     step               The MD step
+     * \param[in]     haveVelocities     Whether the velocities were also constrained
+     * \param[in]     computeVirial      Whether the virial was computed
+     * \param[in,out] constraintsVirial  Sum of r x m delta_r on input, the virial on output
+     * \param[in]     errorHasOccurred   Whether one or more settles could not be applied
+     * \returns whether the constraining succeeded without error
+     */
+    bool finishFusedSettle(int64_t step,
+                           bool    haveVelocities,
+                           bool    computeVirial,
+                           tensor  constraintsVirial,
+                           bool    errorHasOccurred);
+
 private:
     //! Implementation type.
     class Impl;
@@ -1365,7 +1365,7 @@ void trotter_update(const t_inputrec*                   ir,
                     TrotterSequence                     trotter_seqno)
 {
 
-    int              n, i, d, ngtc, gc = 0, t;
+    int              n, i, d, ngtc, t;
     t_grp_tcstat*    tcstat;
     const t_grpopts* opts;
     int64_t          step_eff;
@@ -1464,18 +1464,24 @@ void trotter_update(const t_inputrec*                   ir,
                 /* but do we actually need the total? */
 
                 /* modify the velocities as well */
-                for (n = 0; n < homenr; n++)
                 {
-                    if (!cTC.empty()) /* does this conditional need to be here? is this always true?*/
-                    {
-                        gc = cTC[n];
-                    }
-                    for (d = 0; d < DIM; d++)
+                    const int gmx_unused numThreads =
+                            gmx_omp_nthreads_get(ModuleMultiThread::Update);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+                    for (int a = 0; a < homenr; a++)
                     {
-                        v[n][d] *= scalefac[gc];
+                        // Trivial OpenMP region that does not throw
+                        const int group = cTC.empty() ? 0 : cTC[a];
+                        for (int dim = 0; dim < DIM; dim++)
+                        {
+                            v[a][dim] *= scalefac[group];
+                        }
                     }
+                }
 
-                    if (debug)
+                if (debug)
+                {
+                    for (n = 0; n < homenr; n++)
                     {
                         for (d = 0; d < DIM; d++)
                         {
@@ -142,6 +142,7 @@ EnergyOutput::EnergyOutput(ener_file*                fp_ene,
                            bool                      isRerun,
                            const StartingBehavior    startingBehavior,
                            const bool                simulationsShareState,
+                           const bool                exchangeLambdaStates,
                            const MDModulesNotifiers& mdModulesNotifiers)
 {
     const char*        ener_nm[F_NRE];
@@ -553,6 +554,7 @@ EnergyOutput::EnergyOutput(ener_file*                fp_ene,
         fp_dhdl_ = fp_dhdl;
         dE_.resize(inputrec.fepvals->n_lambda);
     }
+    exchangeLambdaStates_ = exchangeLambdaStates;
     if (inputrec.bSimTemp)
     {
         temperatures_ = inputrec.simtempvals->temperatures;
@@ -630,7 +632,10 @@ static void print_lambda_vector(t_lambda* fep, int i, bool get_native_lambda, bo
     }
 }
 
-FILE* open_dhdl(const char* filename, const t_inputrec* ir, const gmx_output_env_t* oenv)
+FILE* open_dhdl(const char*             filename,
+                const t_inputrec*       ir,
+                bool                    exchangeLambdaStates,
+                const gmx_output_env_t* oenv)
 {
     FILE*       fp;
     const char *dhdl = "dH/d\\lambda", *deltag = "\\DeltaH", *lambda = "\\lambda",
@@ -638,7 +643,6 @@ FILE* open_dhdl(const char* filename, const t_inputrec* ir, const gmx_output_env
     int         i, nsets, nsets_de, nsetsbegin;
     int         n_lambda_terms = 0;
     t_lambda*   fep            = ir->fepvals.get(); /* for simplicity */
-    t_expanded* expand         = ir->expandedvals.get();
     char        lambda_vec_str[STRLEN], lambda_name_str[STRLEN];
 
     int  nsets_dhdl = 0;
@@ -706,7 +710,10 @@ FILE* open_dhdl(const char* filename, const t_inputrec* ir, const gmx_output_env
 
     nsets = nsets_dhdl + nsets_de; /* dhdl + fep differences */
 
-    if (fep->n_lambda > 0 && (expand->elmcmove > LambdaMoveCalculation::No))
+    /* With expanded ensemble or lambda state exchange the state changes during the run */
+    const bool writeLambdaState =
+            (ir->expandedvals->elmcmove > LambdaMoveCalculation::No || exchangeLambdaStates);
+    if (fep->n_lambda > 0 && writeLambdaState)
     {
         nsets += 1; /*add fep state for expanded ensemble */
     }
@@ -728,7 +735,7 @@ FILE* open_dhdl(const char* filename, const t_inputrec* ir, const gmx_output_env
     }
     std::vector<std::string> setname(nsetsextend);
 
-    if (expand->elmcmove > LambdaMoveCalculation::No)
+    if (writeLambdaState)
     {
         /* state for the fep_vals, if we have alchemical sampling */
         setname[s++] = "Thermodynamic state";
@@ -781,7 +788,7 @@ FILE* open_dhdl(const char* filename, const t_inputrec* ir, const gmx_output_env
          * from this xvg legend.
          */
 
-        if (expand->elmcmove > LambdaMoveCalculation::No)
+        if (writeLambdaState)
         {
             nsetsbegin = 1; /* for including the expanded ensemble */
         }
@@ -1047,8 +1054,9 @@ void EnergyOutput::addDataAtEnergyStep(bool                    bDoDHDL,
             fprintf(fp_dhdl_, "%.4f", time);
             /* the current free energy state */
 
-            /* print the current state if we are doing expanded ensemble */
-            if (expand->elmcmove > LambdaMoveCalculation::No)
+            /* print the current state if we are doing expanded ensemble
+             * or exchanging lambda states */
+            if (expand->elmcmove > LambdaMoveCalculation::No || exchangeLambdaStates_)
             {
                 fprintf(fp_dhdl_, " %4d", fep_state);
             }
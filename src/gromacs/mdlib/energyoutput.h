@@ -144,6 +144,7 @@ public:
      * \param[in] isRerun    Is this is a rerun instead of the simulations.
      * \param[in] startingBehavior  Run starting behavior.
      * \param[in] simulationsShareState  Tells whether the physical state is shared over simulations
+     * \param[in] exchangeLambdaStates  Tells whether replica exchange exchanges lambda states
      * \param[in] mdModulesNotifiers Notifications to MD modules.
      */
     EnergyOutput(ener_file*                fp_ene,
@@ -154,6 +155,7 @@ public:
                  bool                      isRerun,
                  StartingBehavior          startingBehavior,
                  bool                      simulationsShareState,
+                 bool                      exchangeLambdaStates,
                  const MDModulesNotifiers& mdModulesNotifiers);
 
     ~EnergyOutput();
@@ -404,6 +406,8 @@ private:
     FILE* fp_dhdl_ = nullptr;
     //! Energy components for dhdl.xvg output
     std::vector<double> dE_;
+    //! Whether the lambda state changes by replica exchange, so it is written to dhdl.xvg
+    bool exchangeLambdaStates_ = false;
     //! The delta U components (raw data + histogram)
     std::unique_ptr<t_mde_delta_h_coll> dhc_;
     //! Temperatures for simulated tempering groups
@@ -415,7 +419,14 @@ private:
 
 } // namespace gmx
 
-//! Open the dhdl file for output
-FILE* open_dhdl(const char* filename, const t_inputrec* ir, const gmx_output_env_t* oenv);
+/*! \brief Open the dhdl file for output
+ *
+ * The current lambda state is written with expanded ensemble and when
+ * \p exchangeLambdaStates tells that replica exchange exchanges lambda states.
+ */
+FILE* open_dhdl(const char*             filename,
+                const t_inputrec*       ir,
+                bool                    exchangeLambdaStates,
+                const gmx_output_env_t* oenv);
 
 #endif
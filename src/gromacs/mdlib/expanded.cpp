@@ -76,86 +76,38 @@ void init_expanded_ensemble(gmx_bool bStateFromCP, const t_inputrec* ir, df_hist
     }
 }
 
-static void GenerateGibbsProbabilities(const real* ene, double* p_k, double* pks, int minfep, int maxfep)
+/*! \brief Computes the Gibbs probabilities p_k of the states minfep to maxfep with log weights ene
+ *
+ * \returns the log of the normalization of the probabilities
+ */
+static double GenerateGibbsProbabilities(const real* ene, double* p_k, int minfep, int maxfep)
 {
+    const int numStates = maxfep - minfep + 1;
 
-    int  i;
-    real maxene;
-
-    *pks   = 0.0;
-    maxene = ene[minfep];
-    /* find the maximum value */
-    for (i = minfep; i <= maxfep; i++)
-    {
-        if (ene[i] > maxene)
-        {
-            maxene = ene[i];
-        }
-    }
-    /* find the denominator */
-    for (i = minfep; i <= maxfep; i++)
-    {
-        *pks += std::exp(ene[i] - maxene);
-    }
-    /*numerators*/
-    for (i = minfep; i <= maxfep; i++)
-    {
-        p_k[i] = std::exp(ene[i] - maxene) / *pks;
-    }
+    return gmx::calculateGibbsProbabilities(gmx::arrayRefFromArray(ene + minfep, numStates),
+                                            gmx::arrayRefFromArray(p_k + minfep, numStates));
 }
 
-static void
-GenerateWeightedGibbsProbabilities(const real* ene, double* p_k, double* pks, int nlim, real* nvals, real delta)
+/*! \brief Computes the Gibbs probabilities p_k for log weights ene weighted with counts nvals
+ *
+ * \p nene is used as work array, all arrays should have \p nlim elements.
+ */
+static void GenerateWeightedGibbsProbabilities(const real* ene,
+                                               double*     p_k,
+                                               int         nlim,
+                                               const real* nvals,
+                                               real        delta,
+                                               real*       nene)
 {
-
-    int   i;
-    real  maxene;
-    real* nene;
-    *pks = 0.0;
-
-    snew(nene, nlim);
-    for (i = 0; i < nlim; i++)
-    {
-        if (nvals[i] == 0)
-        {
-            /* add the delta, since we need to make sure it's greater than zero, and
-               we need a non-arbitrary number? */
-            nene[i] = ene[i] + std::log(nvals[i] + delta);
-        }
-        else
-        {
-            nene[i] = ene[i] + std::log(nvals[i]);
-        }
-    }
-
-    /* find the maximum value */
-    maxene = nene[0];
-    for (i = 0; i < nlim; i++)
+    for (int i = 0; i < nlim; i++)
     {
-        if (nene[i] > maxene)
-        {
-            maxene = nene[i];
-        }
+        /* add the delta when there are no counts, since we need to make sure it's greater
+           than zero, and we need a non-arbitrary number? */
+        nene[i] = ene[i] + std::log(nvals[i] == 0 ? nvals[i] + delta : nvals[i]);
     }
 
-    /* subtract off the maximum, avoiding overflow */
-    for (i = 0; i < nlim; i++)
-    {
-        nene[i] -= maxene;
-    }
-
-    /* find the denominator */
-    for (i = 0; i < nlim; i++)
-    {
-        *pks += std::exp(nene[i]);
-    }
-
-    /*numerators*/
-    for (i = 0; i < nlim; i++)
-    {
-        p_k[i] = std::exp(nene[i]) / *pks;
-    }
-    sfree(nene);
+    gmx::calculateGibbsProbabilities(gmx::arrayRefFromArray(nene, nlim),
+                                     gmx::arrayRefFromArray(p_k, nlim));
 }
 
 static int FindMinimum(const real* min_metric, int N)
@@ -339,7 +291,7 @@ static gmx_bool UpdateWeights(int           nlim,
     real    clam_varm, clam_varp, clam_osum, clam_weightsm, clam_weightsp, clam_minvar;
     real *  lam_variance, *lam_dg;
     double* p_k;
-    double  pks = 0;
+    real*   nene;
 
     /* Future potential todos for this function (see #3848):
      *  - Update the names in the dhist structure to be clearer. Not done for now since this
@@ -382,18 +334,18 @@ static gmx_bool UpdateWeights(int           nlim,
          * applied to expanded ensemble. */
         {
             snew(p_k, nlim);
+            snew(nene, nlim);
 
             /* first increment count */
-            GenerateGibbsProbabilities(weighted_lamee, p_k, &pks, 0, nlim - 1);
+            GenerateGibbsProbabilities(weighted_lamee, p_k, 0, nlim - 1);
             for (i = 0; i < nlim; i++)
             {
                 dfhist->wl_histo[i] += static_cast<real>(p_k[i]);
             }
 
             /* then increment weights (uses count) */
-            pks = 0.0;
             GenerateWeightedGibbsProbabilities(
-                    weighted_lamee, p_k, &pks, nlim, dfhist->wl_histo, dfhist->wl_delta);
+                    weighted_lamee, p_k, nlim, dfhist->wl_histo, dfhist->wl_delta, nene);
 
             for (i = 0; i < nlim; i++)
             {
@@ -409,6 +361,7 @@ static gmx_bool UpdateWeights(int           nlim,
                }
              */
             sfree(p_k);
+            sfree(nene);
         }
 
         zero_sum_weights = dfhist->sum_weights[0];
@@ -846,7 +799,7 @@ static int ChooseNewLambda(int               nlim,
     int                  i, ifep, minfep, maxfep, lamnew, lamtrial, starting_fep_state;
     real                 r1, r2, de, trialprob, tprob = 0;
     double *             propose, *accept, *remainder;
-    double               pks;
+    double               logPks = 0;
     real                 pnorm;
     gmx::ThreeFry2x64<0> rng(
             seed, gmx::RandomDomain::ExpandedEnsemble); // We only draw once, so zero bits internal counter is fine
@@ -918,7 +871,7 @@ static int ChooseNewLambda(int               nlim,
                 }
             }
 
-            GenerateGibbsProbabilities(weighted_lamee, p_k, &pks, minfep, maxfep);
+            logPks = GenerateGibbsProbabilities(weighted_lamee, p_k, minfep, maxfep);
 
             if (expand->elmcmove == LambdaMoveCalculation::Gibbs)
             {
@@ -1043,10 +996,10 @@ static int ChooseNewLambda(int               nlim,
                     loc += sprintf(
                             errorstr,
                             "Something wrong in choosing new lambda state with a Gibbs move -- "
-                            "probably underflow in weight determination.\nDenominator is: "
+                            "probably underflow in weight determination.\nLog of denominator is: "
                             "%3d%17.10e\n  i                dE        numerator          weights\n",
                             0,
-                            pks);
+                            logPks);
                     for (ifep = minfep; ifep <= maxfep; ifep++)
                     {
                         loc += sprintf(&errorstr[loc],
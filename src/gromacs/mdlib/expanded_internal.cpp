@@ -45,8 +45,13 @@
 
 #include <cmath>
 
+#include <algorithm>
+
 #include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
 
 namespace gmx
 {
@@ -100,4 +105,59 @@ real calculateAcceptanceWeight(LambdaWeightCalculation calculationMode, real lam
     GMX_THROW(NotImplementedError("Unknown acceptance calculation mode"));
 }
 
+double calculateGibbsProbabilities(ArrayRef<const real> logWeights, ArrayRef<double> probabilities)
+{
+    GMX_ASSERT(!logWeights.empty(), "Need at least one state");
+    GMX_ASSERT(probabilities.size() == logWeights.size(),
+               "Need as many probabilities as log weights");
+
+    const int numStates = logWeights.ssize();
+
+    /* Log-sum-exp in double precision: subtracting the maximum avoids
+     * overflow and the maximum contributes exp(0) = 1, so the sum is at least 1.
+     */
+    const double maxLogWeight = *std::max_element(logWeights.begin(), logWeights.end());
+
+    /* The shifted log weights are stored in the output, so the exponentials
+     * can be computed in SIMD in place. This keeps the cost of the many
+     * exponentials low also for hundreds of lambda states.
+     */
+    for (int i = 0; i < numStates; i++)
+    {
+        probabilities[i] = logWeights[i] - maxLogWeight;
+    }
+
+#if GMX_SIMD_HAVE_DOUBLE && GMX_SIMD_HAVE_LOADU && GMX_SIMD_HAVE_STOREU
+    typedef SimdDouble PackType;
+    constexpr int      packSize = GMX_SIMD_DOUBLE_WIDTH;
+#else
+    typedef double PackType;
+    constexpr int  packSize = 1;
+#endif
+    const int numPackedStates = (numStates / packSize) * packSize;
+
+    double* gmx_restrict probabilityData = probabilities.data();
+    PackType             sumPack(0.0);
+    for (int i = 0; i < numPackedStates; i += packSize)
+    {
+        const PackType probabilityPack = gmx::exp(loadU<PackType>(probabilityData + i));
+        sumPack                        = sumPack + probabilityPack;
+        storeU(probabilityData + i, probabilityPack);
+    }
+    double sum = reduce(sumPack);
+    for (int i = numPackedStates; i < numStates; i++)
+    {
+        probabilities[i] = std::exp(probabilities[i]);
+        sum += probabilities[i];
+    }
+
+    const double invSum = 1.0 / sum;
+    for (double& probability : probabilities)
+    {
+        probability *= invSum;
+    }
+
+    return maxLogWeight + std::log(sum);
+}
+
 } // namespace gmx
@@ -44,6 +44,7 @@
 #ifndef GMX_MDLIB_EXPANDEDINTERNAL_H
 #define GMX_MDLIB_EXPANDEDINTERNAL_H
 
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/real.h"
 
 enum class LambdaWeightCalculation : int;
@@ -57,6 +58,19 @@ namespace gmx
  * \return  The acceptance weight
  */
 real calculateAcceptanceWeight(LambdaWeightCalculation calculationMode, real lambdaEnergyDifference);
+
+/*! \brief Calculates normalized Gibbs probabilities of a set of lambda states
+ *
+ * Computes p_i = exp(w_i) / sum_j exp(w_j) for the (unnormalized) log weights w_i.
+ * The maximum log weight is subtracted before exponentiation to avoid overflow
+ * and the exponentials and their sum are computed in double precision, using
+ * SIMD when available.
+ *
+ * \param[in]  logWeights     The log weights of the states, should not be empty
+ * \param[out] probabilities  The normalized probabilities, same size as \p logWeights
+ * \return  The log of sum_j exp(w_j)
+ */
+double calculateGibbsProbabilities(ArrayRef<const real> logWeights, ArrayRef<double> probabilities);
 } // namespace gmx
 
 #endif // GMX_MDLIB_EXPANDEDINTERNAL_H
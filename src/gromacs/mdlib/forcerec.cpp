@@ -728,6 +728,15 @@ void init_forcerec(FILE*                            fplog,
         }
     }
 
+    forcerec->sortBondedInteractionsByLocality = (getenv("GMX_BONDED_SORT_LOCALITY") != nullptr);
+    if (forcerec->sortBondedInteractionsByLocality && fplog != nullptr)
+    {
+        fprintf(fplog,
+                "\nFound environment variable GMX_BONDED_SORT_LOCALITY.\n"
+                "Sorting the bonded interactions on atom index before dividing them over "
+                "threads.\n\n");
+    }
+
     forcerec->haveBuckingham = (mtop.ffparams.functype[0] == F_BHAM);
 
     /* Neighbour searching stuff */
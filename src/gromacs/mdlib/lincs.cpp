@@ -53,6 +53,7 @@
 #include <cstdlib>
 
 #include <algorithm>
+#include <type_traits>
 #include <vector>
 
 #include "gromacs/domdec/domdec.h"
@@ -123,6 +124,8 @@ struct Task
     tensor vir_r_m_dr = { { 0 } };
     //! Temporary variable for lambda derivative.
     real dhdlambda;
+    //! Whether a mixed-precision matrix expansion of this task reached single-precision resolution.
+    bool mixedPrecisionResolutionReached = false;
 };
 
 /*! \brief Data for LINCS algorithm.
@@ -207,6 +210,14 @@ public:
     std::vector<real, AlignedAllocator<real>> tmp3;
     std::vector<real, AlignedAllocator<real>> tmp4;
     /*! @} */
+    //! Whether the matrix expansion runs in single precision, only used with double precision.
+    bool useMixedPrecisionExpansion = false;
+    //! Single-precision storage for the mixed-precision matrix expansion.
+    /*! @{ */
+    std::vector<float> blccMixed;
+    std::vector<float> rhs1Mixed;
+    std::vector<float> rhs2Mixed;
+    /*! @} */
     //! The Lagrange multipliers times -1.
     std::vector<real, AlignedAllocator<real>> mlambda;
     //! Storage for the constraint RMS relative deviation output.
@@ -237,17 +248,33 @@ real lincs_rmsd(const Lincs* lincsd)
     }
 }
 
+/*! \brief Margin for detecting that a mixed-precision matrix expansion is limited by precision
+ *
+ * When the last term of the expansion is smaller than this factor times
+ * the single-precision resolution of the solution, the rounding errors
+ * of the single-precision terms are no longer small compared to the
+ * truncation error of the expansion.
+ */
+static constexpr float c_mixedPrecisionResolutionMargin = 10;
+
 /*! \brief Do a set of nrec LINCS matrix multiplications.
  *
  * This function will return with up to date thread-local
  * constraint data, without an OpenMP barrier.
+ *
+ * The matrix and right-hand side can be stored with lower precision
+ * than \p sol, the solution is always accumulated in real precision.
+ *
+ * \returns whether, with lower precision storage, the last terms of
+ *          the expansion are below the resolution of that precision.
  */
-static void lincs_matrix_expand(const Lincs&              lincsd,
-                                const Task&               li_task,
-                                gmx::ArrayRef<const real> blcc,
-                                gmx::ArrayRef<real>       rhs1,
-                                gmx::ArrayRef<real>       rhs2,
-                                gmx::ArrayRef<real>       sol)
+template<typename ExpansionReal>
+static bool lincs_matrix_expand(const Lincs&                       lincsd,
+                                const Task&                        li_task,
+                                gmx::ArrayRef<const ExpansionReal> blcc,
+                                gmx::ArrayRef<ExpansionReal>       rhs1,
+                                gmx::ArrayRef<ExpansionReal>       rhs2,
+                                gmx::ArrayRef<real>                sol)
 {
     gmx::ArrayRef<const int> blnr  = lincsd.blnr;
     gmx::ArrayRef<const int> blbnb = lincsd.blbnb;
@@ -256,6 +283,11 @@ static void lincs_matrix_expand(const Lincs&              lincsd,
     const int b1   = li_task.b1;
     const int nrec = lincsd.nOrder;
 
+    /* With reduced precision we check the size of the last terms in the expansion */
+    constexpr bool checkResolution = !std::is_same<ExpansionReal, real>::value;
+    ExpansionReal  maxLastTerm     = 0;
+    real           maxSolution     = 0;
+
     for (int rec = 0; rec < nrec; rec++)
     {
         if (lincsd.bTaskDep)
@@ -264,8 +296,8 @@ static void lincs_matrix_expand(const Lincs&              lincsd,
         }
         for (int b = b0; b < b1; b++)
         {
-            real mvb;
-            int  n;
+            ExpansionReal mvb;
+            int           n;
 
             mvb = 0;
             for (n = blnr[b]; n < blnr[b + 1]; n++)
@@ -274,6 +306,12 @@ static void lincs_matrix_expand(const Lincs&              lincsd,
             }
             rhs2[b] = mvb;
             sol[b]  = sol[b] + mvb;
+
+            if (checkResolution && rec == nrec - 1)
+            {
+                maxLastTerm = std::max(maxLastTerm, std::abs(mvb));
+                maxSolution = std::max(maxSolution, std::abs(sol[b]));
+            }
         }
 
         std::swap(rhs1, rhs2);
@@ -310,8 +348,8 @@ static void lincs_matrix_expand(const Lincs&              lincsd,
         {
             for (int tb = 0; tb < li_task.ntriangle; tb++)
             {
-                int  b, bits, nr0, nr1, n;
-                real mvb;
+                int           b, bits, nr0, nr1, n;
+                ExpansionReal mvb;
 
                 b    = triangle[tb];
                 bits = tri_bits[tb];
@@ -327,6 +365,12 @@ static void lincs_matrix_expand(const Lincs&              lincsd,
                 }
                 rhs2[b] = mvb;
                 sol[b]  = sol[b] + mvb;
+
+                if (checkResolution && rec == nrec - 1)
+                {
+                    maxLastTerm = std::max(maxLastTerm, std::abs(mvb));
+                    maxSolution = std::max(maxSolution, std::abs(sol[b]));
+                }
             }
 
             std::swap(rhs1, rhs2);
@@ -341,6 +385,42 @@ static void lincs_matrix_expand(const Lincs&              lincsd,
 #pragma omp barrier
         }
     }
+
+    return checkResolution
+           && maxLastTerm < c_mixedPrecisionResolutionMargin * GMX_FLOAT_EPS * maxSolution;
+}
+
+/*! \brief Runs the LINCS matrix expansion for task \p th, in mixed precision when requested
+ *
+ * With mixed precision the matrix elements should be stored in
+ * lincsd->blccMixed. The right-hand side is then converted to single
+ * precision, while the solution is accumulated in real precision.
+ */
+static void lincs_matrix_expand_task(Lincs*               lincsd,
+                                     int                  th,
+                                     ArrayRef<const real> blcc,
+                                     ArrayRef<real>       rhs1,
+                                     ArrayRef<real>       rhs2,
+                                     ArrayRef<real>       sol)
+{
+    Task& li_task = lincsd->task[th];
+
+    if (lincsd->useMixedPrecisionExpansion)
+    {
+        for (int b = li_task.b0; b < li_task.b1; b++)
+        {
+            lincsd->rhs1Mixed[b] = rhs1[b];
+        }
+        if (lincs_matrix_expand<float>(
+                    *lincsd, li_task, lincsd->blccMixed, lincsd->rhs1Mixed, lincsd->rhs2Mixed, sol))
+        {
+            li_task.mixedPrecisionResolutionReached = true;
+        }
+    }
+    else
+    {
+        lincs_matrix_expand<real>(*lincsd, li_task, blcc, rhs1, rhs2, sol);
+    }
 }
 
 //! Update atomic coordinates when an index is not required.
@@ -682,7 +762,7 @@ static void do_lincsp(ArrayRefWithPadding<const RVec> xPadded,
     }
     /* Together: 23*ncons + 6*nrtot flops */
 
-    lincs_matrix_expand(*lincsd, lincsd->task[th], blcc, rhs1, rhs2, sol);
+    lincs_matrix_expand<real>(*lincsd, lincsd->task[th], blcc, rhs1, rhs2, sol);
     /* nrec*(ncons+2*nrtot) flops */
 
     if (econq == ConstraintVariable::Deriv_FlexCon)
@@ -990,6 +1070,8 @@ static void do_lincs(ArrayRefWithPadding<const RVec> xPadded,
     gmx::ArrayRef<real>           mlambda = lincsd->mlambda;
     gmx::ArrayRef<const int>      nlocat  = lincsd->nlocat;
 
+    lincsd->task[th].mixedPrecisionResolutionReached = false;
+
 #if GMX_SIMD_HAVE_REAL
 
     /* This SIMD code does the same as the plain-C code after the #else.
@@ -1061,16 +1143,30 @@ static void do_lincs(ArrayRefWithPadding<const RVec> xPadded,
     }
 
     /* Construct the (sparse) LINCS matrix */
-    for (int b = b0; b < b1; b++)
+    if (lincsd->useMixedPrecisionExpansion)
     {
-        for (int n = blnr[b]; n < blnr[b + 1]; n++)
+        ArrayRef<float> blccMixed = lincsd->blccMixed;
+        for (int b = b0; b < b1; b++)
         {
-            blcc[n] = blmf[n] * gmx::dot(r[b], r[blbnb[n]]);
+            for (int n = blnr[b]; n < blnr[b + 1]; n++)
+            {
+                blccMixed[n] = blmf[n] * gmx::dot(r[b], r[blbnb[n]]);
+            }
+        }
+    }
+    else
+    {
+        for (int b = b0; b < b1; b++)
+        {
+            for (int n = blnr[b]; n < blnr[b + 1]; n++)
+            {
+                blcc[n] = blmf[n] * gmx::dot(r[b], r[blbnb[n]]);
+            }
         }
     }
     /* Together: 26*ncons + 6*nrtot flops */
 
-    lincs_matrix_expand(*lincsd, lincsd->task[th], blcc, rhs1, rhs2, sol);
+    lincs_matrix_expand_task(lincsd, th, blcc, rhs1, rhs2, sol);
     /* nrec*(ncons+2*nrtot) flops */
 
 #if GMX_SIMD_HAVE_REAL
@@ -1127,7 +1223,7 @@ static void do_lincs(ArrayRefWithPadding<const RVec> xPadded,
         /* 20*ncons flops */
 #endif // GMX_SIMD_HAVE_REAL
 
-        lincs_matrix_expand(*lincsd, lincsd->task[th], blcc, rhs1, rhs2, sol);
+        lincs_matrix_expand_task(lincsd, th, blcc, rhs1, rhs2, sol);
         /* nrec*(ncons+2*nrtot) flops */
 
 #if GMX_SIMD_HAVE_REAL
@@ -1460,6 +1556,10 @@ Lincs* init_lincs(FILE*                            fplog,
     li->nIter  = nIter;
     li->nOrder = nProjOrder;
 
+#if GMX_DOUBLE
+    li->useMixedPrecisionExpansion = (getenv("GMX_LINCS_MIXED_PRECISION") != nullptr);
+#endif
+
     li->max_connect = 0;
     for (size_t mt = 0; mt < mtop.moltype.size(); mt++)
     {
@@ -1548,6 +1648,12 @@ Lincs* init_lincs(FILE*                            fplog,
                     li->ncg_triangle,
                     li->nOrder);
         }
+        if (li->useMixedPrecisionExpansion)
+        {
+            fprintf(fplog,
+                    "Will run the LINCS matrix expansion in single precision,\n"
+                    "with accumulation of the solution in double precision\n");
+        }
     }
 
     return li;
@@ -1939,6 +2045,11 @@ void set_lincs(const InteractionDefinitions& idef,
     li->tmp3.resize(numEntries);
     li->tmp4.resize(numEntries);
     li->mlambda.resize(numEntries);
+    if (li->useMixedPrecisionExpansion)
+    {
+        li->rhs1Mixed.resize(numEntries);
+        li->rhs2Mixed.resize(numEntries);
+    }
 
     gmx::ArrayRef<const int> iatom = idef.il[F_CONSTR].iatoms;
 
@@ -2112,6 +2223,10 @@ void set_lincs(const InteractionDefinitions& idef,
     li->blmf.resize(li->ncc);
     li->blmf1.resize(li->ncc);
     li->tmpncc.resize(li->ncc);
+    if (li->useMixedPrecisionExpansion)
+    {
+        li->blccMixed.resize(li->ncc);
+    }
 
     gmx::ArrayRef<const int> nlocat_dd = dd_constraints_nlocalatoms(cr->dd);
     if (!nlocat_dd.empty())
@@ -2406,6 +2521,28 @@ bool constrain_lincs(bool                            computeRmsd,
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
 
+        if (lincsd->useMixedPrecisionExpansion)
+        {
+            bool resolutionReached = false;
+            for (int th = 0; th < lincsd->ntask; th++)
+            {
+                resolutionReached =
+                        resolutionReached || lincsd->task[th].mixedPrecisionResolutionReached;
+            }
+            if (resolutionReached)
+            {
+                /* The rounding errors of the single-precision expansion are no longer
+                 * negligible compared to the truncation error, so we would lose accuracy.
+                 */
+                lincsd->useMixedPrecisionExpansion = false;
+                fprintf(stderr,
+                        "\nStep %" PRId64
+                        ": the LINCS matrix expansion is limited by single precision,\n"
+                        "continuing with the expansion in double precision\n",
+                        step);
+            }
+        }
+
         if (computeRmsd || printDebugOutput || bWarn)
         {
             LincsDeviations deviations = makeLincsDeviations(*lincsd, xprime, pbc);
@@ -77,10 +77,51 @@
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/logger.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/snprintf.h"
 
+/*! \brief Adds the kinetic energy tensor of atoms \p start to \p end to \p ekin
+ *
+ * The sums are accumulated in local variables and, as the tensor is
+ * symmetric, only 6 of the 9 elements are computed.
+ */
+static inline void addKineticEnergyTensor(gmx::ArrayRef<const gmx::RVec> v,
+                                          const real*                    mass,
+                                          int                            start,
+                                          int                            end,
+                                          matrix                         ekin)
+{
+    real xx = 0;
+    real yy = 0;
+    real zz = 0;
+    real xy = 0;
+    real xz = 0;
+    real yz = 0;
+    for (int n = start; n < end; n++)
+    {
+        const real hm  = 0.5 * mass[n];
+        const real hvx = hm * v[n][XX];
+        const real hvy = hm * v[n][YY];
+        xx += hvx * v[n][XX];
+        yy += hvy * v[n][YY];
+        zz += hm * v[n][ZZ] * v[n][ZZ];
+        xy += hvx * v[n][YY];
+        xz += hvx * v[n][ZZ];
+        yz += hvy * v[n][ZZ];
+    }
+    ekin[XX][XX] += xx;
+    ekin[YY][YY] += yy;
+    ekin[ZZ][ZZ] += zz;
+    ekin[XX][YY] += xy;
+    ekin[YY][XX] += xy;
+    ekin[XX][ZZ] += xz;
+    ekin[ZZ][XX] += xz;
+    ekin[YY][ZZ] += yz;
+    ekin[ZZ][YY] += yz;
+}
+
 static void calc_ke_part_normal(gmx::ArrayRef<const gmx::RVec> v,
                                 const t_grpopts*               opts,
                                 const t_mdatoms*               md,
@@ -113,51 +154,66 @@ static void calc_ke_part_normal(gmx::ArrayRef<const gmx::RVec> v,
     ekind->dekindl_old = ekind->dekindl;
     int nthread        = gmx_omp_nthreads_get(ModuleMultiThread::Update);
 
-#pragma omp parallel for num_threads(nthread) schedule(static)
-    for (int thread = 0; thread < nthread; thread++)
+#pragma omp parallel num_threads(nthread)
     {
         // This OpenMP only loops over arrays and does not call any functions
         // or memory allocation. It should not be able to throw, so for now
         // we do not need a try/catch wrapper.
-        int     start_t, end_t, n;
-        int     gt;
-        real    hm;
-        int     d, m;
-        matrix* ekin_sum;
-        real*   dekindl_sum;
+        const int thread = gmx_omp_get_thread_num();
 
-        start_t = ((thread + 0) * md->homenr) / nthread;
-        end_t   = ((thread + 1) * md->homenr) / nthread;
+        const int start_t = ((thread + 0) * md->homenr) / nthread;
+        const int end_t   = ((thread + 1) * md->homenr) / nthread;
 
-        ekin_sum    = ekind->ekin_work[thread];
-        dekindl_sum = ekind->dekindl_work[thread];
+        matrix* ekin_sum    = ekind->ekin_work[thread];
+        real*   dekindl_sum = ekind->dekindl_work[thread];
 
-        for (gt = 0; gt < opts->ngtc; gt++)
+        for (int gt = 0; gt < opts->ngtc; gt++)
         {
             clear_mat(ekin_sum[gt]);
         }
         *dekindl_sum = 0.0;
 
-        gt = 0;
-        for (n = start_t; n < end_t; n++)
+        /* Accumulate over ranges of consecutive atoms in the same T-coupling group.
+         * If we're computing a full step velocity, v has v(t). Otherwise, v(t+dt/2).
+         */
+        int n = start_t;
+        while (n < end_t)
         {
+            int gt    = 0;
+            int end_g = end_t;
             if (md->cTC)
             {
-                gt = md->cTC[n];
+                gt    = md->cTC[n];
+                end_g = n + 1;
+                while (end_g < end_t && md->cTC[end_g] == gt)
+                {
+                    end_g++;
+                }
             }
-            hm = 0.5 * md->massT[n];
-
-            for (d = 0; (d < DIM); d++)
+            addKineticEnergyTensor(v, md->massT, n, end_g, ekin_sum[gt]);
+            n = end_g;
+        }
+        if (md->nMassPerturbed)
+        {
+            for (n = start_t; n < end_t; n++)
             {
-                for (m = 0; (m < DIM); m++)
+                if (md->bPerturbed[n])
                 {
-                    /* if we're computing a full step velocity, v[d] has v(t).  Otherwise, v(t+dt/2) */
-                    ekin_sum[gt][m][d] += hm * v[n][m] * v[n][d];
+                    *dekindl_sum += 0.5 * (md->massB[n] - md->massA[n]) * iprod(v[n], v[n]);
                 }
             }
-            if (md->nMassPerturbed && md->bPerturbed[n])
+        }
+
+        /* Reduce the thread contributions, with the groups divided over the threads */
+#pragma omp barrier
+        const int gStart = ((thread + 0) * opts->ngtc) / nthread;
+        const int gEnd   = ((thread + 1) * opts->ngtc) / nthread;
+        for (int g = gStart; g < gEnd; g++)
+        {
+            matrix& ekinSum = (bEkinAveVel ? tcstat[g].ekinf : tcstat[g].ekinh);
+            for (int t = 0; t < nthread; t++)
             {
-                *dekindl_sum += 0.5 * (md->massB[n] - md->massA[n]) * iprod(v[n], v[n]);
+                m_add(ekinSum, ekind->ekin_work[t][g], ekinSum);
             }
         }
     }
@@ -165,18 +221,6 @@ static void calc_ke_part_normal(gmx::ArrayRef<const gmx::RVec> v,
     ekind->dekindl = 0;
     for (int thread = 0; thread < nthread; thread++)
     {
-        for (g = 0; g < opts->ngtc; g++)
-        {
-            if (bEkinAveVel)
-            {
-                m_add(tcstat[g].ekinf, ekind->ekin_work[thread][g], tcstat[g].ekinf);
-            }
-            else
-            {
-                m_add(tcstat[g].ekinh, ekind->ekin_work[thread][g], tcstat[g].ekinh);
-            }
-        }
-
         ekind->dekindl += *ekind->dekindl_work[thread];
     }
 
@@ -260,14 +304,14 @@ static void calc_ke_part_visc(const matrix                   box,
     inc_nrnb(nrnb, eNR_EKIN, homenr);
 }
 
-static void calc_ke_part(gmx::ArrayRef<const gmx::RVec> x,
-                         gmx::ArrayRef<const gmx::RVec> v,
-                         const matrix                   box,
-                         const t_grpopts*               opts,
-                         const t_mdatoms*               md,
-                         gmx_ekindata_t*                ekind,
-                         t_nrnb*                        nrnb,
-                         gmx_bool                       bEkinAveVel)
+void calc_ke_part(gmx::ArrayRef<const gmx::RVec> x,
+                  gmx::ArrayRef<const gmx::RVec> v,
+                  const matrix                   box,
+                  const t_grpopts*               opts,
+                  const t_mdatoms*               md,
+                  gmx_ekindata_t*                ekind,
+                  t_nrnb*                        nrnb,
+                  gmx_bool                       bEkinAveVel)
 {
     if (ekind->cosacc.cos_accel == 0)
     {
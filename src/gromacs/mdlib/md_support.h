@@ -50,6 +50,7 @@ struct t_extmass;
 struct t_forcerec;
 struct t_grpopts;
 struct t_inputrec;
+struct t_mdatoms;
 struct t_nrnb;
 class t_state;
 struct t_trxframe;
@@ -106,6 +107,23 @@ void rerun_parallel_comm(t_commrec* cr, t_trxframe* fr, gmx_bool* bLastStep);
 //! \brief Allocate and initialize node-local state entries
 void set_state_entries(t_state* state, const t_inputrec* ir, bool useModularSimulator);
 
+/*! \brief Computes the local kinetic energy tensors per temperature-coupling group
+ *
+ * With \p bEkinAveVel the full step kinetic energies in \p ekind->tcstat[].ekinf
+ * are set, otherwise the half step kinetic energies in ekinh. The accumulation
+ * is divided over the ModuleMultiThread::Update threads, \p ekind should have
+ * work buffers for at least this number of threads.
+ * Coordinates \p x and \p box are only used with cosine acceleration.
+ */
+void calc_ke_part(gmx::ArrayRef<const gmx::RVec> x,
+                  gmx::ArrayRef<const gmx::RVec> v,
+                  const matrix                   box,
+                  const t_grpopts*               opts,
+                  const t_mdatoms*               md,
+                  gmx_ekindata_t*                ekind,
+                  t_nrnb*                        nrnb,
+                  gmx_bool                       bEkinAveVel);
+
 /* Compute global variables during integration
  *
  * Coordinates x are needed for kinetic energy calculation with cosine accelation
@@ -39,6 +39,15 @@
 
 #include "config.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/collect.h"
 #include "gromacs/domdec/domdec_struct.h"
@@ -71,6 +80,138 @@
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/sysinfo.h"
 
+namespace gmx
+{
+
+/*! \internal
+ * \brief Executes trajectory and checkpoint output tasks on a separate writer thread
+ *
+ * The tasks own copies of all the data they write, so the MD loop
+ * can continue as soon as a task has been queued. The queue is bounded:
+ * queuing blocks while the maximum number of tasks is pending, which
+ * limits the memory usage and throttles the simulation when the file
+ * system can not keep up. Tasks are executed in the order they were queued.
+ * An exception thrown by a task is rethrown on the calling thread at
+ * the next call to queue() or waitForCompletion().
+ */
+class AsyncOutputWriter
+{
+public:
+    //! Starts the writer thread, at most \p maxPendingTasks tasks can be pending
+    explicit AsyncOutputWriter(int maxPendingTasks) :
+        maxPendingTasks_(maxPendingTasks), thread_([this]() { run(); })
+    {
+    }
+
+    //! Executes all pending tasks and stops the writer thread
+    ~AsyncOutputWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopRequested_ = true;
+        }
+        stateChanged_.notify_all();
+        thread_.join();
+    }
+
+    //! Queues \p task for execution, blocks while the maximum number of tasks is pending
+    void queue(std::function<void()>&& task)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stateChanged_.wait(lock,
+                           [this]() { return numPendingTasks() < maxPendingTasks_ || exception_; });
+        rethrowTaskException();
+        tasks_.push_back(std::move(task));
+        lock.unlock();
+        stateChanged_.notify_all();
+    }
+
+    //! Waits until all queued tasks have been executed
+    void waitForCompletion()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stateChanged_.wait(lock, [this]() { return numPendingTasks() == 0; });
+        rethrowTaskException();
+    }
+
+private:
+    //! Returns the number of queued and running tasks, the mutex should be locked
+    int numPendingTasks() const { return tasks_.size() + (taskIsRunning_ ? 1 : 0); }
+
+    //! Rethrows the first exception thrown by a task, the mutex should be locked
+    void rethrowTaskException()
+    {
+        if (exception_)
+        {
+            std::exception_ptr exception = exception_;
+            exception_                   = nullptr;
+            std::rethrow_exception(exception);
+        }
+    }
+
+    //! The writer thread loop, returns when stopping is requested and no tasks are left
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            stateChanged_.wait(lock, [this]() { return !tasks_.empty() || stopRequested_; });
+            if (tasks_.empty())
+            {
+                return;
+            }
+            std::function<void()> task = std::move(tasks_.front());
+            tasks_.pop_front();
+            taskIsRunning_ = true;
+            lock.unlock();
+
+            std::exception_ptr exception;
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            lock.lock();
+            if (exception && !exception_)
+            {
+                exception_ = exception;
+            }
+            taskIsRunning_ = false;
+            stateChanged_.notify_all();
+        }
+    }
+
+    //! The maximum number of queued plus running tasks
+    const int maxPendingTasks_;
+    //! Protects all data below
+    std::mutex mutex_;
+    //! Signals changes in the task queue and task state
+    std::condition_variable stateChanged_;
+    //! The queued tasks
+    std::deque<std::function<void()>> tasks_;
+    //! Whether the writer thread is executing a task
+    bool taskIsRunning_ = false;
+    //! Whether the writer thread should stop once the queue is empty
+    bool stopRequested_ = false;
+    //! The first exception thrown by a task that has not been rethrown yet
+    std::exception_ptr exception_;
+    //! The writer thread, declared last as it should start after initialization of the rest
+    std::thread thread_;
+};
+
+} // namespace gmx
+
+/*! \brief The maximum number of trajectory frames pending for asynchronous writing
+ *
+ * Each pending frame stores a copy of the global coordinates, and velocities
+ * and forces when these are written.
+ */
+static constexpr int c_maxPendingTrajectoryFrames = 4;
+
 struct gmx_mdoutf
 {
     t_fileio*                      fp_trn;
@@ -95,6 +236,9 @@ struct gmx_mdoutf
     const gmx::MDModulesNotifiers* mdModulesNotifiers;
     bool                           simulationsShareState;
     MPI_Comm                       mastersComm;
+    gmx::AsyncOutputWriter*        asyncWriter; /* nullptr when all output is synchronous */
+    bool                           writeTrajectoryAsync;
+    bool                           writeCheckpointAsync;
 };
 
 
@@ -111,6 +255,7 @@ gmx_mdoutf_t init_mdoutf(FILE*                          fplog,
                          gmx_wallcycle*                 wcycle,
                          const gmx::StartingBehavior    startingBehavior,
                          bool                           simulationsShareState,
+                         bool                           exchangeLambdaStates,
                          const gmx_multisim_t*          ms)
 {
     gmx_mdoutf_t of;
@@ -213,7 +358,8 @@ gmx_mdoutf_t init_mdoutf(FILE*                          fplog,
             }
             else
             {
-                of->fp_dhdl = open_dhdl(opt2fn("-dhdl", nfile, fnm), ir, oenv);
+                of->fp_dhdl =
+                        open_dhdl(opt2fn("-dhdl", nfile, fnm), ir, exchangeLambdaStates, oenv);
             }
         }
 
@@ -239,6 +385,29 @@ gmx_mdoutf_t init_mdoutf(FILE*                          fplog,
         {
             snew(of->f_global, top_global.natoms);
         }
+
+        of->writeTrajectoryAsync = (getenv("GMX_ASYNC_TRAJECTORY_OUTPUT") != nullptr
+                                    && (of->fp_trn || of->fp_xtc || of->tng || of->tng_low_prec));
+        /* Renaming the checkpoint on the writer thread is not possible
+         * when it requires an MPI barrier between the simulations.
+         */
+        of->writeCheckpointAsync = (getenv("GMX_ASYNC_CHECKPOINT_OUTPUT") != nullptr
+                                    && !of->simulationsShareState && !GMX_FAHCORE);
+        if (of->writeTrajectoryAsync || of->writeCheckpointAsync)
+        {
+            of->asyncWriter = new gmx::AsyncOutputWriter(c_maxPendingTrajectoryFrames);
+        }
+        if (fplog && of->writeTrajectoryAsync)
+        {
+            fprintf(fplog,
+                    "\nTrajectory frames will be written asynchronously by a separate thread\n");
+        }
+        if (fplog && of->writeCheckpointAsync)
+        {
+            fprintf(fplog,
+                    "\nCheckpoint files will be synced to disk and renamed asynchronously by a "
+                    "separate thread\n");
+        }
     }
 
     if (bCiteTng)
@@ -276,10 +445,112 @@ static void mpiBarrierBeforeRename(const bool applyMpiBarrierBeforeRename, MPI_C
 #endif
     }
 }
+
+/*! \brief Syncs the checkpoint and output files to disk and moves the
+ * temporary checkpoint file \p fntemp to \p fn
+ *
+ * Moves the previous checkpoint file to the filename with suffix _prev
+ * unless \p bNumberAndKeep is set.
+ */
+static void finish_checkpoint(t_fileio*          fp,
+                              const std::string& fn,
+                              const std::string& fntemp,
+                              gmx_bool           bNumberAndKeep,
+                              bool               applyMpiBarrierBeforeRename,
+                              MPI_Comm           mpiBarrierCommunicator)
+{
+    /* we really, REALLY, want to make sure to physically write the checkpoint,
+       and all the files it depends on, out to disk. Because we've
+       opened the checkpoint with gmx_fio_open(), it's in our list
+       of open files.  */
+    t_fileio* ret = gmx_fio_all_output_fsync();
+
+    if (ret)
+    {
+        char buf[STRLEN];
+        sprintf(buf, "Cannot fsync '%s'; maybe you are out of disk space?", gmx_fio_getname(ret));
+
+        if (getenv(GMX_IGNORE_FSYNC_FAILURE_ENV) == nullptr)
+        {
+            gmx_file(buf);
+        }
+        else
+        {
+            gmx_warning("%s", buf);
+        }
+    }
+
+    if (gmx_fio_close(fp) != 0)
+    {
+        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+    }
+
+    /* we don't move the checkpoint if the user specified they didn't want it,
+       or if the fsyncs failed */
+#if !GMX_NO_RENAME
+    if (!bNumberAndKeep && !ret)
+    {
+        // Add a barrier before renaming to reduce chance to get out of sync (#2440)
+        // Note: Checkpoint might only exist on some ranks, so put barrier before if clause (#3919)
+        mpiBarrierBeforeRename(applyMpiBarrierBeforeRename, mpiBarrierCommunicator);
+        if (gmx_fexist(fn.c_str()))
+        {
+            /* Rename the previous checkpoint file */
+            const size_t extensionStart = fn.size() - std::strlen(ftp2ext(fn2ftp(fn.c_str()))) - 1;
+            const std::string prevFn =
+                    fn.substr(0, extensionStart) + "_prev" + fn.substr(extensionStart);
+            if (!GMX_FAHCORE)
+            {
+                /* we copy here so that if something goes wrong between now and
+                 * the rename below, there's always a state.cpt.
+                 * If renames are atomic (such as in POSIX systems),
+                 * this copying should be unneccesary.
+                 */
+                gmx_file_copy(fn.c_str(), prevFn.c_str(), FALSE);
+                /* We don't really care if this fails:
+                 * there's already a new checkpoint.
+                 */
+            }
+            else
+            {
+                gmx_file_rename(fn.c_str(), prevFn.c_str());
+            }
+        }
+
+        /* Rename the checkpoint file from the temporary to the final name */
+        mpiBarrierBeforeRename(applyMpiBarrierBeforeRename, mpiBarrierCommunicator);
+
+        if (gmx_file_rename(fntemp.c_str(), fn.c_str()) != 0)
+        {
+            gmx_file("Cannot rename checkpoint file; maybe you are out of disk space?");
+        }
+    }
+#endif /* GMX_NO_RENAME */
+
+#if GMX_FAHCORE
+    /* Always FAH checkpoint immediately after a GROMACS checkpoint.
+     *
+     * Note that it is critical that we save a FAH checkpoint directly
+     * after writing a GROMACS checkpoint. If the program dies, either
+     * by the machine powering off suddenly or the process being,
+     * killed, FAH can recover files that have only appended data by
+     * truncating them to the last recorded length. The GROMACS
+     * checkpoint does not just append data, it is fully rewritten each
+     * time so a crash between moving the new Gromacs checkpoint file in
+     * to place and writing a FAH checkpoint is not recoverable. Thus
+     * the time between these operations must be kept as short as
+     * possible.
+     */
+    fcCheckpoint();
+#endif /* end GMX_FAHCORE block */
+}
+
 /*! \brief Write a checkpoint to the filename
  *
  * Appends the _step<step>.cpt with bNumberAndKeep, otherwise moves
  * the previous checkpoint filename with suffix _prev.cpt.
+ * When \p asyncWriter is not nullptr, syncing the files to disk and
+ * renaming is done by the writer thread.
  */
 static void write_checkpoint(const char*                     fn,
                              gmx_bool                        bNumberAndKeep,
@@ -298,13 +569,13 @@ static void write_checkpoint(const char*                     fn,
                              const gmx::MDModulesNotifiers&  mdModulesNotifiers,
                              gmx::WriteCheckpointDataHolder* modularSimulatorCheckpointData,
                              bool                            applyMpiBarrierBeforeRename,
-                             MPI_Comm                        mpiBarrierCommunicator)
+                             MPI_Comm                        mpiBarrierCommunicator,
+                             gmx::AsyncOutputWriter*         asyncWriter)
 {
     t_fileio* fp;
     char*     fntemp; /* the temporary checkpoint file name */
     int       npmenodes;
     char      buf[1024], suffix[5 + STEPSTRSIZE], sbuf[STEPSTRSIZE];
-    t_fileio* ret;
 
     if (DOMAINDECOMP(cr))
     {
@@ -402,93 +673,38 @@ static void write_checkpoint(const char*                     fn,
                           &outputfiles,
                           modularSimulatorCheckpointData);
 
-    /* we really, REALLY, want to make sure to physically write the checkpoint,
-       and all the files it depends on, out to disk. Because we've
-       opened the checkpoint with gmx_fio_open(), it's in our list
-       of open files.  */
-    ret = gmx_fio_all_output_fsync();
-
-    if (ret)
-    {
-        char buf[STRLEN];
-        sprintf(buf, "Cannot fsync '%s'; maybe you are out of disk space?", gmx_fio_getname(ret));
-
-        if (getenv(GMX_IGNORE_FSYNC_FAILURE_ENV) == nullptr)
-        {
-            gmx_file(buf);
-        }
-        else
-        {
-            gmx_warning("%s", buf);
-        }
-    }
+    const std::string fnString(fn);
+    const std::string fntempString(fntemp);
+    sfree(fntemp);
 
-    if (gmx_fio_close(fp) != 0)
+    if (asyncWriter)
     {
-        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+        /* Syncing and renaming can take long on shared file systems,
+         * we let the writer thread take care of that.
+         */
+        asyncWriter->queue([fp,
+                            fnString,
+                            fntempString,
+                            bNumberAndKeep,
+                            applyMpiBarrierBeforeRename,
+                            mpiBarrierCommunicator]() {
+            finish_checkpoint(fp,
+                              fnString,
+                              fntempString,
+                              bNumberAndKeep,
+                              applyMpiBarrierBeforeRename,
+                              mpiBarrierCommunicator);
+        });
     }
-
-    /* we don't move the checkpoint if the user specified they didn't want it,
-       or if the fsyncs failed */
-#if !GMX_NO_RENAME
-    if (!bNumberAndKeep && !ret)
+    else
     {
-        // Add a barrier before renaming to reduce chance to get out of sync (#2440)
-        // Note: Checkpoint might only exist on some ranks, so put barrier before if clause (#3919)
-        mpiBarrierBeforeRename(applyMpiBarrierBeforeRename, mpiBarrierCommunicator);
-        if (gmx_fexist(fn))
-        {
-            /* Rename the previous checkpoint file */
-            std::strcpy(buf, fn);
-            buf[std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1] = '\0';
-            std::strcat(buf, "_prev");
-            std::strcat(buf, fn + std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1);
-            if (!GMX_FAHCORE)
-            {
-                /* we copy here so that if something goes wrong between now and
-                 * the rename below, there's always a state.cpt.
-                 * If renames are atomic (such as in POSIX systems),
-                 * this copying should be unneccesary.
-                 */
-                gmx_file_copy(fn, buf, FALSE);
-                /* We don't really care if this fails:
-                 * there's already a new checkpoint.
-                 */
-            }
-            else
-            {
-                gmx_file_rename(fn, buf);
-            }
-        }
-
-        /* Rename the checkpoint file from the temporary to the final name */
-        mpiBarrierBeforeRename(applyMpiBarrierBeforeRename, mpiBarrierCommunicator);
-
-        if (gmx_file_rename(fntemp, fn) != 0)
-        {
-            gmx_file("Cannot rename checkpoint file; maybe you are out of disk space?");
-        }
+        finish_checkpoint(fp,
+                          fnString,
+                          fntempString,
+                          bNumberAndKeep,
+                          applyMpiBarrierBeforeRename,
+                          mpiBarrierCommunicator);
     }
-#endif /* GMX_NO_RENAME */
-
-    sfree(fntemp);
-
-#if GMX_FAHCORE
-    /* Always FAH checkpoint immediately after a GROMACS checkpoint.
-     *
-     * Note that it is critical that we save a FAH checkpoint directly
-     * after writing a GROMACS checkpoint. If the program dies, either
-     * by the machine powering off suddenly or the process being,
-     * killed, FAH can recover files that have only appended data by
-     * truncating them to the last recorded length. The GROMACS
-     * checkpoint does not just append data, it is fully rewritten each
-     * time so a crash between moving the new Gromacs checkpoint file in
-     * to place and writing a FAH checkpoint is not recoverable. Thus
-     * the time between these operations must be kept as short as
-     * possible.
-     */
-    fcCheckpoint();
-#endif /* end GMX_FAHCORE block */
 }
 
 void mdoutf_write_checkpoint(gmx_mdoutf_t                    of,
@@ -500,6 +716,13 @@ void mdoutf_write_checkpoint(gmx_mdoutf_t                    of,
                              ObservablesHistory*             observablesHistory,
                              gmx::WriteCheckpointDataHolder* modularSimulatorCheckpointData)
 {
+    /* The checkpoint stores the output file positions, so all frames
+     * of earlier steps should have been written.
+     */
+    if (of->asyncWriter)
+    {
+        of->asyncWriter->waitForCompletion();
+    }
     fflush_tng(of->tng);
     fflush_tng(of->tng_low_prec);
     /* Write the checkpoint file.
@@ -525,7 +748,139 @@ void mdoutf_write_checkpoint(gmx_mdoutf_t                    of,
                      *(of->mdModulesNotifiers),
                      modularSimulatorCheckpointData,
                      of->simulationsShareState,
-                     of->mastersComm);
+                     of->mastersComm,
+                     of->writeCheckpointAsync ? of->asyncWriter : nullptr);
+}
+
+/*! \brief Writes the trajectory output selected by \p mdof_flags for one frame
+ *
+ * \p x should be set when (compressed) positions are written,
+ * \p v and \p f should be set when velocities and forces are written.
+ */
+static void write_trajectory_frame(gmx_mdoutf_t of,
+                                   int          mdof_flags,
+                                   int          natoms,
+                                   int64_t      step,
+                                   double       t,
+                                   real         lambda,
+                                   const rvec*  box,
+                                   const rvec*  x,
+                                   const rvec*  v,
+                                   const rvec*  f)
+{
+    if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+    {
+        const rvec* xOut = (mdof_flags & MDOF_X) ? x : nullptr;
+
+        if (of->fp_trn)
+        {
+            gmx_trr_write_frame(of->fp_trn, step, t, lambda, box, natoms, xOut, v, f);
+            if (gmx_fio_flush(of->fp_trn) != 0)
+            {
+                gmx_file("Cannot write trajectory; maybe you are out of disk space?");
+            }
+        }
+
+        /* If a TNG file is open for uncompressed coordinate output also write
+           velocities and forces to it. */
+        else if (of->tng)
+        {
+            gmx_fwrite_tng(of->tng, FALSE, step, t, lambda, box, natoms, xOut, v, f);
+        }
+        /* If only a TNG file is open for compressed coordinate output (no uncompressed
+           coordinate output) also write forces and velocities to it. */
+        else if (of->tng_low_prec)
+        {
+            gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, lambda, box, natoms, xOut, v, f);
+        }
+    }
+    if (mdof_flags & MDOF_X_COMPRESSED)
+    {
+        const rvec* xxtc    = x;
+        rvec*       xSubset = nullptr;
+
+        if (of->natoms_x_compressed != of->natoms_global)
+        {
+            /* We are writing the positions of only a subset of
+               the atoms to the compressed output, so we have to
+               make a copy of the subset of coordinates. */
+            int i, j;
+
+            snew(xSubset, of->natoms_x_compressed);
+            for (i = 0, j = 0; (i < of->natoms_global); i++)
+            {
+                if (getGroupType(*of->groups, SimulationAtomGroupType::CompressedPositionOutput, i) == 0)
+                {
+                    copy_rvec(x[i], xSubset[j++]);
+                }
+            }
+            xxtc = xSubset;
+        }
+        if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t, box, xxtc, of->x_compression_precision)
+            == 0)
+        {
+            gmx_fatal(FARGS,
+                      "XTC error. This indicates you are out of disk space, or a "
+                      "simulation with major instabilities resulting in coordinates "
+                      "that are NaN or too large to be represented in the XTC format.\n");
+        }
+        gmx_fwrite_tng(of->tng_low_prec,
+                       TRUE,
+                       step,
+                       t,
+                       lambda,
+                       box,
+                       of->natoms_x_compressed,
+                       xxtc,
+                       nullptr,
+                       nullptr);
+        sfree(xSubset);
+    }
+    if (mdof_flags & (MDOF_BOX | MDOF_LAMBDA) && !(mdof_flags & (MDOF_X | MDOF_V | MDOF_F)))
+    {
+        if (of->tng)
+        {
+            const real  lambdaOut = (mdof_flags & MDOF_LAMBDA) ? lambda : -1;
+            const rvec* boxOut    = (mdof_flags & MDOF_BOX) ? box : nullptr;
+            gmx_fwrite_tng(
+                    of->tng, FALSE, step, t, lambdaOut, boxOut, natoms, nullptr, nullptr, nullptr);
+        }
+    }
+    if (mdof_flags & (MDOF_BOX_COMPRESSED | MDOF_LAMBDA_COMPRESSED)
+        && !(mdof_flags & (MDOF_X_COMPRESSED)))
+    {
+        if (of->tng_low_prec)
+        {
+            const real  lambdaOut = (mdof_flags & MDOF_LAMBDA_COMPRESSED) ? lambda : -1;
+            const rvec* boxOut    = (mdof_flags & MDOF_BOX_COMPRESSED) ? box : nullptr;
+            gmx_fwrite_tng(of->tng_low_prec,
+                           FALSE,
+                           step,
+                           t,
+                           lambdaOut,
+                           boxOut,
+                           natoms,
+                           nullptr,
+                           nullptr,
+                           nullptr);
+        }
+    }
+}
+
+//! Returns a copy of \p vec with \p numAtoms elements, or an empty vector when \p vec is nullptr
+static std::vector<gmx::RVec> copyFrameVector(const rvec* vec, int numAtoms)
+{
+    if (vec == nullptr)
+    {
+        return {};
+    }
+    return std::vector<gmx::RVec>(vec, vec + numAtoms);
+}
+
+//! Returns a pointer to the data of \p vec, or nullptr when \p vec is empty
+static const rvec* frameVectorData(const std::vector<gmx::RVec>& vec)
+{
+    return vec.empty() ? nullptr : as_rvec_array(vec.data());
 }
 
 void mdoutf_write_to_trajectory_files(FILE*                           fplog,
@@ -602,144 +957,46 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
                     of, fplog, cr, step, t, state_global, observablesHistory, modularSimulatorCheckpointData);
         }
 
-        if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
-        {
-            const rvec* x = (mdof_flags & MDOF_X) ? state_global->x.rvec_array() : nullptr;
-            const rvec* v = (mdof_flags & MDOF_V) ? state_global->v.rvec_array() : nullptr;
-            const rvec* f = (mdof_flags & MDOF_F) ? f_global : nullptr;
-
-            if (of->fp_trn)
-            {
-                gmx_trr_write_frame(of->fp_trn,
-                                    step,
-                                    t,
-                                    state_local->lambda[FreeEnergyPerturbationCouplingType::Fep],
-                                    state_local->box,
-                                    natoms,
-                                    x,
-                                    v,
-                                    f);
-                if (gmx_fio_flush(of->fp_trn) != 0)
-                {
-                    gmx_file("Cannot write trajectory; maybe you are out of disk space?");
-                }
-            }
+        const rvec* x = (mdof_flags & (MDOF_X | MDOF_X_COMPRESSED)) ? state_global->x.rvec_array()
+                                                                     : nullptr;
+        const rvec* v = (mdof_flags & MDOF_V) ? state_global->v.rvec_array() : nullptr;
+        const rvec* f = (mdof_flags & MDOF_F) ? f_global : nullptr;
+        const real lambda = state_local->lambda[FreeEnergyPerturbationCouplingType::Fep];
 
-            /* If a TNG file is open for uncompressed coordinate output also write
-               velocities and forces to it. */
-            else if (of->tng)
-            {
-                gmx_fwrite_tng(of->tng,
-                               FALSE,
-                               step,
-                               t,
-                               state_local->lambda[FreeEnergyPerturbationCouplingType::Fep],
-                               state_local->box,
-                               natoms,
-                               x,
-                               v,
-                               f);
-            }
-            /* If only a TNG file is open for compressed coordinate output (no uncompressed
-               coordinate output) also write forces and velocities to it. */
-            else if (of->tng_low_prec)
-            {
-                gmx_fwrite_tng(of->tng_low_prec,
-                               FALSE,
-                               step,
-                               t,
-                               state_local->lambda[FreeEnergyPerturbationCouplingType::Fep],
-                               state_local->box,
-                               natoms,
-                               x,
-                               v,
-                               f);
-            }
-        }
-        if (mdof_flags & MDOF_X_COMPRESSED)
+        if (!of->writeTrajectoryAsync)
         {
-            rvec* xxtc = nullptr;
-
-            if (of->natoms_x_compressed == of->natoms_global)
-            {
-                /* We are writing the positions of all of the atoms to
-                   the compressed output */
-                xxtc = state_global->x.rvec_array();
-            }
-            else
-            {
-                /* We are writing the positions of only a subset of
-                   the atoms to the compressed output, so we have to
-                   make a copy of the subset of coordinates. */
-                int i, j;
-
-                snew(xxtc, of->natoms_x_compressed);
-                auto x = makeArrayRef(state_global->x);
-                for (i = 0, j = 0; (i < of->natoms_global); i++)
-                {
-                    if (getGroupType(*of->groups, SimulationAtomGroupType::CompressedPositionOutput, i) == 0)
-                    {
-                        copy_rvec(x[i], xxtc[j++]);
-                    }
-                }
-            }
-            if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t, state_local->box, xxtc, of->x_compression_precision)
-                == 0)
-            {
-                gmx_fatal(FARGS,
-                          "XTC error. This indicates you are out of disk space, or a "
-                          "simulation with major instabilities resulting in coordinates "
-                          "that are NaN or too large to be represented in the XTC format.\n");
-            }
-            gmx_fwrite_tng(of->tng_low_prec,
-                           TRUE,
-                           step,
-                           t,
-                           state_local->lambda[FreeEnergyPerturbationCouplingType::Fep],
-                           state_local->box,
-                           of->natoms_x_compressed,
-                           xxtc,
-                           nullptr,
-                           nullptr);
-            if (of->natoms_x_compressed != of->natoms_global)
-            {
-                sfree(xxtc);
-            }
+            write_trajectory_frame(
+                    of, mdof_flags, natoms, step, t, lambda, state_local->box, x, v, f);
         }
-        if (mdof_flags & (MDOF_BOX | MDOF_LAMBDA) && !(mdof_flags & (MDOF_X | MDOF_V | MDOF_F)))
+        else if (mdof_flags & ~(MDOF_CPT | MDOF_IMD))
         {
-            if (of->tng)
-            {
-                real  lambda = -1;
-                rvec* box    = nullptr;
-                if (mdof_flags & MDOF_BOX)
-                {
-                    box = state_local->box;
-                }
-                if (mdof_flags & MDOF_LAMBDA)
-                {
-                    lambda = state_local->lambda[FreeEnergyPerturbationCouplingType::Fep];
-                }
-                gmx_fwrite_tng(of->tng, FALSE, step, t, lambda, box, natoms, nullptr, nullptr, nullptr);
-            }
-        }
-        if (mdof_flags & (MDOF_BOX_COMPRESSED | MDOF_LAMBDA_COMPRESSED)
-            && !(mdof_flags & (MDOF_X_COMPRESSED)))
-        {
-            if (of->tng_low_prec)
-            {
-                real  lambda = -1;
-                rvec* box    = nullptr;
-                if (mdof_flags & MDOF_BOX_COMPRESSED)
-                {
-                    box = state_local->box;
-                }
-                if (mdof_flags & MDOF_LAMBDA_COMPRESSED)
-                {
-                    lambda = state_local->lambda[FreeEnergyPerturbationCouplingType::Fep];
-                }
-                gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, lambda, box, natoms, nullptr, nullptr, nullptr);
-            }
+            /* The frame is written after we return, so the task gets copies of the data */
+            matrix box;
+            copy_mat(state_local->box, box);
+            std::vector<gmx::RVec> xCopy = copyFrameVector(x, natoms);
+            std::vector<gmx::RVec> vCopy = copyFrameVector(v, natoms);
+            std::vector<gmx::RVec> fCopy = copyFrameVector(f, natoms);
+            of->asyncWriter->queue([of,
+                                    mdof_flags,
+                                    natoms,
+                                    step,
+                                    t,
+                                    lambda,
+                                    box,
+                                    xCopy = std::move(xCopy),
+                                    vCopy = std::move(vCopy),
+                                    fCopy = std::move(fCopy)]() {
+                write_trajectory_frame(of,
+                                       mdof_flags,
+                                       natoms,
+                                       step,
+                                       t,
+                                       lambda,
+                                       box,
+                                       frameVectorData(xCopy),
+                                       frameVectorData(vCopy),
+                                       frameVectorData(fCopy));
+            });
         }
 
 #if GMX_FAHCORE
@@ -758,6 +1015,10 @@ void mdoutf_tng_close(gmx_mdoutf_t of)
     if (of->tng || of->tng_low_prec)
     {
         wallcycle_start(of->wcycle, WallCycleCounter::Traj);
+        if (of->asyncWriter)
+        {
+            of->asyncWriter->waitForCompletion();
+        }
         gmx_tng_close(&of->tng);
         gmx_tng_close(&of->tng_low_prec);
         wallcycle_stop(of->wcycle, WallCycleCounter::Traj);
@@ -766,6 +1027,12 @@ void mdoutf_tng_close(gmx_mdoutf_t of)
 
 void done_mdoutf(gmx_mdoutf_t of)
 {
+    if (of->asyncWriter)
+    {
+        /* Write all pending frames before closing the files */
+        of->asyncWriter->waitForCompletion();
+        delete of->asyncWriter;
+    }
     if (of->fp_ene != nullptr)
     {
         done_ener_file(of->fp_ene);
@@ -67,7 +67,8 @@ typedef struct gmx_mdoutf* gmx_mdoutf_t;
 /*! \brief Allocate and initialize object to manager trajectory writing output
  *
  * Returns a pointer to a data structure with all output file pointers
- * and names required by mdrun.
+ * and names required by mdrun. With \p exchangeLambdaStates, the lambda
+ * state is written to the dhdl file, as with expanded ensemble.
  */
 gmx_mdoutf_t init_mdoutf(FILE*                          fplog,
                          int                            nfile,
@@ -82,6 +83,7 @@ gmx_mdoutf_t init_mdoutf(FILE*                          fplog,
                          gmx_wallcycle*                 wcycle,
                          gmx::StartingBehavior          startingBehavior,
                          bool                           simulationsShareState,
+                         bool                           exchangeLambdaStates,
                          const gmx_multisim_t*          ms);
 
 /*! \brief Getter for file pointer */
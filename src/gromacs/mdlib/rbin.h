@@ -38,6 +38,7 @@
 #define GMX_MDLIB_RBIN_H
 
 #include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/gmxmpi.h"
 #include "gromacs/utility/real.h"
 
 struct t_commrec;
@@ -67,6 +68,13 @@ int add_bind(t_bin* b, gmx::ArrayRef<const double> r);
 void sum_bin(t_bin* b, const t_commrec* cr);
 /* Globally sum the reals in the bin */
 
+void sum_bin_start(t_bin* b, const t_commrec* cr, MPI_Request* request);
+/* Start globally summing the reals in the bin, the bin should not be
+ * accessed until sum_bin_finish() has been called */
+
+void sum_bin_finish(t_bin* b, const t_commrec* cr, MPI_Request* request);
+/* Complete the global sum started with sum_bin_start() */
+
 void extract_binr(t_bin* b, int index, int nr, real r[]);
 void extract_binr(t_bin* b, int index, gmx::ArrayRef<real> r);
 void extract_bind(t_bin* b, int index, int nr, double r[]);
@@ -255,6 +255,27 @@ void SettleData::setConstraints(const InteractionList&    il_settle,
             virfac_[i] = 0;
         }
     }
+
+    settlesAreConsecutiveAndOrdered_ = true;
+    for (int i = 0; i < nsettle; i++)
+    {
+        if (hw2_[i] != ow1_[i] + 1 || hw3_[i] != ow1_[i] + 2 || (i > 0 && ow1_[i] <= hw3_[i - 1]))
+        {
+            settlesAreConsecutiveAndOrdered_ = false;
+            break;
+        }
+    }
+}
+
+int SettleData::packSize() const
+{
+#if GMX_SIMD_HAVE_REAL
+    if (useSimd_)
+    {
+        return GMX_SIMD_REAL_WIDTH;
+    }
+#endif
+    return 1;
 }
 
 void settle_proj(const SettleData&    settled,
@@ -696,13 +717,13 @@ static void settleTemplate(const SettleData&  settled,
     *bErrorHasOccurred = anyTrue(bError);
 }
 
-/*! \brief Wrapper template function that divides the settles over threads
- * and instantiates the core template with instantiated booleans.
+/*! \brief Wrapper template function that instantiates the core template
+ * with instantiated booleans for settles \p settleStart to \p settleEnd.
  */
 template<typename T, typename TypeBool, int packSize, typename TypePbc>
 static void settleTemplateWrapper(const SettleData& settled,
-                                  int               nthread,
-                                  int               thread,
+                                  int               settleStart,
+                                  int               settleEnd,
                                   TypePbc           pbc,
                                   const real        x[],
                                   real              xprime[],
@@ -712,12 +733,6 @@ static void settleTemplateWrapper(const SettleData& settled,
                                   tensor            vir_r_m_dr,
                                   bool*             bErrorHasOccurred)
 {
-    /* We need to assign settles to threads in groups of pack_size */
-    int numSettlePacks = (settled.numSettles() + packSize - 1) / packSize;
-    /* Round the end value up to give thread 0 more work */
-    int settleStart = ((numSettlePacks * thread + nthread - 1) / nthread) * packSize;
-    int settleEnd   = ((numSettlePacks * (thread + 1) + nthread - 1) / nthread) * packSize;
-
     if (v != nullptr)
     {
         if (!bCalcVirial)
@@ -746,18 +761,27 @@ static void settleTemplateWrapper(const SettleData& settled,
     }
 }
 
-void csettle(const SettleData&               settled,
-             int                             nthread,
-             int                             thread,
-             const t_pbc*                    pbc,
-             ArrayRefWithPadding<const RVec> x,
-             ArrayRefWithPadding<RVec>       xprime,
-             real                            invdt,
-             ArrayRefWithPadding<RVec>       v,
-             bool                            bCalcVirial,
-             tensor                          vir_r_m_dr,
-             bool*                           bErrorHasOccurred)
+void csettleRange(const SettleData&               settled,
+                  int                             settleStart,
+                  int                             settleEnd,
+                  const t_pbc*                    pbc,
+                  ArrayRefWithPadding<const RVec> x,
+                  ArrayRefWithPadding<RVec>       xprime,
+                  real                            invdt,
+                  ArrayRefWithPadding<RVec>       v,
+                  bool                            bCalcVirial,
+                  tensor                          vir_r_m_dr,
+                  bool*                           bErrorHasOccurred)
 {
+    const int packSize = settled.packSize();
+
+    GMX_ASSERT(settleStart % packSize == 0, "The settle range should start at a pack boundary");
+    GMX_ASSERT(settleEnd % packSize == 0 || settleEnd == settled.numSettles(),
+               "The settle range should end at a pack boundary or at the last settle");
+
+    /* The settle data is padded up to a multiple of the pack size */
+    settleEnd = ((settleEnd + packSize - 1) / packSize) * packSize;
+
     const real* xPtr      = as_rvec_array(x.paddedArrayRef().data())[0];
     real*       xprimePtr = as_rvec_array(xprime.paddedArrayRef().data())[0];
     real*       vPtr      = as_rvec_array(v.paddedArrayRef().data())[0];
@@ -770,7 +794,7 @@ void csettle(const SettleData&               settled,
         set_pbc_simd(pbc, pbcSimd);
 
         settleTemplateWrapper<SimdReal, SimdBool, GMX_SIMD_REAL_WIDTH, const real*>(
-                settled, nthread, thread, pbcSimd, xPtr, xprimePtr, invdt, vPtr, bCalcVirial, vir_r_m_dr, bErrorHasOccurred);
+                settled, settleStart, settleEnd, pbcSimd, xPtr, xprimePtr, invdt, vPtr, bCalcVirial, vir_r_m_dr, bErrorHasOccurred);
     }
     else
 #endif
@@ -790,8 +814,41 @@ void csettle(const SettleData&               settled,
         }
 
         settleTemplateWrapper<real, bool, 1, const t_pbc*>(
-                settled, nthread, thread, pbcNonNull, &xPtr[0], &xprimePtr[0], invdt, &vPtr[0], bCalcVirial, vir_r_m_dr, bErrorHasOccurred);
+                settled, settleStart, settleEnd, pbcNonNull, &xPtr[0], &xprimePtr[0], invdt, &vPtr[0], bCalcVirial, vir_r_m_dr, bErrorHasOccurred);
     }
 }
 
+void csettle(const SettleData&               settled,
+             int                             nthread,
+             int                             thread,
+             const t_pbc*                    pbc,
+             ArrayRefWithPadding<const RVec> x,
+             ArrayRefWithPadding<RVec>       xprime,
+             real                            invdt,
+             ArrayRefWithPadding<RVec>       v,
+             bool                            bCalcVirial,
+             tensor                          vir_r_m_dr,
+             bool*                           bErrorHasOccurred)
+{
+    const int packSize = settled.packSize();
+
+    /* We need to assign settles to threads in groups of pack_size */
+    int numSettlePacks = (settled.numSettles() + packSize - 1) / packSize;
+    /* Round the end value up to give thread 0 more work */
+    int settleStart = ((numSettlePacks * thread + nthread - 1) / nthread) * packSize;
+    int settleEnd   = ((numSettlePacks * (thread + 1) + nthread - 1) / nthread) * packSize;
+
+    csettleRange(settled,
+                 settleStart,
+                 std::min(settleEnd, settled.numSettles()),
+                 pbc,
+                 x,
+                 xprime,
+                 invdt,
+                 v,
+                 bCalcVirial,
+                 vir_r_m_dr,
+                 bErrorHasOccurred);
+}
+
 } // namespace gmx
@@ -147,6 +147,17 @@ public:
     //! Returns whether we should use SIMD intrinsics code
     bool useSimd() const { return useSimd_; }
 
+    /*! \brief Returns the number of settles processed together
+     *
+     * Ranges of settles passed to csettleRange() should start at a multiple of this number.
+     */
+    int packSize() const;
+
+    /*! \brief Returns whether each settle acts on three consecutive atoms O, H, H
+     * and the settles are ordered by increasing atom index
+     */
+    bool settlesAreConsecutiveAndOrdered() const { return settlesAreConsecutiveAndOrdered_; }
+
 private:
     //! Parameters for SETTLE for coordinates
     SettleParameters parametersMassWeighted_;
@@ -167,6 +178,9 @@ private:
 
     //! Tells whether we will use SIMD intrinsics code
     bool useSimd_;
+
+    //! Whether all settles act on consecutive atoms and are ordered by atom index
+    bool settlesAreConsecutiveAndOrdered_ = false;
 };
 
 /*! \brief Constrain coordinates using SETTLE.
@@ -185,6 +199,26 @@ void csettle(const SettleData&               settled,     /* The SETTLE structur
              bool*                           bErrorHasOccurred /* True if a settle error occurred */
 );
 
+/*! \brief Constrain coordinates using SETTLE for settles \p settleStart to \p settleEnd.
+ *
+ * \p settleStart should be a multiple of SettleData::packSize() and \p settleEnd
+ * should be a multiple of this pack size or equal to the number of settles.
+ * This allows for constraining settles in blocks, e.g. right after updating
+ * the atoms involved. Can be called on any number of threads with
+ * non-overlapping settle ranges.
+ */
+void csettleRange(const SettleData&               settled,
+                  int                             settleStart,
+                  int                             settleEnd,
+                  const t_pbc*                    pbc,
+                  ArrayRefWithPadding<const RVec> x,
+                  ArrayRefWithPadding<RVec>       xprime,
+                  real                            invdt,
+                  ArrayRefWithPadding<RVec>       v,
+                  bool                            bCalcVirial,
+                  tensor                          vir_r_m_dr,
+                  bool*                           bErrorHasOccurred);
+
 /*! \brief Analytical algorithm to subtract the components of derivatives
  * of coordinates working on settle type constraint.
  */
@@ -51,6 +51,7 @@
 #include <cstdlib>
 
 #include <algorithm>
+#include <numeric>
 
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/math/functions.h"
@@ -60,9 +61,14 @@
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
 #include "gromacs/topology/invblock.h"
 #include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 namespace gmx
@@ -122,10 +128,156 @@ static void pr_sortblock(FILE* fp, const char* title, int nsb, t_sortblock sb[])
     }
 }
 
-//! Reallocates a vector.
+//! Reallocates the per-constraint data.
 static void resizeLagrangianData(shakedata* shaked, int ncons)
 {
     shaked->scaled_lagrange_multiplier.resize(ncons);
+    shaked->rij.resize(ncons);
+    shaked->half_of_reduced_mass.resize(ncons);
+    shaked->distance_squared_tolerance.resize(ncons);
+    shaked->constraint_distance_squared.resize(ncons);
+}
+
+//! The minimum number of constraints in a block for iterating it with all threads together
+static constexpr int c_minConstraintsForColoredBlock = 256;
+
+/*! \brief Colors the constraints of a SHAKE block and orders them by color
+ *
+ * A greedy coloring is used, so constraints with the same color share
+ * no atoms and can be updated simultaneously in a Gauss-Seidel sweep.
+ *
+ * \param[in]    numConstraints  The number of constraints in the block
+ * \param[inout] iatoms          The constraint atom triplets of the block, ordered by color
+ *                               on return
+ * \param[inout] atomColorMask   Work array with a zero mask for every atom, zero again on return
+ * \returns The start of each color plus the end, empty when more than 64 colors are needed
+ */
+static std::vector<int> colorShakeBlock(int                numConstraints,
+                                        int*               iatoms,
+                                        ArrayRef<uint64_t> atomColorMask)
+{
+    constexpr int c_maxNumColors = 64;
+
+    std::vector<int> color(numConstraints);
+    int              numColors = 0;
+    for (int c = 0; c < numConstraints && numColors <= c_maxNumColors; c++)
+    {
+        const int      ai   = iatoms[3 * c + 1];
+        const int      aj   = iatoms[3 * c + 2];
+        const uint64_t used = atomColorMask[ai] | atomColorMask[aj];
+        int            col  = 0;
+        while (col < c_maxNumColors && (used & (uint64_t(1) << col)))
+        {
+            col++;
+        }
+        if (col < c_maxNumColors)
+        {
+            atomColorMask[ai] |= (uint64_t(1) << col);
+            atomColorMask[aj] |= (uint64_t(1) << col);
+        }
+        color[c]  = col;
+        numColors = std::max(numColors, col + 1);
+    }
+    for (int c = 0; c < numConstraints; c++)
+    {
+        atomColorMask[iatoms[3 * c + 1]] = 0;
+        atomColorMask[iatoms[3 * c + 2]] = 0;
+    }
+    if (numColors > c_maxNumColors)
+    {
+        return {};
+    }
+
+    /* Order the constraints by color, keeping the original order within a color */
+    std::vector<int> colorStart(numColors + 1, 0);
+    for (int c = 0; c < numConstraints; c++)
+    {
+        colorStart[color[c] + 1]++;
+    }
+    std::partial_sum(colorStart.begin(), colorStart.end(), colorStart.begin());
+    std::vector<int> colorIndex(colorStart.begin(), colorStart.end() - 1);
+    std::vector<int> ordered(3 * numConstraints);
+    for (int c = 0; c < numConstraints; c++)
+    {
+        const int dest = colorIndex[color[c]]++;
+        for (int m = 0; m < 3; m++)
+        {
+            ordered[3 * dest + m] = iatoms[3 * c + m];
+        }
+    }
+    std::copy(ordered.begin(), ordered.end(), iatoms);
+
+    return colorStart;
+}
+
+/*! \brief Sets up the distribution of the SHAKE blocks over the threads
+ *
+ * Blocks that are too large to be handled by one thread with good load balance
+ * are colored, when \p iatoms is passed, and later iterated by all threads.
+ * The remaining blocks are distributed over the threads in contiguous ranges
+ * with approximately equal numbers of constraints.
+ *
+ * \param[inout] shaked    The SHAKE data, sblock should be set
+ * \param[inout] iatoms    The constraint atom triplets, nullptr when reordering is not allowed
+ * \param[in]    numAtoms  The number of atoms, only used with \p iatoms
+ */
+static void setShakeThreading(shakedata* shaked, int* iatoms, int numAtoms)
+{
+    const int numThreads     = shaked->numThreads;
+    const int numBlocks      = shaked->numShakeBlocks();
+    const int numConstraints = shaked->sblock[numBlocks] / 3;
+
+    shaked->blockColorStart.clear();
+    shaked->blockColorStart.resize(numBlocks);
+    int numConstraintsForThreads = numConstraints;
+    if (numThreads > 1 && iatoms != nullptr)
+    {
+        std::vector<uint64_t> atomColorMask;
+        for (int b = 0; b < numBlocks; b++)
+        {
+            const int blockSize = (shaked->sblock[b + 1] - shaked->sblock[b]) / 3;
+            if (blockSize >= c_minConstraintsForColoredBlock
+                && int64_t(blockSize) * numThreads > numConstraints)
+            {
+                atomColorMask.resize(numAtoms, 0);
+                shaked->blockColorStart[b] =
+                        colorShakeBlock(blockSize, iatoms + shaked->sblock[b], atomColorMask);
+                if (!shaked->blockColorStart[b].empty())
+                {
+                    numConstraintsForThreads -= blockSize;
+                    if (debug)
+                    {
+                        fprintf(debug,
+                                "SHAKE block %d with %d constraints is iterated by all threads "
+                                "using %zu colors\n",
+                                b,
+                                blockSize,
+                                shaked->blockColorStart[b].size() - 1);
+                    }
+                }
+            }
+        }
+    }
+
+    shaked->threadBlockRange.resize(numThreads + 1);
+    shaked->threadData.resize(numThreads);
+    shaked->threadBlockRange[0] = 0;
+    int block                   = 0;
+    int numAssigned             = 0;
+    for (int t = 0; t < numThreads; t++)
+    {
+        const int64_t target = (int64_t(numConstraintsForThreads) * (t + 1)) / numThreads;
+        while (block < numBlocks && numAssigned < target)
+        {
+            if (shaked->blockColorStart[block].empty())
+            {
+                numAssigned += (shaked->sblock[block + 1] - shaked->sblock[block]) / 3;
+            }
+            block++;
+        }
+        shaked->threadBlockRange[t + 1] = block;
+    }
+    shaked->threadBlockRange[numThreads] = numBlocks;
 }
 
 void make_shake_sblock_serial(shakedata* shaked, InteractionDefinitions* idef, const int numAtoms)
@@ -214,6 +366,7 @@ void make_shake_sblock_serial(shakedata* shaked, InteractionDefinitions* idef, c
     sfree(sb);
     sfree(inv_sblock);
     resizeLagrangianData(shaked, ncons);
+    setShakeThreading(shaked, idef->il[F_CONSTR].iatoms.data(), numAtoms);
 }
 
 void make_shake_sblock_dd(shakedata* shaked, const InteractionList& ilcon)
@@ -238,6 +391,90 @@ void make_shake_sblock_dd(shakedata* shaked, const InteractionList& ilcon)
     }
     shaked->sblock.push_back(3 * ncons);
     resizeLagrangianData(shaked, ncons);
+    /* The local topology is shared, so we can not reorder constraints here */
+    setShakeThreading(shaked, nullptr, 0);
+}
+
+//! Tolerance factor for the inner product check in SHAKE, default should be increased! MRS 8/4/2009
+static constexpr real c_shakeInnerProductTolerance = 1e-10;
+
+/*! \brief Applies one SHAKE update to constraint \p ll
+ *
+ * Parameters are described with cshake().
+ *
+ * \returns whether the constraint was not yet converged, sets \p error to ll + 1
+ *          when the input was malformed
+ */
+static inline bool shakeConstraint(int                  ll,
+                                   const int            iatom[],
+                                   ArrayRef<const real> constraint_distance_squared,
+                                   ArrayRef<RVec>       positions,
+                                   const t_pbc*         pbc,
+                                   ArrayRef<const RVec> initial_displacements,
+                                   ArrayRef<const real> half_of_reduced_mass,
+                                   real                 omega,
+                                   ArrayRef<const real> invmass,
+                                   ArrayRef<const real> distance_squared_tolerance,
+                                   ArrayRef<real>       scaled_lagrange_multiplier,
+                                   int*                 error)
+{
+    const int  l3   = 3 * ll;
+    const real rijx = initial_displacements[ll][XX];
+    const real rijy = initial_displacements[ll][YY];
+    const real rijz = initial_displacements[ll][ZZ];
+    const int  i    = iatom[l3 + 1];
+    const int  j    = iatom[l3 + 2];
+
+    /* Compute r prime between atoms i and j, which is the
+       displacement *before* this update stage */
+    rvec r_prime;
+    if (pbc)
+    {
+        pbc_dx(pbc, positions[i], positions[j], r_prime);
+    }
+    else
+    {
+        rvec_sub(positions[i], positions[j], r_prime);
+    }
+    const real r_prime_squared                = norm2(r_prime);
+    const real constraint_distance_squared_ll = constraint_distance_squared[ll];
+    const real diff                           = constraint_distance_squared_ll - r_prime_squared;
+
+    /* iconvf is less than 1 when the error is smaller than a bound */
+    const real iconvf = std::abs(diff) * distance_squared_tolerance[ll];
+
+    if (iconvf <= 1.0_real)
+    {
+        return false;
+    }
+
+    const real r_dot_r_prime = (rijx * r_prime[XX] + rijy * r_prime[YY] + rijz * r_prime[ZZ]);
+
+    if (r_dot_r_prime < constraint_distance_squared_ll * c_shakeInnerProductTolerance)
+    {
+        *error = ll + 1;
+    }
+    else
+    {
+        /* The next line solves equation 5.6 (neglecting
+           the term in g^2), for g */
+        const real scaled_lagrange_multiplier_ll =
+                omega * diff * half_of_reduced_mass[ll] / r_dot_r_prime;
+        scaled_lagrange_multiplier[ll] += scaled_lagrange_multiplier_ll;
+        const real xh = rijx * scaled_lagrange_multiplier_ll;
+        const real yh = rijy * scaled_lagrange_multiplier_ll;
+        const real zh = rijz * scaled_lagrange_multiplier_ll;
+        const real im = invmass[i];
+        const real jm = invmass[j];
+        positions[i][XX] += xh * im;
+        positions[i][YY] += yh * im;
+        positions[i][ZZ] += zh * im;
+        positions[j][XX] -= xh * jm;
+        positions[j][YY] -= yh * jm;
+        positions[j][ZZ] -= zh * jm;
+    }
+
+    return true;
 }
 
 /*! \brief Inner kernel for SHAKE constraints
@@ -288,78 +525,180 @@ void cshake(const int            iatom[],
             ArrayRef<real>       scaled_lagrange_multiplier,
             int*                 nerror)
 {
-    /* default should be increased! MRS 8/4/2009 */
-    const real mytol = 1e-10;
-
-    // TODO nconv is used solely as a boolean, so we should write the
-    // code like that
-    int error = 0;
-    int nconv = 1;
-    int nit;
-    for (nit = 0; (nit < maxnit) && (nconv != 0) && (error == 0); nit++)
+    int  error       = 0;
+    bool isConverged = false;
+    int  nit;
+    for (nit = 0; (nit < maxnit) && !isConverged && (error == 0); nit++)
     {
-        nconv = 0;
+        isConverged = true;
         for (int ll = 0; (ll < ncon) && (error == 0); ll++)
         {
-            const int  l3   = 3 * ll;
-            const real rijx = initial_displacements[ll][XX];
-            const real rijy = initial_displacements[ll][YY];
-            const real rijz = initial_displacements[ll][ZZ];
-            const int  i    = iatom[l3 + 1];
-            const int  j    = iatom[l3 + 2];
-
-            /* Compute r prime between atoms i and j, which is the
-               displacement *before* this update stage */
-            rvec r_prime;
-            if (pbc)
-            {
-                pbc_dx(pbc, positions[i], positions[j], r_prime);
-            }
-            else
+            if (shakeConstraint(ll,
+                                iatom,
+                                constraint_distance_squared,
+                                positions,
+                                pbc,
+                                initial_displacements,
+                                half_of_reduced_mass,
+                                omega,
+                                invmass,
+                                distance_squared_tolerance,
+                                scaled_lagrange_multiplier,
+                                &error))
             {
-                rvec_sub(positions[i], positions[j], r_prime);
+                isConverged = false;
             }
-            const real r_prime_squared                = norm2(r_prime);
-            const real constraint_distance_squared_ll = constraint_distance_squared[ll];
-            const real diff = constraint_distance_squared_ll - r_prime_squared;
+        }
+    }
+    *nnit   = nit;
+    *nerror = error;
+}
 
-            /* iconvf is less than 1 when the error is smaller than a bound */
-            const real iconvf = std::abs(diff) * distance_squared_tolerance[ll];
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_LOADU && GMX_SIMD_HAVE_STOREU
+/*! \brief Applies one SHAKE update to GMX_SIMD_REAL_WIDTH constraints starting at \p c0
+ *
+ * The constraints should not share atoms and no PBC should be required.
+ * Parameters are described with cshake(). The positions should be padded
+ * as required for SIMD gather loads.
+ *
+ * \returns whether any of the constraints was not yet converged, sets \p error
+ *          to one more than the first malformed constraint
+ */
+static bool gmx_simdcall shakeConstraintsSimd(int                  c0,
+                                              const int            iatom[],
+                                              ArrayRef<const real> constraint_distance_squared,
+                                              ArrayRef<RVec>       positions,
+                                              ArrayRef<const RVec> initial_displacements,
+                                              ArrayRef<const real> half_of_reduced_mass,
+                                              real                 omega,
+                                              ArrayRef<const real> invmass,
+                                              ArrayRef<const real> distance_squared_tolerance,
+                                              ArrayRef<real>       scaled_lagrange_multiplier,
+                                              int*                 error)
+{
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t offsetI[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t offsetJ[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         buffer[6 * GMX_SIMD_REAL_WIDTH];
 
-            if (iconvf > 1.0_real)
+    for (int i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        offsetI[i]                          = iatom[3 * (c0 + i) + 1];
+        offsetJ[i]                          = iatom[3 * (c0 + i) + 2];
+        buffer[i]                           = initial_displacements[c0 + i][XX];
+        buffer[GMX_SIMD_REAL_WIDTH + i]     = initial_displacements[c0 + i][YY];
+        buffer[2 * GMX_SIMD_REAL_WIDTH + i] = initial_displacements[c0 + i][ZZ];
+        buffer[3 * GMX_SIMD_REAL_WIDTH + i] = invmass[offsetI[i]];
+        buffer[4 * GMX_SIMD_REAL_WIDTH + i] = invmass[offsetJ[i]];
+    }
+    const SimdReal rijx = load<SimdReal>(buffer);
+    const SimdReal rijy = load<SimdReal>(buffer + GMX_SIMD_REAL_WIDTH);
+    const SimdReal rijz = load<SimdReal>(buffer + 2 * GMX_SIMD_REAL_WIDTH);
+    const SimdReal im   = load<SimdReal>(buffer + 3 * GMX_SIMD_REAL_WIDTH);
+    const SimdReal jm   = load<SimdReal>(buffer + 4 * GMX_SIMD_REAL_WIDTH);
+
+    real*    x = positions[0].as_vec();
+    SimdReal xi, yi, zi, xj, yj, zj;
+    gatherLoadUTranspose<3>(x, offsetI, &xi, &yi, &zi);
+    gatherLoadUTranspose<3>(x, offsetJ, &xj, &yj, &zj);
+    const SimdReal rpx = xi - xj;
+    const SimdReal rpy = yi - yj;
+    const SimdReal rpz = zi - zj;
+
+    const SimdReal dist2  = loadU<SimdReal>(constraint_distance_squared.data() + c0);
+    const SimdReal diff   = dist2 - norm2(rpx, rpy, rpz);
+    const SimdReal iconvf = abs(diff) * loadU<SimdReal>(distance_squared_tolerance.data() + c0);
+    const SimdBool notConverged = (SimdReal(1.0_real) < iconvf);
+
+    const SimdReal rDotRPrime    = iprod(rijx, rijy, rijz, rpx, rpy, rpz);
+    const SimdReal minRDotRPrime = dist2 * SimdReal(c_shakeInnerProductTolerance);
+    const SimdBool doUpdate      = notConverged && (minRDotRPrime <= rDotRPrime);
+    const SimdBool isMalformed   = notConverged && (rDotRPrime < minRDotRPrime);
+
+    /* Solve equation 5.6 (neglecting the term in g^2) for g, zero for lanes without update */
+    const SimdReal g = SimdReal(omega) * diff * loadU<SimdReal>(half_of_reduced_mass.data() + c0)
+                       * maskzInv(rDotRPrime, doUpdate);
+    storeU(scaled_lagrange_multiplier.data() + c0,
+           loadU<SimdReal>(scaled_lagrange_multiplier.data() + c0) + g);
+
+    const SimdReal xh = rijx * g;
+    const SimdReal yh = rijy * g;
+    const SimdReal zh = rijz * g;
+    transposeScatterIncrU<3>(x, offsetI, xh * im, yh * im, zh * im);
+    transposeScatterDecrU<3>(x, offsetJ, xh * jm, yh * jm, zh * jm);
+
+    if (anyTrue(isMalformed))
+    {
+        store(buffer + 5 * GMX_SIMD_REAL_WIDTH, selectByMask(SimdReal(1.0_real), isMalformed));
+        for (int i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+        {
+            if (buffer[5 * GMX_SIMD_REAL_WIDTH + i] != 0)
             {
-                nconv = static_cast<int>(iconvf);
-                const real r_dot_r_prime =
-                        (rijx * r_prime[XX] + rijy * r_prime[YY] + rijz * r_prime[ZZ]);
-
-                if (r_dot_r_prime < constraint_distance_squared_ll * mytol)
-                {
-                    error = ll + 1;
-                }
-                else
-                {
-                    /* The next line solves equation 5.6 (neglecting
-                       the term in g^2), for g */
-                    real scaled_lagrange_multiplier_ll =
-                            omega * diff * half_of_reduced_mass[ll] / r_dot_r_prime;
-                    scaled_lagrange_multiplier[ll] += scaled_lagrange_multiplier_ll;
-                    const real xh = rijx * scaled_lagrange_multiplier_ll;
-                    const real yh = rijy * scaled_lagrange_multiplier_ll;
-                    const real zh = rijz * scaled_lagrange_multiplier_ll;
-                    const real im = invmass[i];
-                    const real jm = invmass[j];
-                    positions[i][XX] += xh * im;
-                    positions[i][YY] += yh * im;
-                    positions[i][ZZ] += zh * im;
-                    positions[j][XX] -= xh * jm;
-                    positions[j][YY] -= yh * jm;
-                    positions[j][ZZ] -= zh * jm;
-                }
+                *error = c0 + i + 1;
+                break;
             }
         }
     }
-    *nnit   = nit;
-    *nerror = error;
+
+    return anyTrue(notConverged);
+}
+#endif
+
+/*! \brief Applies one RATTLE update to constraint \p ll
+ *
+ * Parameters are described with crattle().
+ *
+ * \returns whether the constraint was not yet converged
+ */
+static inline bool rattleConstraint(int                  ll,
+                                    const int            iatom[],
+                                    ArrayRef<const real> constraint_distance_squared,
+                                    ArrayRef<RVec>       vp,
+                                    ArrayRef<const RVec> rij,
+                                    ArrayRef<const real> m2,
+                                    real                 omega,
+                                    ArrayRef<const real> invmass,
+                                    ArrayRef<const real> distance_squared_tolerance,
+                                    ArrayRef<real>       scaled_lagrange_multiplier,
+                                    real                 invdt)
+{
+    const int  l3   = 3 * ll;
+    const real rijx = rij[ll][XX];
+    const real rijy = rij[ll][YY];
+    const real rijz = rij[ll][ZZ];
+    const int  i    = iatom[l3 + 1];
+    const int  j    = iatom[l3 + 2];
+    rvec       v;
+    rvec_sub(vp[i], vp[j], v);
+
+    const real vpijd                          = v[XX] * rijx + v[YY] * rijy + v[ZZ] * rijz;
+    const real constraint_distance_squared_ll = constraint_distance_squared[ll];
+
+    /* iconv is zero when the error is smaller than a bound */
+    const real iconvf = fabs(vpijd) * (distance_squared_tolerance[ll] / invdt);
+
+    if (iconvf <= 1.0_real)
+    {
+        return false;
+    }
+
+    const real fac  = omega * 2.0_real * m2[ll] / constraint_distance_squared_ll;
+    const real acor = -fac * vpijd;
+    scaled_lagrange_multiplier[ll] += acor;
+    const real xh = rijx * acor;
+    const real yh = rijy * acor;
+    const real zh = rijz * acor;
+
+    const real im = invmass[i];
+    const real jm = invmass[j];
+
+    vp[i][XX] += xh * im;
+    vp[i][YY] += yh * im;
+    vp[i][ZZ] += zh * im;
+    vp[j][XX] -= xh * jm;
+    vp[j][YY] -= yh * jm;
+    vp[j][ZZ] -= zh * jm;
+
+    return true;
 }
 
 //! Implements RATTLE (ie. SHAKE for velocity verlet integrators)
@@ -387,101 +726,59 @@ static void crattle(const int            iatom[],
      *     second part of rattle algorithm
      */
 
-    // TODO nconv is used solely as a boolean, so we should write the
-    // code like that
-    int error = 0;
-    int nconv = 1;
-    int nit;
-    for (nit = 0; (nit < maxnit) && (nconv != 0) && (error == 0); nit++)
+    bool isConverged = false;
+    int  nit;
+    for (nit = 0; (nit < maxnit) && !isConverged; nit++)
     {
-        nconv = 0;
-        for (int ll = 0; (ll < ncon) && (error == 0); ll++)
+        isConverged = true;
+        for (int ll = 0; ll < ncon; ll++)
         {
-            const int  l3   = 3 * ll;
-            const real rijx = rij[ll][XX];
-            const real rijy = rij[ll][YY];
-            const real rijz = rij[ll][ZZ];
-            const int  i    = iatom[l3 + 1];
-            const int  j    = iatom[l3 + 2];
-            rvec       v;
-            rvec_sub(vp[i], vp[j], v);
-
-            const real vpijd                          = v[XX] * rijx + v[YY] * rijy + v[ZZ] * rijz;
-            const real constraint_distance_squared_ll = constraint_distance_squared[ll];
-
-            /* iconv is zero when the error is smaller than a bound */
-            const real iconvf = fabs(vpijd) * (distance_squared_tolerance[ll] / invdt);
-
-            if (iconvf > 1.0_real)
+            if (rattleConstraint(ll,
+                                 iatom,
+                                 constraint_distance_squared,
+                                 vp,
+                                 rij,
+                                 m2,
+                                 omega,
+                                 invmass,
+                                 distance_squared_tolerance,
+                                 scaled_lagrange_multiplier,
+                                 invdt))
             {
-                nconv           = static_cast<int>(iconvf);
-                const real fac  = omega * 2.0_real * m2[ll] / constraint_distance_squared_ll;
-                const real acor = -fac * vpijd;
-                scaled_lagrange_multiplier[ll] += acor;
-                const real xh = rijx * acor;
-                const real yh = rijy * acor;
-                const real zh = rijz * acor;
-
-                const real im = invmass[i];
-                const real jm = invmass[j];
-
-                vp[i][XX] += xh * im;
-                vp[i][YY] += yh * im;
-                vp[i][ZZ] += zh * im;
-                vp[j][XX] -= xh * jm;
-                vp[j][YY] -= yh * jm;
-                vp[j][ZZ] -= zh * jm;
+                isConverged = false;
             }
         }
     }
     *nnit   = nit;
-    *nerror = error;
+    *nerror = 0;
 }
 
-//! Applies SHAKE
-static int vec_shakef(FILE*                     fplog,
-                      shakedata*                shaked,
-                      ArrayRef<const real>      invmass,
-                      int                       ncon,
-                      ArrayRef<const t_iparams> ip,
-                      const int*                iatom,
-                      real                      tol,
-                      ArrayRef<const RVec>      x,
-                      ArrayRef<RVec>            prime,
-                      const t_pbc*              pbc,
-                      real                      omega,
-                      bool                      bFEP,
-                      real                      lambda,
-                      ArrayRef<real>            scaled_lagrange_multiplier,
-                      real                      invdt,
-                      ArrayRef<RVec>            v,
-                      bool                      bCalcVir,
-                      tensor                    vir_r_m_dr,
-                      ConstraintVariable        econq)
+/*! \brief Sets the reference data for constraints \p c0 to \p c1
+ *
+ * All arrays are indexed with the constraint index.
+ */
+static void setShakeConstraintData(int                       c0,
+                                   int                       c1,
+                                   ArrayRef<const real>      invmass,
+                                   ArrayRef<const t_iparams> ip,
+                                   const int*                iatom,
+                                   real                      tol,
+                                   ArrayRef<const RVec>      x,
+                                   const t_pbc*              pbc,
+                                   bool                      bFEP,
+                                   real                      lambda,
+                                   ArrayRef<RVec>            rij,
+                                   ArrayRef<real>            half_of_reduced_mass,
+                                   ArrayRef<real>            distance_squared_tolerance,
+                                   ArrayRef<real>            constraint_distance_squared)
 {
-    int  maxnit = 1000;
-    int  nit    = 0, ll, i, j, d, d2, type;
-    real L1;
-    int  error = 0;
-    real constraint_distance;
-
-    shaked->rij.resize(ncon);
-    shaked->half_of_reduced_mass.resize(ncon);
-    shaked->distance_squared_tolerance.resize(ncon);
-    shaked->constraint_distance_squared.resize(ncon);
-
-    ArrayRef<RVec> rij                         = shaked->rij;
-    ArrayRef<real> half_of_reduced_mass        = shaked->half_of_reduced_mass;
-    ArrayRef<real> distance_squared_tolerance  = shaked->distance_squared_tolerance;
-    ArrayRef<real> constraint_distance_squared = shaked->constraint_distance_squared;
-
-    L1            = 1.0_real - lambda;
-    const int* ia = iatom;
-    for (ll = 0; (ll < ncon); ll++, ia += 3)
+    const real L1 = 1.0_real - lambda;
+    for (int ll = c0; ll < c1; ll++)
     {
-        type = ia[0];
-        i    = ia[1];
-        j    = ia[2];
+        const int* ia   = iatom + 3 * ll;
+        const int  type = ia[0];
+        const int  i    = ia[1];
+        const int  j    = ia[2];
 
         if (pbc)
         {
@@ -493,6 +790,7 @@ static int vec_shakef(FILE*                     fplog,
         }
         const real mm            = 2.0_real * (invmass[i] + invmass[j]);
         half_of_reduced_mass[ll] = 1.0_real / mm;
+        real constraint_distance;
         if (bFEP)
         {
             constraint_distance = L1 * ip[type].constr.dA + lambda * ip[type].constr.dB;
@@ -504,54 +802,39 @@ static int vec_shakef(FILE*                     fplog,
         constraint_distance_squared[ll] = gmx::square(constraint_distance);
         distance_squared_tolerance[ll]  = 0.5 / (constraint_distance_squared[ll] * tol);
     }
+}
 
-    switch (econq)
+/*! \brief Returns \p nit, or zero when SHAKE did not converge or the input was malformed
+ *
+ * Does not report, so it can be called from any thread. Failures should
+ * be reported with reportShakeFailure().
+ */
+static int checkShakeConvergence(int nit, int maxnit, int error)
+{
+    if (nit >= maxnit || error != 0)
     {
-        case ConstraintVariable::Positions:
-            cshake(iatom,
-                   ncon,
-                   &nit,
-                   maxnit,
-                   constraint_distance_squared,
-                   prime,
-                   pbc,
-                   rij,
-                   half_of_reduced_mass,
-                   omega,
-                   invmass,
-                   distance_squared_tolerance,
-                   scaled_lagrange_multiplier,
-                   &error);
-            break;
-        case ConstraintVariable::Velocities:
-            crattle(iatom,
-                    ncon,
-                    &nit,
-                    maxnit,
-                    constraint_distance_squared,
-                    prime,
-                    rij,
-                    half_of_reduced_mass,
-                    omega,
-                    invmass,
-                    distance_squared_tolerance,
-                    scaled_lagrange_multiplier,
-                    &error,
-                    invdt);
-            break;
-        default: gmx_incons("Unknown constraint quantity for SHAKE");
+        nit = 0;
     }
 
-    if (nit >= maxnit)
+    return nit;
+}
+
+/*! \brief Reports a SHAKE failure for the block with constraints \p iatom
+ *
+ * \p error is the error code returned for the block, zero when SHAKE did
+ * not converge within \p maxnit iterations.
+ */
+static void reportShakeFailure(FILE* fplog, int maxnit, int error, const int* iatom)
+{
+    if (error == 0)
     {
         if (fplog)
         {
             fprintf(fplog, "Shake did not converge in %d steps\n", maxnit);
         }
         fprintf(stderr, "Shake did not converge in %d steps\n", maxnit);
-        nit = 0;
     }
-    else if (error != 0)
+    else
     {
         if (fplog)
         {
@@ -568,29 +851,47 @@ static int vec_shakef(FILE*                     fplog,
                 error - 1,
                 iatom[3 * (error - 1) + 1] + 1,
                 iatom[3 * (error - 1) + 2] + 1);
-        nit = 0;
     }
+}
 
-    /* Constraint virial and correct the Lagrange multipliers for the length */
-
-    ia = iatom;
-
-    for (ll = 0; (ll < ncon); ll++, ia += 3)
+/*! \brief Corrects the velocities, computes the constraint virial and corrects
+ * the Lagrange multipliers for the length, for constraints \p c0 to \p c1
+ *
+ * All arrays are indexed with the constraint index.
+ */
+static void finishShakeConstraints(int                       c0,
+                                   int                       c1,
+                                   ArrayRef<const real>      invmass,
+                                   ArrayRef<const t_iparams> ip,
+                                   const int*                iatom,
+                                   bool                      bFEP,
+                                   real                      lambda,
+                                   ArrayRef<const RVec>      rij,
+                                   ArrayRef<real>            scaled_lagrange_multiplier,
+                                   real                      invdt,
+                                   ArrayRef<RVec>            v,
+                                   bool                      bCalcVir,
+                                   tensor                    vir_r_m_dr,
+                                   ConstraintVariable        econq)
+{
+    const real L1 = 1.0_real - lambda;
+    for (int ll = c0; ll < c1; ll++)
     {
-        type = ia[0];
-        i    = ia[1];
-        j    = ia[2];
+        const int* ia   = iatom + 3 * ll;
+        const int  type = ia[0];
+        const int  i    = ia[1];
+        const int  j    = ia[2];
 
         if ((econq == ConstraintVariable::Positions) && !v.empty())
         {
             /* Correct the velocities */
             real mm = scaled_lagrange_multiplier[ll] * invmass[i] * invdt;
-            for (d = 0; d < DIM; d++)
+            for (int d = 0; d < DIM; d++)
             {
                 v[ia[1]][d] += mm * rij[ll][d];
             }
             mm = scaled_lagrange_multiplier[ll] * invmass[j] * invdt;
-            for (d = 0; d < DIM; d++)
+            for (int d = 0; d < DIM; d++)
             {
                 v[ia[2]][d] -= mm * rij[ll][d];
             }
@@ -601,10 +902,10 @@ static int vec_shakef(FILE*                     fplog,
         if (bCalcVir)
         {
             const real mm = scaled_lagrange_multiplier[ll];
-            for (d = 0; d < DIM; d++)
+            for (int d = 0; d < DIM; d++)
             {
                 const real tmp = mm * rij[ll][d];
-                for (d2 = 0; d2 < DIM; d2++)
+                for (int d2 = 0; d2 < DIM; d2++)
                 {
                     vir_r_m_dr[d][d2] -= tmp * rij[ll][d2];
                 }
@@ -614,6 +915,7 @@ static int vec_shakef(FILE*                     fplog,
 
         /* cshake and crattle produce Lagrange multipliers scaled by
            the reciprocal of the constraint length, so fix that */
+        real constraint_distance;
         if (bFEP)
         {
             constraint_distance = L1 * ip[type].constr.dA + lambda * ip[type].constr.dB;
@@ -624,10 +926,341 @@ static int vec_shakef(FILE*                     fplog,
         }
         scaled_lagrange_multiplier[ll] *= constraint_distance;
     }
+}
+
+//! The maximum number of SHAKE iterations
+static constexpr int c_shakeMaxNumIterations = 1000;
+
+/*! \brief Applies SHAKE to the block with constraints \p c0 to \p c0 + \p ncon
+ *
+ * The per-constraint arrays in \p shaked and \p scaled_lagrange_multiplier
+ * are indexed with the global constraint index, \p iatom points to the start
+ * of the constraint list.
+ *
+ * \returns the number of iterations, or zero when SHAKE failed, in which
+ * case \p error returns the error code for reportShakeFailure().
+ */
+static int vec_shakef(shakedata*                shaked,
+                      ArrayRef<const real>      invmass,
+                      int                       c0,
+                      int                       ncon,
+                      ArrayRef<const t_iparams> ip,
+                      const int*                iatom,
+                      real                      tol,
+                      ArrayRef<const RVec>      x,
+                      ArrayRef<RVec>            prime,
+                      const t_pbc*              pbc,
+                      real                      omega,
+                      bool                      bFEP,
+                      real                      lambda,
+                      ArrayRef<real>            scaled_lagrange_multiplier,
+                      real                      invdt,
+                      ArrayRef<RVec>            v,
+                      bool                      bCalcVir,
+                      tensor                    vir_r_m_dr,
+                      ConstraintVariable        econq,
+                      int*                      error)
+{
+    int nit = 0;
+    *error  = 0;
+
+    setShakeConstraintData(c0,
+                           c0 + ncon,
+                           invmass,
+                           ip,
+                           iatom,
+                           tol,
+                           x,
+                           pbc,
+                           bFEP,
+                           lambda,
+                           shaked->rij,
+                           shaked->half_of_reduced_mass,
+                           shaked->distance_squared_tolerance,
+                           shaked->constraint_distance_squared);
+
+    const int*           blockIatom = iatom + 3 * c0;
+    ArrayRef<const RVec> rij        = makeConstArrayRef(shaked->rij).subArray(c0, ncon);
+    ArrayRef<const real> half_of_reduced_mass =
+            makeConstArrayRef(shaked->half_of_reduced_mass).subArray(c0, ncon);
+    ArrayRef<const real> distance_squared_tolerance =
+            makeConstArrayRef(shaked->distance_squared_tolerance).subArray(c0, ncon);
+    ArrayRef<const real> constraint_distance_squared =
+            makeConstArrayRef(shaked->constraint_distance_squared).subArray(c0, ncon);
+    ArrayRef<real> blockLagrangeMultiplier = scaled_lagrange_multiplier.subArray(c0, ncon);
+
+    switch (econq)
+    {
+        case ConstraintVariable::Positions:
+            cshake(blockIatom,
+                   ncon,
+                   &nit,
+                   c_shakeMaxNumIterations,
+                   constraint_distance_squared,
+                   prime,
+                   pbc,
+                   rij,
+                   half_of_reduced_mass,
+                   omega,
+                   invmass,
+                   distance_squared_tolerance,
+                   blockLagrangeMultiplier,
+                   error);
+            break;
+        case ConstraintVariable::Velocities:
+            crattle(blockIatom,
+                    ncon,
+                    &nit,
+                    c_shakeMaxNumIterations,
+                    constraint_distance_squared,
+                    prime,
+                    rij,
+                    half_of_reduced_mass,
+                    omega,
+                    invmass,
+                    distance_squared_tolerance,
+                    blockLagrangeMultiplier,
+                    error,
+                    invdt);
+            break;
+        default: gmx_incons("Unknown constraint quantity for SHAKE");
+    }
+
+    nit = checkShakeConvergence(nit, c_shakeMaxNumIterations, *error);
+
+    finishShakeConstraints(c0,
+                           c0 + ncon,
+                           invmass,
+                           ip,
+                           iatom,
+                           bFEP,
+                           lambda,
+                           shaked->rij,
+                           scaled_lagrange_multiplier,
+                           invdt,
+                           v,
+                           bCalcVir,
+                           vir_r_m_dr,
+                           econq);
 
     return nit;
 }
 
+/*! \brief Applies SHAKE to a colored block using all threads
+ *
+ * The constraints of the block are ordered by color and constraints within
+ * a color share no atoms. Each iteration is a Gauss-Seidel sweep over the colors,
+ * the constraints within a color are distributed over the threads and,
+ * for positions without PBC, processed with SIMD. The result does not depend
+ * on the number of threads.
+ *
+ * Parameters are as for vec_shakef(), \p colorStart lists the block-local start
+ * of each color. The virial contributions are added to the thread data.
+ */
+static int vec_shakef_colored(shakedata*                shaked,
+                              ArrayRef<const real>      invmass,
+                              int                       c0,
+                              int                       ncon,
+                              ArrayRef<const int>       colorStart,
+                              ArrayRef<const t_iparams> ip,
+                              const int*                iatom,
+                              real                      tol,
+                              ArrayRef<const RVec>      x,
+                              ArrayRef<RVec>            prime,
+                              const t_pbc*              pbc,
+                              real                      omega,
+                              bool                      bFEP,
+                              real                      lambda,
+                              ArrayRef<real>            scaled_lagrange_multiplier,
+                              real                      invdt,
+                              ArrayRef<RVec>            v,
+                              bool                      bCalcVir,
+                              ConstraintVariable        econq,
+                              int*                      error)
+{
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_LOADU && GMX_SIMD_HAVE_STOREU
+    constexpr int c_chunkSize = GMX_SIMD_REAL_WIDTH;
+    const bool    useSimd     = (econq == ConstraintVariable::Positions && pbc == nullptr);
+#else
+    constexpr int c_chunkSize = 4;
+#endif
+    const int numColors = colorStart.ssize() - 1;
+
+    const int*           blockIatom = iatom + 3 * c0;
+    ArrayRef<const RVec> rij        = makeConstArrayRef(shaked->rij).subArray(c0, ncon);
+    ArrayRef<const real> half_of_reduced_mass =
+            makeConstArrayRef(shaked->half_of_reduced_mass).subArray(c0, ncon);
+    ArrayRef<const real> distance_squared_tolerance =
+            makeConstArrayRef(shaked->distance_squared_tolerance).subArray(c0, ncon);
+    ArrayRef<const real> constraint_distance_squared =
+            makeConstArrayRef(shaked->constraint_distance_squared).subArray(c0, ncon);
+    ArrayRef<real> blockLagrangeMultiplier = scaled_lagrange_multiplier.subArray(c0, ncon);
+
+    int nit = c_shakeMaxNumIterations;
+    *error  = 0;
+    /* We alternate between two sets of flags, so the flags for the next iteration
+     * can be reset while other threads might still read the flags of this iteration.
+     */
+    int notConverged[2]   = { 1, 1 };
+    int iterationError[2] = { 0, 0 };
+
+#pragma omp parallel num_threads(shaked->numThreads)
+    {
+        const int thread = gmx_omp_get_thread_num();
+
+#pragma omp for schedule(static)
+        for (int ll = c0; ll < c0 + ncon; ll++)
+        {
+            setShakeConstraintData(ll,
+                                   ll + 1,
+                                   invmass,
+                                   ip,
+                                   iatom,
+                                   tol,
+                                   x,
+                                   pbc,
+                                   bFEP,
+                                   lambda,
+                                   shaked->rij,
+                                   shaked->half_of_reduced_mass,
+                                   shaked->distance_squared_tolerance,
+                                   shaked->constraint_distance_squared);
+        }
+
+        for (int iter = 0; iter < c_shakeMaxNumIterations; iter++)
+        {
+#pragma omp single
+            {
+                notConverged[iter % 2]   = 0;
+                iterationError[iter % 2] = 0;
+            }
+
+            bool threadNotConverged = false;
+            int  threadError        = 0;
+            for (int color = 0; color < numColors; color++)
+            {
+                const int colorBegin = colorStart[color];
+                const int colorEnd   = colorStart[color + 1];
+                const int numChunks  = (colorEnd - colorBegin + c_chunkSize - 1) / c_chunkSize;
+#pragma omp for schedule(static)
+                for (int chunk = 0; chunk < numChunks; chunk++)
+                {
+                    const int chunkBegin = colorBegin + chunk * c_chunkSize;
+                    const int chunkEnd   = std::min(chunkBegin + c_chunkSize, colorEnd);
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_LOADU && GMX_SIMD_HAVE_STOREU
+                    if (useSimd && chunkEnd - chunkBegin == c_chunkSize)
+                    {
+                        threadNotConverged = shakeConstraintsSimd(chunkBegin,
+                                                                  blockIatom,
+                                                                  constraint_distance_squared,
+                                                                  prime,
+                                                                  rij,
+                                                                  half_of_reduced_mass,
+                                                                  omega,
+                                                                  invmass,
+                                                                  distance_squared_tolerance,
+                                                                  blockLagrangeMultiplier,
+                                                                  &threadError)
+                                             || threadNotConverged;
+                        continue;
+                    }
+#endif
+                    for (int ll = chunkBegin; ll < chunkEnd; ll++)
+                    {
+                        bool constraintNotConverged;
+                        if (econq == ConstraintVariable::Positions)
+                        {
+                            int constraintError    = 0;
+                            constraintNotConverged = shakeConstraint(ll,
+                                                                     blockIatom,
+                                                                     constraint_distance_squared,
+                                                                     prime,
+                                                                     pbc,
+                                                                     rij,
+                                                                     half_of_reduced_mass,
+                                                                     omega,
+                                                                     invmass,
+                                                                     distance_squared_tolerance,
+                                                                     blockLagrangeMultiplier,
+                                                                     &constraintError);
+                            if (threadError == 0)
+                            {
+                                threadError = constraintError;
+                            }
+                        }
+                        else
+                        {
+                            constraintNotConverged = rattleConstraint(ll,
+                                                                      blockIatom,
+                                                                      constraint_distance_squared,
+                                                                      prime,
+                                                                      rij,
+                                                                      half_of_reduced_mass,
+                                                                      omega,
+                                                                      invmass,
+                                                                      distance_squared_tolerance,
+                                                                      blockLagrangeMultiplier,
+                                                                      invdt);
+                        }
+                        threadNotConverged = threadNotConverged || constraintNotConverged;
+                    }
+                }
+            }
+
+            if (threadNotConverged)
+            {
+#pragma omp atomic write
+                notConverged[iter % 2] = 1;
+            }
+            if (threadError != 0)
+            {
+#pragma omp critical
+                {
+                    if (iterationError[iter % 2] == 0 || threadError < iterationError[iter % 2])
+                    {
+                        iterationError[iter % 2] = threadError;
+                    }
+                }
+            }
+#pragma omp barrier
+            if (notConverged[iter % 2] == 0 || iterationError[iter % 2] != 0)
+            {
+                if (thread == 0)
+                {
+                    nit    = iter + 1;
+                    *error = iterationError[iter % 2];
+                }
+                break;
+            }
+        }
+
+        ShakeThreadData& threadData = shaked->threadData[thread];
+        for (int color = 0; color < numColors; color++)
+        {
+#pragma omp for schedule(static)
+            for (int ll = c0 + colorStart[color]; ll < c0 + colorStart[color + 1]; ll++)
+            {
+                finishShakeConstraints(ll,
+                                       ll + 1,
+                                       invmass,
+                                       ip,
+                                       iatom,
+                                       bFEP,
+                                       lambda,
+                                       shaked->rij,
+                                       scaled_lagrange_multiplier,
+                                       invdt,
+                                       v,
+                                       bCalcVir,
+                                       threadData.virial,
+                                       econq);
+            }
+        }
+    }
+
+    return checkShakeConvergence(nit, c_shakeMaxNumIterations, *error);
+}
+
 //! Check that constraints are satisfied.
 static void check_cons(FILE*                     log,
                        int                       nc,
@@ -679,9 +1312,9 @@ static void check_cons(FILE*                     log,
                 break;
             case ConstraintVariable::Velocities:
                 rvec_sub(v[ai], v[aj], dv);
-                d = iprod(dx, dv);
+                d = ::iprod(dx, dv);
                 rvec_sub(prime[ai], prime[aj], dv);
-                dp = iprod(dx, dv);
+                dp = ::iprod(dx, dv);
                 fprintf(log,
                         "%5d  %5.2f  %5d  %5.2f  %10.5f  %10.5f  %10.5f\n",
                         ai + 1,
@@ -717,7 +1350,7 @@ static bool bshakef(FILE*                         log,
                     ConstraintVariable            econq)
 {
     real dt_2, dvdl;
-    int  i, n0, ncon, blen, type, ll;
+    int  ncon, type, ll;
     int  tnit = 0, trij = 0;
 
     ncon = idef.il[F_CONSTR].size() / 3;
@@ -727,50 +1360,136 @@ static bool bshakef(FILE*                         log,
         shaked->scaled_lagrange_multiplier[ll] = 0;
     }
 
-    // TODO Rewrite this block so that it is obvious that i, iatoms
-    // and lam are all iteration variables. Is this easier if the
-    // sblock data structure is organized differently?
-    const int*     iatoms = &(idef.il[F_CONSTR].iatoms[shaked->sblock[0]]);
-    ArrayRef<real> lam    = shaked->scaled_lagrange_multiplier;
-    for (i = 0; (i < shaked->numShakeBlocks());)
-    {
-        blen = (shaked->sblock[i + 1] - shaked->sblock[i]);
-        blen /= 3;
-        n0 = vec_shakef(log,
-                        shaked,
-                        invmass,
-                        blen,
-                        idef.iparams,
-                        iatoms,
-                        ir.shake_tol,
-                        x_s,
-                        prime,
-                        pbc,
-                        shaked->omega,
-                        ir.efep != FreeEnergyPerturbationType::No,
-                        lambda,
-                        lam,
-                        invdt,
-                        v,
-                        bCalcVir,
-                        vir_r_m_dr,
-                        econq);
+    const int*     iatoms     = idef.il[F_CONSTR].iatoms.data();
+    ArrayRef<real> lam        = shaked->scaled_lagrange_multiplier;
+    const bool     bFEP       = (ir.efep != FreeEnergyPerturbationType::No);
+    const int      numThreads = shaked->numThreads;
 
-        if (n0 == 0)
+    /* The blocks are independent, so each thread handles its own range of blocks */
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        try
         {
-            if (bDumpOnError && log)
+            ShakeThreadData& threadData = shaked->threadData[thread];
+            clear_mat(threadData.virial);
+            threadData.numIterations  = 0;
+            threadData.numConstraints = 0;
+            threadData.failedBlock      = -1;
+            threadData.failedBlockError = 0;
+            for (int b = shaked->threadBlockRange[thread];
+                 b < shaked->threadBlockRange[thread + 1] && threadData.failedBlock < 0;
+                 b++)
             {
+                if (!shaked->blockColorStart[b].empty())
                 {
-                    check_cons(log, blen, x_s, prime, v, pbc, idef.iparams, iatoms, invmass, econq);
+                    continue;
                 }
+                const int c0    = shaked->sblock[b] / 3;
+                const int blen  = shaked->sblock[b + 1] / 3 - c0;
+                int       error = 0;
+                const int n0    = vec_shakef(shaked,
+                                             invmass,
+                                             c0,
+                                             blen,
+                                             idef.iparams,
+                                             iatoms,
+                                             ir.shake_tol,
+                                             x_s,
+                                             prime,
+                                             pbc,
+                                             shaked->omega,
+                                             bFEP,
+                                             lambda,
+                                             lam,
+                                             invdt,
+                                             v,
+                                             bCalcVir,
+                                             threadData.virial,
+                                             econq,
+                                             &error);
+                if (n0 == 0)
+                {
+                    threadData.failedBlock      = b;
+                    threadData.failedBlockError = error;
+                }
+                threadData.numIterations += n0 * blen;
+                threadData.numConstraints += blen;
             }
-            return FALSE;
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    /* Blocks that are too large for a single thread are iterated by all threads together */
+    int failedBlock      = -1;
+    int failedBlockError = 0;
+    for (int b = 0; b < shaked->numShakeBlocks() && failedBlock < 0; b++)
+    {
+        if (shaked->blockColorStart[b].empty())
+        {
+            continue;
+        }
+        const int c0    = shaked->sblock[b] / 3;
+        const int blen  = shaked->sblock[b + 1] / 3 - c0;
+        int       error = 0;
+        const int n0    = vec_shakef_colored(shaked,
+                                             invmass,
+                                             c0,
+                                             blen,
+                                             shaked->blockColorStart[b],
+                                             idef.iparams,
+                                             iatoms,
+                                             ir.shake_tol,
+                                             x_s,
+                                             prime,
+                                             pbc,
+                                             shaked->omega,
+                                             bFEP,
+                                             lambda,
+                                             lam,
+                                             invdt,
+                                             v,
+                                             bCalcVir,
+                                             econq,
+                                             &error);
+        if (n0 == 0)
+        {
+            failedBlock      = b;
+            failedBlockError = error;
         }
         tnit += n0 * blen;
         trij += blen;
-        iatoms += 3 * blen; /* Increment pointer! */
-        lam = lam.subArray(blen, lam.ssize() - blen);
-        i++;
+    }
+
+    /* Reduce the thread output in a fixed order for reproducibility */
+    for (const ShakeThreadData& threadData : shaked->threadData)
+    {
+        if (threadData.failedBlock >= 0
+            && (failedBlock < 0 || threadData.failedBlock < failedBlock))
+        {
+            failedBlock      = threadData.failedBlock;
+            failedBlockError = threadData.failedBlockError;
+        }
+        tnit += threadData.numIterations;
+        trij += threadData.numConstraints;
+        if (bCalcVir)
+        {
+            m_add(vir_r_m_dr, threadData.virial, vir_r_m_dr);
+        }
+    }
+
+    if (failedBlock >= 0)
+    {
+        /* Report only the first failed block, from the master thread */
+        const int blockStart = shaked->sblock[failedBlock];
+        reportShakeFailure(log, c_shakeMaxNumIterations, failedBlockError, iatoms + blockStart);
+        if (bDumpOnError && log)
+        {
+            const int blen = (shaked->sblock[failedBlock + 1] - blockStart) / 3;
+            check_cons(
+                    log, blen, x_s, prime, v, pbc, idef.iparams, iatoms + blockStart, invmass, econq);
+        }
+        return FALSE;
     }
     /* only for position part? */
     if (econq == ConstraintVariable::Positions)
@@ -62,6 +62,23 @@ class ArrayRef;
 
 enum class ConstraintVariable : int;
 
+/*! \libinternal
+ * \brief Output of one thread of the threaded SHAKE block loop
+ */
+struct ShakeThreadData
+{
+    //! The constraint virial contribution of this thread
+    tensor virial = { { 0 } };
+    //! The number of iterations summed over the constraints handled
+    int numIterations = 0;
+    //! The number of constraints handled
+    int numConstraints = 0;
+    //! The first block for which SHAKE failed, -1 when all blocks converged
+    int failedBlock = -1;
+    //! The error code for \p failedBlock, 0 when SHAKE did not converge
+    int failedBlockError = 0;
+};
+
 /*! \libinternal
  * \brief Working data for the SHAKE algorithm
  */
@@ -92,6 +109,20 @@ struct shakedata
      * Value is -2 * eta from p. 336 of the paper, divided by the
      * constraint distance. */
     std::vector<real> scaled_lagrange_multiplier;
+    //! The number of OpenMP threads to use
+    int numThreads = 1;
+    //! Thread t handles the SHAKE blocks threadBlockRange[t] to threadBlockRange[t+1]
+    std::vector<int> threadBlockRange;
+    //! Output of the threaded block loop, per thread
+    std::vector<ShakeThreadData> threadData;
+    /*! \brief For each SHAKE block, the start of the colors as block-local constraint indices
+     *
+     * Blocks that are too large for a balanced distribution over the threads
+     * have their constraints ordered by color, constraints with the same color
+     * share no atoms. Such a block is iterated by all threads together, one color
+     * after the other. The list is empty for blocks handled by a single thread.
+     */
+    std::vector<std::vector<int>> blockColorStart;
 };
 
 //! Make SHAKE blocks when not using DD.
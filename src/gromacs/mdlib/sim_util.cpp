@@ -1547,6 +1547,18 @@ void do_force(FILE*                               fplog,
                                  stepWork);
     }
 
+    /* With non-bonded interactions computed on the CPU, we overlap the first
+     * coordinate halo pulse with the local non-bonded work and the first
+     * force halo pulse with the long-range and special force work, which
+     * only act on home atoms.
+     */
+    const bool overlapCpuHaloCommunication =
+            (havePPDomainDecomposition(cr) && ddOverlapsCpuHaloCommunication(*cr->dd)
+             && !simulationWork.useGpuNonbonded && !fr->nbv->emulateGpu());
+    const bool overlapCoordinateHalo = (overlapCpuHaloCommunication && !stepWork.doNeighborSearch);
+    const bool overlapForceHalo =
+            (overlapCpuHaloCommunication && stepWork.computeForces && !simulationWork.useMts);
+
     /* Communicate coordinates and sum dipole if necessary +
        do non-local pair search */
     if (havePPDomainDecomposition(cr))
@@ -1593,7 +1605,14 @@ void do_force(FILE*                               fplog,
                                "a wait should only be triggered if copy has been scheduled");
                     stateGpu->waitCoordinatesReadyOnHost(AtomLocality::Local);
                 }
-                dd_move_x(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                if (overlapCoordinateHalo)
+                {
+                    dd_move_x_start(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                }
+                else
+                {
+                    dd_move_x(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                }
             }
 
             if (stepWork.useGpuXBufferOps)
@@ -1607,7 +1626,7 @@ void do_force(FILE*                               fplog,
                                            stateGpu->getCoordinatesReadyOnDeviceEvent(
                                                    AtomLocality::NonLocal, simulationWork, stepWork));
             }
-            else
+            else if (!overlapCoordinateHalo)
             {
                 nbv->convertCoordinates(AtomLocality::NonLocal, x.unpaddedArrayRef());
             }
@@ -1777,6 +1796,15 @@ void do_force(FILE*                               fplog,
         do_nb_verlet(fr, ic, enerd, stepWork, InteractionLocality::Local, enbvClearFYes, step, nrnb, wcycle);
     }
 
+    if (overlapCoordinateHalo)
+    {
+        /* Complete the coordinate communication, which overlapped with the local non-bonded work */
+        wallcycle_stop(wcycle, WallCycleCounter::Force);
+        dd_move_x_finish(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+        nbv->convertCoordinates(AtomLocality::NonLocal, x.unpaddedArrayRef());
+        wallcycle_start_nocount(wcycle, WallCycleCounter::Force);
+    }
+
     if (fr->efep != FreeEnergyPerturbationType::No && stepWork.computeNonbondedForces)
     {
         /* Calculate the local and non-local free energy interactions here.
@@ -1930,6 +1958,7 @@ void do_force(FILE*                               fplog,
                                    inputrec.fepvals.get(),
                                    cr,
                                    ms,
+                                   step,
                                    x,
                                    xWholeMolecules,
                                    fr->fcdata.get(),
@@ -1946,6 +1975,17 @@ void do_force(FILE*                               fplog,
         }
     }
 
+    if (overlapForceHalo)
+    {
+        /* All contributions to the non-local forces have been computed,
+         * so we can start communicating them. The communication is
+         * completed by dd_move_f_finish() below.
+         */
+        wallcycle_stop(wcycle, WallCycleCounter::Force);
+        dd_move_f_start(cr->dd, &forceOutMtsLevel0.forceWithShiftForces(), wcycle);
+        wallcycle_start_nocount(wcycle, WallCycleCounter::Force);
+    }
+
     if (stepWork.computeSlowForces)
     {
         calculateLongRangeNonbondeds(fr,
@@ -2121,7 +2161,11 @@ void do_force(FILE*                               fplog,
 
                 // Without MTS or with MTS at slow steps with uncombined forces we need to
                 // communicate the fast forces
-                if (!simulationWork.useMts || !stepWork.combineMtsForcesBeforeHaloExchange)
+                if (overlapForceHalo)
+                {
+                    dd_move_f_finish(cr->dd, &forceOutMtsLevel0.forceWithShiftForces(), wcycle);
+                }
+                else if (!simulationWork.useMts || !stepWork.combineMtsForcesBeforeHaloExchange)
                 {
                     dd_move_f(cr->dd, &forceOutMtsLevel0.forceWithShiftForces(), wcycle);
                 }
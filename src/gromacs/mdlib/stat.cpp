@@ -59,26 +59,49 @@
 #include "gromacs/mdtypes/group.h"
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/timing/timelinetracer.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/smalloc.h"
 
+//! The force terms that are summed by global_stat_start_force_terms()
+struct GlobalForceTermsSum
+{
+    //! Buffer for the data to sum
+    t_bin* rb = nullptr;
+    //! The request for the non-blocking summation
+    MPI_Request request;
+    //! Whether summation has been started, but global_stat() has not been called yet
+    bool isInFlight = false;
+    //! Whether the potential energy terms are summed
+    bool haveEnergies = false;
+    //! The number of energy terms summed
+    int nener = 0;
+    //! Index of the force virial in the buffer
+    int ifv = 0;
+    //! Index of the energy terms in the buffer
+    int ie = 0;
+    //! Indices of the energy group pair terms in the buffer
+    gmx::EnumerationArray<NonBondedEnergyTerms, int> inn;
+};
+
 typedef struct gmx_global_stat
 {
     t_bin* rb;
     int*   itc0;
     int*   itc1;
+    //! The force terms summed ahead of global_stat()
+    GlobalForceTermsSum forceTerms;
 } t_gmx_global_stat;
 
 gmx_global_stat_t global_stat_init(const t_inputrec* ir)
 {
-    gmx_global_stat_t gs;
-
-    snew(gs, 1);
+    gmx_global_stat_t gs = new gmx_global_stat;
 
     gs->rb = mk_bin();
     snew(gs->itc0, ir->opts.ngtc);
     snew(gs->itc1, ir->opts.ngtc);
+    gs->forceTerms.rb = mk_bin();
 
     return gs;
 }
@@ -88,10 +111,23 @@ void global_stat_destroy(gmx_global_stat_t gs)
     destroy_bin(gs->rb);
     sfree(gs->itc0);
     sfree(gs->itc1);
-    sfree(gs);
+    destroy_bin(gs->forceTerms.rb);
+    delete gs;
 }
 
-static int filter_enerdterm(const real* afrom, gmx_bool bToBuffer, real* ato, gmx_bool bTemp, gmx_bool bPres, gmx_bool bEner)
+/*! \brief Copies energy terms to or from a buffer for summation
+ *
+ * The potential energy terms are the terms computed in the force
+ * calculation, these are selected by \p bPotential. The other terms
+ * that are not kinetic or pressure terms are selected by \p bEner.
+ */
+static int filter_enerdterm(const real* afrom,
+                            gmx_bool    bToBuffer,
+                            real*       ato,
+                            gmx_bool    bTemp,
+                            gmx_bool    bPres,
+                            gmx_bool    bEner,
+                            gmx_bool    bPotential)
 {
     int i, to, from;
 
@@ -129,30 +165,100 @@ static int filter_enerdterm(const real* afrom, gmx_bool bToBuffer, real* ato, gm
                 // Don't reduce total and conserved energy
                 // because they are computed later (see #4301)
                 break;
-            default:
+            case F_DVDL_CONSTR:
+                // Computed after the force calculation in update/constraints
                 if (bEner)
                 {
                     ato[to++] = afrom[from++];
                 }
                 break;
+            default:
+                if (bPotential)
+                {
+                    ato[to++] = afrom[from++];
+                }
+                break;
         }
     }
 
     return to;
 }
 
-void global_stat(const gmx_global_stat& gs,
-                 const t_commrec*       cr,
-                 gmx_enerdata_t*        enerd,
-                 tensor                 fvir,
-                 tensor                 svir,
-                 const t_inputrec&      inputrec,
-                 gmx_ekindata_t*        ekind,
-                 gmx::ArrayRef<real>    constraintsRmsdData,
-                 t_vcm*                 vcm,
-                 gmx::ArrayRef<real>    sig,
-                 bool                   bSumEkinhOld,
-                 int                    flags)
+void global_stat_start_force_terms(gmx_global_stat*      gs,
+                                   const t_commrec*      cr,
+                                   const gmx_enerdata_t& enerd,
+                                   const tensor          fvir,
+                                   bool                  sumEnergies)
+{
+    GlobalForceTermsSum& forceTerms = gs->forceTerms;
+    GMX_RELEASE_ASSERT(!forceTerms.isInFlight,
+                       "global_stat() should be called before summing force terms again");
+
+    t_bin* rb = forceTerms.rb;
+    reset_bin(rb);
+
+    forceTerms.ifv          = add_binr(rb, DIM * DIM, fvir[0]);
+    forceTerms.haveEnergies = sumEnergies;
+    if (sumEnergies)
+    {
+        std::array<real, F_NRE> copyenerd;
+        forceTerms.nener = filter_enerdterm(
+                enerd.term.data(), TRUE, copyenerd.data(), FALSE, FALSE, FALSE, TRUE);
+        forceTerms.ie = add_binr(rb, forceTerms.nener, copyenerd.data());
+        for (auto key : gmx::keysOf(forceTerms.inn))
+        {
+            forceTerms.inn[key] =
+                    add_binr(rb, enerd.grpp.nener, enerd.grpp.energyGroupPairTerms[key].data());
+        }
+    }
+
+    sum_bin_start(rb, cr, &forceTerms.request);
+    forceTerms.isInFlight = true;
+}
+
+//! Completes the summation started by global_stat_start_force_terms() and extracts the data
+static void finish_force_terms(GlobalForceTermsSum* forceTerms,
+                               const t_commrec*     cr,
+                               gmx_enerdata_t*      enerd,
+                               tensor               fvir)
+{
+    t_bin* rb = forceTerms->rb;
+
+    {
+        gmx::TimelineEventScope timelineEvent(cr->dd ? cr->dd->timelineTracer.get() : nullptr,
+                                              gmx::TimelineEventType::GlobalReduction);
+        sum_bin_finish(rb, cr, &forceTerms->request);
+    }
+    forceTerms->isInFlight = false;
+
+    extract_binr(rb, forceTerms->ifv, DIM * DIM, fvir[0]);
+    if (forceTerms->haveEnergies)
+    {
+        std::array<real, F_NRE> copyenerd;
+        extract_binr(rb, forceTerms->ie, forceTerms->nener, copyenerd.data());
+        for (auto key : gmx::keysOf(forceTerms->inn))
+        {
+            extract_binr(rb,
+                         forceTerms->inn[key],
+                         enerd->grpp.nener,
+                         enerd->grpp.energyGroupPairTerms[key].data());
+        }
+        filter_enerdterm(copyenerd.data(), FALSE, enerd->term.data(), FALSE, FALSE, FALSE, TRUE);
+    }
+}
+
+void global_stat(gmx_global_stat&    gs,
+                 const t_commrec*    cr,
+                 gmx_enerdata_t*     enerd,
+                 tensor              fvir,
+                 tensor              svir,
+                 const t_inputrec&   inputrec,
+                 gmx_ekindata_t*     ekind,
+                 gmx::ArrayRef<real> constraintsRmsdData,
+                 t_vcm*              vcm,
+                 gmx::ArrayRef<real> sig,
+                 bool                bSumEkinhOld,
+                 int                 flags)
 /* instead of current system, gmx_booleans for summing virial, kinetic energy, and other terms */
 {
     int ie = 0, ifv = 0, isv = 0, irmsd = 0;
@@ -174,6 +280,14 @@ void global_stat(const gmx_global_stat& gs,
     int*   itc0 = gs.itc0;
     int*   itc1 = gs.itc1;
 
+    /* The force virial and potential energies might already be in flight */
+    const bool haveForceTermsInFlight = gs.forceTerms.isInFlight;
+    const bool sumForceVirial         = (bPres && !haveForceTermsInFlight);
+    const bool sumPotentialEnergies =
+            (bEner && !(haveForceTermsInFlight && gs.forceTerms.haveEnergies));
+    GMX_RELEASE_ASSERT(!haveForceTermsInFlight || bPres,
+                       "Force terms should only be summed ahead when the pressure is computed");
+
 
     reset_bin(rb);
     /* This routine copies all the data to be summed to one big buffer
@@ -186,7 +300,8 @@ void global_stat(const gmx_global_stat& gs,
        the sums and overcounting. */
 
     std::array<real, F_NRE> copyenerd;
-    int nener = filter_enerdterm(enerd->term.data(), TRUE, copyenerd.data(), bTemp, bPres, bEner);
+    int nener = filter_enerdterm(
+            enerd->term.data(), TRUE, copyenerd.data(), bTemp, bPres, bEner, sumPotentialEnergies);
 
     /* First, the data that needs to be communicated with velocity verlet every time
        This is just the constraint virial.*/
@@ -228,7 +343,7 @@ void global_stat(const gmx_global_stat& gs,
         }
     }
 
-    if (bPres)
+    if (sumForceVirial)
     {
         ifv = add_binr(rb, DIM * DIM, fvir[0]);
     }
@@ -241,9 +356,13 @@ void global_stat(const gmx_global_stat& gs,
         {
             irmsd = add_binr(rb, 2, constraintsRmsdData.data());
         }
-        for (auto key : gmx::keysOf(inn))
+        if (sumPotentialEnergies)
         {
-            inn[key] = add_binr(rb, enerd->grpp.nener, enerd->grpp.energyGroupPairTerms[key].data());
+            for (auto key : gmx::keysOf(inn))
+            {
+                inn[key] = add_binr(
+                        rb, enerd->grpp.nener, enerd->grpp.energyGroupPairTerms[key].data());
+            }
         }
         if (inputrec.efep != FreeEnergyPerturbationType::No)
         {
@@ -284,7 +403,16 @@ void global_stat(const gmx_global_stat& gs,
         isig = add_binr(rb, sig);
     }
 
-    sum_bin(rb, cr);
+    {
+        gmx::TimelineEventScope timelineEvent(cr->dd ? cr->dd->timelineTracer.get() : nullptr,
+                                              gmx::TimelineEventType::GlobalReduction);
+        sum_bin(rb, cr);
+    }
+
+    if (haveForceTermsInFlight)
+    {
+        finish_force_terms(&gs.forceTerms, cr, enerd, fvir);
+    }
 
     /* Extract all the data locally */
 
@@ -324,7 +452,7 @@ void global_stat(const gmx_global_stat& gs,
             }
         }
     }
-    if (bPres)
+    if (sumForceVirial)
     {
         extract_binr(rb, ifv, DIM * DIM, fvir[0]);
     }
@@ -336,9 +464,15 @@ void global_stat(const gmx_global_stat& gs,
         {
             extract_binr(rb, irmsd, constraintsRmsdData);
         }
-        for (auto key : gmx::keysOf(inn))
+        if (sumPotentialEnergies)
         {
-            extract_binr(rb, inn[key], enerd->grpp.nener, enerd->grpp.energyGroupPairTerms[key].data());
+            for (auto key : gmx::keysOf(inn))
+            {
+                extract_binr(rb,
+                             inn[key],
+                             enerd->grpp.nener,
+                             enerd->grpp.energyGroupPairTerms[key].data());
+            }
         }
         if (inputrec.efep != FreeEnergyPerturbationType::No)
         {
@@ -353,7 +487,13 @@ void global_stat(const gmx_global_stat& gs,
             }
         }
 
-        filter_enerdterm(copyenerd.data(), FALSE, enerd->term.data(), bTemp, bPres, bEner);
+        filter_enerdterm(copyenerd.data(),
+                         FALSE,
+                         enerd->term.data(),
+                         bTemp,
+                         bPres,
+                         bEner,
+                         sumPotentialEnergies);
     }
 
     if (vcm)
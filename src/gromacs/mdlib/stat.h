@@ -62,19 +62,32 @@ gmx_global_stat_t global_stat_init(const t_inputrec* ir);
 
 void global_stat_destroy(gmx_global_stat_t gs);
 
+/*! \brief Start the all-reduce of the force virial and, optionally, the potential energies
+ *
+ * This can be called directly after the force calculation, so the
+ * communication overlaps with the update and constraints. The sum is
+ * completed in the next call to global_stat(), which should compute
+ * the pressure and, when \p sumEnergies is true, the energies.
+ */
+void global_stat_start_force_terms(gmx_global_stat*      gs,
+                                   const t_commrec*      cr,
+                                   const gmx_enerdata_t& enerd,
+                                   const tensor          fvir,
+                                   bool                  sumEnergies);
+
 /*! \brief All-reduce energy-like quantities over cr->mpi_comm_mysim  */
-void global_stat(const gmx_global_stat& gs,
-                 const t_commrec*       cr,
-                 gmx_enerdata_t*        enerd,
-                 tensor                 fvir,
-                 tensor                 svir,
-                 const t_inputrec&      inputrec,
-                 gmx_ekindata_t*        ekind,
-                 gmx::ArrayRef<real>    constraintsRmsdData,
-                 t_vcm*                 vcm,
-                 gmx::ArrayRef<real>    sig,
-                 bool                   bSumEkinhOld,
-                 int                    flags);
+void global_stat(gmx_global_stat&    gs,
+                 const t_commrec*    cr,
+                 gmx_enerdata_t*     enerd,
+                 tensor              fvir,
+                 tensor              svir,
+                 const t_inputrec&   inputrec,
+                 gmx_ekindata_t*     ekind,
+                 gmx::ArrayRef<real> constraintsRmsdData,
+                 t_vcm*              vcm,
+                 gmx::ArrayRef<real> sig,
+                 bool                bSumEkinhOld,
+                 int                 flags);
 
 /*! \brief Returns TRUE if io should be done */
 inline bool do_per_step(int64_t step, int64_t nstep)
@@ -602,6 +602,7 @@ TEST_P(EnergyOutputTest, CheckOutput)
                                            parameters.isRerun,
                                            StartingBehavior::NewSimulation,
                                            false,
+                                           false,
                                            mdModulesNotifiers);
 
     // Add synthetic data for a single step
@@ -49,6 +49,10 @@
 
 #include <cmath>
 
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "gromacs/mdlib/expanded_internal.h"
@@ -137,6 +141,60 @@ INSTANTIATE_TEST_CASE_P(
                 RegressionTuple{ LambdaWeightCalculation::Barker, 1.0, 1.0 / (1.0 + std::exp(1.0)) },
                 RegressionTuple{ LambdaWeightCalculation::Barker, GMX_REAL_MAX, 0.0 }));
 
+//! Test fixture accepting the number of lambda states for calculateGibbsProbabilities
+class CalculateGibbsProbabilities : public ::testing::Test, public ::testing::WithParamInterface<int>
+{
+};
+// Check that the probabilities match a straightforward evaluation
+TEST_P(CalculateGibbsProbabilities, MatchesReference)
+{
+    const int numStates = GetParam();
+
+    // Log weights spanning a range that would overflow exp() without offset
+    std::vector<real> logWeights(numStates);
+    for (int i = 0; i < numStates; i++)
+    {
+        logWeights[i] = 100 + 0.37_real * ((i * 7) % 31) - 0.05_real * i;
+    }
+    const double maxLogWeight = *std::max_element(logWeights.begin(), logWeights.end());
+
+    double referenceSum = 0;
+    for (const real logWeight : logWeights)
+    {
+        referenceSum += std::exp(logWeight - maxLogWeight);
+    }
+
+    std::vector<double> probabilities(numStates);
+    const double        logSum = calculateGibbsProbabilities(logWeights, probabilities);
+
+    FloatingPointTolerance tolerance = relativeToleranceAsFloatingPoint(1.0, 10 * GMX_DOUBLE_EPS);
+    EXPECT_DOUBLE_EQ_TOL(maxLogWeight + std::log(referenceSum), logSum, tolerance);
+    for (int i = 0; i < numStates; i++)
+    {
+        EXPECT_DOUBLE_EQ_TOL(
+                std::exp(logWeights[i] - maxLogWeight) / referenceSum, probabilities[i], tolerance);
+    }
+    EXPECT_DOUBLE_EQ_TOL(1.0,
+                         std::accumulate(probabilities.begin(), probabilities.end(), 0.0),
+                         relativeToleranceAsFloatingPoint(1.0, 10 * GMX_DOUBLE_EPS));
+}
+// Check that states with negligible weight get zero probability
+TEST(CalculateGibbsProbabilitiesUnderflow, LargeDifferencesGiveZero)
+{
+    const std::vector<real> logWeights = { 0, -1000, -2000, 0, -1000, 0, -1000, -1000, -2000 };
+    std::vector<double>     probabilities(logWeights.size());
+
+    EXPECT_REAL_EQ(std::log(3.0), calculateGibbsProbabilities(logWeights, probabilities));
+    for (size_t i = 0; i < logWeights.size(); i++)
+    {
+        EXPECT_DOUBLE_EQ(logWeights[i] == 0 ? 1.0 / 3.0 : 0.0, probabilities[i]);
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(StateCounts,
+                        CalculateGibbsProbabilities,
+                        ::testing::Values(1, 3, 8, 21, 200, 517, 1000));
+
 } // namespace
 } // namespace test
 } // namespace gmx
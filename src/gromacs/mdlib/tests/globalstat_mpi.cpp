@@ -0,0 +1,221 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for the global summation of energies and virials
+ *
+ * Checks that summing the force virial and the potential energies
+ * ahead of global_stat() gives the same results as summing them in
+ * global_stat().
+ *
+ * \ingroup module_mdlib
+ */
+
+#include "gmxpre.h"
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/md_support.h"
+#include "gromacs/mdlib/stat.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/enerdata.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/arrayref.h"
+
+#include "testutils/mpitest.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of energy groups used in the tests
+constexpr int c_numEnergyGroups = 2;
+
+//! Sets up a commrec for summing over all ranks in MPI_COMM_WORLD
+void initCommrec(t_commrec* cr)
+{
+    int rank;
+    int numRanks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &numRanks);
+
+    cr->sim_nodeid                = rank;
+    cr->nodeid                    = rank;
+    cr->nnodes                    = numRanks;
+    cr->npmenodes                 = 0;
+    cr->mpi_comm_mysim            = MPI_COMM_WORLD;
+    cr->mpi_comm_mygroup          = MPI_COMM_WORLD;
+    cr->mpiDefaultCommunicator    = MPI_COMM_WORLD;
+    cr->sizeOfDefaultCommunicator = numRanks;
+    cr->rankInDefaultCommunicator = rank;
+    cr->nc.bUse                   = FALSE;
+    cr->dd                        = nullptr;
+    cr->duty                      = (DUTY_PP | DUTY_PME);
+}
+
+//! Fills the energies and the force virial with values that differ between ranks
+void fillLocalData(int rank, gmx_enerdata_t* enerd, tensor fvir)
+{
+    for (int i = 0; i < F_NRE; i++)
+    {
+        enerd->term[i] = 10 * (rank + 1) + 0.5_real * i;
+    }
+    for (auto& terms : enerd->grpp.energyGroupPairTerms)
+    {
+        for (int i = 0; i < enerd->grpp.nener; i++)
+        {
+            terms[i] = 3 * (rank + 1) + 0.25_real * i;
+        }
+    }
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            fvir[d1][d2] = (rank + 1) * (d1 - 0.5_real * d2);
+        }
+    }
+}
+
+/*! \brief Sums with global_stat(), optionally summing the force terms ahead
+ *
+ * When \p sumForceTermsAhead is true, the local force terms are
+ * overwritten after starting their summation, to check that the
+ * values at the start are the ones that are summed.
+ */
+void sumWithGlobalStat(const t_commrec* cr,
+                       gmx_enerdata_t*  enerd,
+                       tensor           fvir,
+                       bool             sumForceTermsAhead,
+                       bool             sumEnergiesAhead)
+{
+    t_inputrec       ir;
+    gmx_global_stat* gs = global_stat_init(&ir);
+
+    fillLocalData(cr->nodeid, enerd, fvir);
+
+    if (sumForceTermsAhead)
+    {
+        global_stat_start_force_terms(gs, cr, *enerd, fvir, sumEnergiesAhead);
+
+        clear_mat(fvir);
+        if (sumEnergiesAhead)
+        {
+            enerd->term[F_LJ] = -1;
+            enerd->grpp.energyGroupPairTerms[NonBondedEnergyTerms::CoulombSR][0] = -1;
+        }
+    }
+
+    tensor svir = { { 0 } };
+    global_stat(*gs,
+                cr,
+                enerd,
+                fvir,
+                svir,
+                ir,
+                nullptr,
+                {},
+                nullptr,
+                {},
+                false,
+                CGLO_ENERGY | CGLO_PRESSURE);
+
+    global_stat_destroy(gs);
+}
+
+//! Checks that the energies and virials in \p test match those in \p reference
+void compareSums(const gmx_enerdata_t& reference,
+                 const tensor          referenceFvir,
+                 const gmx_enerdata_t& test,
+                 const tensor          testFvir)
+{
+    for (int i = 0; i < F_NRE; i++)
+    {
+        EXPECT_REAL_EQ_TOL(reference.term[i], test.term[i], defaultRealTolerance())
+                << "for energy term " << interaction_function[i].longname;
+    }
+    for (auto key : keysOf(reference.grpp.energyGroupPairTerms))
+    {
+        for (int i = 0; i < reference.grpp.nener; i++)
+        {
+            EXPECT_REAL_EQ_TOL(reference.grpp.energyGroupPairTerms[key][i],
+                               test.grpp.energyGroupPairTerms[key][i],
+                               defaultRealTolerance());
+        }
+    }
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_REAL_EQ_TOL(referenceFvir[d1][d2], testFvir[d1][d2], defaultRealTolerance());
+        }
+    }
+}
+
+TEST(GlobalStatTest, SummingForceTermsAheadGivesSameResults)
+{
+    GMX_MPI_TEST(2);
+
+    t_commrec cr;
+    initCommrec(&cr);
+
+    gmx_enerdata_t referenceEnerd(c_numEnergyGroups, 0);
+    tensor         referenceFvir;
+    sumWithGlobalStat(&cr, &referenceEnerd, referenceFvir, false, false);
+
+    // Check one summed value explicitly, the other terms are filled in the same way
+    const real expectedLJ = 10 * (1 + 2) + 2 * 0.5_real * F_LJ;
+    EXPECT_REAL_EQ_TOL(expectedLJ, referenceEnerd.term[F_LJ], defaultRealTolerance());
+
+    for (bool sumEnergiesAhead : { false, true })
+    {
+        SCOPED_TRACE(sumEnergiesAhead ? "Summing the energies ahead"
+                                      : "Summing only the virial ahead");
+
+        gmx_enerdata_t enerd(c_numEnergyGroups, 0);
+        tensor         fvir;
+        sumWithGlobalStat(&cr, &enerd, fvir, true, sumEnergiesAhead);
+
+        compareSums(referenceEnerd, referenceFvir, enerd, fvir);
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,334 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for the per-group kinetic energy and COM motion sums
+ *
+ * The sums are accumulated over runs of atoms in the same group and
+ * reduced over threads. The tests compare the sums for different
+ * numbers of threads with a straightforward per-atom sum in double
+ * precision. The group assignment mixes long runs, runs of a single
+ * atom and runs that cross the thread boundaries.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/md_support.h"
+#include "gromacs/mdlib/vcm.h"
+#include "gromacs/mdtypes/group.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of atoms, not a multiple of the number of threads
+constexpr int c_numAtoms = 1001;
+
+//! The number of temperature-coupling groups
+constexpr int c_numTCGroups = 3;
+
+//! The number of COM removal groups, the rest group comes on top
+constexpr int c_numVcmGroups = 2;
+
+//! Returns the group of \p atom out of \p numGroups, with long and short runs
+int groupOfAtom(int atom, int numGroups, int offset)
+{
+    if (atom < 400)
+    {
+        // Long runs
+        return (atom / 150 + offset) % numGroups;
+    }
+    else if (atom < 600)
+    {
+        // Runs of a single atom
+        return (atom + offset) % numGroups;
+    }
+    else
+    {
+        // Runs of varying, short length
+        return ((atom * atom) / 97 + offset) % numGroups;
+    }
+}
+
+//! Test fixture for the group sums, parametrized on the number of threads
+class GroupSumsTest : public ::testing::TestWithParam<int>
+{
+public:
+    GroupSumsTest()
+    {
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            x_.emplace_back(0.1_real * (a % 17), 1.0_real + std::sin(0.7_real * a), 0.003_real * a);
+            v_.emplace_back(
+                    std::sin(1.3_real * a), std::cos(0.9_real * a), 0.5_real - 0.001_real * a);
+            massA_.push_back(1 + a % 5);
+            // Every eleventh atom has a perturbed mass
+            bPerturbed_[a] = (a % 11 == 0);
+            massB_.push_back(bPerturbed_[a] ? 2 + a % 7 : massA_[a]);
+            massT_.push_back(0.7_real * massA_[a] + 0.3_real * massB_[a]);
+            cTC_.push_back(groupOfAtom(a, c_numTCGroups, 0));
+            // Index c_numVcmGroups is the rest group
+            cVCM_.push_back(groupOfAtom(a, c_numVcmGroups + 1, 1));
+        }
+
+        mdatoms_                = {};
+        mdatoms_.homenr         = c_numAtoms;
+        mdatoms_.nr             = c_numAtoms;
+        mdatoms_.massA          = massA_.data();
+        mdatoms_.massB          = massB_.data();
+        mdatoms_.massT          = massT_.data();
+        mdatoms_.bPerturbed     = bPerturbed_.data();
+        mdatoms_.nMassPerturbed = 1;
+        mdatoms_.cTC            = cTC_.data();
+        mdatoms_.cVCM           = cVCM_.data();
+    }
+
+    //! Checks the kinetic energy sums with \p numThreads threads
+    void checkKineticEnergy(int numThreads, bool bEkinAveVel)
+    {
+        // Reference sums in double precision
+        std::array<dvec, c_numTCGroups> refEkinDiag   = {};
+        std::array<dvec, c_numTCGroups> refEkinOffDiag = {};
+        double                          refDEkinDL    = 0;
+        double                          magnitude     = 0;
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            const int    g  = cTC_[a];
+            const double hm = 0.5 * massT_[a];
+            for (int d = 0; d < DIM; d++)
+            {
+                refEkinDiag[g][d] += hm * v_[a][d] * v_[a][d];
+            }
+            refEkinOffDiag[g][0] += hm * v_[a][XX] * v_[a][YY];
+            refEkinOffDiag[g][1] += hm * v_[a][XX] * v_[a][ZZ];
+            refEkinOffDiag[g][2] += hm * v_[a][YY] * v_[a][ZZ];
+            if (bPerturbed_[a])
+            {
+                refDEkinDL += 0.5 * (massB_[a] - massA_[a]) * norm2(v_[a]);
+            }
+            magnitude += hm * norm2(v_[a]);
+        }
+
+        t_grpopts opts;
+        opts.ngtc = c_numTCGroups;
+
+        gmx_omp_nthreads_set(ModuleMultiThread::Update, numThreads);
+        gmx_ekindata_t ekind(c_numTCGroups, 0, numThreads);
+        t_nrnb         nrnb;
+        matrix         box = { { 0 } };
+        // Call twice to check that the previous sums are cleared
+        for (int call = 0; call < 2; call++)
+        {
+            calc_ke_part(x_, v_, box, &opts, &mdatoms_, &ekind, &nrnb, bEkinAveVel);
+        }
+
+        const FloatingPointTolerance tolerance =
+                relativeToleranceAsPrecisionDependentFloatingPoint(magnitude, 1e-6, 1e-14);
+        for (int g = 0; g < c_numTCGroups; g++)
+        {
+            const t_grp_tcstat& tcstat = ekind.tcstat[g];
+            const tensor&       ekin   = (bEkinAveVel ? tcstat.ekinf : tcstat.ekinh);
+            const tensor&       unused = (bEkinAveVel ? tcstat.ekinh : tcstat.ekinf);
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(refEkinDiag[g][d], ekin[d][d], tolerance)
+                        << "for group " << g << " dimension " << d;
+                for (int e = 0; e < DIM; e++)
+                {
+                    EXPECT_EQ(ekin[d][e], ekin[e][d]) << "the tensor should be symmetric";
+                    EXPECT_EQ(0, unused[d][e]) << "the other kinetic energy should not be set";
+                }
+            }
+            EXPECT_REAL_EQ_TOL(refEkinOffDiag[g][0], ekin[XX][YY], tolerance) << "for group " << g;
+            EXPECT_REAL_EQ_TOL(refEkinOffDiag[g][1], ekin[XX][ZZ], tolerance) << "for group " << g;
+            EXPECT_REAL_EQ_TOL(refEkinOffDiag[g][2], ekin[YY][ZZ], tolerance) << "for group " << g;
+        }
+        EXPECT_REAL_EQ_TOL(refDEkinDL, ekind.dekindl, tolerance);
+    }
+
+    //! Checks the COM motion sums with \p numThreads threads
+    void checkComMotion(int numThreads, ComRemovalAlgorithm mode)
+    {
+        constexpr int c_size = c_numVcmGroups + 1;
+
+        // Reference sums in double precision
+        std::array<double, c_size> refMass   = {};
+        std::array<dvec, c_size>   refP      = {};
+        std::array<dvec, c_size>   refJ      = {};
+        std::array<dvec, c_size>   refX      = {};
+        std::array<dvec, c_size>   refIDiag  = {};
+        std::array<dvec, c_size>   refIOff   = {};
+        double                     magnitude = 0;
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            const int    g = cVCM_[a];
+            const double m = massT_[a];
+            refMass[g] += m;
+            const dvec x = { x_[a][XX], x_[a][YY], x_[a][ZZ] };
+            const dvec v = { v_[a][XX], v_[a][YY], v_[a][ZZ] };
+            dvec       j;
+            dcprod(x, v, j);
+            for (int d = 0; d < DIM; d++)
+            {
+                refP[g][d] += m * v[d];
+                refJ[g][d] += m * j[d];
+                refX[g][d] += m * x[d];
+                refIDiag[g][d] += m * x[d] * x[d];
+            }
+            refIOff[g][0] += m * x[XX] * x[YY];
+            refIOff[g][1] += m * x[XX] * x[ZZ];
+            refIOff[g][2] += m * x[YY] * x[ZZ];
+            magnitude += m * (1 + std::sqrt(diprod(x, x))) * (1 + std::sqrt(diprod(v, v)));
+        }
+
+        t_inputrec ir;
+        ir.eI        = IntegrationAlgorithm::MD;
+        ir.nstcomm   = 10;
+        ir.comm_mode = mode;
+        snew(ir.opts.nrdf, c_numVcmGroups);
+
+        // The group names are only used for printing
+        std::array<char, 6>               name     = { "group" };
+        std::array<char*, c_numVcmGroups> namePtrs = { name.data(), name.data() };
+        SimulationGroups                  groups;
+        for (int g = 0; g < c_numVcmGroups; g++)
+        {
+            groups.groupNames.push_back(&namePtrs[g]);
+            groups.groups[SimulationAtomGroupType::MassCenterVelocityRemoval].push_back(g);
+        }
+
+        gmx_omp_nthreads_set(ModuleMultiThread::Default, numThreads);
+        t_vcm vcm(groups, ir);
+        ASSERT_EQ(c_size, vcm.size);
+        // Call twice to check that the previous sums are cleared
+        for (int call = 0; call < 2; call++)
+        {
+            calc_vcm_grp(mdatoms_, x_, v_, &vcm);
+        }
+
+        const FloatingPointTolerance tolerance =
+                relativeToleranceAsPrecisionDependentFloatingPoint(magnitude, 1e-6, 1e-14);
+        for (int g = 0; g < c_size; g++)
+        {
+            EXPECT_REAL_EQ_TOL(refMass[g], vcm.group_mass[g], tolerance) << "for group " << g;
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(refP[g][d], vcm.group_p[g][d], tolerance)
+                        << "for group " << g << " dimension " << d;
+            }
+            if (mode != ComRemovalAlgorithm::Angular)
+            {
+                continue;
+            }
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(refJ[g][d], vcm.group_j[g][d], tolerance)
+                        << "for group " << g << " dimension " << d;
+                EXPECT_REAL_EQ_TOL(refX[g][d], vcm.group_x[g][d], tolerance)
+                        << "for group " << g << " dimension " << d;
+                EXPECT_REAL_EQ_TOL(refIDiag[g][d], vcm.group_i[g][d][d], tolerance)
+                        << "for group " << g << " dimension " << d;
+            }
+            const tensor& inertia = vcm.group_i[g];
+            EXPECT_REAL_EQ_TOL(refIOff[g][0], inertia[XX][YY], tolerance) << "for group " << g;
+            EXPECT_REAL_EQ_TOL(refIOff[g][1], inertia[XX][ZZ], tolerance) << "for group " << g;
+            EXPECT_REAL_EQ_TOL(refIOff[g][2], inertia[YY][ZZ], tolerance) << "for group " << g;
+        }
+    }
+
+    //! Positions
+    std::vector<RVec> x_;
+    //! Velocities
+    std::vector<RVec> v_;
+    //! A-state masses
+    std::vector<real> massA_;
+    //! B-state masses
+    std::vector<real> massB_;
+    //! Current masses
+    std::vector<real> massT_;
+    //! Whether the atoms are perturbed, stored in an array as t_mdatoms needs a bool pointer
+    std::array<bool, c_numAtoms> bPerturbed_ = {};
+    //! Temperature-coupling group per atom
+    std::vector<unsigned short> cTC_;
+    //! COM removal group per atom
+    std::vector<unsigned short> cVCM_;
+    //! The atom data passed to the routines
+    t_mdatoms mdatoms_;
+};
+
+TEST_P(GroupSumsTest, HalfStepKineticEnergy)
+{
+    checkKineticEnergy(GetParam(), false);
+}
+
+TEST_P(GroupSumsTest, FullStepKineticEnergy)
+{
+    checkKineticEnergy(GetParam(), true);
+}
+
+TEST_P(GroupSumsTest, LinearComMotion)
+{
+    checkComMotion(GetParam(), ComRemovalAlgorithm::Linear);
+}
+
+TEST_P(GroupSumsTest, AngularComMotion)
+{
+    checkComMotion(GetParam(), ComRemovalAlgorithm::Angular);
+}
+
+INSTANTIATE_TEST_CASE_P(WithThreads, GroupSumsTest, ::testing::Values(1, 2, 3, 4));
+
+} // namespace
+} // namespace test
+} // namespace gmx
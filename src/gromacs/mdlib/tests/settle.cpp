@@ -391,6 +391,71 @@ TEST_P(SettleTest, SatisfiesConstraints)
 // The test will cycle through all available runners, including CPU and, if applicable, GPU implementations of SETTLE.
 INSTANTIATE_TEST_CASE_P(WithParameters, SettleTest, ::testing::ValuesIn(parametersSets));
 
+TEST(SettleRangeTest, ConstrainingInRangesMatchesConstrainingAll)
+{
+    const int numSettles = 17;
+
+    SettleTestData referenceData(numSettles);
+    SettleTestData testData(numSettles);
+
+    SettleData settled(referenceData.mtop_);
+    settled.setConstraints(referenceData.idef_->il[F_SETTLE],
+                           referenceData.numAtoms_,
+                           referenceData.masses_,
+                           referenceData.inverseMasses_);
+
+    EXPECT_TRUE(settled.settlesAreConsecutiveAndOrdered());
+
+    bool errorOccured = false;
+    csettle(settled,
+            1,
+            0,
+            nullptr,
+            referenceData.x_.arrayRefWithPadding(),
+            referenceData.xPrime_.arrayRefWithPadding(),
+            referenceData.reciprocalTimeStep_,
+            referenceData.v_.arrayRefWithPadding(),
+            true,
+            referenceData.virial_,
+            &errorOccured);
+    EXPECT_FALSE(errorOccured);
+
+    // Constrain one pack of settles at a time, the virial is accumulated
+    const int packSize = settled.packSize();
+    for (int settleStart = 0; settleStart < numSettles; settleStart += packSize)
+    {
+        csettleRange(settled,
+                     settleStart,
+                     std::min(settleStart + packSize, numSettles),
+                     nullptr,
+                     testData.x_.arrayRefWithPadding(),
+                     testData.xPrime_.arrayRefWithPadding(),
+                     testData.reciprocalTimeStep_,
+                     testData.v_.arrayRefWithPadding(),
+                     true,
+                     testData.virial_,
+                     &errorOccured);
+        EXPECT_FALSE(errorOccured);
+    }
+
+    const FloatingPointTolerance tolerance = defaultRealTolerance();
+    for (int i = 0; i < referenceData.numAtoms_; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(referenceData.xPrime_[i][d], testData.xPrime_[i][d], tolerance);
+            EXPECT_REAL_EQ_TOL(referenceData.v_[i][d], testData.v_[i][d], tolerance);
+        }
+    }
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_REAL_EQ_TOL(referenceData.virial_[d1][d2], testData.virial_[d1][d2], tolerance);
+        }
+    }
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
@@ -45,6 +45,13 @@
 
 #include <gtest/gtest.h>
 
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/constr.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/topology/forcefieldparameters.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/topology/ifunc.h"
 #include "gromacs/utility/arrayref.h"
 
 #include "testutils/refdata.h"
@@ -349,5 +356,189 @@ TEST_F(ShakeTest, ConstrainsThreeBondsWithCommonAtoms)
     runTest(numAtoms, numConstraints, iatom, constrainedDistances, inverseMasses, positions);
 }
 
+/*! \brief Test fixture comparing threaded SHAKE with serial SHAKE
+ *
+ * The system consists of a chain that is large enough to be iterated
+ * by all threads together over colors, and of many small molecules
+ * that are distributed over the threads.
+ */
+class ThreadedShakeTest : public ::testing::Test
+{
+public:
+    //! The number of atoms in the chain
+    static constexpr int c_numChainAtoms = 400;
+    //! The number of diatomic molecules
+    static constexpr int c_numDiatomics = 70;
+    //! The constraint length
+    static constexpr real c_constraintLength = 0.1;
+    //! The time step
+    static constexpr real c_timeStep = 0.002;
+
+    ThreadedShakeTest() : numAtoms_(c_numChainAtoms + 2 * c_numDiatomics)
+    {
+        ffparams_.iparams.resize(1);
+        ffparams_.iparams[0].constr.dA = c_constraintLength;
+        ffparams_.iparams[0].constr.dB = c_constraintLength;
+        ffparams_.functype.push_back(F_CONSTR);
+
+        ir_.efep      = FreeEnergyPerturbationType::No;
+        ir_.shake_tol = 1e-5;
+        ir_.delta_t   = c_timeStep;
+        ir_.bShakeSOR = false;
+
+        // Positions that satisfy the constraints: a zig-zag chain and diatomics along x
+        const real halfLength = 0.5 * c_constraintLength;
+        for (int a = 0; a < c_numChainAtoms; a++)
+        {
+            const real y = (a % 2 == 0) ? 0 : std::sqrt(3.0_real) * halfLength;
+            x_.emplace_back(a * halfLength, y, 0);
+        }
+        for (int m = 0; m < c_numDiatomics; m++)
+        {
+            x_.emplace_back(0.3_real * (m % 10), 0.5_real + 0.3_real * (m / 10), 0);
+            x_.emplace_back(x_.back()[XX] + c_constraintLength, x_.back()[YY], 0);
+        }
+        // Unconstrained updated positions with reproducible displacements of 0.01 nm
+        for (int a = 0; a < numAtoms_; a++)
+        {
+            const RVec displacement(
+                    std::sin(1.1_real * a), std::sin(2.3_real * a), std::sin(3.7_real * a));
+            xPrime_.push_back(x_[a] + 0.01_real * displacement);
+            invmass_.push_back(1.0_real / (1 + a % 3));
+        }
+    }
+
+    /*! \brief Returns the constraint list, the chain is listed after the diatomics
+     *
+     * Note that SHAKE reorders the list.
+     */
+    std::vector<int> constraintList() const
+    {
+        std::vector<int> iatoms;
+        for (int m = 0; m < c_numDiatomics; m++)
+        {
+            const int a = c_numChainAtoms + 2 * m;
+            iatoms.insert(iatoms.end(), { 0, a, a + 1 });
+        }
+        for (int a = 0; a < c_numChainAtoms - 1; a++)
+        {
+            iatoms.insert(iatoms.end(), { 0, a, a + 1 });
+        }
+        return iatoms;
+    }
+
+    //! Applies SHAKE with \p numThreads, returns the blocks used and the results
+    void applyShake(int                numThreads,
+                    shakedata*         shaked,
+                    std::vector<RVec>* xPrime,
+                    std::vector<RVec>* v,
+                    tensor             virial)
+    {
+        InteractionDefinitions idef(ffparams_);
+        idef.il[F_CONSTR].iatoms = constraintList();
+
+        shaked->numThreads = numThreads;
+        make_shake_sblock_serial(shaked, &idef, numAtoms_);
+
+        *xPrime = xPrime_;
+        v->assign(numAtoms_, { 0, 0, 0 });
+        clear_mat(virial);
+        t_nrnb nrnb;
+        real   dvdlambda = 0;
+        bool   success   = constrain_shake(nullptr,
+                                       shaked,
+                                       invmass_,
+                                       idef,
+                                       ir_,
+                                       x_,
+                                       *xPrime,
+                                       {},
+                                       nullptr,
+                                       &nrnb,
+                                       0,
+                                       &dvdlambda,
+                                       1 / c_timeStep,
+                                       *v,
+                                       true,
+                                       virial,
+                                       false,
+                                       ConstraintVariable::Positions);
+        EXPECT_TRUE(success) << "SHAKE failed with " << numThreads << " threads";
+    }
+
+    //! The number of atoms
+    int numAtoms_;
+    //! The force-field parameters with one constraint type
+    gmx_ffparams_t ffparams_;
+    //! The input record
+    t_inputrec ir_;
+    //! The reference positions
+    std::vector<RVec> x_;
+    //! The unconstrained updated positions
+    std::vector<RVec> xPrime_;
+    //! The inverse masses
+    std::vector<real> invmass_;
+};
+
+TEST_F(ThreadedShakeTest, MatchesSerialShake)
+{
+    shakedata         serialShaked;
+    std::vector<RVec> serialXPrime;
+    std::vector<RVec> serialV;
+    tensor            serialVirial;
+    applyShake(1, &serialShaked, &serialXPrime, &serialV, serialVirial);
+
+    shakedata         threadedShaked;
+    std::vector<RVec> threadedXPrime;
+    std::vector<RVec> threadedV;
+    tensor            threadedVirial;
+    applyShake(4, &threadedShaked, &threadedXPrime, &threadedV, threadedVirial);
+
+    // Check that we tested both the colored and the per-thread block code paths
+    const int numColoredBlocks =
+            std::count_if(threadedShaked.blockColorStart.begin(),
+                          threadedShaked.blockColorStart.end(),
+                          [](const std::vector<int>& colorStart) { return !colorStart.empty(); });
+    EXPECT_EQ(numColoredBlocks, 1);
+    EXPECT_GT(threadedShaked.numShakeBlocks(), numColoredBlocks);
+
+    /* The colored block is iterated in a different order, so the results
+     * agree within (a multiple of) the SHAKE tolerance, not exactly.
+     * This is still far below the displacements of 0.01 nm.
+     */
+    const real positionTolerance = 50 * ir_.shake_tol * c_constraintLength;
+    const real velocityTolerance = positionTolerance / c_timeStep;
+    for (int a = 0; a < numAtoms_; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(serialXPrime[a][d],
+                               threadedXPrime[a][d],
+                               test::absoluteTolerance(positionTolerance))
+                    << "for atom " << a << " dimension " << d;
+            EXPECT_REAL_EQ_TOL(
+                    serialV[a][d], threadedV[a][d], test::absoluteTolerance(velocityTolerance))
+                    << "for atom " << a << " dimension " << d;
+        }
+    }
+    real maxVirialElement = 0;
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            maxVirialElement = std::max(maxVirialElement, std::abs(serialVirial[d1][d2]));
+        }
+    }
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_REAL_EQ_TOL(serialVirial[d1][d2],
+                               threadedVirial[d1][d2],
+                               test::absoluteTolerance(1e-3 * maxVirialElement));
+        }
+    }
+}
+
 } // namespace
 } // namespace gmx
@@ -0,0 +1,285 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for the SD and BD coordinate updates
+ *
+ * The SIMD update is only used when no freeze group freezes only some
+ * dimensions. The tests compare the update with an unused partially
+ * frozen group, which uses the scalar code for all atoms, with the
+ * update using SIMD. The noise is drawn per atom, so both should agree
+ * to within rounding.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/update.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/fcdata.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/mdtypes/state.h"
+#include "gromacs/topology/atoms.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The stochastic update variants tested
+enum class StochasticUpdate
+{
+    SD,              //!< SD without constraints, friction and noise combined with the force update
+    SDForcesOnly,    //!< The first part of the SD update with constraints
+    BD,              //!< BD with the friction given per atom through the mass
+    BDWithFriction,  //!< BD with a friction coefficient
+    Count            //!< The number of variants
+};
+
+//! Names of the variants
+const EnumerationArray<StochasticUpdate, const char*> c_stochasticUpdateNames = {
+    { "SD", "SDForcesOnly", "BD", "BDWithFriction" }
+};
+
+/*! \brief The number of atoms
+ *
+ * This is not a multiple of any SIMD width, so the remainder is updated
+ * with the scalar code.
+ */
+constexpr int c_numAtoms = 53;
+
+//! The index of the freeze group that freezes all dimensions
+constexpr int c_frozenGroup = 1;
+
+//! Parameters: the update variant and the number of threads
+using StochasticUpdateTestParameters = std::tuple<StochasticUpdate, int>;
+
+//! Test fixture comparing the SIMD and the scalar SD and BD updates
+class StochasticUpdateTest : public ::testing::TestWithParam<StochasticUpdateTestParameters>
+{
+public:
+    StochasticUpdateTest()
+    {
+        // The SIMD update requires aligned and padded inverse masses
+        invMass_.resizeWithPadding(c_numAtoms);
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            x_.emplace_back(0.1_real * a, 1.0_real + std::sin(0.7_real * a), 2.0_real);
+            v_.emplace_back(std::sin(1.3_real * a), std::cos(0.9_real * a), -0.5_real);
+            f_.emplace_back(100 * std::cos(2.1_real * a), -50.0_real, 30 * std::sin(1.7_real * a));
+            // Every seventh atom is frozen in all dimensions and atom 10 is a shell
+            cFREEZE_.push_back(a % 7 == 3 ? c_frozenGroup : 0);
+            cTC_.push_back(a % 2);
+            ptype_.push_back(a == 10 ? ParticleType::Shell : ParticleType::Atom);
+            invMass_[a] = (a == 10 ? 0 : 1.0_real / (1 + a % 5));
+        }
+    }
+
+    /*! \brief Sets up \p ir for \p update
+     *
+     * When \p forceScalarUpdate is true, an extra unused freeze group that freezes
+     * only the x-dimension is added, so the scalar update is used for all atoms.
+     */
+    static void setInputrec(StochasticUpdate update, bool forceScalarUpdate, t_inputrec* ir)
+    {
+        const bool isBD =
+                (update == StochasticUpdate::BD || update == StochasticUpdate::BDWithFriction);
+        ir->eI      = isBD ? IntegrationAlgorithm::BD : IntegrationAlgorithm::SD1;
+        ir->delta_t = 0.002;
+        ir->ld_seed = 1993;
+        ir->bd_fric = (update == StochasticUpdate::BDWithFriction) ? 1000 : 0;
+
+        ir->opts.ngtc = 2;
+        snew(ir->opts.tau_t, ir->opts.ngtc);
+        snew(ir->opts.ref_t, ir->opts.ngtc);
+        snew(ir->opts.annealing, ir->opts.ngtc);
+        snew(ir->opts.anneal_time, ir->opts.ngtc);
+        snew(ir->opts.anneal_temp, ir->opts.ngtc);
+        ir->opts.tau_t[0] = 0.1;
+        ir->opts.tau_t[1] = 1.0;
+        ir->opts.ref_t[0] = 300;
+        ir->opts.ref_t[1] = 200;
+
+        ir->opts.ngfrz = forceScalarUpdate ? 3 : 2;
+        snew(ir->opts.nFreeze, ir->opts.ngfrz);
+        for (int d = 0; d < DIM; d++)
+        {
+            ir->opts.nFreeze[c_frozenGroup][d] = 1;
+        }
+        if (forceScalarUpdate)
+        {
+            ir->opts.nFreeze[2][XX] = 1;
+        }
+    }
+
+    //! Performs one update step and returns the updated positions and velocities
+    void runUpdate(StochasticUpdate   update,
+                   int                numThreads,
+                   bool               forceScalarUpdate,
+                   std::vector<RVec>* xPrime,
+                   std::vector<RVec>* v)
+    {
+        t_inputrec ir;
+        setInputrec(update, forceScalarUpdate, &ir);
+
+        t_state state;
+        state.flags = 0;
+        state.x.resizeWithPadding(c_numAtoms);
+        state.v.resizeWithPadding(c_numAtoms);
+        std::copy(x_.begin(), x_.end(), state.x.begin());
+        std::copy(v_.begin(), v_.end(), state.v.begin());
+        PaddedVector<RVec> f(c_numAtoms);
+        std::copy(f_.begin(), f_.end(), f.begin());
+
+        t_commrec cr;
+        cr.nnodes = 1;
+        cr.dd     = nullptr;
+        t_fcdata fcdata;
+        matrix   M = { { 0 } };
+
+        gmx_omp_nthreads_set(ModuleMultiThread::Update, numThreads);
+
+        Update upd(ir, nullptr);
+        upd.updateAfterPartition(c_numAtoms, cFREEZE_, cTC_);
+        upd.update_coords(ir,
+                          7,
+                          c_numAtoms,
+                          false,
+                          ptype_,
+                          invMass_,
+                          {},
+                          &state,
+                          f.arrayRefWithPadding(),
+                          fcdata,
+                          nullptr,
+                          M,
+                          etrtPOSITION,
+                          &cr,
+                          update == StochasticUpdate::SDForcesOnly);
+
+        const auto xp = makeArrayRef(*upd.xp()).subArray(0, c_numAtoms);
+        xPrime->assign(xp.begin(), xp.end());
+        v->assign(state.v.begin(), state.v.begin() + c_numAtoms);
+    }
+
+    //! Positions
+    std::vector<RVec> x_;
+    //! Velocities
+    std::vector<RVec> v_;
+    //! Forces
+    std::vector<RVec> f_;
+    //! Freeze group per atom
+    std::vector<unsigned short> cFREEZE_;
+    //! Temperature-coupling group per atom
+    std::vector<unsigned short> cTC_;
+    //! Particle type per atom
+    std::vector<ParticleType> ptype_;
+    //! Inverse mass per atom
+    PaddedVector<real> invMass_;
+};
+
+TEST_P(StochasticUpdateTest, SimdMatchesScalar)
+{
+    const StochasticUpdate update     = std::get<0>(GetParam());
+    const int              numThreads = std::get<1>(GetParam());
+
+    std::vector<RVec> scalarXPrime;
+    std::vector<RVec> scalarV;
+    runUpdate(update, numThreads, true, &scalarXPrime, &scalarV);
+
+    std::vector<RVec> simdXPrime;
+    std::vector<RVec> simdV;
+    runUpdate(update, numThreads, false, &simdXPrime, &simdV);
+
+    const FloatingPointTolerance tolerance = relativeToleranceAsPrecisionDependentUlp(10.0, 8, 8);
+    for (int a = 0; a < c_numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(scalarXPrime[a][d], simdXPrime[a][d], tolerance)
+                    << "for the position of atom " << a << " dimension " << d;
+            EXPECT_REAL_EQ_TOL(scalarV[a][d], simdV[a][d], tolerance)
+                    << "for the velocity of atom " << a << " dimension " << d;
+        }
+        if (cFREEZE_[a] == c_frozenGroup || ptype_[a] == ParticleType::Shell)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_EQ(x_[a][d], simdXPrime[a][d]) << "for frozen atom or shell " << a;
+                EXPECT_EQ(0, simdV[a][d]) << "for frozen atom or shell " << a;
+            }
+        }
+    }
+}
+
+//! Returns a readable name for the test parameters
+std::string nameOfTest(const ::testing::TestParamInfo<StochasticUpdateTestParameters>& info)
+{
+    return formatString("%s_%dThreads",
+                        c_stochasticUpdateNames[std::get<0>(info.param)],
+                        std::get<1>(info.param));
+}
+
+INSTANTIATE_TEST_CASE_P(WithParameters,
+                        StochasticUpdateTest,
+                        ::testing::Combine(::testing::Values(StochasticUpdate::SD,
+                                                             StochasticUpdate::SDForcesOnly,
+                                                             StochasticUpdate::BD,
+                                                             StochasticUpdate::BDWithFriction),
+                                           ::testing::Values(1, 2)),
+                        nameOfTest);
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,365 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for the leap-frog update fused with SETTLE
+ *
+ * The fused update, SETTLE and finishing of the update is compared
+ * with the separate update, constraining and finishing as done when
+ * the fused path is not used.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/constr.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/makeconstraints.h"
+#include "gromacs/mdlib/update.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/fcdata.h"
+#include "gromacs/mdtypes/group.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/state.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/topology/atoms.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "gromacs/mdlib/tests/watersystem.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of shifted copies of the water system
+constexpr int c_numCopies = 12;
+
+/*! \brief The number of atoms
+ *
+ * This is more than two blocks of the fused update for a single thread
+ * and not a multiple of any SIMD width.
+ */
+constexpr int c_numAtoms = c_numCopies * c_waterPositions.size();
+
+//! Oxygen mass
+constexpr real c_oxygenMass = 15.9994;
+//! Hydrogen mass
+constexpr real c_hydrogenMass = 1.008;
+
+//! The result of an update step
+struct UpdateResult
+{
+    //! Positions
+    std::vector<RVec> x;
+    //! Velocities
+    std::vector<RVec> v;
+    //! Constraint virial
+    matrix virial;
+    //! Whether SETTLE succeeded
+    bool settleSucceeded;
+};
+
+//! Test fixture comparing the fused update and SETTLE with the separate update and SETTLE
+class UpdateSettleTest : public ::testing::TestWithParam<int>
+{
+public:
+    UpdateSettleTest()
+    {
+        ir_.eI          = IntegrationAlgorithm::MD;
+        ir_.delta_t     = 0.002;
+        ir_.pbcType     = PbcType::No;
+        ir_.etc         = TemperatureCoupling::No;
+        ir_.epc         = PressureCoupling::No;
+        ir_.eConstrAlg  = ConstraintAlgorithm::Lincs;
+        ir_.nLincsIter  = 1;
+        ir_.nProjOrder  = 4;
+        ir_.efep        = FreeEnergyPerturbationType::No;
+        ir_.nsttcouple  = 10;
+        ir_.nstpcouple  = 10;
+        ir_.opts.ngtc   = 1;
+        ir_.opts.ngfrz  = 1;
+        snew(ir_.opts.tau_t, ir_.opts.ngtc);
+        snew(ir_.opts.ref_t, ir_.opts.ngtc);
+        snew(ir_.opts.annealing, ir_.opts.ngtc);
+        snew(ir_.opts.anneal_time, ir_.opts.ngtc);
+        snew(ir_.opts.anneal_temp, ir_.opts.ngtc);
+        snew(ir_.opts.nFreeze, ir_.opts.ngfrz);
+
+        // A single water molecule type with SETTLE
+        t_iparams iparams;
+        iparams.settle.doh = 0.1;
+        iparams.settle.dhh = 0.1633;
+        mtop_.ffparams.iparams.push_back(iparams);
+        mtop_.ffparams.functype.push_back(F_SETTLE);
+        mtop_.moltype.resize(1);
+        gmx_moltype_t& moltype = mtop_.moltype[0];
+        init_t_atoms(&moltype.atoms, 3, FALSE);
+        for (int i = 0; i < 3; i++)
+        {
+            moltype.atoms.atom[i].m  = (i == 0 ? c_oxygenMass : c_hydrogenMass);
+            moltype.atoms.atom[i].mB = moltype.atoms.atom[i].m;
+        }
+        moltype.ilist[F_SETTLE].iatoms = { 0, 0, 1, 2 };
+        mtop_.molblock.resize(1);
+        mtop_.molblock[0].type = 0;
+        mtop_.molblock[0].nmol = c_numAtoms / 3;
+        mtop_.natoms           = c_numAtoms;
+
+        for (int copy = 0; copy < c_numCopies; copy++)
+        {
+            for (const RVec& x : c_waterPositions)
+            {
+                x_.emplace_back(x[XX] + 2.5_real * copy, x[YY], x[ZZ]);
+            }
+        }
+        // The SIMD update requires aligned and padded inverse masses
+        invMasses_.resizeWithPadding(c_numAtoms);
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            const real mass = (a % 3 == 0 ? c_oxygenMass : c_hydrogenMass);
+            masses_.push_back(mass);
+            invMasses_[a] = 1 / mass;
+            invMassPerDim_.emplace_back(1 / mass, 1 / mass, 1 / mass);
+            v_.emplace_back(std::sin(1.3_real * a), std::cos(0.9_real * a), -0.5_real);
+            f_.emplace_back(300 * std::cos(2.1_real * a), -50.0_real, 200 * std::sin(1.7_real * a));
+            cTC_.push_back(0);
+        }
+    }
+
+    //! Performs one update step, with the update and SETTLE fused when \p fused is true
+    UpdateResult runUpdate(bool fused, int numThreads)
+    {
+        gmx_omp_nthreads_set(ModuleMultiThread::Update, numThreads);
+        gmx_omp_nthreads_set(ModuleMultiThread::Settle, numThreads);
+
+        t_commrec cr;
+        cr.nnodes = 1;
+        cr.dd     = nullptr;
+        t_nrnb nrnb;
+
+        auto constr = makeConstraints(
+                mtop_, ir_, nullptr, false, nullptr, &cr, false, nullptr, &nrnb, nullptr, false);
+        gmx_localtop_t top(mtop_.ffparams);
+        for (int a = 0; a < c_numAtoms; a += 3)
+        {
+            top.idef.il[F_SETTLE].push_back(0, std::array<int, 3>{ a, a + 1, a + 2 });
+        }
+        constr->setConstraints(&top, c_numAtoms, c_numAtoms, masses_, invMasses_, false, 0, {});
+        EXPECT_NE(constr->settleDataForFusedUpdate(), nullptr);
+
+        t_state state;
+        state.flags = 0;
+        state.x.resizeWithPadding(c_numAtoms);
+        state.v.resizeWithPadding(c_numAtoms);
+        std::copy(x_.begin(), x_.end(), state.x.begin());
+        std::copy(v_.begin(), v_.end(), state.v.begin());
+        PaddedVector<RVec> f(c_numAtoms);
+        std::copy(f_.begin(), f_.end(), f.begin());
+
+        t_fcdata       fcdata;
+        gmx_ekindata_t ekind(1, 0.0, 1);
+        ekind.tcstat[0].lambda = 1;
+        matrix M               = { { 0 } };
+
+        const int64_t step = 5;
+
+        Update upd(ir_, nullptr);
+        upd.updateAfterPartition(c_numAtoms, {}, cTC_);
+
+        const ArrayRef<const rvec> invMassPerDim =
+                arrayRefFromArray(as_rvec_array(invMassPerDim_.data()), c_numAtoms);
+
+        UpdateResult result;
+        if (fused)
+        {
+            result.settleSucceeded = upd.update_coords_settle_and_finish(ir_,
+                                                                         step,
+                                                                         c_numAtoms,
+                                                                         false,
+                                                                         invMasses_,
+                                                                         invMassPerDim,
+                                                                         &state,
+                                                                         f.arrayRefWithPadding(),
+                                                                         fcdata,
+                                                                         &ekind,
+                                                                         M,
+                                                                         constr.get(),
+                                                                         true,
+                                                                         result.virial);
+        }
+        else
+        {
+            upd.update_coords(ir_,
+                              step,
+                              c_numAtoms,
+                              false,
+                              {},
+                              invMasses_,
+                              invMassPerDim,
+                              &state,
+                              f.arrayRefWithPadding(),
+                              fcdata,
+                              &ekind,
+                              M,
+                              etrtPOSITION,
+                              &cr,
+                              true);
+            real dvdlambda         = 0;
+            result.settleSucceeded = constr->apply(false,
+                                                   false,
+                                                   step,
+                                                   1,
+                                                   1.0,
+                                                   state.x.arrayRefWithPadding(),
+                                                   upd.xp()->arrayRefWithPadding(),
+                                                   ArrayRef<RVec>(),
+                                                   state.box,
+                                                   0,
+                                                   &dvdlambda,
+                                                   state.v.arrayRefWithPadding(),
+                                                   true,
+                                                   result.virial,
+                                                   ConstraintVariable::Positions);
+            upd.finish_update(ir_, false, c_numAtoms, &state, nullptr, true);
+        }
+
+        result.x.assign(state.x.begin(), state.x.begin() + c_numAtoms);
+        result.v.assign(state.v.begin(), state.v.begin() + c_numAtoms);
+
+        return result;
+    }
+
+    //! The input record
+    t_inputrec ir_;
+    //! The topology
+    gmx_mtop_t mtop_;
+    //! Positions
+    std::vector<RVec> x_;
+    //! Velocities
+    std::vector<RVec> v_;
+    //! Forces
+    std::vector<RVec> f_;
+    //! Masses
+    std::vector<real> masses_;
+    //! Inverse masses
+    PaddedVector<real> invMasses_;
+    //! Inverse masses per dimension
+    std::vector<RVec> invMassPerDim_;
+    //! Temperature-coupling group per atom
+    std::vector<unsigned short> cTC_;
+};
+
+TEST_P(UpdateSettleTest, FusedMatchesSeparate)
+{
+    const int numThreads = GetParam();
+
+    const UpdateResult separate = runUpdate(false, numThreads);
+    const UpdateResult fused    = runUpdate(true, numThreads);
+
+    EXPECT_TRUE(separate.settleSucceeded);
+    EXPECT_TRUE(fused.settleSucceeded);
+
+    const FloatingPointTolerance tolerance = relativeToleranceAsPrecisionDependentUlp(10.0, 20, 20);
+    for (int a = 0; a < c_numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(separate.x[a][d], fused.x[a][d], tolerance)
+                    << "for the position of atom " << a << " dimension " << d;
+            EXPECT_REAL_EQ_TOL(separate.v[a][d], fused.v[a][d], tolerance)
+                    << "for the velocity of atom " << a << " dimension " << d;
+        }
+    }
+
+    // The virial is summed in different orders, so we compare relative to its magnitude
+    real maxVirial = 0;
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            maxVirial = std::max(maxVirial, std::abs(separate.virial[d1][d2]));
+        }
+    }
+    const FloatingPointTolerance virialTolerance =
+            absoluteTolerance(maxVirial * 1e-5);
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_REAL_EQ_TOL(separate.virial[d1][d2], fused.virial[d1][d2], virialTolerance)
+                    << "for virial element " << d1 << " " << d2;
+        }
+    }
+}
+
+TEST_P(UpdateSettleTest, FusedReportsSettleFailure)
+{
+    // Move an oxygen so far out of the plane of its water that SETTLE fails
+    const int  failingWater = 7;
+    const RVec oh1          = x_[3 * failingWater + 1] - x_[3 * failingWater];
+    const RVec oh2          = x_[3 * failingWater + 2] - x_[3 * failingWater];
+    RVec       normal       = oh1.cross(oh2);
+    normal /= norm(normal);
+    v_[3 * failingWater] = 100.0_real * normal;
+
+    const UpdateResult fused = runUpdate(true, GetParam());
+
+    EXPECT_FALSE(fused.settleSucceeded);
+}
+
+INSTANTIATE_TEST_CASE_P(WithThreads, UpdateSettleTest, ::testing::Values(1, 2, 3));
+
+} // namespace
+} // namespace test
+} // namespace gmx
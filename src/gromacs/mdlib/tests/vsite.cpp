@@ -0,0 +1,421 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for virtual site construction and force spreading
+ *
+ * The SIMD construction and spreading kernels for the vsite types 3, 3fd,
+ * 3out and 4fdn are compared with the plain-C code, which is selected
+ * by setting GMX_DISABLE_SIMD_KERNELS. The number of vsites per type is
+ * not a multiple of the SIMD width and the last vsite is constructed from
+ * another vsite, so the plain-C remainder loops are also used.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "gromacs/mdlib/vsite.h"
+
+#include "config.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/topology/atoms.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/setenv.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of molecules of the type without dependent vsites
+constexpr int c_numMolecules = 13;
+
+//! The number of atoms per molecule, four atoms followed by one vsite of each type
+constexpr int c_numAtomsPerMolecule = 8;
+
+//! The number of atoms in the last molecule, which has an extra vsite constructed from a vsite
+constexpr int c_numAtomsLastMolecule = c_numAtomsPerMolecule + 1;
+
+//! The total number of atoms
+constexpr int c_numAtoms = c_numMolecules * c_numAtomsPerMolecule + c_numAtomsLastMolecule;
+
+//! The size of the cubic box
+constexpr real c_boxSize = 2.0;
+
+//! The vsite types and their parameter indices, in the order of the vsites in a molecule
+const std::vector<int> c_vsiteTypes = { F_VSITE3, F_VSITE3FD, F_VSITE3OUT, F_VSITE4FDN };
+
+//! The results of constructing vsites and spreading their forces
+struct VsiteResult
+{
+    //! The positions after construction
+    std::vector<RVec> x;
+    //! The forces after spreading
+    std::vector<RVec> f;
+    //! The shift forces
+    std::vector<RVec> fshift;
+    //! The virial
+    matrix virial;
+};
+
+//! Test fixture comparing SIMD and plain-C vsite construction and force spreading
+class VsiteTest : public ::testing::TestWithParam<int>
+{
+public:
+    VsiteTest()
+    {
+        // The vsite parameters, one parameter type per vsite type
+        const real parameters[][3] = {
+            { 0.3, 0.4, 0 }, { 0.5, 0.1, 0 }, { 0.3, 0.4, 2.0 }, { 0.8, 0.6, 0.12 }
+        };
+        for (size_t t = 0; t < c_vsiteTypes.size(); t++)
+        {
+            t_iparams iparams = {};
+            iparams.vsite.a   = parameters[t][0];
+            iparams.vsite.b   = parameters[t][1];
+            iparams.vsite.c   = parameters[t][2];
+            mtop_.ffparams.iparams.push_back(iparams);
+            mtop_.ffparams.functype.push_back(c_vsiteTypes[t]);
+        }
+
+        // Two molecule types, the second has an extra vsite 3 constructed from the first vsite
+        mtop_.moltype.resize(2);
+        for (int mt = 0; mt < 2; mt++)
+        {
+            gmx_moltype_t& moltype = mtop_.moltype[mt];
+            const int numAtoms = (mt == 0 ? c_numAtomsPerMolecule : c_numAtomsLastMolecule);
+            init_t_atoms(&moltype.atoms, numAtoms, FALSE);
+            for (int a = 0; a < numAtoms; a++)
+            {
+                moltype.atoms.atom[a].m     = (a < 4 ? 12 : 0);
+                moltype.atoms.atom[a].ptype = (a < 4 ? ParticleType::Atom : ParticleType::VSite);
+            }
+            addVsitesToList(&moltype.ilist, 0, mt == 1);
+        }
+        mtop_.molblock.resize(2);
+        mtop_.molblock[0].type = 0;
+        mtop_.molblock[0].nmol = c_numMolecules;
+        mtop_.molblock[1].type = 1;
+        mtop_.molblock[1].nmol = 1;
+        mtop_.natoms           = c_numAtoms;
+
+        // The local interaction lists and particle types
+        for (int m = 0; m <= c_numMolecules; m++)
+        {
+            addVsitesToList(&ilists_, m * c_numAtomsPerMolecule, m == c_numMolecules);
+        }
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            const int atomInMolecule = a - moleculeStart(a);
+            ptype_.push_back(atomInMolecule < 4 ? ParticleType::Atom : ParticleType::VSite);
+        }
+
+        // Irregular molecules on a grid, with the vsites starting at the first atom
+        const RVec atomOffsets[4] = {
+            { 0, 0, 0 }, { 0.1, 0.02, 0 }, { -0.03, 0.1, 0.01 }, { 0.02, -0.03, 0.1 }
+        };
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            const int  m              = std::min(a / c_numAtomsPerMolecule, c_numMolecules);
+            const int  atomInMolecule = a - moleculeStart(a);
+            const RVec center(0.5_real * (m % 4) + 0.25_real,
+                              0.5_real * ((m / 4) % 4) + 0.25_real,
+                              0.5_real * (m / 16) + 0.25_real);
+            RVec       x = center;
+            if (atomInMolecule < 4)
+            {
+                x += atomOffsets[atomInMolecule];
+                x += RVec(0.01_real * std::sin(1.3_real * a),
+                          0.01_real * std::cos(0.7_real * a),
+                          0.01_real * std::sin(2.1_real * a));
+            }
+            x_.push_back(x);
+            f_.emplace_back(
+                    10 * std::cos(1.1_real * a), 20 * std::sin(0.3_real * a), -15 + std::cos(a));
+        }
+        // Give the vsites their starting positions at their first constructing atom
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            if (ptype_[a] == ParticleType::VSite)
+            {
+                x_[a] = x_[moleculeStart(a)];
+            }
+        }
+
+        clear_mat(box_);
+        box_[XX][XX] = c_boxSize;
+        box_[YY][YY] = c_boxSize;
+        box_[ZZ][ZZ] = c_boxSize;
+
+        cr_.nnodes = 1;
+        cr_.dd     = nullptr;
+    }
+
+    //! Returns the index of the first atom of the molecule atom \p a belongs to
+    static int moleculeStart(int a)
+    {
+        return std::min(a / c_numAtomsPerMolecule, c_numMolecules) * c_numAtomsPerMolecule;
+    }
+
+    //! Adds the vsites of a molecule starting at atom \p start to \p ilists
+    static void addVsitesToList(InteractionLists* ilists, int start, bool addDependentVsite)
+    {
+        (*ilists)[F_VSITE3].push_back(
+                0, std::array<int, 4>{ start + 4, start, start + 1, start + 2 });
+        (*ilists)[F_VSITE3FD].push_back(
+                1, std::array<int, 4>{ start + 5, start, start + 1, start + 2 });
+        (*ilists)[F_VSITE3OUT].push_back(
+                2, std::array<int, 4>{ start + 6, start, start + 1, start + 2 });
+        (*ilists)[F_VSITE4FDN].push_back(
+                3, std::array<int, 5>{ start + 7, start, start + 1, start + 2, start + 3 });
+        if (addDependentVsite)
+        {
+            (*ilists)[F_VSITE3].push_back(
+                    0, std::array<int, 4>{ start + 8, start + 4, start + 1, start + 3 });
+        }
+    }
+
+    /*! \brief Constructs the vsites and spreads the forces
+     *
+     * \param[in] useSimd         Whether to use the SIMD kernels
+     * \param[in] pbcType         The PBC type
+     * \param[in] shiftAtoms      Whether to shift atom 1 of the odd molecules by a box vector
+     * \param[in] virialHandling  How to handle the virial
+     */
+    VsiteResult run(bool                                useSimd,
+                    PbcType                             pbcType,
+                    bool                                shiftAtoms,
+                    VirtualSitesHandler::VirialHandling virialHandling)
+    {
+        gmx_omp_nthreads_set(ModuleMultiThread::VirtualSite, GetParam());
+
+        // The choice between SIMD and plain-C kernels is made when the handler is made
+        const char* envName   = "GMX_DISABLE_SIMD_KERNELS";
+        const char* envValue  = std::getenv(envName);
+        const bool  hadEnv    = (envValue != nullptr);
+        std::string envBackup = (hadEnv ? envValue : "");
+        if (useSimd)
+        {
+            gmxUnsetenv(envName);
+        }
+        else
+        {
+            gmxSetenv(envName, "1", 1);
+        }
+        auto vsite = makeVirtualSitesHandler(mtop_, &cr_, pbcType, {});
+        if (hadEnv)
+        {
+            gmxSetenv(envName, envBackup.c_str(), 1);
+        }
+        else
+        {
+            gmxUnsetenv(envName);
+        }
+        EXPECT_NE(vsite, nullptr);
+
+        vsite->setVirtualSites(ilists_, c_numAtoms, c_numAtoms, ptype_);
+
+        VsiteResult result;
+        result.x = x_;
+        if (shiftAtoms)
+        {
+            for (int m = 1; m <= c_numMolecules; m += 2)
+            {
+                result.x[m * c_numAtomsPerMolecule + 1][XX] += c_boxSize;
+            }
+        }
+        vsite->construct(result.x, {}, box_, VSiteOperation::Positions);
+
+        result.f = f_;
+        result.fshift.resize(c_numShiftVectors, { 0, 0, 0 });
+        clear_mat(result.virial);
+        t_nrnb nrnb;
+        vsite->spreadForces(result.x,
+                            result.f,
+                            virialHandling,
+                            result.fshift,
+                            result.virial,
+                            &nrnb,
+                            box_,
+                            nullptr);
+
+        return result;
+    }
+
+    //! The global topology
+    gmx_mtop_t mtop_;
+    //! The local interaction lists
+    InteractionLists ilists_;
+    //! The particle types
+    std::vector<ParticleType> ptype_;
+    //! The starting positions
+    std::vector<RVec> x_;
+    //! The forces before spreading
+    std::vector<RVec> f_;
+    //! The box
+    matrix box_;
+    //! The communication record
+    t_commrec cr_;
+};
+
+//! Expects that the vectors in \p a and \p b are equal within \p tolerance
+void compareVectors(ArrayRef<const RVec>          a,
+                    ArrayRef<const RVec>          b,
+                    const FloatingPointTolerance& tolerance,
+                    const char*                   name)
+{
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(a[i][d], b[i][d], tolerance)
+                    << "for " << name << " " << i << " dimension " << d;
+        }
+    }
+}
+
+//! Expects that \p a and \p b are equal within \p tolerance
+void compareMatrices(const matrix a, const matrix b, const FloatingPointTolerance& tolerance)
+{
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_REAL_EQ_TOL(a[d1][d2], b[d1][d2], tolerance)
+                    << "for virial element " << d1 << " " << d2;
+        }
+    }
+}
+
+//! The tolerance for comparing SIMD and plain-C results
+FloatingPointTolerance simdTolerance()
+{
+    return absoluteTolerance(GMX_DOUBLE ? 1e-12 : 2e-5);
+}
+
+/*! \brief The tolerance for comparing results with shifted atoms to those for whole molecules
+ *
+ * Shifting atoms by a box vector rounds their coordinates, the forces are of order 10.
+ */
+FloatingPointTolerance shiftedAtomsTolerance()
+{
+    return relativeToleranceAsPrecisionDependentFloatingPoint(10.0, 1e-5, 1e-10);
+}
+
+TEST_P(VsiteTest, SimdMatchesPlainC)
+{
+    for (auto virialHandling : { VirtualSitesHandler::VirialHandling::None,
+                                 VirtualSitesHandler::VirialHandling::Pbc,
+                                 VirtualSitesHandler::VirialHandling::NonLinear })
+    {
+        SCOPED_TRACE(formatString("With virial handling %d", static_cast<int>(virialHandling)));
+
+        const VsiteResult plainC = run(false, PbcType::No, false, virialHandling);
+        const VsiteResult simd   = run(true, PbcType::No, false, virialHandling);
+
+        compareVectors(plainC.x, simd.x, simdTolerance(), "position of atom");
+        compareVectors(plainC.f, simd.f, simdTolerance(), "force on atom");
+        compareVectors(plainC.fshift, simd.fshift, simdTolerance(), "shift force");
+        compareMatrices(plainC.virial, simd.virial, simdTolerance());
+    }
+}
+
+TEST_P(VsiteTest, WithPbcMatchesWholeMolecules)
+{
+    for (auto virialHandling : { VirtualSitesHandler::VirialHandling::Pbc,
+                                 VirtualSitesHandler::VirialHandling::NonLinear })
+    {
+        SCOPED_TRACE(formatString("With virial handling %d", static_cast<int>(virialHandling)));
+
+        const VsiteResult whole  = run(true, PbcType::No, false, virialHandling);
+        const VsiteResult plainC = run(false, PbcType::Xyz, true, virialHandling);
+        const VsiteResult simd   = run(true, PbcType::Xyz, true, virialHandling);
+
+        compareVectors(plainC.x, simd.x, simdTolerance(), "position of atom");
+        compareVectors(plainC.f, simd.f, simdTolerance(), "force on atom");
+        compareVectors(plainC.fshift, simd.fshift, simdTolerance(), "shift force");
+        compareMatrices(plainC.virial, simd.virial, simdTolerance());
+
+        // The vsites are constructed relative to the first atom, which is not shifted
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            if (ptype_[a] == ParticleType::VSite)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(whole.x[a][d], simd.x[a][d], shiftedAtomsTolerance())
+                            << "for the position of vsite " << a << " dimension " << d;
+                }
+            }
+        }
+        // The forces do not depend on the periodic images
+        compareVectors(whole.f, simd.f, shiftedAtomsTolerance(), "force on atom");
+        if (virialHandling == VirtualSitesHandler::VirialHandling::NonLinear)
+        {
+            compareMatrices(whole.virial, simd.virial, shiftedAtomsTolerance());
+        }
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(WithThreads, VsiteTest, ::testing::Values(1, 2));
+
+} // namespace
+} // namespace test
+} // namespace gmx
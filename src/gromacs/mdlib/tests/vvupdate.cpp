@@ -0,0 +1,402 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for the velocity Verlet velocity and position updates
+ *
+ * The SIMD update is only used when no freeze group freezes only some
+ * dimensions. The tests compare the update with an unused partially
+ * frozen group, which uses the scalar code for all atoms, with the
+ * update using SIMD.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/update.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/fcdata.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/state.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/topology/atoms.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+/*! \brief The number of atoms
+ *
+ * This is more than two fused update blocks of 256 atoms and not
+ * a multiple of any SIMD width, so the remainder of each thread range
+ * is updated with the scalar code.
+ */
+constexpr int c_numAtoms = 601;
+
+//! The index of the freeze group that freezes all dimensions
+constexpr int c_frozenGroup = 1;
+
+//! The names of the update parts
+std::string updatePartName(int updatePart)
+{
+    switch (updatePart)
+    {
+        case etrtVELOCITY1: return "Velocity1";
+        case etrtVELOCITY2: return "Velocity2";
+        case etrtPOSITION: return "Position";
+        case etrtVELOCITY2_AND_POSITION: return "Velocity2AndPosition";
+        default: return "Unknown";
+    }
+}
+
+//! Test data and helpers for comparing the SIMD and the scalar velocity Verlet updates
+class VVUpdateTestData
+{
+public:
+    VVUpdateTestData()
+    {
+        // The SIMD update requires aligned and padded data
+        x_.resizeWithPadding(c_numAtoms);
+        v_.resizeWithPadding(c_numAtoms);
+        f_.resizeWithPadding(c_numAtoms);
+        invMass_.resizeWithPadding(c_numAtoms);
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            x_[a] = { 0.1_real * a, 1.0_real + std::sin(0.7_real * a), 2.0_real };
+            v_[a] = { std::sin(1.3_real * a), std::cos(0.9_real * a), -0.5_real };
+            f_[a] = { 100 * std::cos(2.1_real * a), -50.0_real, 30 * std::sin(1.7_real * a) };
+            // Every seventh atom is frozen in all dimensions and atom 10 is a shell
+            cFREEZE_.push_back(a % 7 == 3 ? c_frozenGroup : 0);
+            ptype_.push_back(a == 10 ? ParticleType::Shell : ParticleType::Atom);
+            invMass_[a] = (a == 10 ? 0 : 1.0_real / (1 + a % 5));
+        }
+    }
+
+    /*! \brief Returns the freeze dimensions per group
+     *
+     * When \p forceScalarUpdate is true, an extra unused freeze group that freezes
+     * only the x-dimension is added, so the scalar update is used for all atoms.
+     */
+    static std::vector<ivec> freezeGroups(bool forceScalarUpdate)
+    {
+        std::vector<ivec> nFreeze(forceScalarUpdate ? 3 : 2);
+        for (int d = 0; d < DIM; d++)
+        {
+            nFreeze[0][d]             = 0;
+            nFreeze[c_frozenGroup][d] = 1;
+            if (forceScalarUpdate)
+            {
+                nFreeze[2][d] = (d == XX) ? 1 : 0;
+            }
+        }
+        return nFreeze;
+    }
+
+    /*! \brief Checks that the scalar and SIMD results match
+     *
+     * Also checks that atoms outside \p start to \p end are not changed
+     * and that frozen atoms and shells are not moved and have zero velocity
+     * after a velocity update.
+     */
+    void checkUpdate(ArrayRef<const RVec> scalarXPrime,
+                     ArrayRef<const RVec> scalarV,
+                     ArrayRef<const RVec> simdXPrime,
+                     ArrayRef<const RVec> simdV,
+                     int                  start,
+                     int                  end,
+                     bool                 haveVelocityUpdate) const
+    {
+        const FloatingPointTolerance tolerance =
+                relativeToleranceAsPrecisionDependentUlp(10.0, 4, 4);
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            const bool isInRange = (a >= start && a < end);
+            const bool isFixed = (cFREEZE_[a] == c_frozenGroup || ptype_[a] == ParticleType::Shell);
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(scalarXPrime[a][d], simdXPrime[a][d], tolerance)
+                        << "for the position of atom " << a << " dimension " << d;
+                EXPECT_REAL_EQ_TOL(scalarV[a][d], simdV[a][d], tolerance)
+                        << "for the velocity of atom " << a << " dimension " << d;
+                if (!isInRange || isFixed)
+                {
+                    EXPECT_EQ(x_[a][d], simdXPrime[a][d]) << "for unchanged atom " << a;
+                }
+                if (!isInRange)
+                {
+                    EXPECT_EQ(v_[a][d], simdV[a][d]) << "for atom " << a << " outside the range";
+                }
+                else if (isFixed && haveVelocityUpdate)
+                {
+                    EXPECT_EQ(0, simdV[a][d]) << "for frozen atom or shell " << a;
+                }
+            }
+        }
+    }
+
+    //! Positions
+    PaddedVector<RVec> x_;
+    //! Velocities
+    PaddedVector<RVec> v_;
+    //! Forces
+    PaddedVector<RVec> f_;
+    //! Freeze group per atom
+    std::vector<unsigned short> cFREEZE_;
+    //! Particle type per atom
+    std::vector<ParticleType> ptype_;
+    //! Inverse mass per atom
+    PaddedVector<real> invMass_;
+};
+
+//! Parameters: the update part, whether the barostat scaling is used and the number of threads
+using VVUpdateTestParameters = std::tuple<int, bool, int>;
+
+//! Test fixture comparing the SIMD and the scalar velocity Verlet updates in Update
+class VVUpdateTest :
+    public VVUpdateTestData,
+    public ::testing::TestWithParam<VVUpdateTestParameters>
+{
+public:
+    //! Performs one update of \p updatePart and returns the updated positions and velocities
+    void runUpdate(int                updatePart,
+                   bool               useBarostatScaling,
+                   int                numThreads,
+                   bool               forceScalarUpdate,
+                   std::vector<RVec>* xPrime,
+                   std::vector<RVec>* v)
+    {
+        const std::vector<ivec> nFreeze = freezeGroups(forceScalarUpdate);
+
+        t_inputrec ir;
+        ir.eI      = IntegrationAlgorithm::VV;
+        ir.delta_t = 0.002;
+        // Nose-Hoover coupling turns on the scaling with the barostat velocity
+        ir.etc = useBarostatScaling ? TemperatureCoupling::NoseHoover : TemperatureCoupling::No;
+        ir.opts.ngfrz = nFreeze.size();
+        // The update only uses the degrees of freedom of the first group
+        snew(ir.opts.nrdf, 1);
+        ir.opts.nrdf[0] = 3 * c_numAtoms - 3;
+        snew(ir.opts.nFreeze, ir.opts.ngfrz);
+        for (int g = 0; g < ir.opts.ngfrz; g++)
+        {
+            copy_ivec(nFreeze[g], ir.opts.nFreeze[g]);
+        }
+
+        t_state state;
+        state.flags = 0;
+        state.x.resizeWithPadding(c_numAtoms);
+        state.v.resizeWithPadding(c_numAtoms);
+        std::copy(x_.begin(), x_.end(), state.x.begin());
+        std::copy(v_.begin(), v_.end(), state.v.begin());
+        state.veta = 0.3;
+
+        t_commrec cr;
+        cr.nnodes = 1;
+        cr.dd     = nullptr;
+        t_fcdata fcdata;
+        matrix   M = { { 0 } };
+
+        gmx_omp_nthreads_set(ModuleMultiThread::Update, numThreads);
+
+        Update upd(ir, nullptr);
+        upd.updateAfterPartition(c_numAtoms, cFREEZE_, {});
+        // Without a position update, the updated positions should stay at x
+        std::copy(x_.begin(), x_.end(), upd.xp()->begin());
+        upd.update_coords(ir,
+                          7,
+                          c_numAtoms,
+                          false,
+                          ptype_,
+                          invMass_,
+                          {},
+                          &state,
+                          f_.arrayRefWithPadding(),
+                          fcdata,
+                          nullptr,
+                          M,
+                          updatePart,
+                          &cr,
+                          false);
+
+        const auto xp = makeArrayRef(*upd.xp()).subArray(0, c_numAtoms);
+        xPrime->assign(xp.begin(), xp.end());
+        v->assign(state.v.begin(), state.v.begin() + c_numAtoms);
+    }
+};
+
+TEST_P(VVUpdateTest, SimdMatchesScalar)
+{
+    const int  updatePart         = std::get<0>(GetParam());
+    const bool useBarostatScaling = std::get<1>(GetParam());
+    const int  numThreads         = std::get<2>(GetParam());
+
+    std::vector<RVec> scalarXPrime;
+    std::vector<RVec> scalarV;
+    runUpdate(updatePart, useBarostatScaling, numThreads, true, &scalarXPrime, &scalarV);
+
+    std::vector<RVec> simdXPrime;
+    std::vector<RVec> simdV;
+    runUpdate(updatePart, useBarostatScaling, numThreads, false, &simdXPrime, &simdV);
+
+    const bool haveVelocityUpdate = (updatePart != etrtPOSITION);
+    checkUpdate(scalarXPrime, scalarV, simdXPrime, simdV, 0, c_numAtoms, haveVelocityUpdate);
+}
+
+//! Returns a readable name for the test parameters
+std::string nameOfTest(const ::testing::TestParamInfo<VVUpdateTestParameters>& info)
+{
+    return formatString("%s_%s_%dThreads",
+                        updatePartName(std::get<0>(info.param)).c_str(),
+                        std::get<1>(info.param) ? "BarostatScaling" : "NoScaling",
+                        std::get<2>(info.param));
+}
+
+INSTANTIATE_TEST_CASE_P(WithParameters,
+                        VVUpdateTest,
+                        ::testing::Combine(::testing::Values(etrtVELOCITY1,
+                                                             etrtVELOCITY2,
+                                                             etrtPOSITION,
+                                                             etrtVELOCITY2_AND_POSITION),
+                                           ::testing::Bool(),
+                                           ::testing::Values(1, 2, 3)),
+                        nameOfTest);
+
+//! Parameters: the start of the range and the number of atoms in the range
+using VVUpdateRangeTestParameters = std::tuple<int, int>;
+
+/*! \brief Test fixture for the velocity Verlet updates of atom ranges
+ *
+ * The ranges need not start at a SIMD aligned atom and can have a tail
+ * that is not a multiple of the SIMD width.
+ */
+class VVUpdateRangeTest :
+    public VVUpdateTestData,
+    public ::testing::TestWithParam<VVUpdateRangeTestParameters>
+{
+public:
+    //! Updates velocities and positions of atoms \p start to \p end and returns them
+    void runUpdate(int                start,
+                   int                end,
+                   bool               forceScalarUpdate,
+                   std::vector<RVec>* xPrime,
+                   std::vector<RVec>* v)
+    {
+        const std::vector<ivec> nFreeze = freezeGroups(forceScalarUpdate);
+
+        const real dt    = 0.002;
+        const real veta  = 0.3;
+        const real alpha = 1.01;
+
+        PaddedVector<RVec> xPrimeWork(x_);
+        PaddedVector<RVec> vWork(v_);
+        doVVVelocityUpdate(start,
+                           end,
+                           dt,
+                           nFreeze,
+                           invMass_,
+                           ptype_,
+                           cFREEZE_,
+                           as_rvec_array(vWork.data()),
+                           as_rvec_array(f_.data()),
+                           true,
+                           veta,
+                           alpha);
+        doVVPositionUpdate(start,
+                           end,
+                           dt,
+                           nFreeze,
+                           ptype_,
+                           cFREEZE_,
+                           as_rvec_array(x_.data()),
+                           as_rvec_array(xPrimeWork.data()),
+                           as_rvec_array(vWork.data()),
+                           true,
+                           veta);
+        xPrime->assign(xPrimeWork.begin(), xPrimeWork.begin() + c_numAtoms);
+        v->assign(vWork.begin(), vWork.begin() + c_numAtoms);
+    }
+};
+
+TEST_P(VVUpdateRangeTest, SimdMatchesScalar)
+{
+    const int start = std::get<0>(GetParam());
+    const int end   = start + std::get<1>(GetParam());
+    ASSERT_LE(end, c_numAtoms);
+
+    std::vector<RVec> scalarXPrime;
+    std::vector<RVec> scalarV;
+    runUpdate(start, end, true, &scalarXPrime, &scalarV);
+
+    std::vector<RVec> simdXPrime;
+    std::vector<RVec> simdV;
+    runUpdate(start, end, false, &simdXPrime, &simdV);
+
+    checkUpdate(scalarXPrime, scalarV, simdXPrime, simdV, start, end, true);
+}
+
+/* The ranges cover an aligned start with a tail, unaligned starts with
+ * and without a tail, a range within a single SIMD block and an empty range.
+ * The shell at atom 10 is in the unaligned head for the wider SIMD widths.
+ */
+INSTANTIATE_TEST_CASE_P(WithRanges,
+                        VVUpdateRangeTest,
+                        ::testing::Values(std::make_tuple(0, 3 * GMX_SIMD_REAL_WIDTH + 5),
+                                          std::make_tuple(3, 4 * GMX_SIMD_REAL_WIDTH + 7),
+                                          std::make_tuple(5, 2 * GMX_SIMD_REAL_WIDTH - 5),
+                                          std::make_tuple(GMX_SIMD_REAL_WIDTH + 1, 2),
+                                          std::make_tuple(7, 0)));
+
+} // namespace
+} // namespace test
+} // namespace gmx
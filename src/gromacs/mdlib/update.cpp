@@ -57,6 +57,7 @@
 #include "gromacs/mdlib/boxdeformation.h"
 #include "gromacs/mdlib/constr.h"
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/settle.h"
 #include "gromacs/mdlib/stat.h"
 #include "gromacs/mdlib/tgroup.h"
 #include "gromacs/mdtypes/commrec.h"
@@ -129,6 +130,23 @@ public:
                        const t_commrec*                                 cr,
                        bool                                             haveConstraints);
 
+    bool canFuseUpdateAndSettle(const t_inputrec& inputRecord, const Constraints* constr) const;
+
+    bool update_coords_settle_and_finish(const t_inputrec&         inputRecord,
+                                         int64_t                   step,
+                                         int                       homenr,
+                                         bool                      havePartiallyFrozenAtoms,
+                                         gmx::ArrayRef<const real> invMass,
+                                         gmx::ArrayRef<const rvec> invMassPerDim,
+                                         t_state*                  state,
+                                         const gmx::ArrayRefWithPadding<const gmx::RVec>& f,
+                                         const t_fcdata&                                  fcdata,
+                                         const gmx_ekindata_t*                            ekind,
+                                         const matrix                                     M,
+                                         Constraints*                                     constr,
+                                         bool   computeVirial,
+                                         tensor constraintsVirial);
+
     void finish_update(const t_inputrec&                   inputRecord,
                        bool                                havePartiallyFrozenAtoms,
                        int                                 homenr,
@@ -182,6 +200,19 @@ private:
     PaddedVector<RVec> xp_;
     //! Box deformation handler (or nullptr if inactive).
     BoxDeformation* deform_ = nullptr;
+    //! Whether the user requested fusing the update with SETTLE
+    bool fuseUpdateAndSettle_;
+
+    //! Thread-local output of SETTLE in the fused update
+    struct FusedSettleThreadData
+    {
+        //! The constraint virial contribution, sum r x m delta_r
+        tensor virial;
+        //! Whether a settle error occurred
+        bool errorHasOccurred;
+    };
+    //! Thread-local SETTLE output for the fused update
+    std::vector<FusedSettleThreadData> fusedSettleThreadData_;
 };
 
 Update::Update(const t_inputrec& inputRecord, BoxDeformation* boxDeformation) :
@@ -242,6 +273,42 @@ void Update::update_coords(const t_inputrec&                 inputRecord,
                                 haveConstraints);
 }
 
+bool Update::canFuseUpdateAndSettle(const t_inputrec& inputRecord, const Constraints* constr) const
+{
+    return impl_->canFuseUpdateAndSettle(inputRecord, constr);
+}
+
+bool Update::update_coords_settle_and_finish(const t_inputrec&         inputRecord,
+                                             int64_t                   step,
+                                             const int                 homenr,
+                                             const bool                havePartiallyFrozenAtoms,
+                                             gmx::ArrayRef<const real> invMass,
+                                             gmx::ArrayRef<const rvec> invMassPerDim,
+                                             t_state*                  state,
+                                             const gmx::ArrayRefWithPadding<const gmx::RVec>& f,
+                                             const t_fcdata&       fcdata,
+                                             const gmx_ekindata_t* ekind,
+                                             const matrix          M,
+                                             Constraints*          constr,
+                                             const bool            computeVirial,
+                                             tensor                constraintsVirial)
+{
+    return impl_->update_coords_settle_and_finish(inputRecord,
+                                                  step,
+                                                  homenr,
+                                                  havePartiallyFrozenAtoms,
+                                                  invMass,
+                                                  invMassPerDim,
+                                                  state,
+                                                  f,
+                                                  fcdata,
+                                                  ekind,
+                                                  M,
+                                                  constr,
+                                                  computeVirial,
+                                                  constraintsVirial);
+}
+
 void Update::finish_update(const t_inputrec& inputRecord,
                            const bool        havePartiallyFrozenAtoms,
                            const int         homenr,
@@ -1001,7 +1068,9 @@ void Update::Impl::update_temperature_constants(const t_inputrec& inputRecord)
 }
 
 Update::Impl::Impl(const t_inputrec& inputRecord, BoxDeformation* boxDeformation) :
-    sd_(inputRecord), deform_(boxDeformation)
+    sd_(inputRecord),
+    deform_(boxDeformation),
+    fuseUpdateAndSettle_(getenv("GMX_FUSE_UPDATE_SETTLE") != nullptr)
 {
     update_temperature_constants(inputRecord);
     xp_.resizeWithPadding(0);
@@ -1136,6 +1205,555 @@ static void doSDUpdateGeneral(const gmx_stochd_t&                 sd,
     }
 }
 
+#if GMX_HAVE_SIMD_UPDATE
+
+//! Returns whether any freeze group freezes only some of the dimensions
+static bool havePartiallyFrozenGroups(gmx::ArrayRef<const ivec> nFreeze)
+{
+    return std::any_of(nFreeze.begin(), nFreeze.end(), [](const ivec& freeze) {
+        return freeze[YY] != freeze[XX] || freeze[ZZ] != freeze[XX];
+    });
+}
+
+/*! \brief Draws the noise for GMX_SIMD_REAL_WIDTH atoms starting at \p a0
+ *
+ * The noise for each atom is drawn from the same random stream, seeded with
+ * the step and the global atom index, as in the scalar updates. Thus results
+ * are identical between the SIMD and scalar paths and independent of
+ * the number of threads.
+ *
+ * \param[in,out] rng       The random engine
+ * \param[in,out] dist      The normal distribution
+ * \param[in]     step      The MD step
+ * \param[in]     a0        The first atom
+ * \param[in]     gatindex  Global atom indices, can be nullptr
+ * \param[out]    noise     DIM normally distributed numbers per atom
+ */
+static inline void drawNoiseForSimdBlock(gmx::ThreeFry2x64<0>*                       rng,
+                                         gmx::TabulatedNormalDistribution<real, 14>* dist,
+                                         int64_t                                     step,
+                                         int                                         a0,
+                                         const int*                                  gatindex,
+                                         real*                                       noise)
+{
+    for (int i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        const int n = a0 + i;
+        rng->restart(step, gatindex ? gatindex[n] : n);
+        dist->reset();
+        for (int d = 0; d < DIM; d++)
+        {
+            noise[DIM * i + d] = (*dist)(*rng);
+        }
+    }
+}
+
+/*! \brief Loads GMX_SIMD_REAL_WIDTH per-atom values and expands them to the rvec layout */
+static inline void
+loadAndExpandToTriplets(const real* values, SimdReal* v0, SimdReal* v1, SimdReal* v2)
+{
+    expandScalarsToTriplets(simdLoad(values), v0, v1, v2);
+}
+
+/*! \brief SD integrator update using SIMD
+ *
+ * Same as doSDUpdateGeneral(), but requires that no freeze group freezes only
+ * some dimensions and that \p start and \p nrend - \p start are multiples of
+ * GMX_SIMD_REAL_WIDTH. Frozen atoms and shells are handled with masks.
+ */
+template<SDUpdate updateType>
+static void doSDUpdateSimd(const gmx_stochd_t&                 sd,
+                           int                                 start,
+                           int                                 nrend,
+                           real                                dt,
+                           gmx::ArrayRef<const ivec>           nFreeze,
+                           gmx::ArrayRef<const real>           invmass,
+                           gmx::ArrayRef<const ParticleType>   ptype,
+                           gmx::ArrayRef<const unsigned short> cFREEZE,
+                           gmx::ArrayRef<const unsigned short> cTC,
+                           const rvec                          x[],
+                           rvec                                xprime[],
+                           rvec                                v[],
+                           const rvec                          f[],
+                           int64_t                             step,
+                           int                                 seed,
+                           const int*                          gatindex)
+{
+    GMX_ASSERT((nrend - start) % GMX_SIMD_REAL_WIDTH == 0,
+               "The atom range should be a multiple of the SIMD width");
+
+    gmx::ThreeFry2x64<0>                       rng(seed, gmx::RandomDomain::UpdateCoordinates);
+    gmx::TabulatedNormalDistribution<real, 14> dist;
+
+    alignas(GMX_SIMD_ALIGNMENT) real isActive[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real frictionFactor[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real noiseFactor[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real noise[DIM * GMX_SIMD_REAL_WIDTH];
+
+    const SimdReal timestep(dt);
+    const SimdReal halfTimestep(0.5_real * dt);
+    const SimdReal zero(0.0_real);
+
+    for (int a = start; a < nrend; a += GMX_SIMD_REAL_WIDTH)
+    {
+        for (int i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+        {
+            const int n           = a + i;
+            const int freezeGroup = !cFREEZE.empty() ? cFREEZE[n] : 0;
+            isActive[i] = (ptype[n] != ParticleType::Shell && !nFreeze[freezeGroup][XX]) ? 1 : 0;
+            if (updateType != SDUpdate::ForcesOnly)
+            {
+                const int temperatureGroup = !cTC.empty() ? cTC[n] : 0;
+                frictionFactor[i]          = sd.sdc[temperatureGroup].em;
+                noiseFactor[i] = std::sqrt(invmass[n]) * sd.sdsig[temperatureGroup].V;
+            }
+        }
+        if (updateType != SDUpdate::ForcesOnly)
+        {
+            drawNoiseForSimdBlock(&rng, &dist, step, a, gatindex, noise);
+        }
+
+        SimdReal isActive0, isActive1, isActive2;
+        loadAndExpandToTriplets(isActive, &isActive0, &isActive1, &isActive2);
+        const SimdBool active0 = (zero < isActive0);
+        const SimdBool active1 = (zero < isActive1);
+        const SimdBool active2 = (zero < isActive2);
+
+        SimdReal v0, v1, v2;
+        simdLoadRvecs(v, a, &v0, &v1, &v2);
+
+        SimdReal vn0 = v0;
+        SimdReal vn1 = v1;
+        SimdReal vn2 = v2;
+        if (updateType != SDUpdate::FrictionAndNoiseOnly)
+        {
+            SimdReal invMass0, invMass1, invMass2;
+            loadAndExpandToTriplets(invmass.data() + a, &invMass0, &invMass1, &invMass2);
+            SimdReal f0, f1, f2;
+            simdLoadRvecs(f, a, &f0, &f1, &f2);
+            vn0 = v0 + invMass0 * f0 * timestep;
+            vn1 = v1 + invMass1 * f1 * timestep;
+            vn2 = v2 + invMass2 * f2 * timestep;
+        }
+
+        SimdReal vNew0 = vn0;
+        SimdReal vNew1 = vn1;
+        SimdReal vNew2 = vn2;
+        if (updateType != SDUpdate::ForcesOnly)
+        {
+            SimdReal em0, em1, em2;
+            loadAndExpandToTriplets(frictionFactor, &em0, &em1, &em2);
+            SimdReal sigma0, sigma1, sigma2;
+            loadAndExpandToTriplets(noiseFactor, &sigma0, &sigma1, &sigma2);
+            vNew0 = vn0 * em0 + sigma0 * simdLoad(noise);
+            vNew1 = vn1 * em1 + sigma1 * simdLoad(noise + GMX_SIMD_REAL_WIDTH);
+            vNew2 = vn2 * em2 + sigma2 * simdLoad(noise + 2 * GMX_SIMD_REAL_WIDTH);
+        }
+
+        SimdReal xprime0, xprime1, xprime2;
+        if (updateType == SDUpdate::FrictionAndNoiseOnly)
+        {
+            // The previous phase already updated the positions with a full v*dt term
+            // that must now be half removed, inactive atoms are left unchanged.
+            simdLoadRvecs(xprime, a, &xprime0, &xprime1, &xprime2);
+            xprime0 = xprime0 + selectByMask((vNew0 - vn0) * halfTimestep, active0);
+            xprime1 = xprime1 + selectByMask((vNew1 - vn1) * halfTimestep, active1);
+            xprime2 = xprime2 + selectByMask((vNew2 - vn2) * halfTimestep, active2);
+            vNew0   = blend(v0, vNew0, active0);
+            vNew1   = blend(v1, vNew1, active1);
+            vNew2   = blend(v2, vNew2, active2);
+        }
+        else
+        {
+            SimdReal x0, x1, x2;
+            simdLoadRvecs(x, a, &x0, &x1, &x2);
+            // Inactive atoms get zero velocity and keep their position
+            vNew0 = selectByMask(vNew0, active0);
+            vNew1 = selectByMask(vNew1, active1);
+            vNew2 = selectByMask(vNew2, active2);
+            if (updateType == SDUpdate::ForcesOnly)
+            {
+                xprime0 = x0 + vNew0 * timestep;
+                xprime1 = x1 + vNew1 * timestep;
+                xprime2 = x2 + vNew2 * timestep;
+            }
+            else
+            {
+                // Here we include half of the friction+noise update of v into the position update
+                xprime0 = x0 + selectByMask(vn0 + vNew0, active0) * halfTimestep;
+                xprime1 = x1 + selectByMask(vn1 + vNew1, active1) * halfTimestep;
+                xprime2 = x2 + selectByMask(vn2 + vNew2, active2) * halfTimestep;
+            }
+        }
+
+        simdStoreRvecs(v, a, vNew0, vNew1, vNew2);
+        simdStoreRvecs(xprime, a, xprime0, xprime1, xprime2);
+    }
+}
+
+/*! \brief BD integrator update using SIMD
+ *
+ * Same as the loop in do_update_bd(), but requires that no freeze group freezes
+ * only some dimensions and that \p start and \p nrend - \p start are multiples
+ * of GMX_SIMD_REAL_WIDTH.
+ */
+static void doBDUpdateSimd(int                                 start,
+                           int                                 nrend,
+                           real                                dt,
+                           int64_t                             step,
+                           const rvec* gmx_restrict            x,
+                           rvec* gmx_restrict                  xprime,
+                           rvec* gmx_restrict                  v,
+                           const rvec* gmx_restrict            f,
+                           gmx::ArrayRef<const ivec>           nFreeze,
+                           gmx::ArrayRef<const real>           invmass,
+                           gmx::ArrayRef<const ParticleType>   ptype,
+                           gmx::ArrayRef<const unsigned short> cFREEZE,
+                           gmx::ArrayRef<const unsigned short> cTC,
+                           real                                friction_coefficient,
+                           const real*                         rf,
+                           int                                 seed,
+                           const int*                          gatindex)
+{
+    GMX_ASSERT((nrend - start) % GMX_SIMD_REAL_WIDTH == 0,
+               "The atom range should be a multiple of the SIMD width");
+
+    gmx::ThreeFry2x64<0>                       rng(seed, gmx::RandomDomain::UpdateCoordinates);
+    gmx::TabulatedNormalDistribution<real, 14> dist;
+
+    alignas(GMX_SIMD_ALIGNMENT) real isActive[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real forceFactor[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real noiseFactor[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real noise[DIM * GMX_SIMD_REAL_WIDTH];
+
+    const real     invfr = (friction_coefficient != 0) ? 1.0_real / friction_coefficient : 0.0_real;
+    const SimdReal timestep(dt);
+    /* Without friction coefficient, the force term also includes the time step */
+    const SimdReal forceTimestep(friction_coefficient != 0 ? 1.0_real : dt);
+    const SimdReal zero(0.0_real);
+
+    for (int a = start; a < nrend; a += GMX_SIMD_REAL_WIDTH)
+    {
+        for (int i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+        {
+            const int n  = a + i;
+            const int gf = !cFREEZE.empty() ? cFREEZE[n] : 0;
+            const int gt = !cTC.empty() ? cTC[n] : 0;
+            isActive[i]  = (ptype[n] != ParticleType::Shell && !nFreeze[gf][XX]) ? 1 : 0;
+            if (friction_coefficient != 0)
+            {
+                forceFactor[i] = invfr;
+                noiseFactor[i] = rf[gt];
+            }
+            else
+            {
+                /* NOTE: invmass = 2/(mass*friction_constant*dt) */
+                forceFactor[i] = 0.5 * invmass[n];
+                noiseFactor[i] = std::sqrt(0.5 * invmass[n]) * rf[gt];
+            }
+        }
+        drawNoiseForSimdBlock(&rng, &dist, step, a, gatindex, noise);
+
+        SimdReal isActive0, isActive1, isActive2;
+        loadAndExpandToTriplets(isActive, &isActive0, &isActive1, &isActive2);
+        SimdReal forceFactor0, forceFactor1, forceFactor2;
+        loadAndExpandToTriplets(forceFactor, &forceFactor0, &forceFactor1, &forceFactor2);
+        SimdReal noiseFactor0, noiseFactor1, noiseFactor2;
+        loadAndExpandToTriplets(noiseFactor, &noiseFactor0, &noiseFactor1, &noiseFactor2);
+
+        SimdReal f0, f1, f2;
+        simdLoadRvecs(f, a, &f0, &f1, &f2);
+        SimdReal vn0 = forceFactor0 * f0 * forceTimestep + noiseFactor0 * simdLoad(noise);
+        SimdReal vn1 = forceFactor1 * f1 * forceTimestep
+                       + noiseFactor1 * simdLoad(noise + GMX_SIMD_REAL_WIDTH);
+        SimdReal vn2 = forceFactor2 * f2 * forceTimestep
+                       + noiseFactor2 * simdLoad(noise + 2 * GMX_SIMD_REAL_WIDTH);
+        vn0 = selectByMask(vn0, zero < isActive0);
+        vn1 = selectByMask(vn1, zero < isActive1);
+        vn2 = selectByMask(vn2, zero < isActive2);
+
+        SimdReal x0, x1, x2;
+        simdLoadRvecs(x, a, &x0, &x1, &x2);
+        simdStoreRvecs(v, a, vn0, vn1, vn2);
+        simdStoreRvecs(xprime, a, x0 + vn0 * timestep, x1 + vn1 * timestep, x2 + vn2 * timestep);
+    }
+}
+
+/*! \brief Velocity half-step update for velocity Verlet using SIMD
+ *
+ * Same as the loop in do_update_vv_vel(), but requires that no freeze group
+ * freezes only some dimensions and that \p start and \p nrend - \p start are
+ * multiples of GMX_SIMD_REAL_WIDTH.
+ */
+static void doVVVelocityUpdateSimd(int                                 start,
+                                   int                                 nrend,
+                                   real                                dt,
+                                   gmx::ArrayRef<const ivec>           nFreeze,
+                                   gmx::ArrayRef<const real>           invmass,
+                                   gmx::ArrayRef<const ParticleType>   ptype,
+                                   gmx::ArrayRef<const unsigned short> cFREEZE,
+                                   rvec* gmx_restrict                  v,
+                                   const rvec* gmx_restrict            f,
+                                   gmx_bool                            bExtended,
+                                   real                                veta,
+                                   real                                alpha)
+{
+    GMX_ASSERT((nrend - start) % GMX_SIMD_REAL_WIDTH == 0,
+               "The atom range should be a multiple of the SIMD width");
+
+    real mv1 = 1.0;
+    real mv2 = 1.0;
+    if (bExtended)
+    {
+        const real g = 0.25 * dt * veta * alpha;
+        mv1          = std::exp(-g);
+        mv2          = gmx::series_sinhx(g);
+    }
+
+    alignas(GMX_SIMD_ALIGNMENT) real isActive[GMX_SIMD_REAL_WIDTH];
+
+    const SimdReal velocityScaling(mv1);
+    const SimdReal forceFactor(0.5_real * dt * mv2);
+    const SimdReal zero(0.0_real);
+
+    for (int a = start; a < nrend; a += GMX_SIMD_REAL_WIDTH)
+    {
+        for (int i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+        {
+            const int n  = a + i;
+            const int gf = !cFREEZE.empty() ? cFREEZE[n] : 0;
+            isActive[i]  = (ptype[n] != ParticleType::Shell && !nFreeze[gf][XX]) ? 1 : 0;
+        }
+
+        SimdReal isActive0, isActive1, isActive2;
+        loadAndExpandToTriplets(isActive, &isActive0, &isActive1, &isActive2);
+        SimdReal invMass0, invMass1, invMass2;
+        loadAndExpandToTriplets(invmass.data() + a, &invMass0, &invMass1, &invMass2);
+
+        SimdReal v0, v1, v2;
+        SimdReal f0, f1, f2;
+        simdLoadRvecs(v, a, &v0, &v1, &v2);
+        simdLoadRvecs(f, a, &f0, &f1, &f2);
+
+        v0 = velocityScaling * fma(invMass0 * f0, forceFactor, velocityScaling * v0);
+        v1 = velocityScaling * fma(invMass1 * f1, forceFactor, velocityScaling * v1);
+        v2 = velocityScaling * fma(invMass2 * f2, forceFactor, velocityScaling * v2);
+
+        // Inactive atoms get zero velocity
+        simdStoreRvecs(v,
+                       a,
+                       selectByMask(v0, zero < isActive0),
+                       selectByMask(v1, zero < isActive1),
+                       selectByMask(v2, zero < isActive2));
+    }
+}
+
+/*! \brief Position update for velocity Verlet using SIMD
+ *
+ * Same as the loop in do_update_vv_pos(), but requires that no freeze group
+ * freezes only some dimensions and that \p start and \p nrend - \p start are
+ * multiples of GMX_SIMD_REAL_WIDTH.
+ */
+static void doVVPositionUpdateSimd(int                                 start,
+                                   int                                 nrend,
+                                   real                                dt,
+                                   gmx::ArrayRef<const ivec>           nFreeze,
+                                   gmx::ArrayRef<const ParticleType>   ptype,
+                                   gmx::ArrayRef<const unsigned short> cFREEZE,
+                                   const rvec* gmx_restrict            x,
+                                   rvec* gmx_restrict                  xprime,
+                                   const rvec* gmx_restrict            v,
+                                   gmx_bool                            bExtended,
+                                   real                                veta)
+{
+    GMX_ASSERT((nrend - start) % GMX_SIMD_REAL_WIDTH == 0,
+               "The atom range should be a multiple of the SIMD width");
+
+    real mr1 = 1.0;
+    real mr2 = 1.0;
+    if (bExtended)
+    {
+        const real g = 0.5 * dt * veta;
+        mr1          = std::exp(g);
+        mr2          = gmx::series_sinhx(g);
+    }
+
+    alignas(GMX_SIMD_ALIGNMENT) real isActive[GMX_SIMD_REAL_WIDTH];
+
+    const SimdReal positionScaling(mr1);
+    const SimdReal velocityFactor(mr2 * dt);
+    const SimdReal zero(0.0_real);
+
+    for (int a = start; a < nrend; a += GMX_SIMD_REAL_WIDTH)
+    {
+        for (int i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+        {
+            const int n  = a + i;
+            const int gf = !cFREEZE.empty() ? cFREEZE[n] : 0;
+            isActive[i]  = (ptype[n] != ParticleType::Shell && !nFreeze[gf][XX]) ? 1 : 0;
+        }
+
+        SimdReal isActive0, isActive1, isActive2;
+        loadAndExpandToTriplets(isActive, &isActive0, &isActive1, &isActive2);
+
+        SimdReal x0, x1, x2;
+        SimdReal v0, v1, v2;
+        simdLoadRvecs(x, a, &x0, &x1, &x2);
+        simdLoadRvecs(v, a, &v0, &v1, &v2);
+
+        // Inactive atoms keep their position
+        const SimdReal xprime0 = positionScaling * fma(v0, velocityFactor, positionScaling * x0);
+        const SimdReal xprime1 = positionScaling * fma(v1, velocityFactor, positionScaling * x1);
+        const SimdReal xprime2 = positionScaling * fma(v2, velocityFactor, positionScaling * x2);
+        simdStoreRvecs(xprime,
+                       a,
+                       blend(x0, xprime0, zero < isActive0),
+                       blend(x1, xprime1, zero < isActive1),
+                       blend(x2, xprime2, zero < isActive2));
+    }
+}
+
+#endif // GMX_HAVE_SIMD_UPDATE
+
+/*! \brief SD integrator update, using SIMD when possible
+ *
+ * Parameters are as for doSDUpdateGeneral(). The SIMD update is used for
+ * whole SIMD blocks of atoms when no freeze group freezes only some dimensions,
+ * the remaining atoms are updated with doSDUpdateGeneral(). Note that \p start
+ * should be aligned to the SIMD width, as given by getThreadAtomRange().
+ */
+template<SDUpdate updateType>
+static void doSDUpdate(const gmx_stochd_t&                 sd,
+                       int                                 start,
+                       int                                 nrend,
+                       real                                dt,
+                       gmx::ArrayRef<const ivec>           nFreeze,
+                       gmx::ArrayRef<const real>           invmass,
+                       gmx::ArrayRef<const ParticleType>   ptype,
+                       gmx::ArrayRef<const unsigned short> cFREEZE,
+                       gmx::ArrayRef<const unsigned short> cTC,
+                       const rvec                          x[],
+                       rvec                                xprime[],
+                       rvec                                v[],
+                       const rvec                          f[],
+                       int64_t                             step,
+                       int                                 seed,
+                       const int*                          gatindex)
+{
+    int simdEnd = start;
+#if GMX_HAVE_SIMD_UPDATE
+    if (!havePartiallyFrozenGroups(nFreeze))
+    {
+        simdEnd = start + ((nrend - start) / GMX_SIMD_REAL_WIDTH) * GMX_SIMD_REAL_WIDTH;
+        doSDUpdateSimd<updateType>(sd,
+                                   start,
+                                   simdEnd,
+                                   dt,
+                                   nFreeze,
+                                   invmass,
+                                   ptype,
+                                   cFREEZE,
+                                   cTC,
+                                   x,
+                                   xprime,
+                                   v,
+                                   f,
+                                   step,
+                                   seed,
+                                   gatindex);
+    }
+#endif
+    doSDUpdateGeneral<updateType>(sd,
+                                  simdEnd,
+                                  nrend,
+                                  dt,
+                                  nFreeze,
+                                  invmass,
+                                  ptype,
+                                  cFREEZE,
+                                  cTC,
+                                  x,
+                                  xprime,
+                                  v,
+                                  f,
+                                  step,
+                                  seed,
+                                  gatindex);
+}
+
+void doVVVelocityUpdate(int                                 start,
+                        int                                 nrend,
+                        real                                dt,
+                        gmx::ArrayRef<const ivec>           nFreeze,
+                        gmx::ArrayRef<const real>           invmass,
+                        gmx::ArrayRef<const ParticleType>   ptype,
+                        gmx::ArrayRef<const unsigned short> cFREEZE,
+                        rvec                                v[],
+                        const rvec                          f[],
+                        bool                                bExtended,
+                        real                                veta,
+                        real                                alpha)
+{
+    int simdStart = nrend;
+    int simdEnd   = nrend;
+#if GMX_HAVE_SIMD_UPDATE
+    if (!havePartiallyFrozenGroups(nFreeze))
+    {
+        // The SIMD update requires a SIMD aligned start
+        constexpr int width = GMX_SIMD_REAL_WIDTH;
+        simdStart           = std::min(((start + width - 1) / width) * width, nrend);
+        simdEnd             = simdStart + ((nrend - simdStart) / width) * width;
+        doVVVelocityUpdateSimd(simdStart,
+                               simdEnd,
+                               dt,
+                               nFreeze,
+                               invmass,
+                               ptype,
+                               cFREEZE,
+                               v,
+                               f,
+                               bExtended,
+                               veta,
+                               alpha);
+    }
+#endif
+    // Update the unaligned head and the tail with the scalar code
+    do_update_vv_vel(
+            start, simdStart, dt, nFreeze, invmass, ptype, cFREEZE, v, f, bExtended, veta, alpha);
+    do_update_vv_vel(
+            simdEnd, nrend, dt, nFreeze, invmass, ptype, cFREEZE, v, f, bExtended, veta, alpha);
+}
+
+void doVVPositionUpdate(int                                 start,
+                        int                                 nrend,
+                        real                                dt,
+                        gmx::ArrayRef<const ivec>           nFreeze,
+                        gmx::ArrayRef<const ParticleType>   ptype,
+                        gmx::ArrayRef<const unsigned short> cFREEZE,
+                        const rvec                          x[],
+                        rvec                                xprime[],
+                        const rvec                          v[],
+                        bool                                bExtended,
+                        real                                veta)
+{
+    int simdStart = nrend;
+    int simdEnd   = nrend;
+#if GMX_HAVE_SIMD_UPDATE
+    if (!havePartiallyFrozenGroups(nFreeze))
+    {
+        // The SIMD update requires a SIMD aligned start
+        constexpr int width = GMX_SIMD_REAL_WIDTH;
+        simdStart           = std::min(((start + width - 1) / width) * width, nrend);
+        simdEnd             = simdStart + ((nrend - simdStart) / width) * width;
+        doVVPositionUpdateSimd(
+                simdStart, simdEnd, dt, nFreeze, ptype, cFREEZE, x, xprime, v, bExtended, veta);
+    }
+#endif
+    // Update the unaligned head and the tail with the scalar code
+    do_update_vv_pos(start, simdStart, dt, nFreeze, ptype, cFREEZE, x, xprime, v, bExtended, veta);
+    do_update_vv_pos(simdEnd, nrend, dt, nFreeze, ptype, cFREEZE, x, xprime, v, bExtended, veta);
+}
+
 static void do_update_sd(int                                 start,
                          int                                 nrend,
                          real                                dt,
@@ -1157,41 +1775,41 @@ static void do_update_sd(int                                 start,
     if (haveConstraints)
     {
         // With constraints, the SD update is done in 2 parts
-        doSDUpdateGeneral<SDUpdate::ForcesOnly>(sd,
-                                                start,
-                                                nrend,
-                                                dt,
-                                                nFreeze,
-                                                invmass,
-                                                ptype,
-                                                cFREEZE,
-                                                gmx::ArrayRef<const unsigned short>(),
-                                                x,
-                                                xprime,
-                                                v,
-                                                f,
-                                                step,
-                                                seed,
-                                                nullptr);
+        doSDUpdate<SDUpdate::ForcesOnly>(sd,
+                                         start,
+                                         nrend,
+                                         dt,
+                                         nFreeze,
+                                         invmass,
+                                         ptype,
+                                         cFREEZE,
+                                         gmx::ArrayRef<const unsigned short>(),
+                                         x,
+                                         xprime,
+                                         v,
+                                         f,
+                                         step,
+                                         seed,
+                                         nullptr);
     }
     else
     {
-        doSDUpdateGeneral<SDUpdate::Combined>(sd,
-                                              start,
-                                              nrend,
-                                              dt,
-                                              nFreeze,
-                                              invmass,
-                                              ptype,
-                                              cFREEZE,
-                                              cTC,
-                                              x,
-                                              xprime,
-                                              v,
-                                              f,
-                                              step,
-                                              seed,
-                                              DOMAINDECOMP(cr) ? cr->dd->globalAtomIndices.data() : nullptr);
+        doSDUpdate<SDUpdate::Combined>(sd,
+                                       start,
+                                       nrend,
+                                       dt,
+                                       nFreeze,
+                                       invmass,
+                                       ptype,
+                                       cFREEZE,
+                                       cTC,
+                                       x,
+                                       xprime,
+                                       v,
+                                       f,
+                                       step,
+                                       seed,
+                                       DOMAINDECOMP(cr) ? cr->dd->globalAtomIndices.data() : nullptr);
     }
 }
 
@@ -1228,7 +1846,32 @@ static void do_update_bd(int                                 start,
         invfr = 1.0 / friction_coefficient;
     }
 
-    for (n = start; (n < nrend); n++)
+    int simdEnd = start;
+#if GMX_HAVE_SIMD_UPDATE
+    if (!havePartiallyFrozenGroups(nFreeze))
+    {
+        simdEnd = start + ((nrend - start) / GMX_SIMD_REAL_WIDTH) * GMX_SIMD_REAL_WIDTH;
+        doBDUpdateSimd(start,
+                       simdEnd,
+                       dt,
+                       step,
+                       x,
+                       xprime,
+                       v,
+                       f,
+                       nFreeze,
+                       invmass,
+                       ptype,
+                       cFREEZE,
+                       cTC,
+                       friction_coefficient,
+                       rf,
+                       seed,
+                       gatindex);
+    }
+#endif
+
+    for (n = simdEnd; (n < nrend); n++)
     {
         int ng = gatindex ? gatindex[n] : n;
 
@@ -1415,7 +2058,7 @@ void Update::Impl::update_sd_second_half(const t_inputrec&                 input
                 int start_th, end_th;
                 getThreadAtomRange(nth, th, homenr, &start_th, &end_th);
 
-                doSDUpdateGeneral<SDUpdate::FrictionAndNoiseOnly>(
+                doSDUpdate<SDUpdate::FrictionAndNoiseOnly>(
                         sd_,
                         start_th,
                         end_th,
@@ -1513,6 +2156,28 @@ void Update::Impl::finish_update(const t_inputrec&                   inputRecord
     wallcycle_stop(wcycle, WallCycleCounter::Update);
 }
 
+//! Updates the NMR restraint history, needed when time averaging is used
+static void updateRestraintHistory(const t_fcdata& fcdata, t_state* state)
+{
+    if (state->flags & enumValueToBitMask(StateEntry::DisreRm3Tav))
+    {
+        update_disres_history(*fcdata.disres, &state->hist);
+    }
+    if (state->flags & enumValueToBitMask(StateEntry::OrireDtav))
+    {
+        update_orires_history(*fcdata.orires, &state->hist);
+    }
+}
+
+/*! \brief The number of atoms per block in the fused update passes
+ *
+ * Used by the fused update, SETTLE and finishing pass and the fused velocity
+ * Verlet velocity and position update. With 4 arrays of rvec accessed per atom,
+ * the data for a block fits in L1 cache.
+ * Has to be a multiple of the SIMD width used in the update.
+ */
+static constexpr int c_fusedUpdateBlockSize = 256;
+
 void Update::Impl::update_coords(const t_inputrec&                 inputRecord,
                                  int64_t                           step,
                                  int                               homenr,
@@ -1530,7 +2195,9 @@ void Update::Impl::update_coords(const t_inputrec&                 inputRecord,
                                  const bool                                       haveConstraints)
 {
     /* Running the velocity half does nothing except for velocity verlet */
-    if ((updatePart == etrtVELOCITY1 || updatePart == etrtVELOCITY2) && !EI_VV(inputRecord.eI))
+    if ((updatePart == etrtVELOCITY1 || updatePart == etrtVELOCITY2
+         || updatePart == etrtVELOCITY2_AND_POSITION)
+        && !EI_VV(inputRecord.eI))
     {
         gmx_incons("update_coords called for velocity without VV integrator");
     }
@@ -1538,15 +2205,7 @@ void Update::Impl::update_coords(const t_inputrec&                 inputRecord,
     /* Cast to real for faster code, no loss in precision (see comment above) */
     real dt = inputRecord.delta_t;
 
-    /* We need to update the NMR restraint history when time averaging is used */
-    if (state->flags & enumValueToBitMask(StateEntry::DisreRm3Tav))
-    {
-        update_disres_history(*fcdata.disres, &state->hist);
-    }
-    if (state->flags & enumValueToBitMask(StateEntry::OrireDtav))
-    {
-        update_orires_history(*fcdata.orires, &state->hist);
-    }
+    updateRestraintHistory(fcdata, state);
 
     /* ############# START The update of velocities and positions ######### */
     int nth = gmx_omp_nthreads_get(ModuleMultiThread::Update);
@@ -1635,37 +2294,71 @@ void Update::Impl::update_coords(const t_inputrec&                 inputRecord,
 
                     /* assuming barostat coupled to group 0 */
                     real alpha = 1.0 + DIM / static_cast<real>(inputRecord.opts.nrdf[0]);
+                    const auto nFreeze = gmx::arrayRefFromArray(inputRecord.opts.nFreeze,
+                                                                inputRecord.opts.ngfrz);
                     switch (updatePart)
                     {
                         case etrtVELOCITY1:
                         case etrtVELOCITY2:
-                            do_update_vv_vel(start_th,
-                                             end_th,
-                                             dt,
-                                             gmx::arrayRefFromArray(inputRecord.opts.nFreeze,
-                                                                    inputRecord.opts.ngfrz),
-                                             invMass,
-                                             ptype,
-                                             cFREEZE_,
-                                             v_rvec,
-                                             f_rvec,
-                                             bExtended,
-                                             state->veta,
-                                             alpha);
+                            doVVVelocityUpdate(start_th,
+                                               end_th,
+                                               dt,
+                                               nFreeze,
+                                               invMass,
+                                               ptype,
+                                               cFREEZE_,
+                                               v_rvec,
+                                               f_rvec,
+                                               bExtended,
+                                               state->veta,
+                                               alpha);
                             break;
                         case etrtPOSITION:
-                            do_update_vv_pos(start_th,
-                                             end_th,
-                                             dt,
-                                             gmx::arrayRefFromArray(inputRecord.opts.nFreeze,
-                                                                    inputRecord.opts.ngfrz),
-                                             ptype,
-                                             cFREEZE_,
-                                             x_rvec,
-                                             xp_rvec,
-                                             v_rvec,
-                                             bExtended,
-                                             state->veta);
+                            doVVPositionUpdate(start_th,
+                                               end_th,
+                                               dt,
+                                               nFreeze,
+                                               ptype,
+                                               cFREEZE_,
+                                               x_rvec,
+                                               xp_rvec,
+                                               v_rvec,
+                                               bExtended,
+                                               state->veta);
+                            break;
+                        case etrtVELOCITY2_AND_POSITION:
+                            /* Update blocks of atoms, so the updated velocities
+                             * are still in cache for the position update.
+                             */
+                            for (int blockStart = start_th; blockStart < end_th;
+                                 blockStart += c_fusedUpdateBlockSize)
+                            {
+                                const int blockEnd =
+                                        std::min(blockStart + c_fusedUpdateBlockSize, end_th);
+                                doVVVelocityUpdate(blockStart,
+                                                   blockEnd,
+                                                   dt,
+                                                   nFreeze,
+                                                   invMass,
+                                                   ptype,
+                                                   cFREEZE_,
+                                                   v_rvec,
+                                                   f_rvec,
+                                                   bExtended,
+                                                   state->veta,
+                                                   alpha);
+                                doVVPositionUpdate(blockStart,
+                                                   blockEnd,
+                                                   dt,
+                                                   nFreeze,
+                                                   ptype,
+                                                   cFREEZE_,
+                                                   x_rvec,
+                                                   xp_rvec,
+                                                   v_rvec,
+                                                   bExtended,
+                                                   state->veta);
+                            }
                             break;
                     }
                     break;
@@ -1677,6 +2370,213 @@ void Update::Impl::update_coords(const t_inputrec&                 inputRecord,
     }
 }
 
+bool Update::Impl::canFuseUpdateAndSettle(const t_inputrec&  inputRecord,
+                                          const Constraints* constr) const
+{
+    return fuseUpdateAndSettle_ && inputRecord.eI == IntegrationAlgorithm::MD && constr != nullptr
+           && constr->settleDataForFusedUpdate() != nullptr;
+}
+
+bool Update::Impl::update_coords_settle_and_finish(
+        const t_inputrec&                           inputRecord,
+        int64_t                                     step,
+        int                                         homenr,
+        bool                                        havePartiallyFrozenAtoms,
+        gmx::ArrayRef<const real>                   invMass,
+        gmx::ArrayRef<const rvec>                   invMassPerDim,
+        t_state*                                    state,
+        const gmx::ArrayRefWithPadding<const RVec>& f,
+        const t_fcdata&                             fcdata,
+        const gmx_ekindata_t*                       ekind,
+        const matrix                                M,
+        Constraints*                                constr,
+        bool                                        computeVirial,
+        tensor                                      constraintsVirial)
+{
+    const SettleData* settled = constr->settleDataForFusedUpdate();
+    GMX_RELEASE_ASSERT(settled != nullptr, "The fused update requires fusable settles");
+
+    /* Cast to real for faster code, no loss in precision */
+    const real dt    = inputRecord.delta_t;
+    const real invdt = (dt == 0 ? 0 : 1 / dt);
+
+    updateRestraintHistory(fcdata, state);
+
+#if GMX_HAVE_SIMD_UPDATE
+    constexpr int c_simdWidth = GMX_SIMD_REAL_WIDTH;
+#else
+    constexpr int c_simdWidth = 1;
+#endif
+    static_assert(c_fusedUpdateBlockSize % c_simdWidth == 0,
+                  "The block size should be a multiple of the SIMD width");
+
+    const int  numSettles = settled->numSettles();
+    const int  packSize   = settled->packSize();
+    const int* ow1        = settled->ow1();
+    const int* hw3        = settled->hw3();
+
+    const int nth = gmx_omp_nthreads_get(ModuleMultiThread::Update);
+
+    fusedSettleThreadData_.resize(nth);
+
+    /* Returns the start of the settle and atom range for thread \p th.
+     * We balance the atoms over threads. We need to put whole packs of settles
+     * on a thread and all atoms of these settles should be in the atom range.
+     */
+    auto threadRangeStart = [&](int th, int* settleStart, int* atomStart) {
+        if (th == 0)
+        {
+            *settleStart = 0;
+            *atomStart   = 0;
+        }
+        else if (th == nth)
+        {
+            *settleStart = numSettles;
+            *atomStart   = homenr;
+        }
+        else
+        {
+            int atomStartBalanced, atomEndBalanced;
+            getThreadAtomRange(nth, th, homenr, &atomStartBalanced, &atomEndBalanced);
+            int s = std::lower_bound(ow1, ow1 + numSettles, atomStartBalanced) - ow1;
+            s     = std::min(((s + packSize - 1) / packSize) * packSize, numSettles);
+            *settleStart = s;
+            *atomStart   = (s > 0 ? std::max(atomStartBalanced, hw3[s - 1] + 1)
+                                  : atomStartBalanced);
+        }
+    };
+
+#pragma omp parallel for num_threads(nth) schedule(static)
+    for (int th = 0; th < nth; th++)
+    {
+        try
+        {
+            int settleStart, atomStart, settleEnd, atomEnd;
+            threadRangeStart(th, &settleStart, &atomStart);
+            threadRangeStart(th + 1, &settleEnd, &atomEnd);
+
+            rvec*       x_rvec  = state->x.rvec_array();
+            rvec*       xp_rvec = xp_.rvec_array();
+            rvec*       v_rvec  = state->v.rvec_array();
+            const rvec* f_rvec  = as_rvec_array(f.unpaddedConstArrayRef().data());
+
+            /* Updates atoms a0 to a1. The SIMD kernels process SIMD width blocks
+             * of atoms and can only pass beyond a1 at homenr where the arrays
+             * are padded. Atoms outside aligned blocks are updated with the plain-C
+             * kernels, which we select by passing havePartiallyFrozenAtoms=true.
+             */
+            auto updateAtoms = [&](int a0, int a1, bool useSimdKernel) {
+                do_update_md(a0,
+                             a1,
+                             dt,
+                             step,
+                             x_rvec,
+                             xp_rvec,
+                             v_rvec,
+                             f_rvec,
+                             inputRecord.etc,
+                             inputRecord.epc,
+                             inputRecord.nsttcouple,
+                             inputRecord.nstpcouple,
+                             cTC_,
+                             invMass,
+                             invMassPerDim,
+                             ekind,
+                             state->box,
+                             state->nosehoover_vxi.data(),
+                             M,
+                             havePartiallyFrozenAtoms || !useSimdKernel);
+            };
+
+            FusedSettleThreadData& threadData = fusedSettleThreadData_[th];
+            clear_mat(threadData.virial);
+            threadData.errorHasOccurred = false;
+
+            int settledEnd  = settleStart;
+            int finishedEnd = atomStart;
+
+            int blockEnd;
+            for (int blockStart = atomStart; blockStart < atomEnd; blockStart = blockEnd)
+            {
+                /* Blocks end at SIMD aligned atoms, except at the end of the thread range */
+                const int blockEndAligned =
+                        ((blockStart + c_fusedUpdateBlockSize) / c_simdWidth) * c_simdWidth;
+                blockEnd = std::min(blockEndAligned, atomEnd);
+
+                const int simdStart = ((blockStart + c_simdWidth - 1) / c_simdWidth) * c_simdWidth;
+                const int simdEnd =
+                        (blockEnd == homenr ? blockEnd : (blockEnd / c_simdWidth) * c_simdWidth);
+                if (simdStart < simdEnd)
+                {
+                    updateAtoms(blockStart, simdStart, false);
+                    updateAtoms(simdStart, simdEnd, true);
+                    updateAtoms(simdEnd, blockEnd, false);
+                }
+                else
+                {
+                    updateAtoms(blockStart, blockEnd, false);
+                }
+
+                /* Constrain the settles for which all atoms have been updated,
+                 * in whole packs, apart from the last, partial pack
+                 */
+                int settleBlockEnd = settledEnd;
+                while (settleBlockEnd < settleEnd && hw3[settleBlockEnd] < blockEnd)
+                {
+                    settleBlockEnd++;
+                }
+                if (settleBlockEnd < settleEnd)
+                {
+                    settleBlockEnd = (settleBlockEnd / packSize) * packSize;
+                }
+                if (settleBlockEnd > settledEnd)
+                {
+                    bool errorHasOccurred = false;
+                    csettleRange(*settled,
+                                 settledEnd,
+                                 settleBlockEnd,
+                                 nullptr,
+                                 state->x.arrayRefWithPadding(),
+                                 xp_.arrayRefWithPadding(),
+                                 invdt,
+                                 state->v.arrayRefWithPadding(),
+                                 computeVirial,
+                                 threadData.virial,
+                                 &errorHasOccurred);
+                    threadData.errorHasOccurred = threadData.errorHasOccurred || errorHasOccurred;
+                    settledEnd                  = settleBlockEnd;
+                }
+
+                /* All atoms before the first settle that is not yet constrained are final */
+                const int finishEnd =
+                        (settledEnd < settleEnd ? std::min(ow1[settledEnd], blockEnd) : blockEnd);
+                for (int a = finishedEnd; a < finishEnd; a++)
+                {
+                    copy_rvec(xp_rvec[a], x_rvec[a]);
+                }
+                finishedEnd = finishEnd;
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    bool errorHasOccurred = false;
+    if (computeVirial)
+    {
+        clear_mat(constraintsVirial);
+    }
+    for (const FusedSettleThreadData& threadData : fusedSettleThreadData_)
+    {
+        if (computeVirial)
+        {
+            m_add(constraintsVirial, threadData.virial, constraintsVirial);
+        }
+        errorHasOccurred = errorHasOccurred || threadData.errorHasOccurred;
+    }
+
+    return constr->finishFusedSettle(step, true, computeVirial, constraintsVirial, errorHasOccurred);
+}
+
 void Update::Impl::update_for_constraint_virial(const t_inputrec&         inputRecord,
                                                 int                       homenr,
                                                 bool                      havePartiallyFrozenAtoms,
@@ -138,6 +138,57 @@ public:
                        const t_commrec*                                 cr,
                        bool                                             haveConstraints);
 
+    /*! \brief Returns whether the leap-frog update, SETTLE and finishing can be fused
+     *
+     * This requires the GMX_FUSE_UPDATE_SETTLE environment variable to be set, the MD
+     * integrator and SETTLE to be the only constraint algorithm. See
+     * Constraints::settleDataForFusedUpdate() for the further conditions on constraints.
+     *
+     * \param[in]  inputRecord  Input record.
+     * \param[in]  constr       Constraints object, can be nullptr.
+     */
+    bool canFuseUpdateAndSettle(const t_inputrec& inputRecord, const Constraints* constr) const;
+
+    /*! \brief Performs the leap-frog update, SETTLE and the coordinate finishing in one pass
+     *
+     * Instead of streaming over all atoms in update_coords(), constraining and
+     * finish_update(), the home atoms are processed per thread in cache-sized
+     * blocks: a block is updated, the settles for which all atoms are updated
+     * are constrained and the coordinates of atoms that are final are copied
+     * to \p state. Should only be called when canFuseUpdateAndSettle() returns true.
+     *
+     * \param[in]  inputRecord               Input record.
+     * \param[in]  step                      Current timestep.
+     * \param[in]  homenr                    The number of atoms on this processor.
+     * \param[in]  havePartiallyFrozenAtoms  Whether atoms are frozen along 1 or 2 (not 3) dimensions?
+     * \param[in]  invMass                   Inverse atomic mass per atom, 0 for vsites and shells.
+     * \param[in]  invMassPerDim             Inverse atomic mass per atom and dimension, 0 for vsites, shells and frozen dimensions
+     * \param[in]  state                     System state object.
+     * \param[in]  f                         Buffer with atomic forces for home particles.
+     * \param[in]  fcdata                    Force calculation data to update distance and orientation restraints.
+     * \param[in]  ekind                     Kinetic energy data (for temperature coupling, energy groups, etc.).
+     * \param[in]  M                         Parrinello-Rahman velocity scaling matrix.
+     * \param[in]  constr                    Constraints object.
+     * \param[in]  computeVirial             Whether to compute the constraint virial.
+     * \param[out] constraintsVirial         The constraint virial, when \p computeVirial is true.
+     * \returns whether all settles succeeded, as Constraints::apply(); a failure has
+     * been reported and counted towards the constraint warning limit.
+     */
+    bool update_coords_settle_and_finish(const t_inputrec&         inputRecord,
+                                         int64_t                   step,
+                                         int                       homenr,
+                                         bool                      havePartiallyFrozenAtoms,
+                                         gmx::ArrayRef<const real> invMass,
+                                         gmx::ArrayRef<const rvec> invMassPerDim,
+                                         t_state*                  state,
+                                         const gmx::ArrayRefWithPadding<const gmx::RVec>& f,
+                                         const t_fcdata&                                  fcdata,
+                                         const gmx_ekindata_t*                            ekind,
+                                         const matrix                                     M,
+                                         Constraints*                                     constr,
+                                         bool   computeVirial,
+                                         tensor constraintsVirial);
+
     /*! \brief Finalize the coordinate update.
      *
      * Copy the updated coordinates to the main coordinates buffer for the atoms that are not frozen.
@@ -269,4 +320,40 @@ void restore_ekinstate_from_state(const t_commrec* cr, gmx_ekindata_t* ekind, co
  */
 void getThreadAtomRange(int numThreads, int threadIndex, int numAtoms, int* startAtom, int* endAtom);
 
+/*! \brief Velocity half-step update for velocity Verlet of atoms \p start to \p nrend
+ *
+ * Uses SIMD for the SIMD aligned blocks of atoms when no freeze group freezes
+ * only some dimensions, the unaligned head and the tail of the range are
+ * updated with scalar code. Shells and frozen atoms get zero velocity.
+ * With \p bExtended, the velocities are scaled for the barostat velocity \p veta.
+ */
+void doVVVelocityUpdate(int                                 start,
+                        int                                 nrend,
+                        real                                dt,
+                        gmx::ArrayRef<const ivec>           nFreeze,
+                        gmx::ArrayRef<const real>           invmass,
+                        gmx::ArrayRef<const ParticleType>   ptype,
+                        gmx::ArrayRef<const unsigned short> cFREEZE,
+                        rvec                                v[],
+                        const rvec                          f[],
+                        bool                                bExtended,
+                        real                                veta,
+                        real                                alpha);
+
+/*! \brief Position update for velocity Verlet of atoms \p start to \p nrend
+ *
+ * Uses SIMD as doVVVelocityUpdate(). Shells and frozen atoms keep their position.
+ */
+void doVVPositionUpdate(int                                 start,
+                        int                                 nrend,
+                        real                                dt,
+                        gmx::ArrayRef<const ivec>           nFreeze,
+                        gmx::ArrayRef<const ParticleType>   ptype,
+                        gmx::ArrayRef<const unsigned short> cFREEZE,
+                        const rvec                          x[],
+                        rvec                                xprime[],
+                        const rvec                          v[],
+                        bool                                bExtended,
+                        real                                veta);
+
 #endif
@@ -365,29 +365,6 @@ void integrateVVSecondStep(int64_t
                            t_nrnb*                                                  nrnb,
                            gmx_wallcycle*                                           wcycle)
 {
-    /* velocity half-step update */
-    upd->update_coords(*ir,
-                       step,
-                       mdatoms->homenr,
-                       mdatoms->havePartiallyFrozenAtoms,
-                       gmx::arrayRefFromArray(mdatoms->ptype, mdatoms->nr),
-                       gmx::arrayRefFromArray(mdatoms->invmass, mdatoms->nr),
-                       gmx::arrayRefFromArray(mdatoms->invMassPerDim, mdatoms->nr),
-                       state,
-                       f->view().forceWithPadding(),
-                       fcdata,
-                       ekind,
-                       M,
-                       etrtVELOCITY2,
-                       cr,
-                       constr != nullptr);
-
-
-    /* Above, initialize just copies ekinh into ekin,
-     * it doesn't copy position (for VV),
-     * and entire integrator for MD.
-     */
-
     if (ir->eI == IntegrationAlgorithm::VVAK)
     {
         cbuf->resize(state->x.size());
@@ -399,6 +376,9 @@ void integrateVVSecondStep(int64_t
         updatePrevStepPullCom(pull_work, state);
     }
 
+    /* Velocity half-step update and position update in one pass over the atoms.
+     * This is allowed because the position update does not modify state->x.
+     */
     upd->update_coords(*ir,
                        step,
                        mdatoms->homenr,
@@ -411,7 +391,7 @@ void integrateVVSecondStep(int64_t
                        fcdata,
                        ekind,
                        M,
-                       etrtPOSITION,
+                       etrtVELOCITY2_AND_POSITION,
                        cr,
                        constr != nullptr);
 
@@ -158,6 +158,60 @@ static void update_tensor(const rvec x, real m0, tensor I)
     I[ZZ][YY] += yz;
 }
 
+/*! \brief Adds the COM motion terms of atoms \p start to \p end to \p vcm_t
+ *
+ * The angular momentum terms are only computed with \p computeAngular.
+ * The sums are accumulated in local variables, so the thread-local
+ * group data is only updated once per range of atoms.
+ */
+template<bool computeAngular>
+static void addVcmRange(const t_mdatoms&               md,
+                        gmx::ArrayRef<const gmx::RVec> x,
+                        gmx::ArrayRef<const gmx::RVec> v,
+                        int                            start,
+                        int                            end,
+                        t_vcm_thread*                  vcm_t)
+{
+    real   mass = 0;
+    rvec   p    = { 0, 0, 0 };
+    rvec   j    = { 0, 0, 0 };
+    rvec   xm   = { 0, 0, 0 };
+    tensor I    = { { 0 } };
+    for (int i = start; i < end; i++)
+    {
+        const real m0 = md.massT[i];
+        /* Calculate linear momentum */
+        mass += m0;
+        for (int m = 0; m < DIM; m++)
+        {
+            p[m] += m0 * v[i][m];
+        }
+
+        if (computeAngular)
+        {
+            /* Calculate angular momentum */
+            rvec j0;
+            cprod(x[i], v[i], j0);
+
+            for (int m = 0; m < DIM; m++)
+            {
+                j[m] += m0 * j0[m];
+                xm[m] += m0 * x[i][m];
+            }
+            /* Update inertia tensor */
+            update_tensor(x[i], m0, I);
+        }
+    }
+    vcm_t->mass += mass;
+    rvec_inc(vcm_t->p, p);
+    if (computeAngular)
+    {
+        rvec_inc(vcm_t->j, j);
+        rvec_inc(vcm_t->x, xm);
+        m_add(vcm_t->i, I, vcm_t->i);
+    }
+}
+
 /* Center of mass code for groups */
 void calc_vcm_grp(const t_mdatoms&               md,
                   gmx::ArrayRef<const gmx::RVec> x,
@@ -171,7 +225,7 @@ void calc_vcm_grp(const t_mdatoms&               md,
     int nthreads = gmx_omp_nthreads_get(ModuleMultiThread::Default);
 
     {
-#pragma omp parallel num_threads(nthreads) default(none) shared(x, v, vcm, md)
+#pragma omp parallel num_threads(nthreads) default(none) shared(x, v, vcm, md, nthreads)
         {
             int t = gmx_omp_get_thread_num();
             for (int g = 0; g < vcm->size; g++)
@@ -189,64 +243,64 @@ void calc_vcm_grp(const t_mdatoms&               md,
                 }
             }
 
-#pragma omp for schedule(static)
-            for (int i = 0; i < md.homenr; i++)
+            /* Accumulate over ranges of consecutive atoms in the same group */
+            const int start = (t * md.homenr) / nthreads;
+            const int end   = ((t + 1) * md.homenr) / nthreads;
+            int       i     = start;
+            while (i < end)
             {
-                int  g  = 0;
-                real m0 = md.massT[i];
+                int g     = 0;
+                int end_g = end;
                 if (md.cVCM)
                 {
-                    g = md.cVCM[i];
+                    g     = md.cVCM[i];
+                    end_g = i + 1;
+                    while (end_g < end && md.cVCM[end_g] == g)
+                    {
+                        end_g++;
+                    }
                 }
                 t_vcm_thread* vcm_t = &vcm->thread_vcm[t * vcm->stride + g];
-                /* Calculate linear momentum */
-                vcm_t->mass += m0;
-                int m;
-                for (m = 0; (m < DIM); m++)
+                if (vcm->mode == ComRemovalAlgorithm::Angular)
                 {
-                    vcm_t->p[m] += m0 * v[i][m];
+                    addVcmRange<true>(md, x, v, i, end_g, vcm_t);
                 }
-
-                if (vcm->mode == ComRemovalAlgorithm::Angular)
+                else
                 {
-                    /* Calculate angular momentum */
-                    rvec j0;
-                    cprod(x[i], v[i], j0);
-
-                    for (m = 0; (m < DIM); m++)
-                    {
-                        vcm_t->j[m] += m0 * j0[m];
-                        vcm_t->x[m] += m0 * x[i][m];
-                    }
-                    /* Update inertia tensor */
-                    update_tensor(x[i], m0, vcm_t->i);
+                    addVcmRange<false>(md, x, v, i, end_g, vcm_t);
                 }
-            }
-        }
-        for (int g = 0; g < vcm->size; g++)
-        {
-            /* Reset linear momentum */
-            vcm->group_mass[g] = 0;
-            clear_rvec(vcm->group_p[g]);
-            if (vcm->mode == ComRemovalAlgorithm::Angular)
-            {
-                /* Reset angular momentum */
-                clear_rvec(vcm->group_j[g]);
-                clear_rvec(vcm->group_x[g]);
-                clear_rvec(vcm->group_w[g]);
-                clear_mat(vcm->group_i[g]);
+                i = end_g;
             }
 
-            for (int t = 0; t < nthreads; t++)
+            /* Reduce the thread contributions, with the groups divided over the threads */
+#pragma omp barrier
+            const int gStart = (t * vcm->size) / nthreads;
+            const int gEnd   = ((t + 1) * vcm->size) / nthreads;
+            for (int g = gStart; g < gEnd; g++)
             {
-                t_vcm_thread* vcm_t = &vcm->thread_vcm[t * vcm->stride + g];
-                vcm->group_mass[g] += vcm_t->mass;
-                rvec_inc(vcm->group_p[g], vcm_t->p);
+                /* Reset linear momentum */
+                vcm->group_mass[g] = 0;
+                clear_rvec(vcm->group_p[g]);
                 if (vcm->mode == ComRemovalAlgorithm::Angular)
                 {
-                    rvec_inc(vcm->group_j[g], vcm_t->j);
-                    rvec_inc(vcm->group_x[g], vcm_t->x);
-                    m_add(vcm_t->i, vcm->group_i[g], vcm->group_i[g]);
+                    /* Reset angular momentum */
+                    clear_rvec(vcm->group_j[g]);
+                    clear_rvec(vcm->group_x[g]);
+                    clear_rvec(vcm->group_w[g]);
+                    clear_mat(vcm->group_i[g]);
+                }
+
+                for (int th = 0; th < nthreads; th++)
+                {
+                    const t_vcm_thread* vcm_t = &vcm->thread_vcm[th * vcm->stride + g];
+                    vcm->group_mass[g] += vcm_t->mass;
+                    rvec_inc(vcm->group_p[g], vcm_t->p);
+                    if (vcm->mode == ComRemovalAlgorithm::Angular)
+                    {
+                        rvec_inc(vcm->group_j[g], vcm_t->j);
+                        rvec_inc(vcm->group_x[g], vcm_t->x);
+                        m_add(vcm_t->i, vcm->group_i[g], vcm->group_i[g]);
+                    }
                 }
             }
         }
@@ -46,9 +46,12 @@
 
 #include "vsite.h"
 
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 
 #include <algorithm>
+#include <array>
 #include <memory>
 #include <vector>
 
@@ -62,10 +65,13 @@
 #include "gromacs/mdtypes/commrec.h"
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/topology/ifunc.h"
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
@@ -89,6 +95,12 @@
  * to avoid high memory usage.
  *
  * Any remaining vsites are assigned to a separate master thread task.
+ *
+ * Within each (thread-)task, vsites of type 3, 3fd, 3out and 4fdn are copied
+ * into SIMD batches with structure-of-arrays layout when the vsites are set,
+ * so once after each (re)partitioning. Without PBC treatment, positions are
+ * constructed and forces are spread for these batches using SIMD, the rest
+ * of the vsites is handled in the plain-C loops.
  */
 namespace gmx
 {
@@ -131,6 +143,41 @@ struct AtomIndex
     std::vector<int> atom;
 };
 
+/*! \brief Vsites of one type in structure-of-arrays layout for the SIMD kernels
+ *
+ * Contains the leading entries of the interaction list of the type, up to
+ * the first vsite constructed from another vsite, rounded down to a multiple
+ * of the SIMD width. The remaining entries are handled by the plain-C code.
+ */
+struct VsiteSimdBatch
+{
+    //! The number of vsites in the batch, a multiple of the SIMD width
+    int numVsites = 0;
+    //! The vsite atom indices followed by the lists of constructing atom indices
+    std::array<std::vector<std::int32_t, AlignedAllocator<std::int32_t>>, 5> atoms;
+    //! The construction parameters a, b and c, as far as used by the vsite type
+    std::array<std::vector<real, AlignedAllocator<real>>, 3> parameters;
+};
+
+//! The number of vsite types that have SIMD construction and spreading kernels
+static constexpr int c_numSimdVsiteTypes = 4;
+
+//! SIMD batches for all vsite types with SIMD kernels, for one set of interaction lists
+using VsiteSimdBatches = std::array<VsiteSimdBatch, c_numSimdVsiteTypes>;
+
+//! Returns the index of vsite type \p ftype in VsiteSimdBatches, -1 when there are no SIMD kernels
+static int simdVsiteTypeIndex(const int ftype)
+{
+    switch (ftype)
+    {
+        case F_VSITE3: return 0;
+        case F_VSITE3FD: return 1;
+        case F_VSITE3OUT: return 2;
+        case F_VSITE4FDN: return 3;
+        default: return -1;
+    }
+}
+
 /*! \brief Data structure for thread tasks that use constructing atoms outside their own atom range
  */
 struct InterdependentTask
@@ -151,6 +198,8 @@ struct InterdependentTask
     std::vector<int> spreadTask;
     //! List of tasks that write to this tasks force block range
     std::vector<int> reduceTask;
+    //! SIMD batches of the vsites in ilist
+    VsiteSimdBatches simdBatches;
 };
 
 /*! \brief Vsite thread task data structure
@@ -163,6 +212,8 @@ struct VsiteThread
     int rangeEnd;
     //! The interaction lists, only vsite entries are used
     std::array<InteractionList, F_NRE> ilist;
+    //! SIMD batches of the vsites in ilist
+    VsiteSimdBatches simdBatches;
     //! Local fshift accumulation buffer
     std::array<RVec, c_numShiftVectors> fshift;
     //! Local virial dx*df accumulation buffer
@@ -216,7 +267,8 @@ public:
                          int                             numAtoms,
                          int                             homenr,
                          ArrayRef<const ParticleType>    ptype,
-                         bool                            useDomdec);
+                         bool                            useDomdec,
+                         bool                            useSimd);
 
 private:
     //! Number of threads used for vsite operations
@@ -284,6 +336,10 @@ private:
     const ArrayRef<const t_iparams> iparams_;
     //! The interaction lists
     ArrayRef<const InteractionList> ilists_;
+    //! Whether to use the SIMD kernels, false when GMX_DISABLE_SIMD_KERNELS is set
+    const bool useSimdKernels_;
+    //! SIMD batches of the vsites in ilists_, only used without multithreading
+    VsiteSimdBatches simdBatches_;
     //! Information for handling vsite threading
     ThreadingInfo threadingInfo_;
 };
@@ -883,6 +939,465 @@ enum class PbcMode
     none //!< No PBC treatment needed
 };
 
+/*! \brief Copies the leading vsites of \p ilist into SIMD batches, for the types with SIMD kernels
+ *
+ * Only vsites up to the first vsite that is constructed from another vsite
+ * are batched, so all vsites in a batch can be processed concurrently and
+ * the order of the dependent constructions in the plain-C loop is preserved.
+ *
+ * \param[in]  ilist        The interaction lists, only vsites are used
+ * \param[in]  ip           Interaction parameters, only vsite parameters are used
+ * \param[in]  ptype        The particle types of the local atoms
+ * \param[in]  useSimd      Whether to use the SIMD kernels, when false all batches are empty
+ * \param[out] simdBatches  The SIMD batches
+ */
+static void setVsiteSimdBatches(ArrayRef<const InteractionList> ilist,
+                                ArrayRef<const t_iparams>       ip,
+                                ArrayRef<const ParticleType>    ptype,
+                                const bool                      useSimd,
+                                VsiteSimdBatches*               simdBatches)
+{
+    for (int ftype = c_ftypeVsiteStart; ftype < c_ftypeVsiteEnd; ftype++)
+    {
+        const int typeIndex = simdVsiteTypeIndex(ftype);
+        if (typeIndex < 0)
+        {
+            continue;
+        }
+
+        VsiteSimdBatch& batch = (*simdBatches)[typeIndex];
+        batch.numVsites       = 0;
+        if (!useSimd)
+        {
+            continue;
+        }
+
+#if GMX_SIMD_HAVE_REAL
+        const int      nra        = interaction_function[ftype].nratoms;
+        const int      inc        = 1 + nra;
+        const int      numEntries = ilist[ftype].size() / inc;
+        const t_iatom* iatoms     = ilist[ftype].iatoms.data();
+
+        int numIndependent = 0;
+        while (numIndependent < numEntries)
+        {
+            const t_iatom* ia                  = iatoms + numIndependent * inc;
+            bool           dependsOnOtherVsite = false;
+            for (int j = 2; j < inc; j++)
+            {
+                dependsOnOtherVsite = dependsOnOtherVsite || ptype[ia[j]] == ParticleType::VSite;
+            }
+            if (dependsOnOtherVsite)
+            {
+                break;
+            }
+            numIndependent++;
+        }
+        batch.numVsites = (numIndependent / GMX_SIMD_REAL_WIDTH) * GMX_SIMD_REAL_WIDTH;
+
+        for (int j = 0; j < nra; j++)
+        {
+            batch.atoms[j].resize(batch.numVsites);
+        }
+        for (auto& parameters : batch.parameters)
+        {
+            parameters.resize(batch.numVsites);
+        }
+        for (int i = 0; i < batch.numVsites; i++)
+        {
+            const t_iatom* ia = iatoms + i * inc;
+            for (int j = 0; j < nra; j++)
+            {
+                batch.atoms[j][i] = ia[1 + j];
+            }
+            batch.parameters[0][i] = ip[ia[0]].vsite.a;
+            batch.parameters[1][i] = ip[ia[0]].vsite.b;
+            batch.parameters[2][i] = ip[ia[0]].vsite.c;
+        }
+#else
+        GMX_UNUSED_VALUE(ilist);
+        GMX_UNUSED_VALUE(ip);
+        GMX_UNUSED_VALUE(ptype);
+#endif
+    }
+}
+
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Loads the vectors for atoms \p atoms from \p v into SIMD registers, one atom per lane
+ *
+ * The vectors are loaded through a buffer, instead of with gatherLoadUTranspose,
+ * as our coordinate and force arrays are not guaranteed to be padded here.
+ */
+static inline void gatherVsiteVectors(ArrayRef<const RVec> v,
+                                      const std::int32_t*  atoms,
+                                      SimdReal*            vx,
+                                      SimdReal*            vy,
+                                      SimdReal*            vz)
+{
+    alignas(GMX_SIMD_ALIGNMENT) real buffer[DIM * GMX_SIMD_REAL_WIDTH];
+
+    for (int lane = 0; lane < GMX_SIMD_REAL_WIDTH; lane++)
+    {
+        const RVec& vAtom                      = v[atoms[lane]];
+        buffer[lane]                           = vAtom[XX];
+        buffer[GMX_SIMD_REAL_WIDTH + lane]     = vAtom[YY];
+        buffer[2 * GMX_SIMD_REAL_WIDTH + lane] = vAtom[ZZ];
+    }
+    *vx = load<SimdReal>(buffer);
+    *vy = load<SimdReal>(buffer + GMX_SIMD_REAL_WIDTH);
+    *vz = load<SimdReal>(buffer + 2 * GMX_SIMD_REAL_WIDTH);
+}
+
+/*! \brief Stores, or adds when \p add=true, SIMD registers to the vectors of \p atoms in \p v
+ *
+ * The lanes are written one at a time, so this is safe with other threads
+ * writing to neighboring elements of \p v.
+ */
+template<bool add>
+static inline void scatterVsiteVectors(ArrayRef<RVec>      v,
+                                       const std::int32_t* atoms,
+                                       SimdReal            vx,
+                                       SimdReal            vy,
+                                       SimdReal            vz)
+{
+    alignas(GMX_SIMD_ALIGNMENT) real buffer[DIM * GMX_SIMD_REAL_WIDTH];
+
+    store(buffer, vx);
+    store(buffer + GMX_SIMD_REAL_WIDTH, vy);
+    store(buffer + 2 * GMX_SIMD_REAL_WIDTH, vz);
+    for (int lane = 0; lane < GMX_SIMD_REAL_WIDTH; lane++)
+    {
+        const RVec vLane = { buffer[lane],
+                             buffer[GMX_SIMD_REAL_WIDTH + lane],
+                             buffer[2 * GMX_SIMD_REAL_WIDTH + lane] };
+        if (add)
+        {
+            v[atoms[lane]] += vLane;
+        }
+        else
+        {
+            v[atoms[lane]] = vLane;
+        }
+    }
+}
+
+//! Computes the cross product c = a x b for SIMD vectors
+static inline void simdCrossProduct(SimdReal  ax,
+                                    SimdReal  ay,
+                                    SimdReal  az,
+                                    SimdReal  bx,
+                                    SimdReal  by,
+                                    SimdReal  bz,
+                                    SimdReal* cx,
+                                    SimdReal* cy,
+                                    SimdReal* cz)
+{
+    *cx = ay * bz - az * by;
+    *cy = az * bx - ax * bz;
+    *cz = ax * by - ay * bx;
+}
+
+/*! \brief Constructs the positions of the vsites in \p batch using SIMD, without PBC
+ *
+ * The math is the same as in the constr_vsite... functions.
+ */
+template<int ftype>
+static void constructVsitesSimd(ArrayRef<RVec> x, const VsiteSimdBatch& batch)
+{
+    for (int i = 0; i < batch.numVsites; i += GMX_SIMD_REAL_WIDTH)
+    {
+        SimdReal xi, yi, zi, xj, yj, zj, xk, yk, zk;
+        gatherVsiteVectors(x, batch.atoms[1].data() + i, &xi, &yi, &zi);
+        gatherVsiteVectors(x, batch.atoms[2].data() + i, &xj, &yj, &zj);
+        gatherVsiteVectors(x, batch.atoms[3].data() + i, &xk, &yk, &zk);
+
+        const SimdReal a = load<SimdReal>(batch.parameters[0].data() + i);
+        const SimdReal b = load<SimdReal>(batch.parameters[1].data() + i);
+
+        SimdReal xv, yv, zv;
+        if constexpr (ftype == F_VSITE3)
+        {
+            const SimdReal c = SimdReal(1.0_real) - a - b;
+
+            xv = fma(c, xi, fma(a, xj, b * xk));
+            yv = fma(c, yi, fma(a, yj, b * yk));
+            zv = fma(c, zi, fma(a, zj, b * zk));
+        }
+        else if constexpr (ftype == F_VSITE3FD)
+        {
+            /* temp goes from i to a point on the line jk */
+            const SimdReal tx = fma(a, xk - xj, xj - xi);
+            const SimdReal ty = fma(a, yk - yj, yj - yi);
+            const SimdReal tz = fma(a, zk - zj, zj - zi);
+
+            const SimdReal c = b * invsqrt(fma(tx, tx, fma(ty, ty, tz * tz)));
+
+            xv = fma(c, tx, xi);
+            yv = fma(c, ty, yi);
+            zv = fma(c, tz, zi);
+        }
+        else if constexpr (ftype == F_VSITE3OUT)
+        {
+            const SimdReal c = load<SimdReal>(batch.parameters[2].data() + i);
+
+            const SimdReal xij = xj - xi;
+            const SimdReal yij = yj - yi;
+            const SimdReal zij = zj - zi;
+            const SimdReal xik = xk - xi;
+            const SimdReal yik = yk - yi;
+            const SimdReal zik = zk - zi;
+
+            SimdReal tx, ty, tz;
+            simdCrossProduct(xij, yij, zij, xik, yik, zik, &tx, &ty, &tz);
+
+            xv = fma(a, xij, fma(b, xik, fma(c, tx, xi)));
+            yv = fma(a, yij, fma(b, yik, fma(c, ty, yi)));
+            zv = fma(a, zij, fma(b, zik, fma(c, tz, zi)));
+        }
+        else if constexpr (ftype == F_VSITE4FDN)
+        {
+            const SimdReal c = load<SimdReal>(batch.parameters[2].data() + i);
+
+            SimdReal xl, yl, zl;
+            gatherVsiteVectors(x, batch.atoms[4].data() + i, &xl, &yl, &zl);
+
+            const SimdReal xij = xj - xi;
+            const SimdReal yij = yj - yi;
+            const SimdReal zij = zj - zi;
+
+            /* rja = a*xik - xij, rjb = b*xil - xij */
+            const SimdReal xja = fms(a, xk - xi, xij);
+            const SimdReal yja = fms(a, yk - yi, yij);
+            const SimdReal zja = fms(a, zk - zi, zij);
+            const SimdReal xjb = fms(b, xl - xi, xij);
+            const SimdReal yjb = fms(b, yl - yi, yij);
+            const SimdReal zjb = fms(b, zl - zi, zij);
+
+            SimdReal xm, ym, zm;
+            simdCrossProduct(xja, yja, zja, xjb, yjb, zjb, &xm, &ym, &zm);
+
+            const SimdReal d = c * invsqrt(fma(xm, xm, fma(ym, ym, zm * zm)));
+
+            xv = fma(d, xm, xi);
+            yv = fma(d, ym, yi);
+            zv = fma(d, zm, zi);
+        }
+
+        scatterVsiteVectors<false>(x, batch.atoms[0].data() + i, xv, yv, zv);
+    }
+}
+
+//! Constructs the positions of the vsites of type \p ftype in \p batch using SIMD, without PBC
+static void constructVsitesSimd(ArrayRef<RVec> x, const int ftype, const VsiteSimdBatch& batch)
+{
+    switch (ftype)
+    {
+        case F_VSITE3: constructVsitesSimd<F_VSITE3>(x, batch); break;
+        case F_VSITE3FD: constructVsitesSimd<F_VSITE3FD>(x, batch); break;
+        case F_VSITE3OUT: constructVsitesSimd<F_VSITE3OUT>(x, batch); break;
+        case F_VSITE4FDN: constructVsitesSimd<F_VSITE4FDN>(x, batch); break;
+        default: GMX_RELEASE_ASSERT(false, "Vsite type without SIMD kernel");
+    }
+}
+
+/*! \brief Spreads the forces on the vsites in \p batch using SIMD, without PBC and virial
+ *
+ * The math is the same as in the spread_vsite... functions.
+ * The vsite forces are cleared.
+ */
+template<int ftype>
+static void spreadForcesSimd(ArrayRef<const RVec> x, ArrayRef<RVec> f, const VsiteSimdBatch& batch)
+{
+    const SimdReal zero(0.0_real);
+
+    for (int i = 0; i < batch.numVsites; i += GMX_SIMD_REAL_WIDTH)
+    {
+        SimdReal fvx, fvy, fvz;
+        gatherVsiteVectors(f, batch.atoms[0].data() + i, &fvx, &fvy, &fvz);
+
+        const SimdReal a = load<SimdReal>(batch.parameters[0].data() + i);
+        const SimdReal b = load<SimdReal>(batch.parameters[1].data() + i);
+
+        /* The force on atom i is computed as fv - the forces on the other atoms */
+        SimdReal fjx, fjy, fjz, fkx, fky, fkz;
+        SimdReal fix, fiy, fiz;
+        if constexpr (ftype == F_VSITE3)
+        {
+            fjx = a * fvx;
+            fjy = a * fvy;
+            fjz = a * fvz;
+            fkx = b * fvx;
+            fky = b * fvy;
+            fkz = b * fvz;
+            fix = fvx - fjx - fkx;
+            fiy = fvy - fjy - fky;
+            fiz = fvz - fjz - fkz;
+        }
+        else
+        {
+            SimdReal xi, yi, zi, xj, yj, zj, xk, yk, zk;
+            gatherVsiteVectors(x, batch.atoms[1].data() + i, &xi, &yi, &zi);
+            gatherVsiteVectors(x, batch.atoms[2].data() + i, &xj, &yj, &zj);
+            gatherVsiteVectors(x, batch.atoms[3].data() + i, &xk, &yk, &zk);
+
+            const SimdReal xij = xj - xi;
+            const SimdReal yij = yj - yi;
+            const SimdReal zij = zj - zi;
+
+            if constexpr (ftype == F_VSITE3FD)
+            {
+                /* xix goes from i to point x on the line jk */
+                const SimdReal xix = fma(a, xk - xj, xij);
+                const SimdReal yix = fma(a, yk - yj, yij);
+                const SimdReal zix = fma(a, zk - zj, zij);
+
+                const SimdReal invDistance = invsqrt(fma(xix, xix, fma(yix, yix, zix * zix)));
+                const SimdReal c           = b * invDistance;
+                /* = (xix . f)/(xix . xix) */
+                const SimdReal fproj =
+                        fma(xix, fvx, fma(yix, fvy, zix * fvz)) * invDistance * invDistance;
+
+                const SimdReal tempx = c * fnma(fproj, xix, fvx);
+                const SimdReal tempy = c * fnma(fproj, yix, fvy);
+                const SimdReal tempz = c * fnma(fproj, zix, fvz);
+
+                const SimdReal a1 = SimdReal(1.0_real) - a;
+                fix               = fvx - tempx;
+                fiy               = fvy - tempy;
+                fiz               = fvz - tempz;
+                fjx               = a1 * tempx;
+                fjy               = a1 * tempy;
+                fjz               = a1 * tempz;
+                fkx               = a * tempx;
+                fky               = a * tempy;
+                fkz               = a * tempz;
+            }
+            else if constexpr (ftype == F_VSITE3OUT)
+            {
+                const SimdReal c = load<SimdReal>(batch.parameters[2].data() + i);
+
+                const SimdReal xik = xk - xi;
+                const SimdReal yik = yk - yi;
+                const SimdReal zik = zk - zi;
+
+                const SimdReal cfx = c * fvx;
+                const SimdReal cfy = c * fvy;
+                const SimdReal cfz = c * fvz;
+
+                /* fj = a*fv + xik x cf, fk = b*fv + cf x xij */
+                SimdReal tx, ty, tz;
+                simdCrossProduct(xik, yik, zik, cfx, cfy, cfz, &tx, &ty, &tz);
+                fjx = fma(a, fvx, tx);
+                fjy = fma(a, fvy, ty);
+                fjz = fma(a, fvz, tz);
+                simdCrossProduct(cfx, cfy, cfz, xij, yij, zij, &tx, &ty, &tz);
+                fkx = fma(b, fvx, tx);
+                fky = fma(b, fvy, ty);
+                fkz = fma(b, fvz, tz);
+
+                fix = fvx - fjx - fkx;
+                fiy = fvy - fjy - fky;
+                fiz = fvz - fjz - fkz;
+            }
+            else if constexpr (ftype == F_VSITE4FDN)
+            {
+                const SimdReal c = load<SimdReal>(batch.parameters[2].data() + i);
+
+                SimdReal xl, yl, zl;
+                gatherVsiteVectors(x, batch.atoms[4].data() + i, &xl, &yl, &zl);
+
+                const SimdReal xa = a * (xk - xi);
+                const SimdReal ya = a * (yk - yi);
+                const SimdReal za = a * (zk - zi);
+                const SimdReal xb = b * (xl - xi);
+                const SimdReal yb = b * (yl - yi);
+                const SimdReal zb = b * (zl - zi);
+
+                const SimdReal xja = xa - xij;
+                const SimdReal yja = ya - yij;
+                const SimdReal zja = za - zij;
+                const SimdReal xjb = xb - xij;
+                const SimdReal yjb = yb - yij;
+                const SimdReal zjb = zb - zij;
+                const SimdReal xab = xb - xa;
+                const SimdReal yab = yb - ya;
+                const SimdReal zab = zb - za;
+
+                SimdReal xm, ym, zm;
+                simdCrossProduct(xja, yja, zja, xjb, yjb, zjb, &xm, &ym, &zm);
+
+                const SimdReal invrm = invsqrt(fma(xm, xm, fma(ym, ym, zm * zm)));
+                const SimdReal denom = invrm * invrm;
+
+                const SimdReal cfx = c * invrm * fvx;
+                const SimdReal cfy = c * invrm * fvy;
+                const SimdReal cfz = c * invrm * fvz;
+
+                SimdReal tx, ty, tz;
+                simdCrossProduct(xm, ym, zm, xab, yab, zab, &tx, &ty, &tz);
+                tx = tx * denom;
+                ty = ty * denom;
+                tz = tz * denom;
+
+                fjx = (-xm * tx) * cfx + (zab - ym * tx) * cfy + (-yab - zm * tx) * cfz;
+                fjy = (-zab - xm * ty) * cfx + (-ym * ty) * cfy + (xab - zm * ty) * cfz;
+                fjz = (yab - xm * tz) * cfx + (-xab - ym * tz) * cfy + (-zm * tz) * cfz;
+
+                simdCrossProduct(xjb, yjb, zjb, xm, ym, zm, &tx, &ty, &tz);
+                tx = tx * denom * a;
+                ty = ty * denom * a;
+                tz = tz * denom * a;
+
+                fkx = (-xm * tx) * cfx + (-a * zjb - ym * tx) * cfy + (a * yjb - zm * tx) * cfz;
+                fky = (a * zjb - xm * ty) * cfx + (-ym * ty) * cfy + (-a * xjb - zm * ty) * cfz;
+                fkz = (-a * yjb - xm * tz) * cfx + (a * xjb - ym * tz) * cfy + (-zm * tz) * cfz;
+
+                simdCrossProduct(xm, ym, zm, xja, yja, zja, &tx, &ty, &tz);
+                tx = tx * denom * b;
+                ty = ty * denom * b;
+                tz = tz * denom * b;
+
+                const SimdReal flx = (-xm * tx) * cfx + (b * zja - ym * tx) * cfy
+                                     + (-b * yja - zm * tx) * cfz;
+                const SimdReal fly = (-b * zja - xm * ty) * cfx + (-ym * ty) * cfy
+                                     + (b * xja - zm * ty) * cfz;
+                const SimdReal flz = (b * yja - xm * tz) * cfx + (-b * xja - ym * tz) * cfy
+                                     + (-zm * tz) * cfz;
+
+                fix = fvx - fjx - fkx - flx;
+                fiy = fvy - fjy - fky - fly;
+                fiz = fvz - fjz - fkz - flz;
+
+                scatterVsiteVectors<true>(f, batch.atoms[4].data() + i, flx, fly, flz);
+            }
+        }
+
+        scatterVsiteVectors<true>(f, batch.atoms[1].data() + i, fix, fiy, fiz);
+        scatterVsiteVectors<true>(f, batch.atoms[2].data() + i, fjx, fjy, fjz);
+        scatterVsiteVectors<true>(f, batch.atoms[3].data() + i, fkx, fky, fkz);
+        scatterVsiteVectors<false>(f, batch.atoms[0].data() + i, zero, zero, zero);
+    }
+}
+
+//! Spreads the forces on the vsites of type \p ftype in \p batch using SIMD, without PBC and virial
+static void spreadForcesSimd(ArrayRef<const RVec>  x,
+                             ArrayRef<RVec>        f,
+                             const int             ftype,
+                             const VsiteSimdBatch& batch)
+{
+    switch (ftype)
+    {
+        case F_VSITE3: spreadForcesSimd<F_VSITE3>(x, f, batch); break;
+        case F_VSITE3FD: spreadForcesSimd<F_VSITE3FD>(x, f, batch); break;
+        case F_VSITE3OUT: spreadForcesSimd<F_VSITE3OUT>(x, f, batch); break;
+        case F_VSITE4FDN: spreadForcesSimd<F_VSITE4FDN>(x, f, batch); break;
+        default: GMX_RELEASE_ASSERT(false, "Vsite type without SIMD kernel");
+    }
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 /*! \brief Returns the PBC mode based on the system PBC and vsite properties
  *
  * \param[in] pbcPtr  A pointer to a PBC struct or nullptr when no PBC treatment is required
@@ -907,13 +1422,15 @@ static PbcMode getPbcMode(const t_pbc* pbcPtr)
  * \param[in]     ip  Interaction parameters for all interaction, only vsite parameters are used
  * \param[in]     ilist  The interaction lists, only vsites are usesd
  * \param[in]     pbc_null  PBC struct, used for PBC distance calculations when !=nullptr
+ * \param[in]     simdBatches  SIMD batches of the vsites in \p ilist, can be nullptr
  */
 template<VSiteCalculatePosition calculatePosition, VSiteCalculateVelocity calculateVelocity>
 static void construct_vsites_thread(ArrayRef<RVec>                  x,
                                     ArrayRef<RVec>                  v,
                                     ArrayRef<const t_iparams>       ip,
                                     ArrayRef<const InteractionList> ilist,
-                                    const t_pbc*                    pbc_null)
+                                    const t_pbc*                    pbc_null,
+                                    const VsiteSimdBatches*         simdBatches)
 {
     if (calculateVelocity == VSiteCalculateVelocity::Yes)
     {
@@ -949,6 +1466,11 @@ static void construct_vsites_thread(ArrayRef<RVec>                  x,
     /* We need another pbc pointer, as with charge groups we switch per vsite */
     const t_pbc* pbc_null2 = pbc_null;
 
+    /* The SIMD kernels only compute positions and do not support PBC */
+    const bool useSimdBatches =
+            (simdBatches != nullptr && calculatePosition == VSiteCalculatePosition::Yes
+             && calculateVelocity == VSiteCalculateVelocity::No && pbcMode == PbcMode::none);
+
     for (int ftype = c_ftypeVsiteStart; ftype < c_ftypeVsiteEnd; ftype++)
     {
         if (ilist[ftype].empty())
@@ -963,7 +1485,22 @@ static void construct_vsites_thread(ArrayRef<RVec>                  x,
 
             const t_iatom* ia = ilist[ftype].iatoms.data();
 
-            for (int i = 0; i < nr;)
+            int i = 0;
+#if GMX_SIMD_HAVE_REAL
+            const int typeIndex = simdVsiteTypeIndex(ftype);
+            if (useSimdBatches && typeIndex >= 0 && (*simdBatches)[typeIndex].numVsites > 0)
+            {
+                const VsiteSimdBatch& batch = (*simdBatches)[typeIndex];
+                constructVsitesSimd(x, ftype, batch);
+                /* Continue with the entries that are not in the batch */
+                i = batch.numVsites * inc;
+                ia += i;
+            }
+#else
+            GMX_UNUSED_VALUE(useSimdBatches);
+#endif
+
+            while (i < nr)
             {
                 int tp = ia[0];
                 /* The vsite and constructing atoms */
@@ -1147,6 +1684,7 @@ static void construct_vsites_thread(ArrayRef<RVec>                  x,
  * \param[in,out] v   When not empty, velocities are generated for virtual sites
  * \param[in]     ip  Interaction parameters for all interaction, only vsite parameters are used
  * \param[in]     ilist  The interaction lists, only vsites are usesd
+ * \param[in]     simdBatches  SIMD batches of the vsites in \p ilist, can be nullptr
  * \param[in]     domainInfo  Information about PBC and DD
  * \param[in]     box  Used for PBC when PBC is set in domainInfo
  */
@@ -1156,6 +1694,7 @@ static void construct_vsites(const ThreadingInfo*            threadingInfo,
                              ArrayRef<RVec>                  v,
                              ArrayRef<const t_iparams>       ip,
                              ArrayRef<const InteractionList> ilist,
+                             const VsiteSimdBatches*         simdBatches,
                              const DomainInfo&               domainInfo,
                              const matrix                    box)
 {
@@ -1198,7 +1737,8 @@ static void construct_vsites(const ThreadingInfo*            threadingInfo,
 
     if (threadingInfo == nullptr || threadingInfo->numThreads() == 1)
     {
-        construct_vsites_thread<calculatePosition, calculateVelocity>(x, v, ip, ilist, pbc_null);
+        construct_vsites_thread<calculatePosition, calculateVelocity>(
+                x, v, ip, ilist, pbc_null, simdBatches);
     }
     else
     {
@@ -1212,7 +1752,7 @@ static void construct_vsites(const ThreadingInfo*            threadingInfo,
                            "The thread data should be initialized before calling construct_vsites");
 
                 construct_vsites_thread<calculatePosition, calculateVelocity>(
-                        x, v, ip, tData.ilist, pbc_null);
+                        x, v, ip, tData.ilist, pbc_null, &tData.simdBatches);
                 if (tData.useInterdependentTask)
                 {
                     /* Here we don't need a barrier (unlike the spreading),
@@ -1220,14 +1760,15 @@ static void construct_vsites(const ThreadingInfo*            threadingInfo,
                      * or local vsites, not from non-local vsites.
                      */
                     construct_vsites_thread<calculatePosition, calculateVelocity>(
-                            x, v, ip, tData.idTask.ilist, pbc_null);
+                            x, v, ip, tData.idTask.ilist, pbc_null, &tData.idTask.simdBatches);
                 }
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
         /* Now we can construct the vsites that might depend on other vsites */
+        const VsiteThread& nlDependentVSites = threadingInfo->threadDataNonLocalDependent();
         construct_vsites_thread<calculatePosition, calculateVelocity>(
-                x, v, ip, threadingInfo->threadDataNonLocalDependent().ilist, pbc_null);
+                x, v, ip, nlDependentVSites.ilist, pbc_null, &nlDependentVSites.simdBatches);
     }
 }
 
@@ -1240,15 +1781,15 @@ void VirtualSitesHandler::Impl::construct(ArrayRef<RVec> x,
     {
         case VSiteOperation::Positions:
             construct_vsites<VSiteCalculatePosition::Yes, VSiteCalculateVelocity::No>(
-                    &threadingInfo_, x, v, iparams_, ilists_, domainInfo_, box);
+                    &threadingInfo_, x, v, iparams_, ilists_, &simdBatches_, domainInfo_, box);
             break;
         case VSiteOperation::Velocities:
             construct_vsites<VSiteCalculatePosition::No, VSiteCalculateVelocity::Yes>(
-                    &threadingInfo_, x, v, iparams_, ilists_, domainInfo_, box);
+                    &threadingInfo_, x, v, iparams_, ilists_, &simdBatches_, domainInfo_, box);
             break;
         case VSiteOperation::PositionsAndVelocities:
             construct_vsites<VSiteCalculatePosition::Yes, VSiteCalculateVelocity::Yes>(
-                    &threadingInfo_, x, v, iparams_, ilists_, domainInfo_, box);
+                    &threadingInfo_, x, v, iparams_, ilists_, &simdBatches_, domainInfo_, box);
             break;
         default: gmx_fatal(FARGS, "Unknown virtual site operation");
     }
@@ -1265,7 +1806,7 @@ void constructVirtualSites(ArrayRef<RVec> x, ArrayRef<const t_iparams> ip, Array
     // No PBC, no DD
     const DomainInfo domainInfo;
     construct_vsites<VSiteCalculatePosition::Yes, VSiteCalculateVelocity::No>(
-            nullptr, x, {}, ip, ilist, domainInfo, nullptr);
+            nullptr, x, {}, ip, ilist, nullptr, domainInfo, nullptr);
 }
 
 #ifndef DOXYGEN
@@ -2139,7 +2680,7 @@ static int vsite_count(ArrayRef<const InteractionList> ilist, int ftype)
     }
 }
 
-//! Executes the force spreading task for a single thread
+//! Executes the force spreading task for a single thread, uses \p simdBatches when !=nullptr
 template<VirialHandling virialHandling>
 static void spreadForceForThread(ArrayRef<const RVec>            x,
                                  ArrayRef<RVec>                  f,
@@ -2147,6 +2688,7 @@ static void spreadForceForThread(ArrayRef<const RVec>            x,
                                  matrix                          dxdf,
                                  ArrayRef<const t_iparams>       ip,
                                  ArrayRef<const InteractionList> ilist,
+                                 const VsiteSimdBatches*         simdBatches,
                                  const t_pbc*                    pbc_null)
 {
     const PbcMode pbcMode = getPbcMode(pbc_null);
@@ -2154,6 +2696,13 @@ static void spreadForceForThread(ArrayRef<const RVec>            x,
     const t_pbc*             pbc_null2 = pbc_null;
     gmx::ArrayRef<const int> vsite_pbc;
 
+    /* The SIMD kernels do not support PBC or the non-linear virial contribution.
+     * Without PBC there are no shift force contributions, so VirialHandling::Pbc
+     * does not require extra work.
+     */
+    const bool useSimdBatches = (simdBatches != nullptr && pbcMode == PbcMode::none
+                                 && virialHandling != VirialHandling::NonLinear);
+
     /* this loop goes backwards to be able to build *
      * higher type vsites from lower types         */
     for (int ftype = c_ftypeVsiteEnd - 1; ftype >= c_ftypeVsiteStart; ftype--)
@@ -2175,7 +2724,22 @@ static void spreadForceForThread(ArrayRef<const RVec>            x,
                 pbc_null2 = pbc_null;
             }
 
-            for (int i = 0; i < nr;)
+            int i = 0;
+#if GMX_SIMD_HAVE_REAL
+            const int typeIndex = simdVsiteTypeIndex(ftype);
+            if (useSimdBatches && typeIndex >= 0 && (*simdBatches)[typeIndex].numVsites > 0)
+            {
+                const VsiteSimdBatch& batch = (*simdBatches)[typeIndex];
+                spreadForcesSimd(x, f, ftype, batch);
+                /* Continue with the entries that are not in the batch */
+                i = batch.numVsites * inc;
+                ia += i;
+            }
+#else
+            GMX_UNUSED_VALUE(useSimdBatches);
+#endif
+
+            while (i < nr)
             {
                 int tp = ia[0];
 
@@ -2244,6 +2808,7 @@ static void spreadForceWrapper(ArrayRef<const RVec>            x,
                                const bool                      clearDxdf,
                                ArrayRef<const t_iparams>       ip,
                                ArrayRef<const InteractionList> ilist,
+                               const VsiteSimdBatches*         simdBatches,
                                const t_pbc*                    pbc_null)
 {
     if (virialHandling == VirialHandling::NonLinear && clearDxdf)
@@ -2254,13 +2819,16 @@ static void spreadForceWrapper(ArrayRef<const RVec>            x,
     switch (virialHandling)
     {
         case VirialHandling::None:
-            spreadForceForThread<VirialHandling::None>(x, f, fshift, dxdf, ip, ilist, pbc_null);
+            spreadForceForThread<VirialHandling::None>(
+                    x, f, fshift, dxdf, ip, ilist, simdBatches, pbc_null);
             break;
         case VirialHandling::Pbc:
-            spreadForceForThread<VirialHandling::Pbc>(x, f, fshift, dxdf, ip, ilist, pbc_null);
+            spreadForceForThread<VirialHandling::Pbc>(
+                    x, f, fshift, dxdf, ip, ilist, simdBatches, pbc_null);
             break;
         case VirialHandling::NonLinear:
-            spreadForceForThread<VirialHandling::NonLinear>(x, f, fshift, dxdf, ip, ilist, pbc_null);
+            spreadForceForThread<VirialHandling::NonLinear>(
+                    x, f, fshift, dxdf, ip, ilist, simdBatches, pbc_null);
             break;
     }
 }
@@ -2319,7 +2887,16 @@ void VirtualSitesHandler::Impl::spreadForces(ArrayRef<const RVec> x,
     if (numThreads == 1)
     {
         matrix dxdf;
-        spreadForceWrapper(x, f, virialHandling, fshift, dxdf, true, iparams_, ilists_, pbc_null);
+        spreadForceWrapper(x,
+                           f,
+                           virialHandling,
+                           fshift,
+                           dxdf,
+                           true,
+                           iparams_,
+                           ilists_,
+                           &simdBatches_,
+                           pbc_null);
 
         if (virialHandling == VirialHandling::NonLinear)
         {
@@ -2344,6 +2921,7 @@ void VirtualSitesHandler::Impl::spreadForces(ArrayRef<const RVec> x,
                            true,
                            iparams_,
                            nlDependentVSites.ilist,
+                           &nlDependentVSites.simdBatches,
                            pbc_null);
 
 #pragma omp parallel num_threads(numThreads)
@@ -2397,6 +2975,7 @@ void VirtualSitesHandler::Impl::spreadForces(ArrayRef<const RVec> x,
                                        true,
                                        iparams_,
                                        tData.idTask.ilist,
+                                       &tData.idTask.simdBatches,
                                        pbc_null);
 
                     /* We need a barrier before reducing forces below
@@ -2433,8 +3012,16 @@ void VirtualSitesHandler::Impl::spreadForces(ArrayRef<const RVec> x,
                 }
 
                 /* Spread the vsites that spread locally only */
-                spreadForceWrapper(
-                        x, f, virialHandling, fshift_t, tData.dxdf, false, iparams_, tData.ilist, pbc_null);
+                spreadForceWrapper(x,
+                                   f,
+                                   virialHandling,
+                                   fshift_t,
+                                   tData.dxdf,
+                                   false,
+                                   iparams_,
+                                   tData.ilist,
+                                   &tData.simdBatches,
+                                   pbc_null);
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
@@ -2646,7 +3233,8 @@ VirtualSitesHandler::Impl::Impl(const gmx_mtop_t&                       mtop,
                                 const ArrayRef<const RangePartitioning> updateGroupingPerMoleculeType) :
     numInterUpdategroupVirtualSites_(countInterUpdategroupVsites(mtop, updateGroupingPerMoleculeType)),
     domainInfo_({ pbcType, pbcType != PbcType::No && numInterUpdategroupVirtualSites_ > 0, domdec }),
-    iparams_(mtop.ffparams.iparams)
+    iparams_(mtop.ffparams.iparams),
+    useSimdKernels_(getenv("GMX_DISABLE_SIMD_KERNELS") == nullptr)
 {
 }
 
@@ -2852,7 +3440,8 @@ void ThreadingInfo::setVirtualSites(ArrayRef<const InteractionList> ilists,
                                     const int                       numAtoms,
                                     const int                       homenr,
                                     ArrayRef<const ParticleType>    ptype,
-                                    const bool                      useDomdec)
+                                    const bool                      useDomdec,
+                                    const bool                      useSimd)
 {
     if (numThreads_ <= 1)
     {
@@ -3033,6 +3622,9 @@ void ThreadingInfo::setVirtualSites(ArrayRef<const InteractionList> ilists,
             }
             assignVsitesToThread(
                     &tData, thread, numThreads_, natperthread, taskIndex_, ilists, iparams, ptype);
+            setVsiteSimdBatches(tData.ilist, iparams, ptype, useSimd, &tData.simdBatches);
+            setVsiteSimdBatches(
+                    tData.idTask.ilist, iparams, ptype, useSimd, &tData.idTask.simdBatches);
 
             if (tData.useInterdependentTask)
             {
@@ -3071,6 +3663,9 @@ void ThreadingInfo::setVirtualSites(ArrayRef<const InteractionList> ilists,
      * to a single task that will not run in parallel with other tasks.
      */
     assignVsitesToSingleTask(tData_[numThreads_].get(), 2 * numThreads_, taskIndex_, ilists, iparams);
+    VsiteThread& nlDependentVSites = threadDataNonLocalDependent();
+    setVsiteSimdBatches(
+            nlDependentVSites.ilist, iparams, ptype, useSimd, &nlDependentVSites.simdBatches);
 
     if (debug && numThreads_ > 1)
     {
@@ -3120,7 +3715,13 @@ void VirtualSitesHandler::Impl::setVirtualSites(ArrayRef<const InteractionList>
 {
     ilists_ = ilists;
 
-    threadingInfo_.setVirtualSites(ilists, iparams_, numAtoms, homenr, ptype, domainInfo_.useDomdec());
+    threadingInfo_.setVirtualSites(
+            ilists, iparams_, numAtoms, homenr, ptype, domainInfo_.useDomdec(), useSimdKernels_);
+
+    if (threadingInfo_.numThreads() == 1)
+    {
+        setVsiteSimdBatches(ilists_, iparams_, ptype, useSimdKernels_, &simdBatches_);
+    }
 }
 
 void VirtualSitesHandler::setVirtualSites(ArrayRef<const InteractionList> ilists,
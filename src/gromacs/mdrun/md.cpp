@@ -276,6 +276,11 @@ void gmx::LegacySimulator::do_md()
         doSimulatedAnnealing   = initSimulatedAnnealing(nonConstInputrec, &upd);
     }
     const bool useReplicaExchange = (replExParams.exchangeInterval > 0);
+    /* With exchange of lambda states, the state is written to the dhdl output */
+    const bool exchangeLambdaStates = (useReplicaExchange && replExParams.exchangeStates);
+    /* With lagged replica exchange, the exchange data is posted at the
+     * exchange step and the exchange is done at the next step */
+    const int replicaExchangeLag = (useReplicaExchange && useLaggedReplicaExchange()) ? 1 : 0;
 
     const t_fcdata& fcdata = *fr->fcdata;
 
@@ -322,6 +327,7 @@ void gmx::LegacySimulator::do_md()
                                    wcycle,
                                    startingBehavior,
                                    simulationsShareState,
+                                   exchangeLambdaStates,
                                    ms);
     gmx::EnergyOutput energyOutput(mdoutf_get_fp_ene(outf),
                                    top_global,
@@ -331,6 +337,7 @@ void gmx::LegacySimulator::do_md()
                                    false,
                                    startingBehavior,
                                    simulationsShareState,
+                                   exchangeLambdaStates,
                                    mdModulesNotifiers);
 
     gstat = global_stat_init(ir);
@@ -346,6 +353,7 @@ void gmx::LegacySimulator::do_md()
                                  top_global,
                                  constr ? constr->numFlexibleConstraints() : 0,
                                  ir->nstcalcenergy,
+                                 ir->shellPropagation,
                                  DOMAINDECOMP(cr),
                                  useGpuForPme);
 
@@ -896,8 +904,15 @@ void gmx::LegacySimulator::do_md()
                            && (!bFirstStep));
         }
 
-        bDoReplEx = (useReplicaExchange && (step > 0) && !bLastStep
-                     && do_per_step(step, replExParams.exchangeInterval));
+        /* A lagged exchange needs data posted at the previous step of this run,
+         * which is not the case at the first step after a restart */
+        bDoReplEx = (useReplicaExchange && (step - replicaExchangeLag > 0) && !bLastStep
+                     && (replicaExchangeLag == 0 || !bFirstStep)
+                     && do_per_step(step - replicaExchangeLag, replExParams.exchangeInterval));
+        /* Only post when the exchange will be done at the next step */
+        const bool bPostReplEx = (replicaExchangeLag > 0 && (step > 0) && !bLastStep
+                                  && (ir->nsteps < 0 || step_rel + 1 < ir->nsteps)
+                                  && do_per_step(step, replExParams.exchangeInterval));
 
         if (doSimulatedAnnealing)
         {
@@ -1097,7 +1112,7 @@ void gmx::LegacySimulator::do_md()
 
         do_ene = (do_per_step(step, ir->nstenergy) || bLastStep);
 
-        if (do_ene || do_log || bDoReplEx)
+        if (do_ene || do_log || bDoReplEx || bPostReplEx)
         {
             bCalcVir  = TRUE;
             bCalcEner = TRUE;
@@ -1151,6 +1166,7 @@ void gmx::LegacySimulator::do_md()
                                 mu_tot,
                                 vsite,
                                 ddBalanceRegionHandler);
+            coupleShellRelativeMotion(shellfc, *ir, *md, makeArrayRef(state->v));
         }
         else
         {
@@ -1202,6 +1218,18 @@ void gmx::LegacySimulator::do_md()
                      ddBalanceRegionHandler);
         }
 
+        /* With leap-frog, the summed force virial and potential energies are
+         * only needed after the update, so we start summing them here to
+         * overlap the communication with the update and constraints.
+         * The sum is completed in compute_globals().
+         */
+        if (!EI_VV(ir->eI) && bGStat && PAR(cr) && gmx_have_nonblocking_sumd())
+        {
+            wallcycle_start_nocount(wcycle, WallCycleCounter::MoveE);
+            global_stat_start_force_terms(gstat, cr, *enerd, force_vir, bCalcEner);
+            wallcycle_stop(wcycle, WallCycleCounter::MoveE);
+        }
+
         // VV integrators do not need the following velocity half step
         // if it is the first step after starting from a checkpoint.
         // That is, the half step is needed on all other steps, and
@@ -1558,6 +1586,27 @@ void gmx::LegacySimulator::do_md()
                     stateGpu->waitVelocitiesReadyOnHost(AtomLocality::Local);
                 }
             }
+            else if (!simulationWork.useMts && upd.canFuseUpdateAndSettle(*ir, constr))
+            {
+                // This applies Leap-Frog and SETTLE and copies back the coordinates in one pass
+                upd.update_coords_settle_and_finish(
+                        *ir,
+                        step,
+                        md->homenr,
+                        md->havePartiallyFrozenAtoms,
+                        gmx::arrayRefFromArray(md->invmass, md->nr),
+                        gmx::arrayRefFromArray(md->invMassPerDim, md->nr),
+                        state,
+                        f.view().forceWithPadding(),
+                        fcdata,
+                        ekind,
+                        M,
+                        constr,
+                        bCalcVir,
+                        shake_vir);
+
+                wallcycle_stop(wcycle, WallCycleCounter::Update);
+            }
             else
             {
                 /* With multiple time stepping we need to do an additional normal
@@ -1942,6 +1991,10 @@ void gmx::LegacySimulator::do_md()
 
         /* Replica exchange */
         bExchanged = FALSE;
+        if (bPostReplEx && MASTER(cr))
+        {
+            post_replica_exchange(ms, repl_ex, enerd, state, step, t);
+        }
         if (bDoReplEx)
         {
             bExchanged = replica_exchange(fplog, cr, ms, repl_ex, state_global, enerd, state, step, t);
@@ -253,6 +253,7 @@ void gmx::LegacySimulator::do_mimic()
                                    wcycle,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    ms);
     gmx::EnergyOutput energyOutput(mdoutf_get_fp_ene(outf),
                                    top_global,
@@ -262,6 +263,7 @@ void gmx::LegacySimulator::do_mimic()
                                    true,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    mdModulesNotifiers);
 
     gstat = global_stat_init(ir);
@@ -271,6 +273,7 @@ void gmx::LegacySimulator::do_mimic()
                                  top_global,
                                  constr ? constr->numFlexibleConstraints() : 0,
                                  ir->nstcalcenergy,
+                                 ir->shellPropagation,
                                  DOMAINDECOMP(cr),
                                  runScheduleWork->simulationWork.useGpuPme);
 
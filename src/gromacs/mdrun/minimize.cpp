@@ -413,6 +413,7 @@ static void init_em(FILE*                fplog,
                                       top_global,
                                       constr ? constr->numFlexibleConstraints() : 0,
                                       ir->nstcalcenergy,
+                                      ir->shellPropagation,
                                       DOMAINDECOMP(cr),
                                       thisRankHasDuty(cr, DUTY_PME));
     }
@@ -1318,6 +1319,7 @@ void LegacySimulator::do_cg()
                                    wcycle,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    ms);
     gmx::EnergyOutput energyOutput(mdoutf_get_fp_ene(outf),
                                    top_global,
@@ -1327,6 +1329,7 @@ void LegacySimulator::do_cg()
                                    false,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    mdModulesNotifiers);
 
     /* Print to log file */
@@ -2017,6 +2020,7 @@ void LegacySimulator::do_lbfgs()
                                    wcycle,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    ms);
     gmx::EnergyOutput energyOutput(mdoutf_get_fp_ene(outf),
                                    top_global,
@@ -2026,6 +2030,7 @@ void LegacySimulator::do_lbfgs()
                                    false,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    mdModulesNotifiers);
 
     const int start = 0;
@@ -2794,6 +2799,7 @@ void LegacySimulator::do_steep()
                                    wcycle,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    ms);
     gmx::EnergyOutput energyOutput(mdoutf_get_fp_ene(outf),
                                    top_global,
@@ -2803,6 +2809,7 @@ void LegacySimulator::do_steep()
                                    false,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    mdModulesNotifiers);
 
     /* Print to log file  */
@@ -3120,6 +3127,7 @@ void LegacySimulator::do_nm()
                                    wcycle,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    ms);
 
     std::vector<int>       atom_index = get_atom_index(top_global);
@@ -51,8 +51,10 @@
 #include "config.h"
 
 #include <cmath>
+#include <cstdlib>
 
 #include <random>
+#include <utility>
 
 #include "gromacs/domdec/collect.h"
 #include "gromacs/gmxlib/network.h"
@@ -142,6 +144,26 @@ struct gmx_repl_ex
     int** nmoves;
     //! i-th element of the array is the number of exchanges between replica i-1 and i
     int* nexchange;
+    //! Whether lambda states are exchanged between the simulations instead of coordinates
+    gmx_bool bExchangeStates;
+    //! The lambda state, as index into the replica list, that each simulation samples
+    int* replicaState;
+    //! The simulation sampling each lambda state, the inverse of \p replicaState
+    int* stateReplica;
+    //! Reduced potential energy matrix, indexed as [state * nrepl + simulation]
+    real* reducedEnergy;
+    //! Whether exchanges are done one step after the exchange data has been posted
+    gmx_bool bLagged;
+    //! Whether posted exchange data is waiting for the exchange
+    gmx_bool bPending;
+    //! The step at which the pending exchange data was posted
+    int64_t postedStep;
+    //! The time at which the pending exchange data was posted
+    real postedTime;
+    //! Buffer for summing all exchange data over the simulations in one call
+    double* sumBuffer;
+    //! Request for the non-blocking sum of \p sumBuffer
+    MPI_Request sumRequest;
 
     /*! \brief Helper arrays for replica exchange; allocated here
      * so they don't have to be allocated each time */
@@ -320,6 +342,31 @@ gmx_repl_ex_t init_replica_exchange(FILE*                            fplog,
             gmx_fatal(FARGS, "delta_lambda is not zero");
         }
     }
+    re->bExchangeStates = replExParams.exchangeStates;
+    if (re->bExchangeStates)
+    {
+        if (re->type != ReplicaExchangeType::Lambda)
+        {
+            gmx_fatal(FARGS,
+                      "Exchanging lambda states instead of coordinates is only supported with "
+                      "replica exchange in lambda, not in %s",
+                      enumValueToString(re->type));
+        }
+        if (ir->bExpanded)
+        {
+            gmx_fatal(FARGS,
+                      "Exchanging lambda states instead of coordinates can not be combined with "
+                      "expanded ensemble simulations");
+        }
+        /* Which simulation samples which lambda state changes with every
+         * exchange, so after a checkpoint restart the initial states of
+         * the simulations are in arbitrary order. The states are indexed
+         * in lambda order here, the state of each simulation is looked up
+         * at each exchange.
+         */
+        real* lambdaStates = re->q[ReplicaExchangeType::Lambda];
+        std::sort(lambdaStates, lambdaStates + re->nrepl);
+    }
     if (re->bNPT)
     {
         snew(re->pres, re->nrepl);
@@ -503,6 +550,21 @@ gmx_repl_ex_t init_replica_exchange(FILE*                            fplog,
     {
         snew(re->de[i], re->nrepl);
     }
+    if (re->bExchangeStates)
+    {
+        fprintf(fplog, "\nRepl  Exchanging lambda states instead of coordinates\n");
+        snew(re->replicaState, re->nrepl);
+        snew(re->stateReplica, re->nrepl);
+        snew(re->reducedEnergy, re->nrepl * re->nrepl);
+    }
+    /* Volumes and energies, or lambda states, and the energy difference matrix */
+    snew(re->sumBuffer, re->nrepl * (2 + re->nrepl));
+    re->bLagged = useLaggedReplicaExchange();
+    if (re->bLagged)
+    {
+        fprintf(fplog,
+                "\nRepl  Exchanges are done one step after the exchange data has been posted\n");
+    }
     re->nex = replExParams.numExchanges;
     return re;
 }
@@ -860,46 +922,27 @@ static real calc_delta(FILE* fplog, gmx_bool bPrint, struct gmx_repl_ex* re, int
     return delta;
 }
 
-static void test_for_replica_exchange(FILE*                 fplog,
-                                      const gmx_multisim_t* ms,
-                                      struct gmx_repl_ex*   re,
-                                      const gmx_enerdata_t* enerd,
-                                      real                  vol,
-                                      int64_t               step,
-                                      real                  time)
+/* Sets the contributions of this simulation to the data for a replica
+ * exchange, the contributions of the other simulations are zero */
+static void set_replica_exchange_data(struct gmx_repl_ex* re, const gmx_enerdata_t* enerd, real vol)
 {
-    int                                m, i, j, a, b, ap, bp, i0, i1, tmp;
-    real                               delta = 0;
-    gmx_bool                           bPrint, bMultiEx;
-    gmx_bool*                          bEx      = re->bEx;
-    real*                              prob     = re->prob;
-    int*                               pind     = re->destinations; /* permuted index */
-    gmx_bool                           bEpot    = FALSE;
-    gmx_bool                           bDLambda = FALSE;
-    gmx_bool                           bVol     = FALSE;
-    gmx::ThreeFry2x64<64>              rng(re->seed, gmx::RandomDomain::ReplicaExchange);
-    gmx::UniformRealDistribution<real> uniformRealDist;
-    gmx::UniformIntDistribution<int>   uniformNreplDist(0, re->nrepl - 1);
-
-    bMultiEx = (re->nex > 1); /* multiple exchanges at each state */
-    fprintf(fplog, "Replica exchange at step %" PRId64 " time %.5f\n", step, time);
+    int i, j;
 
-    if (re->bNPT)
+    for (i = 0; i < re->nrepl; i++)
     {
-        for (i = 0; i < re->nrepl; i++)
+        re->Vol[i]  = 0;
+        re->Epot[i] = 0;
+        for (j = 0; j < re->nrepl; j++)
         {
-            re->Vol[i] = 0;
+            re->de[i][j] = 0;
         }
-        bVol              = TRUE;
+    }
+    if (re->bNPT)
+    {
         re->Vol[re->repl] = vol;
     }
     if ((re->type == ReplicaExchangeType::Temperature || re->type == ReplicaExchangeType::TemperatureLambda))
     {
-        for (i = 0; i < re->nrepl; i++)
-        {
-            re->Epot[i] = 0;
-        }
-        bEpot              = TRUE;
         re->Epot[re->repl] = enerd->term[F_EPOT];
         /* temperatures of different states*/
         for (i = 0; i < re->nrepl; i++)
@@ -916,40 +959,31 @@ static void test_for_replica_exchange(FILE*                 fplog,
     }
     if (re->type == ReplicaExchangeType::Lambda || re->type == ReplicaExchangeType::TemperatureLambda)
     {
-        bDLambda = TRUE;
         /* lambda differences. */
         /* de[i][j] is the energy of the jth simulation in the ith Hamiltonian
            minus the energy of the jth simulation in the jth Hamiltonian */
         for (i = 0; i < re->nrepl; i++)
-        {
-            for (j = 0; j < re->nrepl; j++)
-            {
-                re->de[i][j] = 0;
-            }
-        }
-        for (i = 0; i < re->nrepl; i++)
         {
             re->de[i][re->repl] =
                     enerd->foreignLambdaTerms.deltaH(re->q[ReplicaExchangeType::Lambda][i]);
         }
     }
+}
 
-    /* now actually do the communication */
-    if (bVol)
-    {
-        gmx_sum_sim(re->nrepl, re->Vol, ms);
-    }
-    if (bEpot)
-    {
-        gmx_sum_sim(re->nrepl, re->Epot, ms);
-    }
-    if (bDLambda)
-    {
-        for (i = 0; i < re->nrepl; i++)
-        {
-            gmx_sum_sim(re->nrepl, re->de[i], ms);
-        }
-    }
+static void test_for_replica_exchange(FILE* fplog, struct gmx_repl_ex* re, int64_t step, real time)
+{
+    int                                m, i, a, b, ap, bp, i0, i1, tmp;
+    real                               delta = 0;
+    gmx_bool                           bPrint, bMultiEx;
+    gmx_bool*                          bEx  = re->bEx;
+    real*                              prob = re->prob;
+    int*                               pind = re->destinations; /* permuted index */
+    gmx::ThreeFry2x64<64>              rng(re->seed, gmx::RandomDomain::ReplicaExchange);
+    gmx::UniformRealDistribution<real> uniformRealDist;
+    gmx::UniformIntDistribution<int>   uniformNreplDist(0, re->nrepl - 1);
+
+    bMultiEx = (re->nex > 1); /* multiple exchanges at each state */
+    fprintf(fplog, "Replica exchange at step %" PRId64 " time %.5f\n", step, time);
 
     /* make a duplicate set of indices for shuffling */
     for (i = 0; i < re->nrepl; i++)
@@ -1256,6 +1290,299 @@ static void prepare_to_do_exchange(struct gmx_repl_ex* re, const int replica_id,
     }
 }
 
+/* Metropolis test for an exchange that changes the reduced energy by delta */
+static gmx_bool accept_exchange(real                                delta,
+                                real*                               prob,
+                                gmx::ThreeFry2x64<64>*              rng,
+                                gmx::UniformRealDistribution<real>* uniformRealDist)
+{
+    if (delta <= 0)
+    {
+        *prob = 1;
+        return TRUE;
+    }
+    *prob = (delta > c_probabilityCutoff) ? 0 : std::exp(-delta);
+    uniformRealDist->reset();
+    return (*uniformRealDist)(*rng) < *prob;
+}
+
+/* Returns the reduced energy change when the simulations in states s0 and s1 swap states */
+static real state_swap_delta(const struct gmx_repl_ex* re, int s0, int s1)
+{
+    const real* u  = re->reducedEnergy;
+    const int   n  = re->nrepl;
+    const int   c0 = re->stateReplica[s0];
+    const int   c1 = re->stateReplica[s1];
+
+    return (u[s0 * n + c1] + u[s1 * n + c0]) - (u[s0 * n + c0] + u[s1 * n + c1]);
+}
+
+/* Sets the contributions of this simulation to the data for a lambda
+ * state exchange, the contributions of the other simulations are zero.
+ * The current states of all simulations are collected at every exchange,
+ * as they are only stored in the state of each simulation, which is
+ * needed for continuation from checkpoints.
+ */
+static void set_state_exchange_data(struct gmx_repl_ex*   re,
+                                    const gmx_enerdata_t* enerd,
+                                    int                   fepState)
+{
+    const int   nrepl   = re->nrepl;
+    real*       u       = re->reducedEnergy;
+    const real* lambdaQ = re->q[ReplicaExchangeType::Lambda];
+
+    int myState = -1;
+    for (int s = 0; s < nrepl; s++)
+    {
+        re->replicaState[s] = 0;
+        if (static_cast<int>(lambdaQ[s]) == fepState)
+        {
+            myState = s;
+        }
+    }
+    if (myState < 0)
+    {
+        gmx_fatal(FARGS,
+                  "Simulation %d is in lambda state %d, which is not one of the lambda states of "
+                  "the replicas",
+                  re->repl,
+                  fepState);
+    }
+    re->replicaState[re->repl] = myState;
+
+    /* The reduced energy of the configuration of this simulation in all states.
+     * All simulations have the same temperature and pressure, so the kinetic
+     * and pV terms cancel in the exchange probabilities. */
+    const real beta = 1.0 / (re->temp * gmx::c_boltz);
+    for (int i = 0; i < nrepl * nrepl; i++)
+    {
+        u[i] = 0;
+    }
+    for (int s = 0; s < nrepl; s++)
+    {
+        u[s * nrepl + re->repl] =
+                beta * enerd->foreignLambdaTerms.deltaH(static_cast<int>(lambdaQ[s]));
+    }
+}
+
+/* Exchange of lambda states between the simulations, which keep their
+ * coordinates and velocities. As all master ranks use the same random
+ * stream and the same summed exchange data, they all generate the same
+ * state permutation, so no further communication is needed.
+ * Returns the new lambda state of this simulation.
+ */
+static int test_for_state_exchange(FILE* fplog, struct gmx_repl_ex* re, int64_t step, real time)
+{
+    const int                          nrepl    = re->nrepl;
+    gmx_bool*                          bEx      = re->bEx;
+    real*                              prob     = re->prob;
+    int*                               newState = re->tmpswap;
+    const real*                        lambdaQ  = re->q[ReplicaExchangeType::Lambda];
+    gmx::ThreeFry2x64<64>              rng(re->seed, gmx::RandomDomain::ReplicaExchange);
+    gmx::UniformRealDistribution<real> uniformRealDist;
+    gmx::UniformIntDistribution<int>   uniformNreplDist(0, nrepl - 1);
+
+    fprintf(fplog, "Replica exchange at step %" PRId64 " time %.5f\n", step, time);
+
+    for (int s = 0; s < nrepl; s++)
+    {
+        re->stateReplica[s] = -1;
+    }
+    for (int c = 0; c < nrepl; c++)
+    {
+        if (re->stateReplica[re->replicaState[c]] >= 0)
+        {
+            gmx_fatal(FARGS,
+                      "Multiple simulations are in lambda state %d",
+                      static_cast<int>(lambdaQ[re->replicaState[c]]));
+        }
+        re->stateReplica[re->replicaState[c]] = c;
+    }
+
+    rng.restart(step, 0);
+
+    if (re->nex > 1)
+    {
+        /* Gibbs sampling of the state permutation by swaps of random pairs */
+        int nself = 0;
+        for (int i = 0; i < re->nex + nself; i++)
+        {
+            uniformNreplDist.reset();
+            const int s0 = uniformNreplDist(rng);
+            const int s1 = uniformNreplDist(rng);
+            if (s0 == s1)
+            {
+                nself++;
+                continue;
+            }
+            bEx[0] = accept_exchange(
+                    state_swap_delta(re, s0, s1), &prob[0], &rng, &uniformRealDist);
+            re->prob_sum[0] += prob[0];
+            if (bEx[0])
+            {
+                std::swap(re->stateReplica[s0], re->stateReplica[s1]);
+            }
+        }
+        re->nattempt[0]++;
+    }
+    else
+    {
+        /* Exchange between states that are neighbors in lambda, alternating
+         * even and odd pairs. The states are indices into the replica list,
+         * re->ind orders them by lambda. */
+        const int m           = (step / re->nst) % 2;
+        int*      simulations = re->destinations;
+        for (int i = 0; i < nrepl; i++)
+        {
+            simulations[i] = re->stateReplica[re->ind[i]];
+        }
+        for (int i = 1; i < nrepl; i++)
+        {
+            if (i % 2 == m)
+            {
+                const int s0 = re->ind[i - 1];
+                const int s1 = re->ind[i];
+                bEx[i]       = accept_exchange(
+                        state_swap_delta(re, s0, s1), &prob[i], &rng, &uniformRealDist);
+                re->prob_sum[i] += prob[i];
+                if (bEx[i])
+                {
+                    std::swap(re->stateReplica[s0], re->stateReplica[s1]);
+                    re->nexchange[i]++;
+                }
+            }
+            else
+            {
+                prob[i] = -1;
+                bEx[i]  = FALSE;
+            }
+        }
+        /* The simulations in lambda order before the exchange */
+        print_ind(fplog, "ex", nrepl, simulations, bEx);
+        print_prob(fplog, "pr", nrepl, prob);
+        re->nattempt[m]++;
+    }
+
+    /* record which moves were made and accepted */
+    for (int s = 0; s < nrepl; s++)
+    {
+        const int c = re->stateReplica[s];
+        newState[c] = s;
+        re->nmoves[re->replicaState[c]][s] += 1;
+        re->nmoves[s][re->replicaState[c]] += 1;
+    }
+    fprintf(fplog, "Repl  lambda states of the simulations after exchange:");
+    for (int c = 0; c < nrepl; c++)
+    {
+        fprintf(fplog, " %d", static_cast<int>(lambdaQ[newState[c]]));
+    }
+    fprintf(fplog, "\n\n");
+    fflush(fplog);
+
+    return static_cast<int>(lambdaQ[newState[re->repl]]);
+}
+
+/* Starts the sum over the simulations of all exchange data. The data is
+ * packed into a single buffer, so only one collective call is needed. As
+ * only one simulation contributes to each entry, the sum is exact. */
+static void start_exchange_data_sum(const gmx_multisim_t* ms, struct gmx_repl_ex* re)
+{
+    const int n   = re->nrepl;
+    double*   buf = re->sumBuffer;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (re->bExchangeStates)
+        {
+            buf[i]     = re->replicaState[i];
+            buf[n + i] = 0;
+        }
+        else
+        {
+            buf[i]     = re->Vol[i];
+            buf[n + i] = re->Epot[i];
+        }
+        for (int j = 0; j < n; j++)
+        {
+            buf[(2 + i) * n + j] =
+                    re->bExchangeStates ? re->reducedEnergy[i * n + j] : re->de[i][j];
+        }
+    }
+    gmx_sumd_sim_start(n * (2 + n), buf, ms, &re->sumRequest);
+}
+
+/* Completes the sum started by start_exchange_data_sum() and unpacks the data */
+static void finish_exchange_data_sum(struct gmx_repl_ex* re)
+{
+    const int     n   = re->nrepl;
+    const double* buf = re->sumBuffer;
+
+    gmx_sumd_sim_finish(&re->sumRequest);
+
+    for (int i = 0; i < n; i++)
+    {
+        if (re->bExchangeStates)
+        {
+            re->replicaState[i] = static_cast<int>(buf[i]);
+        }
+        else
+        {
+            re->Vol[i]  = buf[i];
+            re->Epot[i] = buf[n + i];
+        }
+        for (int j = 0; j < n; j++)
+        {
+            if (re->bExchangeStates)
+            {
+                re->reducedEnergy[i * n + j] = buf[(2 + i) * n + j];
+            }
+            else
+            {
+                re->de[i][j] = buf[(2 + i) * n + j];
+            }
+        }
+    }
+}
+
+/* Sets the exchange data of this simulation and starts the sum over the simulations */
+static void start_exchange(const gmx_multisim_t* ms,
+                           struct gmx_repl_ex*   re,
+                           const gmx_enerdata_t* enerd,
+                           const t_state*        state_local)
+{
+    if (re->bExchangeStates)
+    {
+        set_state_exchange_data(re, enerd, state_local->fep_state);
+    }
+    else
+    {
+        set_replica_exchange_data(re, enerd, det(state_local->box));
+    }
+    start_exchange_data_sum(ms, re);
+}
+
+bool useLaggedReplicaExchange()
+{
+    return (getenv("GMX_REPLEX_ASYNC") != nullptr);
+}
+
+void post_replica_exchange(const gmx_multisim_t* ms,
+                           struct gmx_repl_ex*   re,
+                           const gmx_enerdata_t* enerd,
+                           const t_state*        state_local,
+                           int64_t               step,
+                           real                  time)
+{
+    GMX_RELEASE_ASSERT(re->bLagged, "Posting exchange data is only done with lagged exchanges");
+    GMX_RELEASE_ASSERT(!re->bPending,
+                       "Exchange data can only be posted after the previous exchange");
+
+    start_exchange(ms, re, enerd, state_local);
+    re->bPending   = TRUE;
+    re->postedStep = step;
+    re->postedTime = time;
+}
+
 gmx_bool replica_exchange(FILE*                 fplog,
                           const t_commrec*      cr,
                           const gmx_multisim_t* ms,
@@ -1275,12 +1602,35 @@ gmx_bool replica_exchange(FILE*                 fplog,
     /* Where each replica ends up after the exchange attempt(s). */
     /* The order in which multiple exchanges will occur. */
     gmx_bool bThisReplicaExchanged = FALSE;
+    /* The lambda state of this simulation after the exchange */
+    int fepState = state_local->fep_state;
 
     if (MASTER(cr))
     {
         replica_id = re->repl;
-        test_for_replica_exchange(fplog, ms, re, enerd, det(state_local->box), step, time);
-        prepare_to_do_exchange(re, replica_id, &maxswap, &bThisReplicaExchanged);
+        if (re->bLagged)
+        {
+            /* Use the exchange data posted at the previous step */
+            GMX_RELEASE_ASSERT(re->bPending, "With lagged exchanges, data should have been posted");
+            re->bPending = FALSE;
+            step         = re->postedStep;
+            time         = re->postedTime;
+        }
+        else
+        {
+            start_exchange(ms, re, enerd, state_local);
+        }
+        finish_exchange_data_sum(re);
+
+        if (re->bExchangeStates)
+        {
+            fepState = test_for_state_exchange(fplog, re, step, time);
+        }
+        else
+        {
+            test_for_replica_exchange(fplog, re, step, time);
+            prepare_to_do_exchange(re, replica_id, &maxswap, &bThisReplicaExchanged);
+        }
     }
     /* Do intra-simulation broadcast so all processors belonging to
      * each simulation know whether they need to participate in
@@ -1290,9 +1640,18 @@ gmx_bool replica_exchange(FILE*                 fplog,
     {
 #if GMX_MPI
         MPI_Bcast(&bThisReplicaExchanged, sizeof(gmx_bool), MPI_BYTE, MASTERRANK(cr), cr->mpi_comm_mygroup);
+        MPI_Bcast(&fepState, 1, MPI_INT, MASTERRANK(cr), cr->mpi_comm_mygroup);
 #endif
     }
 
+    /* With state exchange only the lambda state changes, the lambda
+     * values are set from it at the start of the next step. */
+    state_local->fep_state = fepState;
+    if (MASTER(cr))
+    {
+        state->fep_state = fepState;
+    }
+
     if (bThisReplicaExchanged)
     {
         /* Exchange the states */
@@ -1352,6 +1711,13 @@ void print_replica_exchange_statistics(FILE* fplog, struct gmx_repl_ex* re)
 {
     int i;
 
+    if (re->bPending)
+    {
+        /* The run ended between posting and doing an exchange, the exchange is dropped */
+        gmx_sumd_sim_finish(&re->sumRequest);
+        re->bPending = FALSE;
+    }
+
     fprintf(fplog, "\nReplica exchange statistics\n");
 
     if (re->nex == 0)
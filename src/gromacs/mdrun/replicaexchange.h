@@ -68,6 +68,8 @@ struct ReplicaExchangeParameters
     int numExchanges = 0;
     //! The random seed, -1 means generate a seed.
     int randomSeed = -1;
+    //! Whether to exchange lambda states between the simulations instead of coordinates.
+    bool exchangeStates = false;
 };
 
 //! Abstract type for replica exchange
@@ -82,13 +84,38 @@ gmx_repl_ex_t init_replica_exchange(FILE*                            fplog,
                                     const t_inputrec*                ir,
                                     const ReplicaExchangeParameters& replExParams);
 
+/*! \brief Returns whether exchanges are done one step after posting the exchange data
+ *
+ * This is enabled by the environment variable GMX_REPLEX_ASYNC. The
+ * sum of the exchange data over the simulations then overlaps with
+ * the next MD step, so simulations do not wait for each other at the
+ * exchange step. The exchange is decided with the energies of the
+ * step before the exchange step, which is an approximation.
+ * Can be called on all ranks.
+ */
+bool useLaggedReplicaExchange();
+
+/*! \brief Posts the exchange data of this simulation for a lagged exchange
+ *
+ * Starts a non-blocking sum of the exchange data over the simulations,
+ * which is completed by the call to replica_exchange() at the next step.
+ * Should only be called on the master ranks.
+ */
+void post_replica_exchange(const gmx_multisim_t* ms,
+                           gmx_repl_ex_t         re,
+                           const gmx_enerdata_t* enerd,
+                           const t_state*        state_local,
+                           int64_t               step,
+                           real                  time);
+
 /*! \brief Attempts replica exchange.
  *
  * Should be called on all ranks.  When running each replica in
  * parallel, this routine collects the state on the master rank before
  * exchange.  With domain decomposition, the global state after
  * exchange is stored in state and still needs to be redistributed
- * over the ranks.
+ * over the ranks. With lagged exchanges, the exchange uses the data
+ * posted by post_replica_exchange() at the previous step.
  *
  * \returns TRUE if the state has been exchanged.
  */
@@ -300,6 +300,7 @@ void gmx::LegacySimulator::do_rerun()
                                    wcycle,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    ms);
     gmx::EnergyOutput energyOutput(mdoutf_get_fp_ene(outf),
                                    top_global,
@@ -309,6 +310,7 @@ void gmx::LegacySimulator::do_rerun()
                                    true,
                                    StartingBehavior::NewSimulation,
                                    simulationsShareState,
+                                   false,
                                    mdModulesNotifiers);
 
     gstat = global_stat_init(ir);
@@ -318,6 +320,7 @@ void gmx::LegacySimulator::do_rerun()
                                  top_global,
                                  constr ? constr->numFlexibleConstraints() : 0,
                                  ir->nstcalcenergy,
+                                 ir->shellPropagation,
                                  DOMAINDECOMP(cr),
                                  runScheduleWork->simulationWork.useGpuPme);
 
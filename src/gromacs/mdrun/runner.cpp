@@ -1144,8 +1144,7 @@ int Mdrunner::mdrunner()
      */
 
     /* This needs to be called before read_checkpoint to extend the state */
-    t_disresdata* disresdata;
-    snew(disresdata, 1);
+    auto disresdata = std::make_unique<t_disresdata>();
     init_disres(fplog,
                 mtop,
                 inputrec.get(),
@@ -1154,7 +1153,7 @@ int Mdrunner::mdrunner()
                 PAR(cr) ? NumRanks::Multiple : NumRanks::Single,
                 cr->mpi_comm_mysim,
                 ms,
-                disresdata,
+                disresdata.get(),
                 globalState.get(),
                 replExParams.exchangeInterval > 0);
 
@@ -1629,7 +1628,7 @@ int Mdrunner::mdrunner()
                       opt2fns("-tableb", filenames.size(), filenames.data()),
                       pforce);
         // Dirty hack, for fixing disres and orires should be made mdmodules
-        fr->fcdata->disres = disresdata;
+        fr->fcdata->disres = disresdata.get();
         fr->fcdata->orires.swap(oriresData);
 
         // Save a handle to device stream manager to use elsewhere in the code
@@ -2065,8 +2064,7 @@ int Mdrunner::mdrunner()
     globalState.reset(nullptr);
     mdModules_.reset(nullptr); // destruct force providers here as they might also use the GPU
     fr.reset(nullptr);         // destruct forcerec before gpu
-    // TODO convert to C++ so we can get rid of these frees
-    sfree(disresdata);
+    disresdata.reset(nullptr);
 
     if (!hwinfo_->deviceInfoList.empty())
     {
@@ -78,6 +78,7 @@
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
 
@@ -97,18 +98,22 @@ struct t_shell
     rvec xold;            /* The old shell coordinates */
     rvec fold;            /* The old force on the shell */
     rvec step;            /* Step size for steepest descents */
+    rvec displacement[2]; /* Shell displacement from its nuclei at the last two steps */
 };
 
 struct gmx_shellfc_t
 {
     /* Shell counts, indices, parameters and working data */
-    std::vector<t_shell> shell_gl;              /* All the shells (for DD only)              */
-    std::vector<int>     shell_index_gl;        /* Global shell index (for DD only)          */
-    gmx_bool             bInterCG;              /* Are there inter charge-group shells?      */
-    std::vector<t_shell> shells;                /* The local shells                          */
-    bool                 predictShells = false; /* Predict shell positions                   */
-    bool                 requireInit   = false; /* Require initialization of shell positions */
-    int                  nflexcon      = 0;     /* The number of flexible constraints        */
+    std::vector<t_shell> shell_gl;                   /* All the shells (for DD only)              */
+    std::vector<int>     shell_index_gl;             /* Global shell index (for DD only)          */
+    gmx_bool             bInterCG;                   /* Are there inter charge-group shells?      */
+    std::vector<t_shell> shells;                     /* The local shells                          */
+    bool                 predictShells      = false; /* Predict shell positions                   */
+    bool                 requireInit        = false; /* Require initialization of shell positions */
+    bool                 extrapolateShells  = false; /* Predict by extrapolating displacements    */
+    bool                 extendedLagrangian = false; /* Propagate shells with the integrator      */
+    int                  numDisplacements   = 0;     /* The number of stored displacements, max 2 */
+    int                  nflexcon           = 0;     /* The number of flexible constraints        */
 
     std::array<PaddedHostVector<RVec>, 2> x; /* Coordinate buffers for iterative minimization */
     std::array<PaddedHostVector<RVec>, 2> f; /* Force buffers for iterative minimization */
@@ -118,8 +123,8 @@ struct gmx_shellfc_t
     gmx::PaddedVector<RVec> x_old;                  /* Old coordinates for flexcon               */
     gmx::PaddedVector<RVec> adir_xnold;             /* Work space for init_adir                  */
     gmx::PaddedVector<RVec> adir_xnew;              /* Work space for init_adir                  */
-    std::int64_t            numForceEvaluations;    /* Total number of force evaluations         */
-    int                     numConvergedIterations; /* Total number of iterations that converged */
+    std::int64_t            numForceEvaluations    = 0; /* Total number of force evaluations    */
+    int                     numConvergedIterations = 0; /* Total number of converged iterations */
 };
 
 
@@ -145,23 +150,64 @@ static void pr_shell(FILE* fplog, ArrayRef<const t_shell> shells)
     }
 }
 
+//! Returns in \p center the mass-weighted center of the nuclei of \p shell
+static inline void nucleiCenter(const t_shell&            shell,
+                                ArrayRef<const RVec>      x,
+                                gmx::ArrayRef<const real> mass,
+                                rvec                      center)
+{
+    switch (shell.nnucl)
+    {
+        case 1: copy_rvec(x[shell.nucl1], center); break;
+        case 2:
+        {
+            const real m1 = mass[shell.nucl1];
+            const real m2 = mass[shell.nucl2];
+            const real tm = 1 / (m1 + m2);
+            for (int m = 0; m < DIM; m++)
+            {
+                center[m] = (m1 * x[shell.nucl1][m] + m2 * x[shell.nucl2][m]) * tm;
+            }
+            break;
+        }
+        case 3:
+        {
+            const real m1 = mass[shell.nucl1];
+            const real m2 = mass[shell.nucl2];
+            const real m3 = mass[shell.nucl3];
+            const real tm = 1 / (m1 + m2 + m3);
+            for (int m = 0; m < DIM; m++)
+            {
+                center[m] = (m1 * x[shell.nucl1][m] + m2 * x[shell.nucl2][m] + m3 * x[shell.nucl3][m])
+                            * tm;
+            }
+            break;
+        }
+        default: gmx_fatal(FARGS, "Shell %d has %d nuclei!", shell.shellIndex, shell.nnucl);
+    }
+}
+
 /* TODO The remain call of this function passes non-NULL mass and NULL
  * mtop, so this routine can be simplified.
  *
  * The other code path supported doing prediction before the MD loop
  * started, but even when called, the prediction was always
  * over-written by a subsequent call in the MD loop, so has been
- * removed. */
+ * removed.
+ *
+ * When \p extrapolate is set, the shells are placed at the center of their
+ * nuclei plus a linear extrapolation of the displacements at the last two steps.
+ */
 static void predict_shells(FILE*                     fplog,
                            ArrayRef<RVec>            x,
                            ArrayRef<RVec>            v,
                            real                      dt,
                            ArrayRef<const t_shell>   shells,
                            gmx::ArrayRef<const real> mass,
-                           gmx_bool                  bInit)
+                           gmx_bool                  bInit,
+                           bool                      extrapolate)
 {
-    int  m, n1, n2, n3;
-    real dt_1, fudge, tm, m1, m2, m3;
+    real dt_1, fudge;
 
     /* We introduce a fudge factor for performance reasons: with this choice
      * the initial force on the shells is about a factor of two lower than
@@ -185,48 +231,58 @@ static void predict_shells(FILE*                     fplog,
         dt_1 = fudge * dt;
     }
 
-    for (const t_shell& shell : shells)
+    /* Each shell only modifies its own position, so we can loop over shells in parallel */
+    const int gmx_unused numThreads = gmx_omp_nthreads_get(ModuleMultiThread::Default);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (gmx::index i = 0; i < shells.ssize(); i++)
     {
-        const int s1 = shell.shellIndex;
-        if (bInit)
-        {
-            clear_rvec(x[s1]);
-        }
-        switch (shell.nnucl)
+        try
         {
-            case 1:
-                n1 = shell.nucl1;
-                for (m = 0; (m < DIM); m++)
-                {
-                    x[s1][m] += xOrV[n1][m] * dt_1;
-                }
-                break;
-            case 2:
-                n1 = shell.nucl1;
-                n2 = shell.nucl2;
-                m1 = mass[n1];
-                m2 = mass[n2];
-                tm = dt_1 / (m1 + m2);
-                for (m = 0; (m < DIM); m++)
-                {
-                    x[s1][m] += (m1 * xOrV[n1][m] + m2 * xOrV[n2][m]) * tm;
-                }
-                break;
-            case 3:
-                n1 = shell.nucl1;
-                n2 = shell.nucl2;
-                n3 = shell.nucl3;
-                m1 = mass[n1];
-                m2 = mass[n2];
-                m3 = mass[n3];
-                tm = dt_1 / (m1 + m2 + m3);
-                for (m = 0; (m < DIM); m++)
+            const t_shell& shell = shells[i];
+            const int      s1    = shell.shellIndex;
+            if (extrapolate)
+            {
+                rvec center;
+                nucleiCenter(shell, x, mass, center);
+                for (int m = 0; m < DIM; m++)
                 {
-                    x[s1][m] += (m1 * xOrV[n1][m] + m2 * xOrV[n2][m] + m3 * xOrV[n3][m]) * tm;
+                    x[s1][m] = center[m] + 2 * shell.displacement[0][m] - shell.displacement[1][m];
                 }
-                break;
-            default: gmx_fatal(FARGS, "Shell %d has %d nuclei!", s1, shell.nnucl);
+                continue;
+            }
+            rvec shift;
+            nucleiCenter(shell, xOrV, mass, shift);
+            if (bInit)
+            {
+                clear_rvec(x[s1]);
+            }
+            for (int m = 0; m < DIM; m++)
+            {
+                x[s1][m] += shift[m] * dt_1;
+            }
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
+
+//! Stores the displacements of the shells from their nuclei for extrapolation
+static void storeShellDisplacements(ArrayRef<const RVec>      x,
+                                    ArrayRef<t_shell>         shells,
+                                    gmx::ArrayRef<const real> mass)
+{
+    const int gmx_unused numThreads = gmx_omp_nthreads_get(ModuleMultiThread::Default);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (gmx::index i = 0; i < shells.ssize(); i++)
+    {
+        try
+        {
+            t_shell& shell = shells[i];
+            rvec     center;
+            nucleiCenter(shell, x, mass, center);
+            copy_rvec(shell.displacement[0], shell.displacement[1]);
+            rvec_sub(x[shell.shellIndex], center, shell.displacement[0]);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 }
 
@@ -234,6 +290,7 @@ gmx_shellfc_t* init_shell_flexcon(FILE*             fplog,
                                   const gmx_mtop_t& mtop,
                                   int               nflexcon,
                                   int               nstcalcenergy,
+                                  ShellPropagation  shellPropagation,
                                   bool              usingDomainDecomposition,
                                   bool              usingPmeOnGpu)
 {
@@ -484,6 +541,34 @@ gmx_shellfc_t* init_shell_flexcon(FILE*             fplog,
     shfc->shell_gl       = shell;
     shfc->shell_index_gl = shell_index;
 
+    if (shellPropagation == ShellPropagation::ExtendedLagrangian)
+    {
+        if (nflexcon > 0)
+        {
+            gmx_fatal(FARGS,
+                      "Shell propagation with an extended Lagrangian is not supported with "
+                      "flexible constraints");
+        }
+        for (const t_shell& s : shell)
+        {
+            int molb = 0;
+            if (s.nnucl != 1 || mtopGetAtomMass(mtop, s.nucl1, &molb) <= 0)
+            {
+                gmx_fatal(FARGS,
+                          "With shell propagation with an extended Lagrangian each shell should "
+                          "be bonded to a single nucleus with mass, but shell %d is not",
+                          s.shellIndex + 1);
+            }
+        }
+        shfc->extendedLagrangian = true;
+        if (fplog)
+        {
+            fprintf(fplog, "\nWill propagate the shells with an extended Lagrangian\n");
+        }
+
+        return shfc;
+    }
+
     shfc->predictShells = (getenv("GMX_NOPREDICT") == nullptr);
     shfc->requireInit   = false;
     if (!shfc->predictShells)
@@ -504,7 +589,16 @@ gmx_shellfc_t* init_shell_flexcon(FILE*             fplog,
 
     if (shfc->predictShells)
     {
-        if (shfc->bInterCG)
+        shfc->extrapolateShells = (getenv("GMX_SHELL_EXTRAPOLATE") != nullptr);
+        if (shfc->extrapolateShells && fplog)
+        {
+            fprintf(fplog,
+                    "\nWill predict shell positions by extrapolating the shell displacements\n");
+        }
+        /* Without domain decomposition the nuclei of all shells are home atoms,
+         * so we only need to disable prediction with domain decomposition.
+         */
+        if (shfc->bInterCG && usingDomainDecomposition)
         {
             if (fplog)
             {
@@ -518,7 +612,8 @@ gmx_shellfc_t* init_shell_flexcon(FILE*             fplog,
              *    shell velocities are zeroed, it's a bit tricky to keep
              *    track of the shell displacements and thus the velocity.
              */
-            shfc->predictShells = false;
+            shfc->predictShells     = false;
+            shfc->extrapolateShells = false;
         }
     }
 
@@ -660,10 +755,19 @@ static void shell_pos_sd(ArrayRef<const RVec> xcur,
 
     step_min = 1e30;
     step_max = 0;
+
+    const int numThreads = 1;
+#else
+    /* The shells are independent, but debug output should not be interleaved */
+    const int gmx_unused numThreads =
+            gmx_debug_at ? 1 : gmx_omp_nthreads_get(ModuleMultiThread::Default);
 #endif
-    for (t_shell& shell : shells)
+#pragma omp parallel for num_threads(numThreads) schedule(static) private(d, dx, df, k_est)
+    for (gmx::index i = 0; i < shells.ssize(); i++)
     {
-        const int ind = shell.shellIndex;
+        // Trivial OpenMP region that does not throw
+        t_shell&  shell = shells[i];
+        const int ind   = shell.shellIndex;
         if (count == 1)
         {
             for (d = 0; d < DIM; d++)
@@ -768,11 +872,15 @@ static real rms_force(const t_commrec*        cr,
     double      buf[4];
     const rvec* f = as_rvec_array(force.data());
 
-    buf[0] = *sf_dir;
-    for (const t_shell& shell : shells)
+    double sumForceSquared = *sf_dir;
+    const int gmx_unused numThreads = gmx_omp_nthreads_get(ModuleMultiThread::Default);
+#pragma omp parallel for num_threads(numThreads) schedule(static) reduction(+ : sumForceSquared)
+    for (gmx::index i = 0; i < shells.ssize(); i++)
     {
-        buf[0] += norm2(f[shell.shellIndex]);
+        // Trivial OpenMP region that does not throw
+        sumForceSquared += norm2(f[shells[i].shellIndex]);
     }
+    buf[0]   = sumForceSquared;
     int ntot = shells.ssize();
 
     if (PAR(cr))
@@ -982,6 +1090,44 @@ void relax_shell_flexcon(FILE*                         fplog,
     ArrayRef<t_shell> shells       = shfc->shells;
     const int         nflexcon     = shfc->nflexcon;
 
+    if (shfc->extendedLagrangian)
+    {
+        /* The shells are propagated by the integrator, we only need the forces */
+        do_force(fplog,
+                 cr,
+                 ms,
+                 *inputrec,
+                 nullptr,
+                 enforcedRotation,
+                 imdSession,
+                 pull_work,
+                 mdstep,
+                 nrnb,
+                 wcycle,
+                 top,
+                 box,
+                 xPadded,
+                 hist,
+                 f,
+                 force_vir,
+                 &md,
+                 enerd,
+                 lambda,
+                 fr,
+                 runScheduleWork,
+                 vsite,
+                 mu_tot,
+                 t,
+                 nullptr,
+                 (bDoNS ? GMX_FORCE_NS : 0) | force_flags,
+                 ddBalanceRegionHandler);
+        accumulatePotentialEnergies(enerd, lambda, inputrec->fepvals.get());
+        shfc->numForceEvaluations++;
+        shfc->numConvergedIterations++;
+
+        return;
+    }
+
     if (DOMAINDECOMP(cr))
     {
         nat = dd_natoms_vsite(*cr->dd);
@@ -1046,9 +1192,17 @@ void relax_shell_flexcon(FILE*                         fplog,
     /* Do a prediction of the shell positions, when appropriate.
      * Without velocities (EM, NM, BD) we only do initial prediction.
      */
+    /* Atoms can be put in the box or redistributed at search steps,
+     * so we can only extrapolate shell displacements stored after the last search.
+     */
+    if (bDoNS || bInit)
+    {
+        shfc->numDisplacements = 0;
+    }
     if (shfc->predictShells && !bCont && (EI_STATE_VELOCITY(inputrec->eI) || bInit))
     {
-        predict_shells(fplog, x, v, inputrec->delta_t, shells, massT, bInit);
+        const bool extrapolate = (shfc->extrapolateShells && shfc->numDisplacements == 2);
+        predict_shells(fplog, x, v, inputrec->delta_t, shells, massT, bInit, extrapolate);
     }
 
     /* Calculate the forces first time around */
@@ -1339,6 +1493,63 @@ void relax_shell_flexcon(FILE*                         fplog,
     /* Copy back the coordinates and the forces */
     std::copy(pos[Min].begin(), pos[Min].end(), x.data());
     std::copy(force[Min].begin(), force[Min].end(), f->force().begin());
+
+    if (shfc->extrapolateShells)
+    {
+        storeShellDisplacements(x, shells, massT);
+        shfc->numDisplacements = std::min(shfc->numDisplacements + 1, 2);
+    }
+}
+
+void coupleShellRelativeMotion(const gmx_shellfc_t* shfc,
+                               const t_inputrec&    inputrec,
+                               const t_mdatoms&     md,
+                               ArrayRef<RVec>       v)
+{
+    if (shfc == nullptr || !shfc->extendedLagrangian || shfc->shells.empty())
+    {
+        return;
+    }
+
+    ArrayRef<const t_shell> shells = shfc->shells;
+    const real*             mass   = md.massT;
+
+    const int gmx_unused numThreads = gmx_omp_nthreads_get(ModuleMultiThread::Default);
+
+    double sumEkinRelative = 0;
+#pragma omp parallel for num_threads(numThreads) schedule(static) reduction(+ : sumEkinRelative)
+    for (gmx::index i = 0; i < shells.ssize(); i++)
+    {
+        // Trivial OpenMP region that does not throw
+        const int  s       = shells[i].shellIndex;
+        const int  n       = shells[i].nucl1;
+        const real reduced = mass[s] * mass[n] / (mass[s] + mass[n]);
+        sumEkinRelative += 0.5 * reduced * norm2(v[s] - v[n]);
+    }
+    const real temperature = 2 * sumEkinRelative / (DIM * shells.ssize() * gmx::c_boltz);
+
+    /* Scale the relative velocities as with the Berendsen thermostat */
+    real lambda = 1;
+    if (temperature > 0)
+    {
+        const real couplingFactor = inputrec.delta_t / inputrec.shellTauT;
+        lambda = std::sqrt(1 + couplingFactor * (inputrec.shellRefT / temperature - 1));
+        lambda = std::max<real>(std::min<real>(lambda, 1.25), 0.8);
+    }
+
+    /* Scaling the relative velocity of each shell-nucleus pair conserves its momentum */
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (gmx::index i = 0; i < shells.ssize(); i++)
+    {
+        // Trivial OpenMP region that does not throw
+        const int  s           = shells[i].shellIndex;
+        const int  n           = shells[i].nucl1;
+        const real invMassPair = 1 / (mass[s] + mass[n]);
+        const RVec vCom        = (mass[s] * v[s] + mass[n] * v[n]) * invMassPair;
+        const RVec vRelative   = lambda * (v[s] - v[n]);
+        v[s]                   = vCom + (mass[n] * invMassPair) * vRelative;
+        v[n]                   = vCom - (mass[s] * invMassPair) * vRelative;
+    }
 }
 
 void done_shellfc(FILE* fplog, gmx_shellfc_t* shfc, int64_t numSteps)
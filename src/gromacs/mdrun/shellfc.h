@@ -46,6 +46,7 @@
 #include "gromacs/utility/enumerationhelpers.h"
 
 class DDBalanceRegionHandler;
+enum class ShellPropagation : int;
 struct gmx_enerdata_t;
 struct gmx_enfrot;
 struct gmx_localtop_t;
@@ -79,6 +80,7 @@ class VirtualSitesHandler;
  * \param mtop Pointer to a global system topology object.
  * \param nflexcon Number of flexible constraints.
  * \param nstcalcenergy How often are energies calculated. Must be provided for sanity check.
+ * \param shellPropagation How the shell positions are propagated.
  * \param usingDomainDecomposition Whether domain decomposition is used. Must be provided for sanity check.
  * \param usingPmeOnGpu Set to true if GPU will be used for PME calculations. Necessary for proper buffer initialization.
  *
@@ -88,6 +90,7 @@ gmx_shellfc_t* init_shell_flexcon(FILE*             fplog,
                                   const gmx_mtop_t& mtop,
                                   int               nflexcon,
                                   int               nstcalcenergy,
+                                  ShellPropagation  shellPropagation,
                                   bool              usingDomainDecomposition,
                                   bool              usingPmeOnGpu);
 
@@ -125,6 +128,23 @@ void relax_shell_flexcon(FILE*                               log,
                          gmx::VirtualSitesHandler*           vsite,
                          const DDBalanceRegionHandler&       ddBalanceRegionHandler);
 
+/*! \brief Couples the motion of the shells relative to their nuclei to a heat bath
+ *
+ * Only has an effect with shells propagated with an extended Lagrangian.
+ * The relative velocities of all shell-nucleus pairs are scaled together
+ * towards the shell reference temperature, as with the Berendsen thermostat.
+ * This does not change the momentum of the pairs.
+ *
+ * \param[in]     shfc      The shell data, can be nullptr
+ * \param[in]     inputrec  The input record
+ * \param[in]     md        The atom data
+ * \param[in,out] v         The velocities
+ */
+void coupleShellRelativeMotion(const gmx_shellfc_t*     shfc,
+                               const t_inputrec&        inputrec,
+                               const t_mdatoms&         md,
+                               gmx::ArrayRef<gmx::RVec> v);
+
 /* Print some final output and delete shellfc */
 void done_shellfc(FILE* fplog, gmx_shellfc_t* shellfc, int64_t numSteps);
 
@@ -216,6 +216,27 @@ void gmx_sumli_sim(int gmx_unused nr, int64_t gmx_unused r[], const gmx_multisim
 #endif
 }
 
+void gmx_sumd_sim_start(int gmx_unused nr,
+                        double gmx_unused r[],
+                        const gmx_multisim_t gmx_unused* ms,
+                        MPI_Request gmx_unused* request)
+{
+#if !GMX_MPI
+    GMX_RELEASE_ASSERT(false, "Invalid call to gmx_sumd_sim_start");
+#elif GMX_LIB_MPI && MPI_VERSION >= 3
+    MPI_Iallreduce(MPI_IN_PLACE, r, nr, MPI_DOUBLE, MPI_SUM, ms->mastersComm_, request);
+#else
+    gmx_sumd_comm(nr, r, ms->mastersComm_);
+#endif
+}
+
+void gmx_sumd_sim_finish(MPI_Request gmx_unused* request)
+{
+#if GMX_LIB_MPI && MPI_VERSION >= 3
+    MPI_Wait(request, MPI_STATUS_IGNORE);
+#endif
+}
+
 std::vector<int> gatherIntFromMultiSimulation(const gmx_multisim_t* ms, const int localValue)
 {
     std::vector<int> valuesFromAllRanks;
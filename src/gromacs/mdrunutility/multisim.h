@@ -127,6 +127,17 @@ void gmx_sumf_sim(int nr, float r[], const gmx_multisim_t* ms);
 //! Calculate the sum over the simulations of an array of doubles
 void gmx_sumd_sim(int nr, double r[], const gmx_multisim_t* ms);
 
+/*! \brief Start the sum over the simulations of an array of doubles
+ *
+ * The sum is completed by gmx_sumd_sim_finish(). \p r should not be
+ * accessed in between. When non-blocking collectives are not supported
+ * by the MPI library, the sum is done here.
+ */
+void gmx_sumd_sim_start(int nr, double r[], const gmx_multisim_t* ms, MPI_Request* request);
+
+//! Complete the sum over the simulations started by gmx_sumd_sim_start()
+void gmx_sumd_sim_finish(MPI_Request* request);
+
 /*! \brief Return a vector containing the gathered values of \c
  * localValue found on the master rank of each simulation. */
 std::vector<int> gatherIntFromMultiSimulation(const gmx_multisim_t* ms, int localValue);
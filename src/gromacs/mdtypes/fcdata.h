@@ -54,34 +54,46 @@ struct t_commrec;
 struct t_inputrec;
 class t_state;
 
+namespace gmx
+{
+class EnsembleSum;
+} // namespace gmx
+
 typedef real rvec5[5];
 
 /* Distance restraining stuff */
 typedef struct t_disresdata
 {
-    DistanceRestraintWeighting dr_weighting; /* Weighting of pairs in one restraint              */
-    bool                       dr_bMixed;    /* Use sqrt of the instantaneous times              *
-                                              * the time averaged violation                      */
-    real dr_fc;                              /* Force constant for disres,                       *
-                                              * which is multiplied by a (possibly)              *
-                                              * different factor for each restraint              */
-    real  dr_tau;                            /* Time constant for disres		          */
-    real  ETerm;                             /* multiplication factor for time averaging         */
-    real  ETerm1;                            /* 1 - ETerm1                                       */
-    real  exp_min_t_tau;                     /* Factor for slowly switching on the force         */
-    int   nres;                              /* The number of distance restraints                */
-    int   npair;                             /* The number of distance restraint pairs           */
-    int   type_min;                          /* The minimum iparam type index for restraints     */
-    real  sumviol;                           /* The sum of violations                            */
-    real* rt;                                /* The instantaneous distance (npair)               */
-    real* rm3tav;                            /* The time averaged distance (npair)               */
-    real* Rtl_6;                             /* The instantaneous r^-6 (nres)                    */
-    real* Rt_6;                              /* The instantaneous ensemble averaged r^-6 (nres)  */
-    real* Rtav_6;                            /* The time and ensemble averaged r^-6 (nres)       */
-    int   nsystems;                          /* The number of systems for ensemble averaging     */
+    /* Constructor and destructor, defined in disre.cpp where gmx::EnsembleSum is complete */
+    t_disresdata();
+    ~t_disresdata();
+
+    DistanceRestraintWeighting dr_weighting{};     /* Weighting of pairs in one restraint         */
+    bool                       dr_bMixed = false;  /* Use sqrt of the instantaneous times         *
+                                                    * the time averaged violation                 */
+    real                       dr_fc = 0;          /* Force constant for disres,                  *
+                                                    * which is multiplied by a (possibly)         *
+                                                    * different factor for each restraint         */
+    real  dr_tau        = 0;       /* Time constant for disres                        */
+    real  ETerm         = 0;       /* multiplication factor for time averaging        */
+    real  ETerm1        = 0;       /* 1 - ETerm1                                      */
+    real  exp_min_t_tau = 0;       /* Factor for slowly switching on the force        */
+    int   nres          = 0;       /* The number of distance restraints               */
+    int   npair         = 0;       /* The number of distance restraint pairs          */
+    int   type_min      = 0;       /* The minimum iparam type index for restraints    */
+    real  sumviol       = 0;       /* The sum of violations                           */
+    real* rt            = nullptr; /* The instantaneous distance (npair)              */
+    real* rm3tav        = nullptr; /* The time averaged distance (npair)              */
+    real* Rtl_6         = nullptr; /* The instantaneous r^-6 (nres)                   */
+    real* Rt_6          = nullptr; /* The instantaneous ensemble averaged r^-6 (nres) */
+    real* Rtav_6        = nullptr; /* The time and ensemble averaged r^-6 (nres)      */
+    int   nsystems      = 0;       /* The number of systems for ensemble averaging    */
+
+    /* Sums Rt_6 and Rtav_6 over the systems, only used with nsystems > 1 */
+    std::unique_ptr<gmx::EnsembleSum> ensembleSum;
 
     /* TODO: Implement a proper solution for parallel disre indexing */
-    const t_iatom* forceatomsStart; /* Pointer to the start of the disre forceatoms */
+    const t_iatom* forceatomsStart = nullptr; /* Pointer to the start of the disre forceatoms */
 } t_disresdata;
 
 /* All coefficients for the matrix equation for the orientation tensor */
@@ -148,6 +160,8 @@ struct t_oriresdata
     rvec5* DTensorsEnsembleAv = nullptr;
     //! The time and ensemble averaged D restraints
     rvec5* DTensorsTimeAndEnsembleAv = nullptr;
+    //! Sums the D tensors over the simulations, only used with ensemble averaging
+    std::unique_ptr<gmx::EnsembleSum> ensembleSum;
     //! The calculated instantaneous orientations
     std::vector<real> orientations;
     //! The calculated emsemble averaged orientations
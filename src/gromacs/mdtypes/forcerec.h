@@ -153,6 +153,9 @@ struct t_forcerec
 
     bool use_simd_kernels = false;
 
+    //! Whether to sort the local bonded interactions on atom index for locality
+    bool sortBondedInteractionsByLocality = false;
+
     /* Interaction for calculated in kernels. In many cases this is similar to
      * the electrostatics settings in the inputrecord, but the difference is that
      * these variables always specify the actual interaction in the kernel - if
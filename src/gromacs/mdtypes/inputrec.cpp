@@ -866,6 +866,9 @@ void pr_inputrec(FILE* fp, int indent, const char* title, const t_inputrec* ir,
         PR("emstep", ir->em_stepsize);
         PI("niter", ir->niter);
         PR("fcstep", ir->fc_stepsize);
+        PS("shell-propagation", enumValueToString(ir->shellPropagation));
+        PR("shell-ref-t", ir->shellRefT);
+        PR("shell-tau-t", ir->shellTauT);
         PI("nstcgsteep", ir->nstcgsteep);
         PI("nbfgscorr", ir->nbfgscorr);
 
@@ -1513,6 +1516,9 @@ void cmp_inputrec(FILE* fp, const t_inputrec* ir1, const t_inputrec* ir2, real f
     cmp_real(fp, "inputrec->em_tol", -1, ir1->em_tol, ir2->em_tol, ftol, abstol);
     cmp_int(fp, "inputrec->niter", -1, ir1->niter, ir2->niter);
     cmp_real(fp, "inputrec->fc_stepsize", -1, ir1->fc_stepsize, ir2->fc_stepsize, ftol, abstol);
+    cmpEnum(fp, "inputrec->shellPropagation", ir1->shellPropagation, ir2->shellPropagation);
+    cmp_real(fp, "inputrec->shellRefT", -1, ir1->shellRefT, ir2->shellRefT, ftol, abstol);
+    cmp_real(fp, "inputrec->shellTauT", -1, ir1->shellTauT, ir2->shellTauT, ftol, abstol);
     cmp_int(fp, "inputrec->nstcgsteep", -1, ir1->nstcgsteep, ir2->nstcgsteep);
     cmp_int(fp, "inputrec->nbfgscorr", 0, ir1->nbfgscorr, ir2->nbfgscorr);
     cmpEnum(fp, "inputrec->eConstrAlg", ir1->eConstrAlg, ir2->eConstrAlg);
@@ -477,6 +477,12 @@ struct t_inputrec // NOLINT (clang-analyzer-optin.performance.Padding)
     int niter;
     //! Stepsize for directional minimization in relax_shells
     real fc_stepsize;
+    //! How shell positions are propagated
+    ShellPropagation shellPropagation;
+    //! Reference temperature for the shell motion relative to the nuclei, extended Lagrangian only
+    real shellRefT;
+    //! Coupling time for the shell motion relative to the nuclei, extended Lagrangian only
+    real shellTauT;
     //! Number of steps after which a steepest descents step is done while doing cg
     int nstcgsteep;
     //! Number of corrections to the Hessian to keep
@@ -379,6 +379,14 @@ const char* enumValueToString(SwapGroupSplittingType enumValue)
     return swapGroupSplittingTypeNames[enumValue];
 }
 
+const char* enumValueToString(ShellPropagation enumValue)
+{
+    static constexpr gmx::EnumerationArray<ShellPropagation, const char*> shellPropagationNames = {
+        "scf", "extended-lagrangian"
+    };
+    return shellPropagationNames[enumValue];
+}
+
 const char* enumValueToString(NbkernelElecType enumValue)
 {
     static constexpr gmx::EnumerationArray<NbkernelElecType, const char*> nbkernelElecTypeNames = {
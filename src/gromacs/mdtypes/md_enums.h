@@ -181,6 +181,7 @@ enum
     etrtVELOCITY1,
     etrtVELOCITY2,
     etrtPOSITION,
+    etrtVELOCITY2_AND_POSITION,
     etrtSKIPALL,
     etrtNR
 };
@@ -758,6 +759,22 @@ enum class SwapGroupSplittingType : int
 //! String for swap group splitting
 const char* enumValueToString(SwapGroupSplittingType enumValue);
 
+/*! \brief How the positions of shell particles are propagated
+ *
+ * With self-consistent field (SCF) propagation the shell positions
+ * are optimized at every step, with extended-Lagrangian propagation
+ * the shells have mass and are propagated by the integrator.
+ */
+enum class ShellPropagation : int
+{
+    Scf,
+    ExtendedLagrangian,
+    Count,
+    Default = Scf
+};
+//! String corresponding to shell propagation
+const char* enumValueToString(ShellPropagation enumValue);
+
 /*! \brief Types of electrostatics calculations
  *
  * Types of electrostatics calculations available inside nonbonded kernels.
@@ -170,6 +170,7 @@ void EnergyData::setup(gmx_mdoutf* outf)
                                                    false,
                                                    startingBehavior_,
                                                    simulationsShareState_,
+                                                   false,
                                                    mdModulesNotifiers_);
 
     if (!isMasterRank_)
@@ -94,6 +94,7 @@ ForceElement::ForceElement(StatePropagatorData*        statePropagatorData,
                                 globalTopology,
                                 constr ? constr->numFlexibleConstraints() : 0,
                                 inputrec->nstcalcenergy,
+                                inputrec->shellPropagation,
                                 DOMAINDECOMP(cr),
                                 runScheduleWork->simulationWork.useGpuPme)),
     doShellFC_(shellfc_ != nullptr),
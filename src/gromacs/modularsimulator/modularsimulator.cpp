@@ -413,6 +413,12 @@ bool ModularSimulator::isInputCompatible(bool                             exitOn
             && conditionalAssert(
                     gmx_mtop_ftype_count(globalTopology, F_ORIRES) == 0,
                     "Orientation restraints are not supported by the modular simulator.");
+    isInputCompatible =
+            isInputCompatible
+            && conditionalAssert(
+                    inputrec->shellPropagation != ShellPropagation::ExtendedLagrangian,
+                    "Extended-Lagrangian shell propagation is not supported by the modular "
+                    "simulator.");
     isInputCompatible =
             isInputCompatible
             && conditionalAssert(ms == nullptr,
@@ -79,6 +79,7 @@ TrajectoryElement::TrajectoryElement(std::vector<ITrajectoryWriterClient*> write
                       wcycle,
                       startingBehavior,
                       simulationsShareState,
+                      false,
                       nullptr)),
     writerClients_(std::move(writerClients))
 {
@@ -543,10 +543,7 @@ void nonbonded_verlet_t::dispatchFreeEnergyKernel(gmx::InteractionLocality
         donb_flags |= GMX_NONBONDED_DO_POTENTIAL;
     }
 
-    gmx::EnumerationArray<FreeEnergyPerturbationCouplingType, real> dvdl_nb      = { 0 };
-    int                                                             kernelFlags  = donb_flags;
-    gmx::ArrayRef<const real>                                       kernelLambda = lambda;
-    gmx::ArrayRef<real>                                             kernelDvdl   = dvdl_nb;
+    gmx::EnumerationArray<FreeEnergyPerturbationCouplingType, real> dvdl_nb = { 0 };
 
     gmx::ArrayRef<real> energygrp_elec = enerd->grpp.energyGroupPairTerms[NonBondedEnergyTerms::CoulombSR];
     gmx::ArrayRef<real> energygrp_vdw = enerd->grpp.energyGroupPairTerms[NonBondedEnergyTerms::LJSR];
@@ -574,9 +571,9 @@ void nonbonded_verlet_t::dispatchFreeEnergyKernel(gmx::InteractionLocality
                                       chargeB,
                                       typeA,
                                       typeB,
-                                      kernelFlags,
-                                      kernelLambda,
-                                      kernelDvdl,
+                                      donb_flags,
+                                      lambda,
+                                      dvdl_nb,
                                       energygrp_elec,
                                       energygrp_vdw,
                                       nrnb);
@@ -604,59 +601,71 @@ void nonbonded_verlet_t::dispatchFreeEnergyKernel(gmx::InteractionLocality
      */
     if (fepvals->n_lambda > 0 && stepWork.computeDhdl && fepvals->sc_alpha != 0)
     {
-        gmx::EnumerationArray<FreeEnergyPerturbationCouplingType, real> lam_i;
-        kernelFlags = (donb_flags & ~(GMX_NONBONDED_DO_FORCE | GMX_NONBONDED_DO_SHIFTFORCE))
-                      | GMX_NONBONDED_DO_FOREIGNLAMBDA;
-        kernelLambda = lam_i;
-        kernelDvdl   = dvdl_nb;
-        gmx::ArrayRef<real> energygrp_elec =
-                foreignEnergyGroups_->energyGroupPairTerms[NonBondedEnergyTerms::CoulombSR];
-        gmx::ArrayRef<real> energygrp_vdw =
-                foreignEnergyGroups_->energyGroupPairTerms[NonBondedEnergyTerms::LJSR];
-
-        for (gmx::index i = 0; i < 1 + enerd->foreignLambdaTerms.numLambdas(); i++)
+        /* All lambda points are computed in a single pass over the pair lists */
+        const int numLambdaPoints = 1 + enerd->foreignLambdaTerms.numLambdas();
+        if (gmx::ssize(foreignEnergyGroups_) < numLambdaPoints)
+        {
+            foreignEnergyGroups_.resize(numLambdaPoints, gmx_grppairener_t(nbat->params().nenergrp));
+        }
+        std::vector<gmx::EnumerationArray<FreeEnergyPerturbationCouplingType, real>> lam_i(
+                numLambdaPoints);
+        std::vector<gmx::EnumerationArray<FreeEnergyPerturbationCouplingType, real>> dvdl_i(
+                numLambdaPoints, { 0 });
+        std::vector<gmx::ArrayRef<const real>> kernelLambdas;
+        std::vector<gmx::ArrayRef<real>>       kernelDvdl;
+        std::vector<gmx::ArrayRef<real>>       energygrp_elec;
+        std::vector<gmx::ArrayRef<real>>       energygrp_vdw;
+        for (int i = 0; i < numLambdaPoints; i++)
         {
-            std::fill(std::begin(dvdl_nb), std::end(dvdl_nb), 0);
             for (int j = 0; j < static_cast<int>(FreeEnergyPerturbationCouplingType::Count); j++)
             {
-                lam_i[j] = (i == 0 ? lambda[j] : fepvals->all_lambda[j][i - 1]);
+                lam_i[i][j] = (i == 0 ? lambda[j] : fepvals->all_lambda[j][i - 1]);
             }
-            foreignEnergyGroups_->clear();
+            foreignEnergyGroups_[i].clear();
+            kernelLambdas.emplace_back(lam_i[i]);
+            kernelDvdl.emplace_back(dvdl_i[i]);
+            energygrp_elec.emplace_back(
+                    foreignEnergyGroups_[i].energyGroupPairTerms[NonBondedEnergyTerms::CoulombSR]);
+            energygrp_vdw.emplace_back(
+                    foreignEnergyGroups_[i].energyGroupPairTerms[NonBondedEnergyTerms::LJSR]);
+        }
+
 #pragma omp parallel for schedule(static) num_threads(nbl_fep.ssize())
-            for (gmx::index th = 0; th < nbl_fep.ssize(); th++)
+        for (gmx::index th = 0; th < nbl_fep.ssize(); th++)
+        {
+            try
             {
-                try
-                {
-                    gmx_nb_free_energy_kernel(*nbl_fep[th],
-                                              coords,
-                                              forceWithShiftForces,
-                                              useSimd,
-                                              ntype,
-                                              rlist,
-                                              ic,
-                                              shiftvec,
-                                              nbfp,
-                                              nbfp_grid,
-                                              chargeA,
-                                              chargeB,
-                                              typeA,
-                                              typeB,
-                                              kernelFlags,
-                                              kernelLambda,
-                                              kernelDvdl,
-                                              energygrp_elec,
-                                              energygrp_vdw,
-                                              nrnb);
-                }
-                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+                gmx_nb_free_energy_kernel_foreign_lambdas(*nbl_fep[th],
+                                                          coords,
+                                                          useSimd,
+                                                          ntype,
+                                                          rlist,
+                                                          ic,
+                                                          shiftvec,
+                                                          nbfp,
+                                                          nbfp_grid,
+                                                          chargeA,
+                                                          chargeB,
+                                                          typeA,
+                                                          typeB,
+                                                          kernelLambdas,
+                                                          kernelDvdl,
+                                                          energygrp_elec,
+                                                          energygrp_vdw,
+                                                          nrnb);
             }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+
+        for (int i = 0; i < numLambdaPoints; i++)
+        {
             std::array<real, F_NRE> foreign_term = { 0 };
-            sum_epot(*foreignEnergyGroups_, foreign_term.data());
+            sum_epot(foreignEnergyGroups_[i], foreign_term.data());
             enerd->foreignLambdaTerms.accumulate(
                     i,
                     foreign_term[F_EPOT],
-                    dvdl_nb[FreeEnergyPerturbationCouplingType::Vdw]
-                            + dvdl_nb[FreeEnergyPerturbationCouplingType::Coul]);
+                    dvdl_i[i][FreeEnergyPerturbationCouplingType::Vdw]
+                            + dvdl_i[i][FreeEnergyPerturbationCouplingType::Coul]);
         }
     }
     wallcycle_sub_stop(wcycle_, WallCycleSubCounter::NonbondedFep);
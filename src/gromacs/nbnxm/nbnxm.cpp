@@ -138,6 +138,17 @@ void nonbonded_verlet_t::setLocalAtomOrder() const
     pairSearch_->setLocalAtomOrder();
 }
 
+void nonbonded_verlet_t::getLocalAtomOrderColumnStarts(std::vector<int>* columnStarts) const
+{
+    const Nbnxm::Grid& grid = pairSearch_->gridSet().grids()[0];
+
+    columnStarts->resize(grid.numColumns() + 1);
+    for (int c = 0; c <= grid.numColumns(); c++)
+    {
+        (*columnStarts)[c] = grid.cxy_ind()[c] * grid.numAtomsPerCell();
+    }
+}
+
 void nonbonded_verlet_t::setAtomProperties(gmx::ArrayRef<const int>     atomTypes,
                                            gmx::ArrayRef<const real>    atomCharges,
                                            gmx::ArrayRef<const int64_t> atomInfo) const
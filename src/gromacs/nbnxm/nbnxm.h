@@ -112,6 +112,7 @@
 #define GMX_NBNXM_NBNXM_H
 
 #include <memory>
+#include <vector>
 
 #include "gromacs/gpu_utils/devicebuffer_datatype.h"
 #include "gromacs/math/vectypes.h"
@@ -293,6 +294,12 @@ public:
     //! Sets the order of the local atoms to the order grid atom ordering
     void setLocalAtomOrder() const;
 
+    /*! \brief Sets \p columnStarts to the start of each local grid column in getLocalAtomOrder()
+     *
+     * Column c covers the range [columnStarts[c], columnStarts[c+1]), which includes fillers.
+     */
+    void getLocalAtomOrderColumnStarts(std::vector<int>* columnStarts) const;
+
     //! Returns the index position of the atoms on the search grid
     gmx::ArrayRef<const int> getGridIndices() const;
 
@@ -431,8 +438,8 @@ private:
     Nbnxm::KernelSetup kernelSetup_;
     //! \brief Pointer to wallcycle structure.
     gmx_wallcycle* wcycle_;
-    //! Temporary array for storing foreign lambda group pair energies
-    std::unique_ptr<gmx_grppairener_t> foreignEnergyGroups_;
+    //! Temporary arrays for storing group pair energies, one for each foreign lambda point
+    std::vector<gmx_grppairener_t> foreignEnergyGroups_;
 
 public:
     //! GPU Nbnxm data, only used with a physical GPU (TODO: use unique_ptr)
@@ -0,0 +1,119 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the timeline tracer
+ *
+ * \ingroup module_timing
+ */
+
+#include "gmxpre.h"
+
+#include "gromacs/timing/timelinetracer.h"
+
+#include <gtest/gtest.h>
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+TEST(TimelineTracerTest, NoEventsGivesEmptyOutput)
+{
+    TimelineTracer tracer(10);
+
+    EXPECT_EQ(tracer.numEvents(), 0);
+    EXPECT_EQ(tracer.chromeTraceEvents(0), "");
+}
+
+TEST(TimelineTracerTest, ScopeRecordsCompleteEvents)
+{
+    TimelineTracer tracer(10);
+    tracer.setOrigin();
+
+    {
+        TimelineEventScope scope(&tracer, TimelineEventType::GlobalReduction);
+    }
+    {
+        TimelineEventScope scope(&tracer, TimelineEventType::HaloCoordinatesComm, 1, 2);
+    }
+
+    EXPECT_EQ(tracer.numEvents(), 2);
+
+    const std::string output = tracer.chromeTraceEvents(3);
+    EXPECT_NE(output.find("\"name\":\"Global reduction\""), std::string::npos);
+    EXPECT_NE(output.find("\"name\":\"Halo X comm.\""), std::string::npos);
+    EXPECT_NE(output.find("\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(output.find("\"pid\":3"), std::string::npos);
+    EXPECT_NE(output.find("\"args\":{\"dim\":1,\"pulse\":2}"), std::string::npos);
+    // The events should be separated by a comma
+    EXPECT_NE(output.find("},\n{"), std::string::npos);
+}
+
+TEST(TimelineTracerTest, ScopeWithoutTracerDoesNothing)
+{
+    TimelineEventScope scope(nullptr, TimelineEventType::Partition);
+}
+
+TEST(TimelineTracerTest, EventsBeyondMaximumAreDropped)
+{
+    TimelineTracer tracer(3);
+
+    for (int i = 0; i < 5; i++)
+    {
+        TimelineEventScope scope(&tracer, TimelineEventType::PmeSendCoordinates);
+    }
+
+    EXPECT_EQ(tracer.numEvents(), 3);
+    EXPECT_EQ(tracer.numDroppedEvents(), 2);
+}
+
+TEST(TimelineTracerTest, ZeroMaximumDropsAllEvents)
+{
+    TimelineTracer tracer(0);
+
+    {
+        TimelineEventScope scope(&tracer, TimelineEventType::Partition);
+    }
+
+    EXPECT_EQ(tracer.numEvents(), 0);
+    EXPECT_EQ(tracer.numDroppedEvents(), 1);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
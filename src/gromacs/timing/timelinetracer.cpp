@@ -0,0 +1,103 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Implements the timeline tracer.
+ *
+ * \ingroup module_timing
+ */
+
+#include "gmxpre.h"
+
+#include "timelinetracer.h"
+
+#include "gromacs/utility/enumerationhelpers.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+const char* enumValueToString(TimelineEventType enumValue)
+{
+    constexpr EnumerationArray<TimelineEventType, const char*> eventTypeNames = {
+        "DD partition", "Halo X comm.", "Halo F comm.",    "Halo F reduction",
+        "PME send X",   "PME recv. F",  "Global reduction"
+    };
+    return eventTypeNames[enumValue];
+}
+
+TimelineTracer::TimelineTracer(const int maxNumEvents) :
+    origin_(Clock::now()), maxNumEvents_(maxNumEvents)
+{
+    GMX_RELEASE_ASSERT(maxNumEvents >= 0, "The maximum number of events should not be negative");
+
+    events_.reserve(maxNumEvents);
+}
+
+std::string TimelineTracer::chromeTraceEvents(const int processId) const
+{
+    std::string output;
+
+    for (const Event& event : events_)
+    {
+        /* The trace event format uses microseconds */
+        using Microseconds    = std::chrono::duration<double, std::micro>;
+        const double begin    = Microseconds(event.begin - origin_).count();
+        const double duration = Microseconds(event.end - event.begin).count();
+
+        if (!output.empty())
+        {
+            output += ",\n";
+        }
+        output += formatString(
+                "{\"name\":\"%s\",\"cat\":\"mdrun\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":%d,\"tid\":0",
+                enumValueToString(event.type),
+                begin,
+                duration,
+                processId);
+        if (event.dimension >= 0)
+        {
+            output += formatString(
+                    ",\"args\":{\"dim\":%d,\"pulse\":%d}", event.dimension, event.pulse);
+        }
+        output += "}";
+    }
+
+    return output;
+}
+
+} // namespace gmx
@@ -0,0 +1,208 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief Declares a low-overhead tracer for recording timelines of
+ * communication and compute phases in the Chrome trace event format.
+ *
+ * \inlibraryapi
+ * \ingroup module_timing
+ */
+
+#ifndef GMX_TIMING_TIMELINETRACER_H
+#define GMX_TIMING_TIMELINETRACER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gromacs/utility/classhelpers.h"
+
+namespace gmx
+{
+
+//! The kinds of events that can be recorded in a timeline
+enum class TimelineEventType : int
+{
+    Partition,           //!< Domain decomposition repartitioning
+    HaloCoordinatesComm, //!< Communication of one coordinate halo pulse
+    HaloForcesComm,      //!< Communication of one force halo pulse
+    HaloForcesReduction, //!< Reduction of the received forces of one halo pulse
+    PmeSendCoordinates,  //!< Sending coordinates to a PME rank
+    PmeReceiveForces,    //!< Waiting for and receiving the forces from a PME rank
+    GlobalReduction,     //!< Global reduction of energies, virial and signals
+    Count                //!< The number of event types
+};
+
+//! Returns the name of a timeline event type, as shown in the trace viewer
+const char* enumValueToString(TimelineEventType enumValue);
+
+/*! \libinternal \brief Records timestamped events on one rank
+ *
+ * Events are stored in a buffer of fixed capacity which is allocated
+ * at construction. Events that do not fit are counted, but not stored,
+ * so recording never allocates. Timestamps are relative to an origin
+ * which should be set simultaneously on all ranks, e.g. after a barrier,
+ * so the timelines of different ranks can be aligned.
+ *
+ * The events are output as a list of "complete" events in the Chrome
+ * trace event format, which can be viewed with chrome://tracing or Perfetto.
+ */
+class TimelineTracer
+{
+public:
+    //! Clock used for the timestamps
+    using Clock = std::chrono::steady_clock;
+
+    /*! \brief Constructor
+     *
+     * \param[in] maxNumEvents  The maximum number of events that will be stored
+     */
+    explicit TimelineTracer(int maxNumEvents);
+
+    //! Sets the origin of the timestamps to the current time
+    void setOrigin() { origin_ = Clock::now(); }
+
+    //! Returns the current time
+    static Clock::time_point now() { return Clock::now(); }
+
+    //! Records an event of \p type from \p begin to \p end with dimension and pulse indices
+    void recordEvent(TimelineEventType type,
+                     Clock::time_point begin,
+                     Clock::time_point end,
+                     int               dimension = -1,
+                     int               pulse     = -1)
+    {
+        if (events_.size() < maxNumEvents_)
+        {
+            events_.push_back({ type, begin, end, dimension, pulse });
+        }
+        else
+        {
+            numDroppedEvents_++;
+        }
+    }
+
+    //! Returns the number of stored events
+    int numEvents() const { return events_.size(); }
+
+    //! Returns the number of events that did not fit in the buffer
+    int64_t numDroppedEvents() const { return numDroppedEvents_; }
+
+    /*! \brief Returns the stored events in Chrome trace event JSON format
+     *
+     * The events are returned as a comma-separated list of JSON objects,
+     * without enclosing brackets, so the output of multiple ranks can
+     * be concatenated into a single trace.
+     *
+     * \param[in] processId  The process id for the events, usually the rank
+     */
+    std::string chromeTraceEvents(int processId) const;
+
+private:
+    //! A recorded event
+    struct Event
+    {
+        //! The type of event
+        TimelineEventType type;
+        //! Start time
+        Clock::time_point begin;
+        //! End time
+        Clock::time_point end;
+        //! The dimension index or -1 when not relevant
+        int dimension;
+        //! The pulse index or -1 when not relevant
+        int pulse;
+    };
+
+    //! The origin for the timestamps
+    Clock::time_point origin_;
+    //! The maximum number of events that are stored
+    size_t maxNumEvents_;
+    //! The stored events, memory for \p maxNumEvents_ events is reserved at construction
+    std::vector<Event> events_;
+    //! The number of events that did not fit in \p events_
+    int64_t numDroppedEvents_ = 0;
+};
+
+/*! \libinternal \brief Records an event spanning the lifetime of this object
+ *
+ * Does nothing when the tracer passed is nullptr, so the cost of tracing
+ * when not active is a single pointer check.
+ */
+class TimelineEventScope
+{
+public:
+    //! Starts an event of \p type, the optional arguments are the dimension and pulse indices
+    TimelineEventScope(TimelineTracer*   tracer,
+                       TimelineEventType type,
+                       int               dimension = -1,
+                       int               pulse     = -1) :
+        tracer_(tracer), type_(type), dimension_(dimension), pulse_(pulse)
+    {
+        if (tracer_)
+        {
+            begin_ = TimelineTracer::now();
+        }
+    }
+
+    //! Ends the event
+    ~TimelineEventScope()
+    {
+        if (tracer_)
+        {
+            tracer_->recordEvent(type_, begin_, TimelineTracer::now(), dimension_, pulse_);
+        }
+    }
+
+    GMX_DISALLOW_COPY_MOVE_AND_ASSIGN(TimelineEventScope);
+
+private:
+    //! The tracer, can be nullptr
+    TimelineTracer* tracer_;
+    //! The event type
+    TimelineEventType type_;
+    //! The dimension index
+    int dimension_;
+    //! The pulse index
+    int pulse_;
+    //! The start time
+    TimelineTracer::Clock::time_point begin_;
+};
+
+} // namespace gmx
+
+#endif
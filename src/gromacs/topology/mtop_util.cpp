@@ -861,17 +861,21 @@ static void sortFreeEnergyInteractionsAtEnd(const gmx_mtop_t& mtop, InteractionD
 {
     std::vector<int64_t> atomInfo(mtop.natoms, 0);
 
-    for (size_t mb = 0; mb < mtop.molblock.size(); mb++)
+    int indexOfFirstAtomInMolecule = 0;
+    for (const gmx_molblock_t& molb : mtop.molblock)
     {
-        const gmx_molblock_t& molb = mtop.molblock[mb];
-        const gmx_moltype_t&  molt = mtop.moltype[molb.type];
-        for (int a = 0; a < molt.atoms.nr; a++)
+        const gmx_moltype_t& molt = mtop.moltype[molb.type];
+        for (int mol = 0; mol < molb.nmol; mol++)
         {
-            if (atomHasPerturbedChargeIn14Interaction(a, molt))
+            for (int a = 0; a < molt.atoms.nr; a++)
             {
-                atomInfo[a] |= gmx::sc_atomInfo_HasPerturbedChargeIn14Interaction;
-                break;
+                if (atomHasPerturbedChargeIn14Interaction(a, molt))
+                {
+                    atomInfo[indexOfFirstAtomInMolecule + a] |=
+                            gmx::sc_atomInfo_HasPerturbedChargeIn14Interaction;
+                }
             }
+            indexOfFirstAtomInMolecule += molt.atoms.nr;
         }
     }
     gmx_sort_ilist_fe(idef, atomInfo);
@@ -46,6 +46,7 @@
 #include <gtest/gtest.h>
 
 #include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/topology.h"
 
 namespace gmx
 {
@@ -229,6 +230,51 @@ TEST(MtopTest, AtomHasPerturbedChargeIn14Interaction)
     }
 }
 
+TEST(MtopTest, LocalTopologySortsPairsWithPerturbedChargesInAllMolecules)
+{
+    gmx_mtop_t mtop;
+    mtop.ffparams.functype.push_back(F_LJ14);
+    mtop.ffparams.iparams.emplace_back();
+    mtop.ffparams.iparams[0].lj14.c6A  = 0.001;
+    mtop.ffparams.iparams[0].lj14.c12A = 1e-6;
+    mtop.ffparams.iparams[0].lj14.c6B  = 0.001;
+    mtop.ffparams.iparams[0].lj14.c12B = 1e-6;
+
+    // Only the charge of atom 2 in each molecule is perturbed
+    gmx_moltype_t& molt     = mtop.moltype.emplace_back();
+    const int      numAtoms = 4;
+    init_t_atoms(&molt.atoms, numAtoms, false);
+    for (int i = 0; i != numAtoms; ++i)
+    {
+        molt.atoms.atom[i].q  = 1.0;
+        molt.atoms.atom[i].qB = (i == 2 ? -1.0 : 1.0);
+        molt.excls.pushBack({});
+    }
+    molt.ilist[F_LJ14].push_back(0, std::array<int, 2>{ 0, 1 });
+    molt.ilist[F_LJ14].push_back(0, std::array<int, 2>{ 1, 2 });
+    molt.ilist[F_LJ14].push_back(0, std::array<int, 2>{ 0, 3 });
+
+    mtop.molblock.resize(1);
+    mtop.molblock[0].type = 0;
+    mtop.molblock[0].nmol = 3;
+    mtop.natoms           = numAtoms * mtop.molblock[0].nmol;
+    mtop.finalize();
+
+    gmx_localtop_t top(mtop.ffparams);
+    gmx_mtop_generate_local_top(mtop, &top, true);
+
+    const InteractionList& pairs = top.idef.il[F_LJ14];
+    ASSERT_EQ(pairs.size(), 3 * 3 * mtop.molblock[0].nmol);
+    EXPECT_EQ(top.idef.ilsort, ilsortFE_SORTED);
+    // Only one of the three pairs of each molecule is perturbed
+    const int numNonperturbed = top.idef.numNonperturbedInteractions[F_LJ14];
+    EXPECT_EQ(numNonperturbed, 3 * 2 * mtop.molblock[0].nmol);
+    for (int i = numNonperturbed; i < pairs.size(); i += 3)
+    {
+        EXPECT_EQ(pairs.iatoms[i + 2] % numAtoms, 2) << "only pairs with atom 2 are perturbed";
+    }
+}
+
 } // namespace
 
 } // namespace gmx
@@ -245,6 +245,46 @@ TEST(TopSortTest, SortsMoreComplexIdefWithPerturbedInteractions)
     EXPECT_THAT(idef.il[F_LJ14].iatoms, Pointwise(Eq(), { 5, 0, 1, 7, 4, 5, 4, 2, 3, 6, 6, 7 }));
 }
 
+TEST(TopSortTest, SortsOnFirstAtomForLocality)
+{
+    gmx_ffparams_t         forcefieldParams;
+    InteractionDefinitions idef(forcefieldParams);
+
+    forcefieldParams.iparams.push_back(makeUnperturbedBondParams(0.9, 1000));
+    forcefieldParams.iparams.push_back(makeUnperturbedBondParams(1.0, 2000));
+    idef.il[F_BONDS].push_back(0, std::array<int, 2>{ 6, 7 });
+    idef.il[F_BONDS].push_back(1, std::array<int, 2>{ 2, 3 });
+    idef.il[F_BONDS].push_back(0, std::array<int, 2>{ 4, 1 });
+    idef.il[F_BONDS].push_back(1, std::array<int, 2>{ 2, 0 });
+    idef.ilsort = ilsortNO_FE;
+
+    gmx_sort_ilist_locality(&idef);
+
+    EXPECT_THAT(idef.il[F_BONDS].iatoms, Pointwise(Eq(), { 1, 2, 3, 1, 2, 0, 0, 4, 1, 0, 6, 7 }))
+            << "interactions are sorted on the first atom, keeping the order of equal atoms";
+}
+
+TEST(TopSortTest, SortsPerturbedInteractionsSeparatelyForLocality)
+{
+    gmx_ffparams_t         forcefieldParams;
+    InteractionDefinitions idef(forcefieldParams);
+
+    forcefieldParams.iparams.push_back(makeUnperturbedBondParams(0.9, 1000));
+    forcefieldParams.iparams.push_back(makePerturbedBondParams(0.9, 1000, 1.1, 4000));
+    idef.il[F_BONDS].push_back(0, std::array<int, 2>{ 4, 5 });
+    idef.il[F_BONDS].push_back(1, std::array<int, 2>{ 6, 7 });
+    idef.il[F_BONDS].push_back(0, std::array<int, 2>{ 2, 3 });
+    idef.il[F_BONDS].push_back(1, std::array<int, 2>{ 0, 1 });
+    std::vector<int64_t> atomInfo(8, 0);
+
+    gmx_sort_ilist_fe(&idef, atomInfo);
+    gmx_sort_ilist_locality(&idef);
+
+    EXPECT_EQ(2, idef.numNonperturbedInteractions[F_BONDS] / (NRAL(F_BONDS) + 1));
+    EXPECT_THAT(idef.il[F_BONDS].iatoms, Pointwise(Eq(), { 0, 2, 3, 0, 4, 5, 1, 0, 1, 1, 6, 7 }))
+            << "perturbed interactions stay at the end";
+}
+
 } // namespace
 
 } // namespace gmx
@@ -41,6 +41,10 @@
 
 #include <cstdio>
 
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
 #include "gromacs/mdtypes/atominfo.h"
 #include "gromacs/topology/ifunc.h"
 #include "gromacs/topology/topology.h"
@@ -247,3 +251,51 @@ void gmx_sort_ilist_fe(InteractionDefinitions* idef, gmx::ArrayRef<const int64_t
 
     idef->ilsort = (havePerturbedInteractions ? ilsortFE_SORTED : ilsortNO_FE);
 }
+
+void gmx_sort_ilist_locality(InteractionDefinitions* idef)
+{
+    std::vector<int> order;
+    std::vector<int> sortedIatoms;
+
+    for (int ftype = 0; ftype < F_NRE; ftype++)
+    {
+        InteractionList* ilist = &idef->il[ftype];
+
+        if (!(interaction_function[ftype].flags & IF_BOND) || ftype == F_DISRES
+            || ftype == F_ORIRES || ilist->empty())
+        {
+            continue;
+        }
+
+        const int                stride = 1 + NRAL(ftype);
+        gmx::ArrayRef<const int> iatoms = ilist->iatoms;
+
+        const auto firstAtomLess = [iatoms, stride](int i, int j) {
+            return iatoms[i * stride + 1] < iatoms[j * stride + 1];
+        };
+
+        order.resize(ilist->size() / stride);
+        std::iota(order.begin(), order.end(), 0);
+
+        const int numNonperturbed = (idef->ilsort == ilsortFE_SORTED)
+                                            ? idef->numNonperturbedInteractions[ftype]
+                                            : ilist->size();
+        const auto firstPerturbed = order.begin() + numNonperturbed / stride;
+
+        if (std::is_sorted(order.begin(), firstPerturbed, firstAtomLess)
+            && std::is_sorted(firstPerturbed, order.end(), firstAtomLess))
+        {
+            continue;
+        }
+
+        std::stable_sort(order.begin(), firstPerturbed, firstAtomLess);
+        std::stable_sort(firstPerturbed, order.end(), firstAtomLess);
+
+        sortedIatoms.resize(ilist->size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            std::copy_n(iatoms.begin() + order[i] * stride, stride, sortedIatoms.begin() + i * stride);
+        }
+        ilist->iatoms.swap(sortedIatoms);
+    }
+}
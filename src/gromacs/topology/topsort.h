@@ -56,4 +56,11 @@ gmx_bool gmx_mtop_bondeds_free_energy(const struct gmx_mtop_t* mtop);
  */
 void gmx_sort_ilist_fe(InteractionDefinitions* idef, gmx::ArrayRef<const int64_t> atomInfo);
 
+/* Sort the bonded ilists in idef on the index of the first atom of each interaction,
+ * so that consecutive interactions act on nearby atoms. With perturbed interactions
+ * sorted at the end, the non-perturbed and perturbed parts are sorted separately.
+ * Distance and orientation restraints are not sorted, as their order matters.
+ */
+void gmx_sort_ilist_locality(InteractionDefinitions* idef);
+
 #endif
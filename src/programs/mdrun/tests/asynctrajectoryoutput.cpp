@@ -0,0 +1,172 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ * \brief
+ * Tests that trajectory frames written by the asynchronous output
+ * thread are identical to those written synchronously
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/setenv.h"
+#include "testutils/simulationdatabase.h"
+#include "testutils/testasserts.h"
+
+#include "moduletest.h"
+#include "simulatorcomparison.h"
+#include "trajectorycomparison.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The environment variable that enables asynchronous trajectory output
+const char* const c_asyncOutputEnvironmentVariable = "GMX_ASYNC_TRAJECTORY_OUTPUT";
+
+//! The line mdrun writes to the log file with asynchronous trajectory output
+const char* const c_asyncOutputLogLine =
+        "Trajectory frames will be written asynchronously by a separate thread";
+
+/*! \brief Test fixture comparing asynchronous with synchronous trajectory output
+ *
+ * The parameter is the name of the simulation in the database.
+ */
+class AsyncTrajectoryOutputTest :
+    public MdrunTestFixture,
+    public ::testing::WithParamInterface<std::string>
+{
+public:
+    /*! \brief Runs mdrun writing to files with \p prefix
+     *
+     * \returns the contents of the log file.
+     */
+    std::string runWithOutputPrefix(const std::string& prefix)
+    {
+        runner_.fullPrecisionTrajectoryFileName_ =
+                fileManager_.getTemporaryFilePath(prefix + ".trr");
+        runner_.reducedPrecisionTrajectoryFileName_ =
+                fileManager_.getTemporaryFilePath(prefix + ".xtc");
+        runner_.edrFileName_ = fileManager_.getTemporaryFilePath(prefix + ".edr");
+        runner_.logFileName_ = fileManager_.getTemporaryFilePath(prefix + ".log");
+        runMdrun(&runner_);
+
+        return TextReader::readFileToString(runner_.logFileName_);
+    }
+};
+
+TEST_P(AsyncTrajectoryOutputTest, WritesTheSameFramesAsSynchronousOutput)
+{
+    const std::string& simulationName = GetParam();
+
+    SCOPED_TRACE(formatString("Comparing asynchronous and synchronous trajectory output of '%s'",
+                              simulationName.c_str()));
+
+    // Write a compressed frame every step, so the writer thread has to
+    // queue frames, and full precision frames at other intervals
+    auto mdpFieldValues                  = prepareMdpFieldValues(simulationName, "md", "no", "no");
+    mdpFieldValues["nsteps"]             = "40";
+    mdpFieldValues["nstxout"]            = "2";
+    mdpFieldValues["nstvout"]            = "3";
+    mdpFieldValues["nstfout"]            = "5";
+    mdpFieldValues["nstxout-compressed"] = "1";
+
+    runner_.tprFileName_ = fileManager_.getTemporaryFilePath("sim.tpr");
+    runner_.useTopGroAndNdxFromDatabase(simulationName);
+    runner_.useStringAsMdpFile(prepareMdpFileContents(mdpFieldValues));
+    runGrompp(&runner_);
+
+    const char* environmentVariableBackup = getenv(c_asyncOutputEnvironmentVariable);
+    gmxUnsetenv(c_asyncOutputEnvironmentVariable);
+
+    const std::string syncLog = runWithOutputPrefix("sync");
+
+    const int overWriteEnvironmentVariable = 1;
+    gmxSetenv(c_asyncOutputEnvironmentVariable, "ON", overWriteEnvironmentVariable);
+
+    const std::string asyncLog = runWithOutputPrefix("async");
+
+    gmxUnsetenv(c_asyncOutputEnvironmentVariable);
+    if (environmentVariableBackup != nullptr)
+    {
+        gmxSetenv(c_asyncOutputEnvironmentVariable,
+                  environmentVariableBackup,
+                  overWriteEnvironmentVariable);
+    }
+
+    EXPECT_EQ(std::string::npos, syncLog.find(c_asyncOutputLogLine));
+    EXPECT_NE(std::string::npos, asyncLog.find(c_asyncOutputLogLine));
+
+    // The dynamics do not depend on how the frames are written, so
+    // all frames must be identical and present in both files. Not all
+    // .trr frames contain positions, velocities and forces.
+    TrajectoryFrameMatchSettings trajectoryMatchSettings;
+    trajectoryMatchSettings.mustCompareBox        = true;
+    trajectoryMatchSettings.handlePbcIfPossible   = false;
+    trajectoryMatchSettings.coordinatesComparison = ComparisonConditions::CompareIfReferenceFound;
+    trajectoryMatchSettings.velocitiesComparison  = ComparisonConditions::CompareIfReferenceFound;
+    trajectoryMatchSettings.forcesComparison      = ComparisonConditions::CompareIfReferenceFound;
+    const TrajectoryTolerances trajectoryTolerances{
+        ulpTolerance(0), ulpTolerance(0), ulpTolerance(0), ulpTolerance(0)
+    };
+    const TrajectoryComparison trajectoryComparison{ trajectoryMatchSettings,
+                                                     trajectoryTolerances };
+
+    compareTrajectories(fileManager_.getTemporaryFilePath("sync.trr"),
+                        fileManager_.getTemporaryFilePath("async.trr"),
+                        trajectoryComparison);
+    compareTrajectories(fileManager_.getTemporaryFilePath("sync.xtc"),
+                        fileManager_.getTemporaryFilePath("async.xtc"),
+                        trajectoryComparison);
+}
+
+INSTANTIATE_TEST_CASE_P(WithSimulations,
+                        AsyncTrajectoryOutputTest,
+                        ::testing::Values("argon12", "tip3p5"));
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -46,9 +46,16 @@
 
 #include <gtest/gtest.h>
 
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/stringutil.h"
+
 #include "testutils/cmdlinetest.h"
+#include "testutils/mpitest.h"
+#include "testutils/setenv.h"
+#include "testutils/simulationdatabase.h"
 
 #include "moduletest.h"
+#include "simulatorcomparison.h"
 
 namespace
 {
@@ -74,4 +81,105 @@ TEST_F(DomainDecompositionSpecialCasesTest, AnEmptyDomainWorks)
     ASSERT_EQ(0, runner_.callMdrun());
 }
 
+/*! \brief Test fixture comparing DD runs with an optimization enabled and disabled
+ *
+ * The parameter is the environment variable that disables the
+ * optimization. Both runs must produce the same energies and
+ * trajectories, up to differences in the order of summation.
+ */
+class DomainDecompositionOptimizationTest :
+    public gmx::test::MdrunTestFixture,
+    public ::testing::WithParamInterface<std::string>
+{
+};
+
+TEST_P(DomainDecompositionOptimizationTest, GivesSameResultsAsWithoutIt)
+{
+    using namespace gmx::test;
+
+    const std::string& environmentVariable = GetParam();
+    const std::string  simulationName      = "alanine_vsite_solvated";
+
+    const int numRanksAvailable = getNumberOfTestMpiRanks();
+    if (!isNumberOfPpRanksSupported(simulationName, numRanksAvailable))
+    {
+        fprintf(stdout,
+                "Test system '%s' cannot run with %d ranks.\n"
+                "The supported numbers are: %s\n",
+                simulationName.c_str(),
+                numRanksAvailable,
+                reportNumbersOfPpRanksSupported(simulationName).c_str());
+        return;
+    }
+
+    SCOPED_TRACE(gmx::formatString("Comparing two simulations of '%s' switching environment variable '%s'",
+                                   simulationName.c_str(),
+                                   environmentVariable.c_str()));
+
+    // Repartition often, so that the later partitionings can reuse
+    // the state of the earlier ones.
+    auto mdpFieldValues       = prepareMdpFieldValues(simulationName.c_str(), "md", "no", "no");
+    mdpFieldValues["nsteps"]  = "20";
+    mdpFieldValues["nstlist"] = "2";
+
+    const EnergyTermsToCompare energyTermsToCompare{ {
+            { interaction_function[F_EPOT].longname, relativeToleranceAsPrecisionDependentUlp(60.0, 200, 160) },
+            { interaction_function[F_EKIN].longname, relativeToleranceAsPrecisionDependentUlp(60.0, 200, 160) },
+            { interaction_function[F_PRES].longname,
+              relativeToleranceAsPrecisionDependentFloatingPoint(10.0, 0.01, 0.001) },
+    } };
+
+    const TrajectoryFrameMatchSettings trajectoryMatchSettings{ true,
+                                                                true,
+                                                                true,
+                                                                ComparisonConditions::MustCompare,
+                                                                ComparisonConditions::MustCompare,
+                                                                ComparisonConditions::MustCompare,
+                                                                MaxNumFrames::compareAllFrames() };
+    TrajectoryTolerances trajectoryTolerances = TrajectoryComparison::s_defaultTrajectoryTolerances;
+    trajectoryTolerances.velocities           = trajectoryTolerances.coordinates;
+    const TrajectoryComparison trajectoryComparison{ trajectoryMatchSettings, trajectoryTolerances };
+
+    const auto optimizedTrajectoryFileName   = fileManager_.getTemporaryFilePath("sim1.trr");
+    const auto optimizedEdrFileName          = fileManager_.getTemporaryFilePath("sim1.edr");
+    const auto unoptimizedTrajectoryFileName = fileManager_.getTemporaryFilePath("sim2.trr");
+    const auto unoptimizedEdrFileName        = fileManager_.getTemporaryFilePath("sim2.edr");
+
+    runner_.tprFileName_ = fileManager_.getTemporaryFilePath("sim.tpr");
+    runner_.useTopGroAndNdxFromDatabase(simulationName);
+    runner_.useStringAsMdpFile(prepareMdpFileContents(mdpFieldValues));
+    runGrompp(&runner_);
+
+    const char* environmentVariableBackup = getenv(environmentVariable.c_str());
+    gmxUnsetenv(environmentVariable.c_str());
+
+    runner_.fullPrecisionTrajectoryFileName_ = optimizedTrajectoryFileName;
+    runner_.edrFileName_                     = optimizedEdrFileName;
+    runMdrun(&runner_);
+
+    const int overWriteEnvironmentVariable = 1;
+    gmxSetenv(environmentVariable.c_str(), "ON", overWriteEnvironmentVariable);
+
+    runner_.fullPrecisionTrajectoryFileName_ = unoptimizedTrajectoryFileName;
+    runner_.edrFileName_                     = unoptimizedEdrFileName;
+    runMdrun(&runner_);
+
+    gmxUnsetenv(environmentVariable.c_str());
+    if (environmentVariableBackup != nullptr)
+    {
+        gmxSetenv(environmentVariable.c_str(), environmentVariableBackup, overWriteEnvironmentVariable);
+    }
+
+    compareEnergies(optimizedEdrFileName, unoptimizedEdrFileName, energyTermsToCompare);
+    compareTrajectories(optimizedTrajectoryFileName, unoptimizedTrajectoryFileName, trajectoryComparison);
+}
+
+INSTANTIATE_TEST_CASE_P(IncrementalLocalTopology,
+                        DomainDecompositionOptimizationTest,
+                        ::testing::Values("GMX_DD_NO_INCREMENTAL_TOP"));
+
+INSTANTIATE_TEST_CASE_P(CpuHaloCommunicationOverlap,
+                        DomainDecompositionOptimizationTest,
+                        ::testing::Values("GMX_DD_NO_CPU_HALO_OVERLAP"));
+
 } // namespace
@@ -54,8 +54,10 @@
 #include "gromacs/topology/idef.h"
 #include "gromacs/trajectory/energyframe.h"
 #include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
 
 #include "testutils/mpitest.h"
+#include "testutils/setenv.h"
 #include "testutils/simulationdatabase.h"
 #include "testutils/testasserts.h"
 
@@ -210,13 +212,19 @@ private:
 };
 
 /*! \brief Run grompp for a normal mdrun, the same mdrun stopping part
- * way, doing a continuation, and compare the results. */
+ * way, doing a continuation, and compare the results.
+ *
+ * With \p writeCheckpointsAsynchronously the first part writes a checkpoint
+ * at every global communication step, with the checkpoint files synced and
+ * renamed on the output thread, and the continuation starts from the last
+ * of these checkpoints. */
 void runTest(TestFileManager*            fileManager,
              SimulationRunner*           runner,
              const std::string&          simulationName,
              int                         maxWarningsTolerated,
              const MdpFieldValues&       mdpFieldValues,
-             const EnergyTermsToCompare& energyTermsToCompare)
+             const EnergyTermsToCompare& energyTermsToCompare,
+             bool                        writeCheckpointsAsynchronously = false)
 {
     int numRanksAvailable = getNumberOfTestMpiRanks();
     if (!isNumberOfPpRanksSupported(simulationName, numRanksAvailable))
@@ -283,7 +291,34 @@ void runTest(TestFileManager*            fileManager,
         CommandLine firstPartRunCaller;
         firstPartRunCaller.append("mdrun");
         firstPartRunCaller.addOption("-cpo", firstPartRunCheckpointFileName);
-        ASSERT_EQ(0, runner->callMdrun(firstPartRunCaller));
+        if (writeCheckpointsAsynchronously)
+        {
+            const char* const asyncCheckpointEnvironmentVariable = "GMX_ASYNC_CHECKPOINT_OUTPUT";
+            const char* environmentVariableBackup = getenv(asyncCheckpointEnvironmentVariable);
+            const int   overWriteEnvironmentVariable = 1;
+            gmxSetenv(asyncCheckpointEnvironmentVariable, "ON", overWriteEnvironmentVariable);
+
+            firstPartRunCaller.addOption("-cpt", 0);
+            const int returnValue = runner->callMdrun(firstPartRunCaller);
+
+            gmxUnsetenv(asyncCheckpointEnvironmentVariable);
+            if (environmentVariableBackup != nullptr)
+            {
+                gmxSetenv(asyncCheckpointEnvironmentVariable,
+                          environmentVariableBackup,
+                          overWriteEnvironmentVariable);
+            }
+            ASSERT_EQ(0, returnValue);
+            EXPECT_NE(std::string::npos,
+                      TextReader::readFileToString(runner->logFileName_)
+                              .find("Checkpoint files will be synced to disk and renamed "
+                                    "asynchronously"))
+                    << "The first part should write checkpoints asynchronously";
+        }
+        else
+        {
+            ASSERT_EQ(0, runner->callMdrun(firstPartRunCaller));
+        }
     }
 
     // do a continuation (without appending) from the first part of
@@ -451,6 +486,49 @@ TEST_P(MdrunNoAppendContinuationIsExact, WithinTolerances)
     runTest(&fileManager_, &runner_, simulationName, numWarningsToTolerate, mdpFieldValues, energyTermsToCompare);
 }
 
+/*! \brief Test fixture for exact continuations from asynchronously written checkpoints
+ *
+ * The parameter is the integrator. */
+class MdrunAsyncCheckpointContinuationIsExact :
+    public MdrunTestFixture,
+    public ::testing::WithParamInterface<std::string>
+{
+};
+
+TEST_P(MdrunAsyncCheckpointContinuationIsExact, WithinTolerances)
+{
+    const std::string simulationName = "argon12";
+    const std::string integrator     = GetParam();
+
+    SCOPED_TRACE(formatString(
+            "Comparing normal and two-part run of simulation '%s' with integrator '%s' "
+            "restarting from an asynchronously written checkpoint",
+            simulationName.c_str(),
+            integrator.c_str()));
+
+    auto mdpFieldValues = prepareMdpFieldValues(simulationName, integrator, "v-rescale", "no");
+    mdpFieldValues["nsteps"] = "16";
+
+    // The checkpoint contents do not depend on how the file is written,
+    // so the continuation should be as exact as with synchronous writing.
+    const auto                 tolerance = relativeToleranceAsPrecisionDependentUlp(10.0, 32, 64);
+    const EnergyTermsToCompare energyTermsToCompare{
+        { { interaction_function[F_EPOT].longname, tolerance },
+          { interaction_function[F_EKIN].longname, tolerance },
+          { interaction_function[F_ECONSERVED].longname, tolerance } }
+    };
+
+    const int  numWarningsToTolerate          = 1;
+    const bool writeCheckpointsAsynchronously = true;
+    runTest(&fileManager_,
+            &runner_,
+            simulationName,
+            numWarningsToTolerate,
+            mdpFieldValues,
+            energyTermsToCompare,
+            writeCheckpointsAsynchronously);
+}
+
 // TODO The time for OpenCL kernel compilation means these tests time
 // out. Once that compilation is cached for the whole process, these
 // tests can run in such configurations.
@@ -524,6 +602,10 @@ INSTANTIATE_TEST_CASE_P(Awh,
                                            ::testing::Values("no"),
                                            ::testing::Values(MdpParameterDatabase::Awh)));
 
+INSTANTIATE_TEST_CASE_P(AsyncCheckpointing,
+                        MdrunAsyncCheckpointContinuationIsExact,
+                        ::testing::Values("md", "md-vv"));
+
 #endif
 
 } // namespace
@@ -320,7 +320,11 @@ int SimulationRunner::callMdrun(const CommandLine& callerRef)
 #endif
 
 #if GMX_OPENMP
-    caller.addOption("-ntomp", g_numOpenMPThreads);
+    // Tests can request a specific number of OpenMP threads
+    if (!caller.contains("-ntomp"))
+    {
+        caller.addOption("-ntomp", g_numOpenMPThreads);
+    }
 #endif
 
     return gmx_mdrun(MdrunTestFixtureBase::communicator_,
@@ -45,7 +45,13 @@
 
 #include "config.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
 #include <regex>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -57,6 +63,7 @@
 #include "gromacs/utility/stringutil.h"
 
 #include "testutils/refdata.h"
+#include "testutils/setenv.h"
 #include "testutils/testfilemanager.h"
 
 #include "energycomparison.h"
@@ -77,6 +84,566 @@ TEST_P(ReplicaExchangeEnsembleTest, ExitsNormally)
     runExitsNormallyTest();
 }
 
+/*! \brief Returns the mdp contents for replica exchange of lambda states
+ *
+ * All simulations have the same temperature and pressure. Over the
+ * lambda states, the charges of the waters are scaled by so little
+ * that nearly all exchange attempts are accepted.
+ *
+ * \param params           The parameters of the multi-simulation test
+ * \param numSteps         Number of MD steps to perform
+ * \param numLambdaStates  The number of lambda states, one per simulation
+ * \param lambdaState      The initial lambda state of this simulation
+ */
+static std::string lambdaStateExchangeMdpContents(const MultiSimTestParams& params,
+                                                  int                       numSteps,
+                                                  int                       numLambdaStates,
+                                                  int                       lambdaState)
+{
+    std::string fepLambdas;
+    for (int state = 0; state < numLambdaStates; state++)
+    {
+        fepLambdas += formatString(" %g", 1e-4 * state);
+    }
+    return formatString(
+            "integrator = %s\n"
+            "tcoupl = %s\n"
+            "pcoupl = %s\n"
+            "nsteps = %d\n"
+            "nstlog = 1\n"
+            "nstcalcenergy = 1\n"
+            "nstenergy = 1\n"
+            "tc-grps = System\n"
+            "tau-t = 1\n"
+            "ref-t = 298\n"
+            "tau-p = 2\n"
+            "ref-p = 1\n"
+            "compressibility = 4.5e-5\n"
+            "gen-vel = yes\n"
+            "gen-temp = 298\n"
+            "rcoulomb = 0.7\n"
+            "rvdw = 0.7\n"
+            "free-energy = yes\n"
+            "couple-moltype = SOL\n"
+            "couple-lambda0 = vdw-q\n"
+            "couple-lambda1 = vdw\n"
+            "fep-lambdas =%s\n"
+            "init-lambda-state = %d\n"
+            "nstdhdl = 1\n",
+            enumValueToString(std::get<1>(params)),
+            enumValueToString(std::get<2>(params)),
+            enumValueToString(std::get<3>(params)),
+            numSteps,
+            fepLambdas.c_str(),
+            lambdaState);
+}
+
+/*! \brief Runs grompp for replica exchange of lambda states
+ *
+ * Simulation i starts in lambda state i. Adds an MPI barrier to ensure
+ * that all ranks have written before returning.
+ */
+static void runGromppForLambdaStateExchange(const MultiSimTest& test,
+                                            SimulationRunner*   runner,
+                                            int                 numSteps)
+{
+    if (test.rank_ % test.numRanksPerSimulation_ == 0)
+    {
+        const int numSimulations = test.size_ / test.numRanksPerSimulation_;
+        runner->useStringAsMdpFile(lambdaStateExchangeMdpContents(
+                test.GetParam(), numSteps, numSimulations, test.simulationNumber_));
+        EXPECT_EQ(0, runner->callGromppOnThisRank());
+    }
+
+#if GMX_LIB_MPI
+    MPI_Barrier(MdrunTestFixtureBase::communicator_);
+#endif
+}
+
+//! Output of replica exchange of lambda states in a log file
+struct LambdaStateExchangeLog
+{
+    //! The simulations in lambda order before each exchange between neighbors
+    std::vector<std::vector<int>> simulations;
+    //! Whether the pair of neighbors i-1 and i was swapped, for each exchange between neighbors
+    std::vector<std::vector<bool>> swapped;
+    //! The lambda states of all simulations after each exchange
+    std::vector<std::vector<int>> statesAfterExchange;
+    //! The number of exchange attempts in the statistics, -1 when not printed
+    int numAttempts = -1;
+    //! The number of exchanges of each pair of neighbors in the statistics
+    std::vector<int> numExchanges;
+};
+
+//! Returns the integers in \p text separated by white space
+static std::vector<int> parseIntegers(const std::string& text)
+{
+    std::vector<int> values;
+    for (const auto& token : splitString(text))
+    {
+        values.push_back(std::stoi(token));
+    }
+    return values;
+}
+
+//! Reads the output of replica exchange of lambda states from a log file
+static LambdaStateExchangeLog readLambdaStateExchangeLog(const std::string& logFileName)
+{
+    const std::string      statesLine = "Repl  lambda states of the simulations after exchange:";
+    TextInputFile          logFile(logFileName);
+    LambdaStateExchangeLog log;
+    std::string            line;
+    while (logFile.readLine(&line))
+    {
+        if (startsWith(line, "Repl ex "))
+        {
+            // The simulations in lambda order with 'x' between swapped neighbors
+            std::vector<int>  simulations;
+            std::vector<bool> swapped(1, false);
+            bool              isSwapped = false;
+            for (const auto& token : splitString(line.substr(std::strlen("Repl ex "))))
+            {
+                if (token == "x")
+                {
+                    isSwapped = true;
+                }
+                else
+                {
+                    if (!simulations.empty())
+                    {
+                        swapped.push_back(isSwapped);
+                    }
+                    simulations.push_back(std::stoi(token));
+                    isSwapped = false;
+                }
+            }
+            log.simulations.push_back(simulations);
+            log.swapped.push_back(swapped);
+        }
+        else if (startsWith(line, statesLine))
+        {
+            log.statesAfterExchange.push_back(parseIntegers(line.substr(statesLine.size())));
+        }
+        else if (startsWith(line, "Repl ") && endsWith(stripString(line), "even"))
+        {
+            log.numAttempts = std::stoi(splitString(line)[1]);
+        }
+        else if (startsWith(line, "Repl  number of exchanges:"))
+        {
+            // Skip the line with the replica indices, the counts follow
+            logFile.readLine(&line);
+            logFile.readLine(&line);
+            log.numExchanges = parseIntegers(line.substr(std::strlen("Repl ")));
+        }
+    }
+    return log;
+}
+
+/*! \brief Checks the log of exchanges between neighbor lambda states
+ *
+ * Simulation i starts in lambda state \p states[i]. The lambda states
+ * after each exchange should follow from the swaps of neighbors, and
+ * the statistics should match the exchanges.
+ *
+ * \returns the lambda states of the simulations after the last exchange
+ */
+static std::vector<int> checkNeighborLambdaStateExchanges(const LambdaStateExchangeLog& log,
+                                                          std::vector<int>              states)
+{
+    const int numSimulations = static_cast<int>(states.size());
+
+    EXPECT_EQ(log.simulations.size(), log.statesAfterExchange.size());
+    EXPECT_EQ(int(log.simulations.size()), log.numAttempts);
+    std::vector<int> numExchanges(numSimulations - 1, 0);
+    for (size_t exchange = 0; exchange < log.simulations.size(); exchange++)
+    {
+        const auto& simulations = log.simulations[exchange];
+        const auto& swapped     = log.swapped[exchange];
+        EXPECT_EQ(numSimulations, int(simulations.size()));
+        EXPECT_EQ(numSimulations, int(swapped.size()));
+        for (int i = 0; i < std::min(numSimulations, int(simulations.size())); i++)
+        {
+            EXPECT_EQ(i, states[simulations[i]]) << "Simulations should be listed in lambda order";
+        }
+        for (int i = 1; i < std::min(numSimulations, int(swapped.size())); i++)
+        {
+            if (swapped[i])
+            {
+                std::swap(states[simulations[i - 1]], states[simulations[i]]);
+                numExchanges[i - 1]++;
+                // Only pairs of neighbors that do not overlap are attempted together
+                EXPECT_FALSE(swapped[i - 1]);
+            }
+        }
+        if (exchange < log.statesAfterExchange.size())
+        {
+            EXPECT_EQ(states, log.statesAfterExchange[exchange]);
+        }
+    }
+    EXPECT_EQ(numExchanges, log.numExchanges);
+
+    return states;
+}
+
+//! Returns the lambda states written to a dhdl file, one per output step
+static std::vector<int> readLambdaStatesFromDhdlFile(const std::string& dhdlFileName)
+{
+    TextInputFile    dhdlFile(dhdlFileName);
+    std::vector<int> states;
+    bool             haveStateLegend = false;
+    std::string      line;
+    while (dhdlFile.readLine(&line))
+    {
+        if (startsWith(line, "@"))
+        {
+            haveStateLegend = haveStateLegend || contains(line, "Thermodynamic state");
+        }
+        else if (!startsWith(line, "#"))
+        {
+            // The lambda state follows the time
+            states.push_back(std::stoi(splitString(line).at(1)));
+        }
+    }
+    EXPECT_TRUE(haveStateLegend) << "The lambda state should be written to " << dhdlFileName;
+    return states;
+}
+
+/*! \brief Checks the lambda states in the dhdl output against the exchanges
+ *
+ * The state after an exchange is used from the step after the exchange.
+ * With lagged exchanges, the exchanges are done \p exchangeLag steps
+ * after the exchange steps.
+ */
+static void checkDhdlLambdaStates(const std::vector<int>&              dhdlStates,
+                                  int                                  initialState,
+                                  const std::vector<std::vector<int>>& statesAfterExchange,
+                                  int                                  simulationNumber,
+                                  int                                  exchangePeriod,
+                                  int                                  exchangeLag = 0)
+{
+    for (size_t step = 0; step < dhdlStates.size(); step++)
+    {
+        const size_t numExchangesBefore =
+                (step <= size_t(exchangeLag))
+                        ? 0
+                        : std::min((step - 1 - exchangeLag) / exchangePeriod,
+                                   statesAfterExchange.size());
+        const int expectedState =
+                (numExchangesBefore == 0)
+                        ? initialState
+                        : statesAfterExchange[numExchangesBefore - 1][simulationNumber];
+        EXPECT_EQ(expectedState, dhdlStates[step]) << "at step " << step;
+    }
+}
+
+TEST_P(ReplicaExchangeEnsembleTest, ExchangesNeighborLambdaStates)
+{
+    if (!mpiSetupValid())
+    {
+        // Can't test multi-sim without multiple simulations
+        return;
+    }
+
+    const int numSteps       = 16;
+    const int exchangePeriod = 4;
+    const int numSimulations = size_ / numRanksPerSimulation_;
+
+    SimulationRunner runner(&fileManager_);
+    runner.useTopGroAndNdxFromDatabase("spc2");
+    runner.dhdlFileName_ = fileManager_.getTemporaryFilePath(".xvg");
+    runGromppForLambdaStateExchange(*this, &runner, numSteps);
+
+    mdrunCaller_->addOption("-replex", exchangePeriod);
+    mdrunCaller_->append("-replexstates");
+    ASSERT_EQ(0, runner.callMdrun(*mdrunCaller_));
+
+    if (rank_ % numRanksPerSimulation_ == 0)
+    {
+        std::vector<int> initialStates(numSimulations);
+        std::iota(initialStates.begin(), initialStates.end(), 0);
+        const auto log = readLambdaStateExchangeLog(runner.logFileName_);
+        EXPECT_EQ(size_t((numSteps - 1) / exchangePeriod), log.simulations.size());
+        checkNeighborLambdaStateExchanges(log, initialStates);
+        // Nearly all exchanges are accepted, as the states hardly differ
+        EXPECT_GT(std::accumulate(log.numExchanges.begin(), log.numExchanges.end(), 0), 0);
+
+        checkDhdlLambdaStates(readLambdaStatesFromDhdlFile(runner.dhdlFileName_),
+                              simulationNumber_,
+                              log.statesAfterExchange,
+                              simulationNumber_,
+                              exchangePeriod);
+    }
+
+#if GMX_LIB_MPI
+    // Make sure testing is complete before returning - ranks delete temporary files on exit
+    MPI_Barrier(MdrunTestFixtureBase::communicator_);
+#endif
+}
+
+TEST_P(ReplicaExchangeEnsembleTest, GibbsSamplesLambdaStates)
+{
+    if (!mpiSetupValid())
+    {
+        // Can't test multi-sim without multiple simulations
+        return;
+    }
+
+    const int numSteps       = 16;
+    const int exchangePeriod = 4;
+    const int numSimulations = size_ / numRanksPerSimulation_;
+
+    SimulationRunner runner(&fileManager_);
+    runner.useTopGroAndNdxFromDatabase("spc2");
+    runner.dhdlFileName_ = fileManager_.getTemporaryFilePath(".xvg");
+    runGromppForLambdaStateExchange(*this, &runner, numSteps);
+
+    mdrunCaller_->addOption("-replex", exchangePeriod);
+    mdrunCaller_->addOption("-nex", 10 * numSimulations);
+    mdrunCaller_->append("-replexstates");
+    ASSERT_EQ(0, runner.callMdrun(*mdrunCaller_));
+
+    if (rank_ % numRanksPerSimulation_ == 0)
+    {
+        const auto log = readLambdaStateExchangeLog(runner.logFileName_);
+        // Gibbs sampling reports neither the pairs nor the statistics of neighbors
+        EXPECT_TRUE(log.simulations.empty());
+        EXPECT_EQ(-1, log.numAttempts);
+        EXPECT_EQ(size_t((numSteps - 1) / exchangePeriod), log.statesAfterExchange.size());
+        std::vector<int> allStates(numSimulations);
+        std::iota(allStates.begin(), allStates.end(), 0);
+        for (auto states : log.statesAfterExchange)
+        {
+            std::sort(states.begin(), states.end());
+            EXPECT_EQ(allStates, states) << "Each lambda state should be sampled by one simulation";
+        }
+
+        checkDhdlLambdaStates(readLambdaStatesFromDhdlFile(runner.dhdlFileName_),
+                              simulationNumber_,
+                              log.statesAfterExchange,
+                              simulationNumber_,
+                              exchangePeriod);
+    }
+
+#if GMX_LIB_MPI
+    // Make sure testing is complete before returning - ranks delete temporary files on exit
+    MPI_Barrier(MdrunTestFixtureBase::communicator_);
+#endif
+}
+
+TEST_P(ReplicaExchangeEnsembleTest, KeepsLambdaStatesOverCheckpointRestart)
+{
+    if (!mpiSetupValid())
+    {
+        // Can't test multi-sim without multiple simulations
+        return;
+    }
+
+    const int numSteps       = 16;
+    const int exchangePeriod = 4;
+    const int numSimulations = size_ / numRanksPerSimulation_;
+
+    SimulationRunner runner(&fileManager_);
+    runner.useTopGroAndNdxFromDatabase("spc2");
+    runner.dhdlFileName_ = fileManager_.getTemporaryFilePath(".xvg");
+    runner.cptFileName_  = fileManager_.getTemporaryFilePath(".cpt");
+    runGromppForLambdaStateExchange(*this, &runner, numSteps);
+
+    mdrunCaller_->addOption("-replex", exchangePeriod);
+    mdrunCaller_->append("-replexstates");
+
+    // The first part ends after the first exchange
+    CommandLine firstPart(*mdrunCaller_);
+    firstPart.addOption("-nsteps", numSteps / 2);
+    firstPart.addOption("-cpo", runner.cptFileName_);
+    ASSERT_EQ(0, runner.callMdrun(firstPart));
+
+    CommandLine secondPart(*mdrunCaller_);
+    secondPart.addOption("-cpi", runner.cptFileName_);
+    secondPart.append("-noappend");
+    ASSERT_EQ(0, runner.callMdrun(secondPart));
+
+    if (rank_ % numRanksPerSimulation_ == 0)
+    {
+        std::vector<int> initialStates(numSimulations);
+        std::iota(initialStates.begin(), initialStates.end(), 0);
+        const auto firstLog = readLambdaStateExchangeLog(runner.logFileName_);
+        ASSERT_FALSE(firstLog.statesAfterExchange.empty());
+        const auto checkpointedStates = checkNeighborLambdaStateExchanges(firstLog, initialStates);
+        const auto firstDhdlStates = readLambdaStatesFromDhdlFile(runner.dhdlFileName_);
+
+        // The continuation starts from the lambda states at the end of the first part
+        const auto secondLog = readLambdaStateExchangeLog(
+                fileManager_.getTemporaryFilePath(".part0002.log"));
+        checkNeighborLambdaStateExchanges(secondLog, checkpointedStates);
+        const auto secondDhdlStates =
+                readLambdaStatesFromDhdlFile(fileManager_.getTemporaryFilePath(".part0002.xvg"));
+        ASSERT_FALSE(firstDhdlStates.empty());
+        ASSERT_FALSE(secondDhdlStates.empty());
+        EXPECT_EQ(checkpointedStates[simulationNumber_], firstDhdlStates.back());
+        EXPECT_EQ(checkpointedStates[simulationNumber_], secondDhdlStates.front());
+    }
+
+#if GMX_LIB_MPI
+    // Make sure testing is complete before returning - ranks delete temporary files on exit
+    MPI_Barrier(MdrunTestFixtureBase::communicator_);
+#endif
+}
+
+namespace
+{
+
+//! The environment variable that enables lagged replica exchange
+const char* const c_laggedReplicaExchangeEnvironmentVariable = "GMX_REPLEX_ASYNC";
+
+/*! \brief Enables lagged replica exchange in its scope
+ *
+ * Restores the previous value of the environment variable on destruction.
+ */
+class LaggedReplicaExchangeEnabler
+{
+public:
+    //! Sets the environment variable
+    LaggedReplicaExchangeEnabler()
+    {
+        const char* value = getenv(c_laggedReplicaExchangeEnvironmentVariable);
+        if (value != nullptr)
+        {
+            backup_ = value;
+        }
+        haveBackup_ = (value != nullptr);
+        gmxSetenv(c_laggedReplicaExchangeEnvironmentVariable, "1", 1);
+    }
+    //! Restores the environment variable
+    ~LaggedReplicaExchangeEnabler()
+    {
+        gmxUnsetenv(c_laggedReplicaExchangeEnvironmentVariable);
+        if (haveBackup_)
+        {
+            gmxSetenv(c_laggedReplicaExchangeEnvironmentVariable, backup_.c_str(), 1);
+        }
+    }
+
+private:
+    //! The previous value of the environment variable
+    std::string backup_;
+    //! Whether the environment variable was set
+    bool haveBackup_;
+};
+
+} // namespace
+
+TEST_P(ReplicaExchangeEnsembleTest, LaggedExchangesNeighborLambdaStates)
+{
+    if (!mpiSetupValid())
+    {
+        // Can't test multi-sim without multiple simulations
+        return;
+    }
+
+    const int numSteps       = 16;
+    const int exchangePeriod = 4;
+    const int numSimulations = size_ / numRanksPerSimulation_;
+
+    LaggedReplicaExchangeEnabler laggedReplicaExchangeEnabler;
+
+    SimulationRunner runner(&fileManager_);
+    runner.useTopGroAndNdxFromDatabase("spc2");
+    runner.dhdlFileName_ = fileManager_.getTemporaryFilePath(".xvg");
+    runGromppForLambdaStateExchange(*this, &runner, numSteps);
+
+    mdrunCaller_->addOption("-replex", exchangePeriod);
+    mdrunCaller_->append("-replexstates");
+    ASSERT_EQ(0, runner.callMdrun(*mdrunCaller_));
+
+    if (rank_ % numRanksPerSimulation_ == 0)
+    {
+        std::vector<int> initialStates(numSimulations);
+        std::iota(initialStates.begin(), initialStates.end(), 0);
+        const auto log = readLambdaStateExchangeLog(runner.logFileName_);
+        // The exchange posted at the last exchange step is done at the next step
+        EXPECT_EQ(size_t((numSteps - 1) / exchangePeriod), log.simulations.size());
+        checkNeighborLambdaStateExchanges(log, initialStates);
+        EXPECT_GT(std::accumulate(log.numExchanges.begin(), log.numExchanges.end(), 0), 0);
+
+        const int exchangeLag = 1;
+        checkDhdlLambdaStates(readLambdaStatesFromDhdlFile(runner.dhdlFileName_),
+                              simulationNumber_,
+                              log.statesAfterExchange,
+                              simulationNumber_,
+                              exchangePeriod,
+                              exchangeLag);
+    }
+
+#if GMX_LIB_MPI
+    // Make sure testing is complete before returning - ranks delete temporary files on exit
+    MPI_Barrier(MdrunTestFixtureBase::communicator_);
+#endif
+}
+
+TEST_P(ReplicaExchangeEnsembleTest, LaggedExchangesContinueOverCheckpointRestart)
+{
+    if (!mpiSetupValid())
+    {
+        // Can't test multi-sim without multiple simulations
+        return;
+    }
+
+    const int numSteps       = 16;
+    const int exchangePeriod = 4;
+    const int numSimulations = size_ / numRanksPerSimulation_;
+
+    LaggedReplicaExchangeEnabler laggedReplicaExchangeEnabler;
+
+    SimulationRunner runner(&fileManager_);
+    runner.useTopGroAndNdxFromDatabase("spc2");
+    runner.dhdlFileName_ = fileManager_.getTemporaryFilePath(".xvg");
+    runner.cptFileName_  = fileManager_.getTemporaryFilePath(".cpt");
+    runGromppForLambdaStateExchange(*this, &runner, numSteps);
+
+    mdrunCaller_->addOption("-replex", exchangePeriod);
+    mdrunCaller_->append("-replexstates");
+
+    // The first part ends one step after an exchange step, which is when
+    // the lagged exchange would be done, but the exchange data of that
+    // exchange step is not posted as it is the step before the last step
+    const int numStepsFirstPart = 2 * exchangePeriod + 1;
+    CommandLine firstPart(*mdrunCaller_);
+    firstPart.addOption("-nsteps", numStepsFirstPart);
+    firstPart.addOption("-cpo", runner.cptFileName_);
+    ASSERT_EQ(0, runner.callMdrun(firstPart));
+
+    // The continuation starts at the step where the lagged exchange would
+    // be done, without data posted in this run
+    CommandLine secondPart(*mdrunCaller_);
+    secondPart.addOption("-cpi", runner.cptFileName_);
+    secondPart.append("-noappend");
+    ASSERT_EQ(0, runner.callMdrun(secondPart));
+
+    if (rank_ % numRanksPerSimulation_ == 0)
+    {
+        std::vector<int> initialStates(numSimulations);
+        std::iota(initialStates.begin(), initialStates.end(), 0);
+        const auto firstLog = readLambdaStateExchangeLog(runner.logFileName_);
+        EXPECT_EQ(1U, firstLog.simulations.size());
+        const auto checkpointedStates = checkNeighborLambdaStateExchanges(firstLog, initialStates);
+
+        // Only the exchange step after the restart leads to an exchange
+        const auto secondLog = readLambdaStateExchangeLog(
+                fileManager_.getTemporaryFilePath(".part0002.log"));
+        EXPECT_EQ(1U, secondLog.simulations.size());
+        checkNeighborLambdaStateExchanges(secondLog, checkpointedStates);
+        const auto secondDhdlStates =
+                readLambdaStatesFromDhdlFile(fileManager_.getTemporaryFilePath(".part0002.xvg"));
+        ASSERT_FALSE(secondDhdlStates.empty());
+        EXPECT_EQ(checkpointedStates[simulationNumber_], secondDhdlStates.front());
+    }
+
+#if GMX_LIB_MPI
+    // Make sure testing is complete before returning - ranks delete temporary files on exit
+    MPI_Barrier(MdrunTestFixtureBase::communicator_);
+#endif
+}
+
 /* Note, not all preprocessor implementations nest macro expansions
    the same way / at all, if we would try to duplicate less code. */
 
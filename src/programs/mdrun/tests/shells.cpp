@@ -0,0 +1,303 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ * \brief
+ * Tests that the threaded and extrapolated shell relaxation and the
+ * extended-Lagrangian shell propagation agree with the serial relaxation
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/mpitest.h"
+#include "testutils/setenv.h"
+#include "testutils/simulationdatabase.h"
+#include "testutils/testasserts.h"
+
+#include "moduletest.h"
+#include "simulatorcomparison.h"
+#include "trajectorycomparison.h"
+#include "trajectoryreader.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The simulation with shells used in these tests
+const std::string c_simulationName = "sw16";
+
+//! The number of atoms per SW water molecule, the shell is the last atom
+constexpr int c_numAtomsPerMolecule = 5;
+
+//! The environment variable that turns on extrapolation of the shell positions
+const char* const c_extrapolateEnvironmentVariable = "GMX_SHELL_EXTRAPOLATE";
+
+//! The text preceding the average number of force evaluations in the log file
+const char* const c_forceEvaluationsLogText = "Average number of force evaluations per MD step:";
+
+//! Returns the average number of force evaluations per step reported in \p log
+double averageNumberOfForceEvaluations(const std::string& log)
+{
+    const size_t position = log.find(c_forceEvaluationsLogText);
+    if (position == std::string::npos)
+    {
+        ADD_FAILURE() << "The log file does not report the number of force evaluations";
+        return 0;
+    }
+    return std::strtod(log.c_str() + position + std::strlen(c_forceEvaluationsLogText), nullptr);
+}
+
+//! Test fixture for mdrun with shells
+class ShellPropagationTest : public MdrunTestFixture
+{
+public:
+    //! Runs grompp with time step \p timeStep and extra \p mdpFields
+    void runGrompp(const std::string& timeStep, const MdpFieldValues& mdpFields = {})
+    {
+        auto mdpFieldValues = prepareMdpFieldValues(c_simulationName, "md", "no", "no");
+        mdpFieldValues["nsteps"]   = "20";
+        mdpFieldValues["dt"]       = timeStep;
+        mdpFieldValues["nstxout"]  = "4";
+        mdpFieldValues["nstvout"]  = "0";
+        mdpFieldValues["nstfout"]  = "0";
+        mdpFieldValues["emtol"]    = "1";
+        mdpFieldValues["niter"]    = "50";
+        mdpFieldValues["gen-vel"]  = "yes";
+        mdpFieldValues["gen-temp"] = "300";
+        mdpFieldValues["gen-seed"] = "1993";
+        for (const auto& field : mdpFields)
+        {
+            mdpFieldValues[field.first] = field.second;
+        }
+
+        runner_.useTopG96AndNdxFromDatabase(c_simulationName);
+        runner_.useStringAsMdpFile(prepareMdpFileContents(mdpFieldValues));
+        ASSERT_EQ(0, runner_.callGrompp());
+    }
+
+    /*! \brief Runs mdrun writing to files starting with \p prefix
+     *
+     * Uses \p numOpenMPThreads OpenMP threads, or the default number
+     * of threads when zero is passed.
+     *
+     * \returns the contents of the log file.
+     */
+    std::string runMdrun(const std::string& prefix, int numOpenMPThreads = 0)
+    {
+        runner_.fullPrecisionTrajectoryFileName_ =
+                fileManager_.getTemporaryFilePath(prefix + ".trr");
+        runner_.edrFileName_ = fileManager_.getTemporaryFilePath(prefix + ".edr");
+        runner_.logFileName_ = fileManager_.getTemporaryFilePath(prefix + ".log");
+
+        CommandLine caller;
+        if (numOpenMPThreads > 0)
+        {
+            caller.addOption("-ntomp", numOpenMPThreads);
+        }
+        EXPECT_EQ(0, runner_.callMdrun(caller));
+
+        return TextReader::readFileToString(runner_.logFileName_);
+    }
+
+    //! Compares the positions in the trajectories with prefixes \p reference and \p test
+    void comparePositions(const std::string& reference, const std::string& test, double tolerance)
+    {
+        TrajectoryFrameMatchSettings matchSettings;
+        matchSettings.mustCompareBox        = true;
+        matchSettings.handlePbcIfPossible   = false;
+        matchSettings.coordinatesComparison = ComparisonConditions::MustCompare;
+        matchSettings.velocitiesComparison  = ComparisonConditions::NoComparison;
+        matchSettings.forcesComparison      = ComparisonConditions::NoComparison;
+        const TrajectoryTolerances tolerances{ ulpTolerance(0),
+                                               absoluteTolerance(tolerance),
+                                               ulpTolerance(0),
+                                               ulpTolerance(0) };
+
+        compareTrajectories(fileManager_.getTemporaryFilePath(reference + ".trr"),
+                            fileManager_.getTemporaryFilePath(test + ".trr"),
+                            TrajectoryComparison{ matchSettings, tolerances });
+    }
+
+    //! Returns whether the test can run with the number of ranks of this test run
+    static bool canRunWithTheseRanks()
+    {
+        const int numRanks = getNumberOfTestMpiRanks();
+        if (!isNumberOfPpRanksSupported(c_simulationName, numRanks))
+        {
+            fprintf(stdout,
+                    "Test system '%s' cannot run with %d ranks.\n"
+                    "The supported numbers are: %s\n",
+                    c_simulationName.c_str(),
+                    numRanks,
+                    reportNumbersOfPpRanksSupported(c_simulationName).c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+#if GMX_OPENMP
+TEST_F(ShellPropagationTest, ThreadedRelaxationMatchesSerialRelaxation)
+{
+    if (!canRunWithTheseRanks())
+    {
+        return;
+    }
+
+    runGrompp("0.001");
+
+    const std::string serialLog   = runMdrun("serial", 1);
+    const std::string threadedLog = runMdrun("threaded", 3);
+
+    // The forces are reduced in a different order, so the positions and
+    // the number of iterations can differ slightly
+    comparePositions("serial", "threaded", 1e-4);
+    EXPECT_NEAR(averageNumberOfForceEvaluations(serialLog),
+                averageNumberOfForceEvaluations(threadedLog),
+                0.1);
+}
+#endif
+
+TEST_F(ShellPropagationTest, ExtrapolationMatchesPrediction)
+{
+    if (!canRunWithTheseRanks())
+    {
+        return;
+    }
+
+    runGrompp("0.001");
+
+    const char* environmentVariableBackup = getenv(c_extrapolateEnvironmentVariable);
+    gmxUnsetenv(c_extrapolateEnvironmentVariable);
+
+    const std::string predictedLog = runMdrun("predicted");
+
+    const int overWriteEnvironmentVariable = 1;
+    gmxSetenv(c_extrapolateEnvironmentVariable, "1", overWriteEnvironmentVariable);
+
+    const std::string extrapolatedLog = runMdrun("extrapolated");
+
+    gmxUnsetenv(c_extrapolateEnvironmentVariable);
+    if (environmentVariableBackup != nullptr)
+    {
+        gmxSetenv(c_extrapolateEnvironmentVariable,
+                  environmentVariableBackup,
+                  overWriteEnvironmentVariable);
+    }
+
+    EXPECT_NE(std::string::npos,
+              extrapolatedLog.find("Will predict shell positions by extrapolating"));
+
+    // Both relax the shells to within the force tolerance, so the positions
+    // agree within the tolerance divided by the shell force constant, which
+    // is much smaller than the tolerance used here
+    comparePositions("predicted", "extrapolated", 1e-4);
+
+    // Extrapolation should give a better initial guess for the shell positions
+    EXPECT_LE(averageNumberOfForceEvaluations(extrapolatedLog),
+              averageNumberOfForceEvaluations(predictedLog));
+}
+
+TEST_F(ShellPropagationTest, ExtendedLagrangianTracksRelaxedShells)
+{
+    if (!canRunWithTheseRanks())
+    {
+        return;
+    }
+
+    // The time step needs to be small compared to the oscillation period
+    // of the shells, which is about 5 fs with a shell mass of 0.4.
+    const std::string timeStep = "0.0005";
+
+    runGrompp(timeStep, { { "define", "-DDRUDE" } });
+    const std::string relaxedLog = runMdrun("relaxed");
+
+    runGrompp(timeStep,
+              { { "define", "-DDRUDE" },
+                { "shell-propagation", "extended-lagrangian" },
+                { "shell-ref-t", "1" },
+                { "shell-tau-t", "0.1" } });
+    const std::string extendedLog = runMdrun("extended");
+
+    EXPECT_NE(std::string::npos,
+              extendedLog.find("Will propagate the shells with an extended Lagrangian"));
+
+    // Without relaxation there is exactly one force evaluation per step
+    EXPECT_EQ(1.0, averageNumberOfForceEvaluations(extendedLog));
+    EXPECT_GT(averageNumberOfForceEvaluations(relaxedLog), 1.0);
+
+    // The shells start from unrelaxed positions and oscillate around
+    // the relaxed positions, the rest of the system follows closely
+    comparePositions("relaxed", "extended", 5e-3);
+
+    // The shells should stay close to their nuclei, the oxygens
+    TrajectoryFrameReader reader(fileManager_.getTemporaryFilePath("extended.trr"));
+    int                   numFrames = 0;
+    while (reader.readNextFrame())
+    {
+        const TrajectoryFrame frame = reader.frame();
+        const auto            x     = frame.x();
+        for (int oxygen = 0; oxygen < x.ssize(); oxygen += c_numAtomsPerMolecule)
+        {
+            const int shell = oxygen + c_numAtomsPerMolecule - 1;
+            EXPECT_LT(norm(x[shell] - x[oxygen]), 0.01)
+                    << "for shell " << shell << " in frame " << frame.frameName();
+        }
+        numFrames++;
+    }
+    EXPECT_GT(numFrames, 1);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -153,6 +153,8 @@ const MdpFileValues mdpFileValueDatabase_g{
     { "spc-dimer", { {}, { 1, 2, 3, 4, 5, 6 } } },
     // SW-Dimer for NMA
     { "sw-dimer", { { { "nstcalcenergy", "1" } }, { 1, 2, 3, 4, 5, 6 } } },
+    // 16 SW water molecules for shell dynamics, which only supports a single rank
+    { "sw16", { { { "nstcalcenergy", "1" } }, { 1 } } },
     // TIP5P for NMA
     { "one-tip5p", { {}, { 1, 2, 3, 4, 5, 6 } } },
     // ICE-Binding protein for NMA